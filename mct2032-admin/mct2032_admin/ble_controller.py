@@ -4,8 +4,9 @@ Handles Bluetooth LE communication with the ESP32 device
 """
 
 import asyncio
+import base64
 import logging
-from typing import Optional, Callable, Any, Dict
+from typing import Optional, Callable, Any, Dict, List
 from queue import Queue
 from bleak import BleakClient, BleakScanner
 from bleak.backends.device import BLEDevice
@@ -34,7 +35,17 @@ class BLEController:
         
         # For handling chunked responses
         self._chunked_data: Dict[str, Any] = {}
-        self._chunk_buffer: List[Any] = []
+        self._chunk_arrays: Dict[str, List[Any]] = {}
+        
+        # For joining a message split into parts
+        self._part_buffer = bytearray()
+        
+        # For collecting a streamed EXPORT_DATA
+        self._export_buffer = bytearray()
+        self._export_active = False
+        self._export_started = False
+        self._export_done = asyncio.Event()
+        self._export_result: Optional[Dict[str, Any]] = None
         
     async def scan_for_device(self, timeout: float = 10.0) -> Optional[BLEDevice]:
         """Scan for MCT2032 device"""
@@ -135,6 +146,19 @@ class BLEController:
             response = Protocol.parse_response(bytes(data))
             logger.info(f"Data notification received: {response}")
             
+            # A message longer than one notification arrives as base64 parts
+            if response.get("type") == "part":
+                seq = response.get("seq", 0)
+                total = response.get("total", 0)
+                if seq == 0:
+                    self._part_buffer = bytearray()
+                self._part_buffer.extend(base64.b64decode(response.get("data", "")))
+                if seq + 1 == total:
+                    joined = bytes(self._part_buffer)
+                    self._part_buffer = bytearray()
+                    self._handle_data_notification(sender, bytearray(joined))
+                return
+            
             # Handle chunked responses
             if response.get("type") == "chunk":
                 cmd = response.get("cmd", "UNKNOWN")
@@ -143,13 +167,18 @@ class BLEController:
                 
                 logger.info(f"Received chunk {chunk_index + 1}/{total_chunks} for {cmd}")
                 
-                # Store network data from chunk
-                if "network" in response:
-                    self._chunk_buffer.append(response["network"])
+                # Each chunk is one item of the array at the dotted path in key
+                if "item" in response:
+                    self._chunk_arrays.setdefault(response.get("key", ""), []).append(response["item"])
                 
                 # Don't trigger response event yet for chunks
                 return
             
+            # Export stream chunks carry base64 encoded bytes
+            if response.get("type") == "export":
+                self._export_buffer.extend(base64.b64decode(response.get("data", "")))
+                return
+            
             # Check if this is a response to a command
             if response.get("type") == "response":
                 # Log the command this response is for
@@ -157,18 +186,34 @@ class BLEController:
                 status = response.get("status", "")
                 logger.info(f"Response is for command: {cmd}, status: {status}")
                 
+                # A running export answers twice: once when it starts, once when it ends
+                if cmd == "EXPORT_DATA" and self._export_active:
+                    data_field = response.get("data", {})
+                    if "bytes_per_sec" in data_field or (status == "error" and self._export_started):
+                        self._finish_export(response)
+                        return
+                    if status == "success":
+                        self._export_started = True
+                
                 # Handle chunked response start
                 if status == "chunked":
                     logger.info(f"Starting chunked response for {cmd}")
-                    self._chunk_buffer = []
+                    self._chunk_arrays = {}
                     self._chunked_data = {"cmd": cmd}
                     return
                 
-                # Handle chunked response completion
-                if cmd in ["SCAN_WIFI", "SCAN_BLE"] and self._chunk_buffer:
-                    logger.info(f"Completing chunked response with {len(self._chunk_buffer)} networks")
-                    response["data"] = {"networks": self._chunk_buffer}
-                    self._chunk_buffer = []
+                # Handle chunked response completion: put the arrays back in place
+                if self._chunked_data.get("cmd") == cmd:
+                    data_field = response.setdefault("data", {})
+                    for key, items in self._chunk_arrays.items():
+                        target = data_field
+                        *parents, name = key.split(".")
+                        for parent in parents:
+                            target = target.setdefault(parent, {})
+                        target[name] = items
+                    logger.info(f"Completed chunked response for {cmd}")
+                    self._chunk_arrays = {}
+                    self._chunked_data = {}
                 
                 # Only store if we're waiting for a response
                 if not self._response_event.is_set():
@@ -187,6 +232,18 @@ class BLEController:
             logger.error(f"Error handling data notification: {e}")
             logger.error(f"Raw data: {data.hex()}")
     
+    def _finish_export(self, response: Dict[str, Any]):
+        """Complete a streamed export, attaching the collected bytes"""
+        if self._export_buffer:
+            response.setdefault("data", {})["blob"] = bytes(self._export_buffer)
+            self._export_buffer = bytearray()
+        self._export_result = response
+        self._export_active = False
+        self._export_done.set()
+        
+        if self.response_queue:
+            self.response_queue.put(("data", response))
+    
     def _handle_status_notification(self, sender: int, data: bytearray):
         """Handle status notifications from device"""
         try:
@@ -258,12 +315,22 @@ class BLEController:
         """Get device status"""
         return await self.send_command(Commands.GET_STATUS)
     
-    async def start_monitor(self, channel: int = 0) -> Optional[Dict[str, Any]]:
-        """Start packet monitoring"""
-        return await self.send_command(
-            Commands.MONITOR_START,
-            {"channel": channel}
-        )
+    async def start_monitor(self, channel: int = 0,
+                            capture_filter: Optional[Dict[str, Any]] = None,
+                            dedup: bool = False) -> Optional[Dict[str, Any]]:
+        """Start packet monitoring
+        
+        capture_filter keys: frames (e.g. ["beacon", "deauth", "data"]),
+        channels, rssi_min/rssi_max, len_min/len_max and macs
+        ([{"addr": ..., "mask": ..., "field": "any|src|dst|bssid"}])
+        dedup drops exact retransmissions before stats and capture
+        """
+        params = {"channel": channel}
+        if capture_filter:
+            params["filter"] = capture_filter
+        if dedup:
+            params["dedup"] = True
+        return await self.send_command(Commands.MONITOR_START, params)
     
     async def stop_monitor(self) -> Optional[Dict[str, Any]]:
         """Stop packet monitoring"""
@@ -276,10 +343,199 @@ class BLEController:
             {"channel": channel}
         )
     
-    async def export_data(self) -> Optional[Dict[str, Any]]:
-        """Export data to SD card"""
-        return await self.send_command(Commands.EXPORT_DATA)
+    async def export_data(self, target: str = "ble", fmt: str = "binary",
+                          filename: Optional[str] = None,
+                          timeout: float = 60.0) -> Optional[Dict[str, Any]]:
+        """Export collected data to SD or over BLE and wait for it to finish
+        
+        The final response reports bytes, elapsed_ms and bytes_per_sec; BLE
+        exports also carry the raw stream under data["blob"] (see
+        Protocol.parse_export for the binary format).
+        """
+        params: Dict[str, Any] = {"target": target, "format": fmt}
+        if filename:
+            params["filename"] = filename
+        
+        self._export_buffer = bytearray()
+        self._export_result = None
+        self._export_started = False
+        self._export_done.clear()
+        self._export_active = True
+        
+        response = await self.send_command(Commands.EXPORT_DATA, params)
+        if not response or response.get("status") != ResponseStatus.SUCCESS.value:
+            self._export_active = False
+            return response
+        
+        try:
+            await asyncio.wait_for(self._export_done.wait(), timeout=timeout)
+        except asyncio.TimeoutError:
+            logger.error("Timeout waiting for export to finish")
+            self._export_active = False
+            return None
+        return self._export_result
     
     async def clear_data(self) -> Optional[Dict[str, Any]]:
         """Clear all stored data"""
-        return await self.send_command(Commands.CLEAR_DATA)
\ No newline at end of file
+        return await self.send_command(Commands.CLEAR_DATA)
+    
+    async def channel_report(self) -> Optional[Dict[str, Any]]:
+        """Get per-channel occupancy and interference report"""
+        return await self.send_command(Commands.CHANNEL_REPORT)
+    
+    async def get_metrics(self, reset: bool = False) -> Optional[Dict[str, Any]]:
+        """Get command queue, storage and capture pipeline metrics
+        
+        Pipeline latency histograms are in CPU cycles (bucket i covers
+        2^i to 2^(i+1)-1); reset clears them after this report.
+        """
+        params = {"reset": True} if reset else None
+        return await self.send_command(Commands.GET_METRICS, params)
+    
+    async def top_talkers(self, kind: str = "tx", by: str = "frames",
+                          k: int = 10) -> Optional[Dict[str, Any]]:
+        """Get the loudest transmitters or BSSIDs over the sliding window
+        
+        kind is "tx" or "bssid", by is "frames" or "bytes". Each entry's
+        true value lies in [count - error_bound, count].
+        """
+        return await self.send_command(
+            Commands.TOP_TALKERS,
+            {"kind": kind, "by": by, "k": k}
+        )
+    
+    async def distinct_count(self, window_s: int = 3600,
+                             channels: Optional[List[int]] = None) -> Optional[Dict[str, Any]]:
+        """Estimate unique transmitters, probing clients and BSSIDs
+        
+        Covers whole five-minute slices back to at least window_s (the reply
+        gives the span actually covered), over all channels unless given.
+        """
+        params: Dict[str, Any] = {"window_s": window_s}
+        if channels:
+            params["channels"] = channels
+        return await self.send_command(Commands.DISTINCT_COUNT, params)
+    
+    async def assoc_graph(self, limit: int = 16,
+                          bssid: Optional[str] = None) -> Optional[Dict[str, Any]]:
+        """Get the busiest APs and station -> BSSID edges from data traffic
+        
+        Optionally only one AP and its stations. Edge "tids" is a bitmask
+        of the QoS TIDs the station has used.
+        """
+        params: Dict[str, Any] = {"limit": limit}
+        if bssid:
+            params["bssid"] = bssid
+        return await self.send_command(Commands.ASSOC_GRAPH, params)
+    
+    async def airtime(self, limit: int = 8) -> Optional[Dict[str, Any]]:
+        """Get channel utilization and airtime by frame class and BSSID
+        
+        util_10s and util_60s are percentages of the time spent listening
+        on each channel; BSSIDs are ranked by their share of all airtime
+        heard this session.
+        """
+        return await self.send_command(Commands.AIRTIME, {"limit": limit})
+    
+    async def phy_stats(self, channels: Optional[List[int]] = None) -> Optional[Dict[int, Dict[str, Any]]]:
+        """Get RSSI, noise floor, rate/MCS and bandwidth histograms per channel
+        
+        Only channels with frames are returned, over all channels unless given.
+        """
+        params: Dict[str, Any] = {}
+        if channels:
+            params["channels"] = channels
+        response = await self.send_command(Commands.PHY_STATS, params)
+        if not response or response.get("status") != ResponseStatus.SUCCESS.value:
+            return None
+        return Protocol.parse_phy_stats(base64.b64decode(response.get("data", {}).get("data", "")))
+    
+    async def probe_report(self, limit: int = 8, mac: Optional[str] = None) -> Optional[Dict[str, Any]]:
+        """Get the SSIDs clients probe for and the clients probing the most
+        
+        SSIDs are ranked by distinct clients. Each client lists up to eight
+        SSIDs by name; "overflow" counts further ones only known by hash.
+        Pass mac for one client instead of the ranking. "devices" sets raw
+        address counts beside estimated devices, with randomized addresses
+        clustered by probe element signature.
+        """
+        params: Dict[str, Any] = {"limit": limit}
+        if mac:
+            params["mac"] = mac
+        return await self.send_command(Commands.PROBE_REPORT, params)
+    
+    async def rogue_allow(self, ssid: str, bssids: List[str]) -> Optional[Dict[str, Any]]:
+        """Set the BSSIDs allowed to advertise an SSID
+        
+        Beacons or scan results for that SSID from any other BSSID raise an
+        "alert" status event. An empty list removes the SSID's allow-list.
+        """
+        return await self.send_command(
+            Commands.ROGUE_ALLOW,
+            {"ssid": ssid, "bssids": bssids}
+        )
+    
+    async def list_jobs(self) -> Optional[Dict[str, Any]]:
+        """List running jobs"""
+        return await self.send_command(Commands.JOB_LIST)
+    
+    async def cancel_job(self, job_id: int) -> Optional[Dict[str, Any]]:
+        """Cancel a running job"""
+        return await self.send_command(
+            Commands.JOB_CANCEL,
+            {"job_id": job_id}
+        )
+    
+    async def start_stats_stream(self, interval: int = 1000) -> Optional[Dict[str, Any]]:
+        """Stream monitor statistics while monitoring"""
+        return await self.send_command(
+            Commands.STATS_STREAM,
+            {"interval": interval}
+        )
+    
+    async def batch(self, commands: List[tuple], stop_on_error: bool = False) -> Optional[Dict[str, Any]]:
+        """Run several (Commands, params) pairs in a single write
+        
+        The results arrive one chunk each and are gathered back into
+        "results". A sub-result too large for one notification arrives as
+        its own response and is listed there with "separate": true.
+        """
+        batch = []
+        for cmd, params in commands:
+            entry = {"cmd": cmd.value}
+            if params:
+                entry["params"] = params
+            batch.append(entry)
+        return await self.send_command(
+            Commands.BATCH,
+            {"commands": batch, "stop_on_error": stop_on_error}
+        )
+    
+    async def arm_flight_recorder(self, triggers: Optional[List[str]] = None,
+                                  filename: str = "/flight.pcap", size_kb: int = 512,
+                                  pre_ms: int = 10000, post_ms: int = 5000,
+                                  mac: Optional[str] = None, rssi: int = -30,
+                                  deauth_count: int = 10,
+                                  deauth_window_ms: int = 1000) -> Optional[Dict[str, Any]]:
+        """Arm the pre-trigger capture ring; triggers are deauth, mac and rssi"""
+        params = {
+            "triggers": triggers or [],
+            "filename": filename,
+            "size_kb": size_kb,
+            "pre_ms": pre_ms,
+            "post_ms": post_ms,
+            "rssi": rssi,
+            "deauth_count": deauth_count,
+            "deauth_window_ms": deauth_window_ms
+        }
+        if mac:
+            params["mac"] = mac
+        return await self.send_command(Commands.FLIGHT_ARM, params)
+    
+    async def trigger_flight_recorder(self) -> Optional[Dict[str, Any]]:
+        """Dump the flight recorder window now"""
+        return await self.send_command(Commands.FLIGHT_TRIGGER)
+    
+    async def disarm_flight_recorder(self) -> Optional[Dict[str, Any]]:
+        """Disarm the flight recorder, discarding anything not yet written"""
+        return await self.send_command(Commands.FLIGHT_DISARM)
\ No newline at end of file
@@ -4,6 +4,8 @@ Python implementation for admin console
 """
 
 import json
+import struct
+import zlib
 from typing import Dict, Any, Optional, List
 from enum import Enum
 from dataclasses import dataclass, asdict
@@ -27,6 +29,19 @@ class Commands(Enum):
     EXPORT_DATA = "EXPORT_DATA"
     SET_MODE = "SET_MODE"
     CLEAR_DATA = "CLEAR_DATA"
+    CHANNEL_REPORT = "CHANNEL_REPORT"
+    GET_METRICS = "GET_METRICS"
+    JOB_LIST = "JOB_LIST"
+    JOB_CANCEL = "JOB_CANCEL"
+    STATS_STREAM = "STATS_STREAM"
+    BATCH = "BATCH"
+    TOP_TALKERS = "TOP_TALKERS"
+    DISTINCT_COUNT = "DISTINCT_COUNT"
+    ASSOC_GRAPH = "ASSOC_GRAPH"
+    AIRTIME = "AIRTIME"
+    PHY_STATS = "PHY_STATS"
+    PROBE_REPORT = "PROBE_REPORT"
+    ROGUE_ALLOW = "ROGUE_ALLOW"
     
     # Advanced commands
     DEAUTH_ATTACK = "DEAUTH_ATTACK"
@@ -37,6 +52,9 @@ class Commands(Enum):
     PCAP_START = "PCAP_START"
     PCAP_STOP = "PCAP_STOP"
     PACKET_INJECT = "PACKET_INJECT"
+    FLIGHT_ARM = "FLIGHT_ARM"
+    FLIGHT_TRIGGER = "FLIGHT_TRIGGER"
+    FLIGHT_DISARM = "FLIGHT_DISARM"
 
 
 class ResponseStatus(Enum):
@@ -46,6 +64,7 @@ class ResponseStatus(Enum):
     BUSY = "busy"
     INVALID_CMD = "invalid_command"
     TIMEOUT = "timeout"
+    PENDING = "pending"
 
 
 class ErrorCode(Enum):
@@ -128,6 +147,26 @@ class PacketStats:
     mgmt_count: int
 
 
+# Binary export (EXPORT_DATA format "binary"), see DataExporter.h on the device
+EXPORT_MAGIC = b"MCTX"
+EXPORT_SECTION_END = 0xFF
+EXPORT_SECTIONS = {
+    1: ("aps", {1: "bssid", 2: "ssid", 3: "channel", 4: "rssi", 5: "security", 6: "hidden"}),
+    2: ("stats", {1: "packets_total", 2: "packets_sec", 3: "beacons", 4: "probes",
+                  5: "deauths", 6: "data", 7: "mgmt"}),
+    3: ("channels", {1: "channel", 2: "ap_count", 3: "strongest_rssi", 4: "interference",
+                     5: "frames", 6: "frame_load"}),
+}
+EXPORT_VALUE_FORMATS = {1: "<B", 2: "<b", 3: "<H", 4: "<I"}
+EXPORT_TYPE_MAC = 5
+EXPORT_TYPE_STR = 6
+
+# PHY statistics blob (PHY_STATS), see PhyStats.h on the device
+PHY_BLOB_MAGIC = b"MCTP"
+PHY_RATE_NAMES = ["1M", "2M", "5.5M", "11M", "?", "2M-S", "5.5M-S", "11M-S",
+                  "48M", "24M", "12M", "6M", "54M", "36M", "18M", "9M"]
+
+
 class Protocol:
     """MCT2032 communication protocol handler"""
     
@@ -212,6 +251,102 @@ class Protocol:
             )
         return None
     
+    @staticmethod
+    def parse_export(blob: bytes) -> Dict[str, List[Dict[str, Any]]]:
+        """Decode a binary export into {section name: [row dicts]}"""
+        if blob[:4] != EXPORT_MAGIC:
+            raise ValueError("Not an MCT2032 export")
+        version, _, section_count, _ = struct.unpack_from("<BBHI", blob, 4)
+        if version != 1:
+            raise ValueError(f"Unsupported export version {version}")
+        
+        result: Dict[str, List[Dict[str, Any]]] = {}
+        pos = 12
+        while pos < len(blob):
+            section_id, column_count = blob[pos], blob[pos + 1]
+            if section_id == EXPORT_SECTION_END:
+                length, crc = struct.unpack_from("<II", blob, pos + 2)
+                if length != pos or zlib.crc32(blob[:pos]) != crc:
+                    raise ValueError("Export checksum mismatch")
+                return result
+            
+            row_count = struct.unpack_from("<I", blob, pos + 2)[0]
+            pos += 6
+            name, column_names = EXPORT_SECTIONS.get(section_id, (f"section_{section_id}", {}))
+            rows: List[Dict[str, Any]] = [{} for _ in range(row_count)]
+            
+            for _ in range(column_count):
+                column_id, value_type = blob[pos], blob[pos + 1]
+                pos += 2
+                column = column_names.get(column_id, f"column_{column_id}")
+                for row in rows:
+                    if value_type == EXPORT_TYPE_MAC:
+                        row[column] = ":".join(f"{b:02X}" for b in blob[pos:pos + 6])
+                        pos += 6
+                    elif value_type == EXPORT_TYPE_STR:
+                        length = blob[pos]
+                        row[column] = blob[pos + 1:pos + 1 + length].decode("utf-8", "replace")
+                        pos += 1 + length
+                    else:
+                        fmt = EXPORT_VALUE_FORMATS[value_type]
+                        row[column] = struct.unpack_from(fmt, blob, pos)[0]
+                        pos += struct.calcsize(fmt)
+            result[name] = rows
+        
+        raise ValueError("Export truncated")
+    
+    @staticmethod
+    def parse_phy_stats(blob: bytes) -> Dict[int, Dict[str, Any]]:
+        """Decode a PHY statistics blob into {channel: histograms}
+        
+        Histogram keys are the lower edge of each bucket in dBm; the first
+        bucket also holds everything below it. Rates are keyed by legacy
+        rate name or "MCS n".
+        """
+        if blob[:4] != PHY_BLOB_MAGIC:
+            raise ValueError("Not an MCT2032 PHY blob")
+        if len(blob) < 17 or zlib.crc32(blob[:-4]) != struct.unpack_from("<I", blob, len(blob) - 4)[0]:
+            raise ValueError("PHY blob checksum mismatch")
+        (version, channel_count, rssi_n, rssi_base, rssi_step,
+         noise_n, noise_base, noise_step, rate_n) = struct.unpack_from("<BBBbBBbBB", blob, 4)
+        if version != 1:
+            raise ValueError(f"Unsupported PHY blob version {version}")
+        
+        pos = 13
+        
+        def varint() -> int:
+            nonlocal pos
+            value, shift = 0, 0
+            while True:
+                byte = blob[pos]
+                pos += 1
+                value |= (byte & 0x7F) << shift
+                shift += 7
+                if not byte & 0x80:
+                    return value
+        
+        result: Dict[int, Dict[str, Any]] = {}
+        for _ in range(channel_count):
+            channel = blob[pos]
+            pos += 1
+            frames = varint()
+            snr = struct.unpack_from("<h", blob, pos)[0] / 16
+            pos += 2
+            rssi = {rssi_base + i * rssi_step: varint() for i in range(rssi_n)}
+            noise = {noise_base + i * noise_step: varint() for i in range(noise_n)}
+            rates = {}
+            for i in range(rate_n):
+                count = varint()
+                if count:
+                    name = PHY_RATE_NAMES[i] if i < len(PHY_RATE_NAMES) else f"MCS {i - len(PHY_RATE_NAMES)}"
+                    rates[name] = count
+            bw20, bw40 = varint(), varint()
+            result[channel] = {
+                "frames": frames, "snr_avg": snr, "rssi": rssi, "noise_floor": noise,
+                "rates": rates, "bw_20": bw20, "bw_40": bw40,
+            }
+        return result
+    
     @staticmethod
     def create_scan_wifi_cmd(duration: int = 3000, channel: int = 0) -> bytes:
         """Create WiFi scan command"""
@@ -0,0 +1,119 @@
+/**
+ * Airtime Meter for MCT2032
+ * Per-frame airtime from the PHY rate, and channel utilization over sliding windows
+ *
+ * Each frame's time on air is worked out from rx_ctrl: DSSS/CCK rates with
+ * their long or short preamble, ERP-OFDM rates, and HT MCS with channel
+ * width, short guard interval and spatial streams. Subframes of an A-MPDU
+ * after the first share its preamble, so they are charged their symbols
+ * only; an aggregated frame opens a new A-MPDU when the frame before it was
+ * not aggregated or ended more than a SIFS earlier by the RX timestamp.
+ * Everything is integer math on microseconds.
+ *
+ * Busy time is summed per channel into one-second buckets next to the time
+ * spent listening on that channel, so hopping does not dilute the figures.
+ * Running sums over the last AIRTIME_SHORT_BUCKETS and all AIRTIME_BUCKETS
+ * buckets are adjusted as buckets expire, so utilization is a division at
+ * query time. Airtime is also totalled per frame class and per BSSID.
+ */
+
+#ifndef AIRTIME_METER_H
+#define AIRTIME_METER_H
+
+#include <Arduino.h>
+#include <esp_wifi.h>
+#include <freertos/FreeRTOS.h>
+#include "MacTable.h"
+
+#define AIRTIME_CHANNELS        14
+#define AIRTIME_BUCKET_MS       1000
+#define AIRTIME_BUCKETS         60      // Long window
+#define AIRTIME_SHORT_BUCKETS   10      // Short window
+#define AIRTIME_BSSES           64
+
+// Frame classes
+#define AIRTIME_BEACON          0
+#define AIRTIME_MGMT            1
+#define AIRTIME_CTRL            2
+#define AIRTIME_DATA            3
+#define AIRTIME_CLASSES         4
+
+struct AirtimeBucket {
+    uint32_t busyUs;
+    uint32_t listenMs;
+};
+
+struct AirtimeChannel {
+    uint32_t shortBusyUs;
+    uint32_t shortListenMs;
+    uint32_t longBusyUs;
+    uint32_t longListenMs;
+    uint64_t classUs[AIRTIME_CLASSES];  // Whole session
+};
+
+struct BssAirtime {
+    uint32_t lastSeen;
+    uint32_t frames;
+    uint64_t airtimeUs;
+};
+
+// Copy of one channel's figures for reports
+struct AirtimeReport {
+    uint8_t shortPct;
+    uint8_t longPct;
+    uint32_t longListenMs;
+    uint64_t classUs[AIRTIME_CLASSES];
+};
+
+// Copy of one BSSID's figures for reports
+struct BssAirtimeReport {
+    uint8_t bssid[6];
+    uint32_t frames;
+    uint64_t airtimeUs;
+};
+
+class AirtimeMeter {
+private:
+    AirtimeBucket buckets[AIRTIME_BUCKETS][AIRTIME_CHANNELS];
+    AirtimeChannel channels[AIRTIME_CHANNELS];
+    MacTable<BssAirtime, AIRTIME_BSSES> bsses;
+    uint64_t totalUs;
+    
+    uint8_t bucket;
+    uint32_t bucketStart;
+    uint8_t listenChannel;      // 0 while not monitoring
+    uint32_t listenMark;        // Listening is credited up to here
+    portMUX_TYPE lock;
+    
+    // Promiscuous callback only
+    bool ampduOpen;             // Last frame was an A-MPDU subframe
+    uint32_t ampduEndUs;        // RX timestamp where it ended
+    
+    // Called with the lock held
+    void creditListen(uint32_t until);
+    void advance(uint32_t now);
+    
+    static uint8_t percent(uint32_t busyUs, uint32_t listenMs);
+
+public:
+    AirtimeMeter();
+    
+    void reset();
+    
+    // Monitor tuned to a channel, or 0 when it stops
+    void setListening(uint8_t channel, uint32_t now);
+    
+    // Promiscuous callback
+    void observe(const uint8_t* frame, const wifi_pkt_rx_ctrl_t& ctrl, uint32_t now);
+    
+    void getChannel(uint8_t channel, uint32_t now, AirtimeReport* report);
+    
+    // The k BSSIDs with the most airtime, largest first, and the session
+    // total they are a share of; copied under the lock
+    uint8_t getTopBss(BssAirtimeReport* out, uint8_t k, uint64_t* total);
+    
+    static uint32_t frameAirtimeUs(const wifi_pkt_rx_ctrl_t& ctrl, bool sharedPreamble);
+    static const char* className(uint8_t frameClass);
+};
+
+#endif // AIRTIME_METER_H
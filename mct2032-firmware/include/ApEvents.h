@@ -0,0 +1,72 @@
+/**
+ * AP Events for MCT2032
+ * Findings about the AP inventory, handed from the frame path to the worker
+ *
+ * Detectors running in the promiscuous callback cannot talk to BLE, storage
+ * or the display, so they post fixed-size events on a FreeRTOS queue that
+ * the command worker drains. Posting never blocks: when the queue is full
+ * the event is dropped and counted. Post outside any critical section.
+ */
+
+#ifndef AP_EVENTS_H
+#define AP_EVENTS_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include "Dot11.h"
+
+#define AP_EVENT_QUEUE_DEPTH    16
+
+// Event types
+#define AP_EVENT_ALERT          1
+#define AP_EVENT_SSID_RESOLVED  2       // A hidden BSSID's real SSID
+
+// Severities, the same values as SURVEY_SEVERITY_*
+#define AP_SEVERITY_INFO        0
+#define AP_SEVERITY_WARNING     1
+#define AP_SEVERITY_CRITICAL    2
+
+struct ApEvent {
+    uint8_t type;
+    uint8_t kind;               // Type-specific
+    uint8_t severity;           // AP_SEVERITY_*
+    uint8_t channel;
+    uint8_t bssid[6];
+    char ssid[DOT11_SSID_MAX + 1];
+    int32_t before;             // Kind-specific values, e.g. old and new channel
+    int32_t after;
+};
+
+class ApEventQueue {
+private:
+    QueueHandle_t queue;
+    uint32_t posted;
+    uint32_t dropped;
+
+public:
+    ApEventQueue() : queue(nullptr), posted(0), dropped(0) {}
+    
+    void begin() {
+        if (!queue) {
+            queue = xQueueCreate(AP_EVENT_QUEUE_DEPTH, sizeof(ApEvent));
+        }
+    }
+    
+    void post(const ApEvent& event) {
+        if (queue && xQueueSend(queue, &event, 0) == pdTRUE) {
+            posted++;
+        } else {
+            dropped++;
+        }
+    }
+    
+    bool take(ApEvent* event) {
+        return queue && xQueueReceive(queue, event, 0) == pdTRUE;
+    }
+    
+    uint32_t getPosted() const { return posted; }
+    uint32_t getDropped() const { return dropped; }
+};
+
+#endif // AP_EVENTS_H
@@ -12,6 +12,12 @@
 #include <functional>
 #include "protocol.h"
 
+// Raw bytes per part of a message longer than one notification; base64
+// brings this to 240 characters, like the export stream's chunks
+#define BLE_PART_BYTES      180
+#define BLE_PART_GAP_MS     10
+#define BLE_CHUNK_GAP_MS    20
+
 class BLEManager {
 private:
     NimBLEServer* server;
@@ -23,8 +29,10 @@ private:
     bool deviceConnected;
     bool oldDeviceConnected;
     
-    // Command callback
-    std::function<void(String)> commandCallback;
+    // Command callback, invoked on the NimBLE host task
+    std::function<void(const char*, size_t)> commandCallback;
+    
+    bool sendParts(const String& data);
     
     // Server callbacks
     class ServerCallbacks : public NimBLEServerCallbacks {
@@ -50,20 +58,14 @@ private:
         CommandCallbacks(BLEManager* p) : parent(p) {}
         
         void onWrite(NimBLECharacteristic* pCharacteristic) {
+            // Keep this path short: it runs on the NimBLE host task, so the
+            // payload is only handed off here and executed elsewhere
             std::string value = pCharacteristic->getValue();
             Serial.printf("BLE: onWrite called, data length: %d\n", value.length());
             
             if (value.length() > 0) {
-                Serial.print("BLE: Raw bytes: ");
-                for (size_t i = 0; i < value.length(); i++) {
-                    Serial.printf("%02X ", (uint8_t)value[i]);
-                }
-                Serial.println();
-                Serial.printf("BLE: Command string: %s\n", value.c_str());
-                
                 if (parent->commandCallback) {
-                    Serial.println("BLE: Calling command callback");
-                    parent->commandCallback(String(value.c_str()));
+                    parent->commandCallback(value.data(), value.length());
                 } else {
                     Serial.println("BLE: ERROR - No command callback registered!");
                 }
@@ -78,16 +80,17 @@ public:
     
     void init();
     bool isConnected() { return deviceConnected; }
-    void setCommandCallback(std::function<void(String)> callback);
+    void setCommandCallback(std::function<void(const char*, size_t)> callback);
     
     // Send data methods
     bool sendData(const String& data);
     bool sendStatus(const String& status);
     bool sendResponse(const String& command, const String& status, const DynamicJsonDocument& data);
     bool sendError(const String& command, const String& error);
+    bool sendBusy(const String& command, const String& reason);
     
-    // Chunked data sending for large responses
-    bool sendChunkedResponse(const String& command, const String& status, DynamicJsonDocument& data);
+    // Item lists one chunk per item, then the rest as the final response
+    bool sendChunkedResponse(const String& command, const String& status, const DynamicJsonDocument& data);
     
     // Notification helpers
     void notifyData(const String& data);
@@ -0,0 +1,117 @@
+/**
+ * Capture Filter for MCT2032
+ * Frame predicate compiled at command time and checked before any frame work
+ *
+ * A filter is a set of optional predicates (channel, RSSI range, length
+ * range, frame type/subtype, masked MAC matches). Compiling turns them into
+ * bitmasks and pre-masked 48-bit addresses, so a match is a handful of
+ * compares evaluated cheapest first. The type and control subtype parts are
+ * also pushed down to the WiFi driver so rejected frames never reach the
+ * callback at all.
+ */
+
+#ifndef CAPTURE_FILTER_H
+#define CAPTURE_FILTER_H
+
+#include <Arduino.h>
+#include <esp_wifi.h>
+
+#define CAPTURE_FILTER_MAX_MACS 4
+
+// Predicates present in a compiled filter, in evaluation order
+#define CAPTURE_CHECK_CHANNEL   0x01
+#define CAPTURE_CHECK_RSSI      0x02
+#define CAPTURE_CHECK_LENGTH    0x04
+#define CAPTURE_CHECK_FRAME     0x08
+#define CAPTURE_CHECK_MAC       0x10
+
+// Address fields a MAC rule applies to
+#define CAPTURE_ADDR_1          0x01    // Receiver / destination
+#define CAPTURE_ADDR_2          0x02    // Transmitter / source
+#define CAPTURE_ADDR_3          0x04    // Third address, whatever it holds
+#define CAPTURE_ADDR_ANY        0x07
+#define CAPTURE_ADDR_BSSID      0x08    // Wherever the frame's DS bits put the BSSID
+
+// Frame mask bits for whole frame types; bit index is (type << 4) | subtype
+#define CAPTURE_FRAMES_MGMT     0x000000000000FFFFULL
+#define CAPTURE_FRAMES_CTRL     0x00000000FFFF0000ULL
+#define CAPTURE_FRAMES_DATA     0x0000FFFF00000000ULL
+
+// What the driver delivers when no frame predicate is set; control frames
+// only come up when a filter asks for them
+#define CAPTURE_HW_DEFAULT_MASK (WIFI_PROMIS_FILTER_MASK_MGMT | WIFI_PROMIS_FILTER_MASK_DATA)
+
+struct CaptureMacRule {
+    uint64_t addr;              // Already masked
+    uint64_t mask;
+    uint8_t fields;
+};
+
+class CaptureFilter {
+private:
+    uint8_t checks;
+    uint16_t channelMask;       // Bit per channel 1-14
+    int8_t rssiMin;
+    int8_t rssiMax;
+    uint16_t lengthMin;
+    uint16_t lengthMax;
+    uint64_t frameMask;
+    CaptureMacRule macs[CAPTURE_FILTER_MAX_MACS];
+    uint8_t macCount;
+    
+    static uint64_t readAddress(const uint8_t* p) {
+        uint64_t value = 0;
+        memcpy(&value, p, 6);
+        return value;
+    }
+    
+    bool matchMac(const uint8_t* frame, uint16_t len) const;
+
+public:
+    CaptureFilter();
+    
+    void clear();
+    bool isActive() const { return checks != 0; }
+    uint8_t getChecks() const { return checks; }
+    
+    // Building; each returns false on an invalid argument
+    bool addChannel(uint8_t channel);
+    void setRssiRange(int8_t minimum, int8_t maximum);
+    void setLengthRange(uint16_t minimum, uint16_t maximum);
+    bool addFrames(const char* name);
+    bool addMac(const char* addr, const char* mask, uint8_t fields);
+    
+    // Promiscuous callback; nothing has been copied or counted yet
+    bool match(const uint8_t* frame, uint16_t len, int8_t rssi, uint8_t channel) const {
+        if (checks == 0) {
+            return true;
+        }
+        if ((checks & CAPTURE_CHECK_CHANNEL) && !(channelMask & (1 << channel))) {
+            return false;
+        }
+        if ((checks & CAPTURE_CHECK_RSSI) && (rssi < rssiMin || rssi > rssiMax)) {
+            return false;
+        }
+        if ((checks & CAPTURE_CHECK_LENGTH) && (len < lengthMin || len > lengthMax)) {
+            return false;
+        }
+        if (checks & CAPTURE_CHECK_FRAME) {
+            if (len < 2) {
+                return false;
+            }
+            uint8_t bit = ((frame[0] & 0x0C) << 2) | (frame[0] >> 4);
+            if (!((frameMask >> bit) & 1)) {
+                return false;
+            }
+        }
+        return !(checks & CAPTURE_CHECK_MAC) || matchMac(frame, len);
+    }
+    
+    // Driver pushdown
+    uint32_t getHardwareMask() const;
+    uint32_t getCtrlMask() const;
+    
+    static uint8_t fieldsFromName(const char* name);
+};
+
+#endif // CAPTURE_FILTER_H
@@ -0,0 +1,55 @@
+/**
+ * Channel Analyzer for MCT2032
+ * Per-channel occupancy and co-channel interference analytics
+ */
+
+#ifndef CHANNEL_ANALYZER_H
+#define CHANNEL_ANALYZER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// 2.4 GHz channels are 22 MHz wide on a 5 MHz raster, so a transmitter
+// bleeds into the four channels on either side of its own
+#define ANALYZER_MAX_CHANNEL    14
+#define ANALYZER_OVERLAP_SPAN   4
+
+struct ChannelStats {
+    uint16_t apCount;
+    int8_t strongestRssi;
+    float aggregateMw;        // Linear sum of AP power on this channel
+    float interferenceMw;     // Overlap-weighted AP power from this and adjacent channels
+    uint32_t frameCount;      // Frames received on this channel while monitoring
+    uint32_t frameLoad;       // Overlap-weighted frame count (percent units)
+};
+
+class ChannelAnalyzer {
+private:
+    // Index 0 is unused so channels can be indexed directly
+    ChannelStats channels[ANALYZER_MAX_CHANNEL + 1];
+    
+    // Relative overlap (percent) between channels 0..ANALYZER_OVERLAP_SPAN apart
+    static const uint8_t overlapWeight[ANALYZER_OVERLAP_SPAN + 1];
+    
+public:
+    ChannelAnalyzer();
+    
+    // Incremental updates, O(ANALYZER_OVERLAP_SPAN) each
+    void addNetwork(uint8_t channel, int32_t rssi);
+    void recordFrame(uint8_t channel, int8_t rssi, uint16_t weight = 1);
+    
+    void resetNetworks();
+    void resetNetworks(uint8_t channel);    // Leaves the other channels' APs
+    void resetFrames();
+    
+    const ChannelStats& getChannel(uint8_t channel) const { return channels[channel]; }
+    uint8_t getRecommendedChannel() const;
+    
+    // JSON serialization, O(channels)
+    void toJSON(DynamicJsonDocument& doc);
+    
+    static float dbmToMw(int32_t dbm);
+    static float mwToDbm(float mw);
+};
+
+#endif // CHANNEL_ANALYZER_H
@@ -0,0 +1,40 @@
+/**
+ * Checksums for MCT2032
+ * CRC-32 (IEEE 802.3, same as zlib) for exported and stored data
+ */
+
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <Arduino.h>
+
+#define CRC32_INIT  0xFFFFFFFFu
+
+// Nibble-wise table, 64 bytes of flash instead of 1 KB
+static const uint32_t crc32NibbleTable[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+// Feed data through a running CRC started at CRC32_INIT
+inline uint32_t crc32Update(uint32_t crc, const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    while (len--) {
+        crc ^= *p++;
+        crc = (crc >> 4) ^ crc32NibbleTable[crc & 0x0F];
+        crc = (crc >> 4) ^ crc32NibbleTable[crc & 0x0F];
+    }
+    return crc;
+}
+
+inline uint32_t crc32Final(uint32_t crc) {
+    return crc ^ 0xFFFFFFFFu;
+}
+
+inline uint32_t crc32(const void* data, size_t len) {
+    return crc32Final(crc32Update(CRC32_INIT, data, len));
+}
+
+#endif // CHECKSUM_H
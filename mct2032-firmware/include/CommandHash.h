@@ -0,0 +1,77 @@
+/**
+ * Command Hash for MCT2032
+ * Compile-time perfect hash from command names to dispatch table entries
+ *
+ * A seed is searched at compile time so that every name in a table lands
+ * in its own slot. A lookup is one hash, one slot read and one strcmp to
+ * reject unknown names. Only standard headers are used so the host
+ * dispatch benchmark can build the same table as the command processor.
+ */
+
+#ifndef COMMAND_HASH_H
+#define COMMAND_HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+// Perfect-hash slots for command dispatch (power of two, >= 2x command count)
+#define MAX_COMMANDS        32
+#define COMMAND_SLOTS       128
+
+struct CommandSlots {
+    uint32_t seed;
+    uint8_t index[COMMAND_SLOTS];   // Hash slot -> table index, 0xFF if empty
+    bool valid;
+};
+
+// FNV-1a, usable both at compile time and at runtime. The high half is
+// folded in because the low slot bits alone only ever see the seed's low bits
+constexpr uint32_t hashCommand(const char* name, uint32_t seed) {
+    uint32_t hash = 2166136261u ^ seed;
+    while (*name) {
+        hash ^= (uint8_t)*name++;
+        hash *= 16777619u;
+    }
+    return hash ^ (hash >> 16);
+}
+
+// Search for a seed that maps every entry's name to its own slot
+template <typename Entry, size_t N>
+constexpr CommandSlots buildCommandSlots(const Entry (&table)[N]) {
+    static_assert(N <= MAX_COMMANDS, "Command table larger than MAX_COMMANDS");
+    
+    for (uint32_t seed = 0; seed < 4096; seed++) {
+        CommandSlots slots = {seed, {}, true};
+        for (auto& slot : slots.index) {
+            slot = 0xFF;
+        }
+        
+        bool collision = false;
+        for (size_t i = 0; i < N && !collision; i++) {
+            uint32_t slot = hashCommand(table[i].name, seed) & (COMMAND_SLOTS - 1);
+            if (slots.index[slot] != 0xFF) {
+                collision = true;
+            } else {
+                slots.index[slot] = i;
+            }
+        }
+        
+        if (!collision) {
+            return slots;
+        }
+    }
+    return CommandSlots{0, {}, false};
+}
+
+// Table entry for a name, nullptr if it isn't in the table
+template <typename Entry>
+inline const Entry* findCommandEntry(const CommandSlots& slots, const Entry* table, const char* name) {
+    uint8_t index = slots.index[hashCommand(name, slots.seed) & (COMMAND_SLOTS - 1)];
+    if (index == 0xFF || strcmp(table[index].name, name) != 0) {
+        return nullptr;
+    }
+    return &table[index];
+}
+
+#endif // COMMAND_HASH_H
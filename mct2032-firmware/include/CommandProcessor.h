@@ -8,25 +8,128 @@
 
 #include <Arduino.h>
 #include <ArduinoJson.h>
-#include <functional>
-#include <map>
+#include <freertos/queue.h>
 #include "protocol.h"
+#include "CommandHash.h"
 #include "BLEManager.h"
 #include "WiFiScanner.h"
 #include "PacketMonitor.h"
+#include "ChannelAnalyzer.h"
+#include "JobManager.h"
+#include "DataExporter.h"
+#include "Storage.h"
+#include "SurveyLog.h"
+
+// Scan results younger than this are served from cache
+#define SCAN_CACHE_MAX_AGE  30000
+
+// Most BSSIDs in one AIRTIME reply
+#define AIRTIME_BSS_MAX     16
+
+// A batch entry goes out as one chunk; this leaves room for the chunk and
+// entry keys around its data within one notification
+#define BATCH_ENTRY_OVERHEAD    160
+
+// Longest AP alert line kept for the display
+#define ALERT_TEXT_LEN      64
+
+// Command worker queue
+#define CMD_QUEUE_HIGH_DEPTH    4
+#define CMD_QUEUE_NORMAL_DEPTH  8
+#define CMD_TASK_STACK_SIZE     8192
+#define CMD_TASK_PRIORITY       2
+#define CMD_TASK_IDLE_MS        20
+
+// Job progress events are rate limited to this period
+#define JOB_PROGRESS_INTERVAL   500
+#define STATS_STREAM_MIN_MS     100
+
+// Command priorities
+#define CMD_PRIORITY_HIGH   0   // Cheap queries, served ahead of everything else
+#define CMD_PRIORITY_NORMAL 1
+
+struct QueuedCommand {
+    uint8_t index;              // commandTable index, 0xFF if the name wasn't recognised
+    uint16_t length;
+    uint32_t enqueueTime;       // micros()
+    char data[MAX_COMMAND_SIZE + 1];
+};
+
+struct CommandStats {
+    uint32_t count;
+    uint32_t waitTotalUs;
+    uint32_t waitMaxUs;
+    uint32_t execTotalUs;
+    uint32_t execMaxUs;
+};
 
 class CommandProcessor {
 private:
     BLEManager* bleManager;
     WiFiScanner* wifiScanner;
     PacketMonitor* packetMonitor;
+    ChannelAnalyzer* channelAnalyzer;
+    Storage* storage;
+    SurveyLog* surveyLog;
     
-    // Device state
+    // Device state, derived from the running jobs
     uint8_t currentMode;
     uint32_t startTime;
     
-    // Command handlers
-    std::map<String, std::function<void(JsonVariant)>> commandHandlers;
+    // Long-running operations
+    JobManager jobs;
+    DataExporter exporter;
+    
+    // Scan result cache
+    uint32_t scanCacheMaxAge;
+    uint32_t scanCacheHits;
+    uint32_t scanCacheMisses;
+    uint32_t scanCoalesced;
+    
+    // Latest AP alert, picked up by the UI loop
+    char alertText[ALERT_TEXT_LEN];
+    uint32_t alertCount;
+    portMUX_TYPE alertLock;
+    
+    // Command dispatch table, resolved at compile time
+    typedef void (CommandProcessor::*CommandHandler)(JsonVariant);
+    
+    struct CommandEntry {
+        const char* name;
+        CommandHandler handler;
+        uint8_t priority;
+    };
+    
+    static const CommandEntry commandTable[];
+    static const CommandSlots commandSlots;
+    
+    const CommandEntry* findCommand(const char* name) const;
+    void dispatch(const char* cmd, JsonVariant params);
+    
+    // Worker task and its queues
+    QueueHandle_t highQueue;
+    QueueHandle_t normalQueue;
+    TaskHandle_t workerTask;
+    uint32_t commandsRejected;
+    CommandStats commandStats[MAX_COMMANDS];
+    
+    static void workerTaskEntry(void* arg);
+    void workerLoop();
+    void executeQueued(const QueuedCommand& item);
+    static bool peekCommandName(const char* data, size_t length, char* name, size_t nameSize);
+    
+    // Response routing; set while a BATCH is collecting sub-command results
+    DynamicJsonDocument* batchDoc;
+    JsonArray* batchResults;
+    size_t batchReserve;        // Kept free for the rest of the batch's entries
+    bool batchResponded;
+    bool batchFailed;
+    
+    void respond(const char* cmd, const char* status, const DynamicJsonDocument& data);
+    void respondError(const char* cmd, const char* error);
+    void respondChunked(const char* cmd, const char* status, const DynamicJsonDocument& data);
+    bool fitsBatch(const DynamicJsonDocument& data) const;
+    void respondSeparately(const char* cmd, const char* status);
     
     // Handler methods
     void handleScanWiFi(JsonVariant params);
@@ -37,6 +140,19 @@ private:
     void handleMonitorStop(JsonVariant params);
     void handleExportData(JsonVariant params);
     void handleClearData(JsonVariant params);
+    void handleChannelReport(JsonVariant params);
+    void handleTopTalkers(JsonVariant params);
+    void handleDistinctCount(JsonVariant params);
+    void handleAssocGraph(JsonVariant params);
+    void handleAirtime(JsonVariant params);
+    void handlePhyStats(JsonVariant params);
+    void handleProbeReport(JsonVariant params);
+    void handleRogueAllow(JsonVariant params);
+    void handleGetMetrics(JsonVariant params);
+    void handleJobList(JsonVariant params);
+    void handleJobCancel(JsonVariant params);
+    void handleStatsStream(JsonVariant params);
+    void handleBatch(JsonVariant params);
     
     // Advanced handlers
     void handleDeauthAttack(JsonVariant params);
@@ -44,12 +160,41 @@ private:
     void handleRickroll(JsonVariant params);
     void handlePCAPStart(JsonVariant params);
     void handlePCAPStop(JsonVariant params);
+    void handleFlightArm(JsonVariant params);
+    void handleFlightTrigger(JsonVariant params);
+    void handleFlightDisarm(JsonVariant params);
+    
+    void sendScanResults();
+    void fillMonitorStats(JsonObject stats);
+    void fillLossStats(JsonObject loss);
+    bool compileFilter(JsonObject spec, CaptureFilter& filter, const char** error);
+    
+    // Job engine, serviced from the worker task
+    void serviceJobs();
+    void stepScanJob(Job* job);
+    void stepMonitorJob(Job* job);
+    void stepCaptureJob(Job* job);
+    void stepStatsJob(Job* job);
+    void stepExportJob(Job* job);
+    void stepFlightJob(Job* job);
+    void fillFlightStatus(JsonObject flight);
+    void cancelJob(Job* job);
+    void stopMonitorJob(Job* job, uint8_t state);
+    void endJob(Job* job, uint8_t state, const char* message = nullptr);
+    void sendJobEvent(Job* job, const char* message = nullptr);
+    void serviceApEvents();
+    void updateMode();
     
 public:
-    CommandProcessor(BLEManager* ble, WiFiScanner* wifi, PacketMonitor* monitor);
+    CommandProcessor(BLEManager* ble, WiFiScanner* wifi, PacketMonitor* monitor, ChannelAnalyzer* analyzer, Storage* store, SurveyLog* survey);
     
     void init();
-    void processCommand(const String& commandStr);
+    
+    // Called from the BLE host task; copies the payload and returns immediately
+    bool enqueueCommand(const char* data, size_t length);
+    
+    // Runs on the worker task
+    void processCommand(const char* commandStr, size_t length);
     
     // Status helpers
     uint32_t getUptime() const;
@@ -59,7 +204,12 @@ public:
     
     // Mode management
     uint8_t getCurrentMode() const { return currentMode; }
-    void setMode(uint8_t mode) { currentMode = mode; }
+    
+    // Number of AP alerts so far, with the latest one's text; safe from any task
+    uint32_t getLastAlert(char* text, size_t len);
+    
+    // Scan cache configuration
+    void setScanCacheMaxAge(uint32_t maxAge) { scanCacheMaxAge = maxAge; }
 };
 
 #endif // COMMAND_PROCESSOR_H
\ No newline at end of file
@@ -0,0 +1,184 @@
+/**
+ * Data Exporter for MCT2032
+ * Streams collected data to SD or BLE through a fixed buffer
+ *
+ * Binary layout (little endian, version EXPORT_VERSION):
+ *   header   "MCTX" u8 version, u8 format flags, u16 section count, u32 uptime ms
+ *   section  u8 section id, u8 column count, u32 row count, then per column
+ *            u8 column id, u8 value type, row count values (columnar)
+ *   trailer  u8 EXPORT_SECTION_END, u8 0, u32 byte count, u32 CRC-32 of all
+ *            bytes before the trailer
+ *
+ * Values: U8/I8 1 byte, U16 2, U32 4, MAC 6, STR u8 length + bytes.
+ * CSV writes each section as a "# name" line, a header row, then one line per row.
+ */
+
+#ifndef DATA_EXPORTER_H
+#define DATA_EXPORTER_H
+
+#include <Arduino.h>
+#include "BLEManager.h"
+#include "Storage.h"
+#include "WiFiScanner.h"
+#include "PacketMonitor.h"
+#include "ChannelAnalyzer.h"
+
+#define EXPORT_MAGIC            "MCTX"
+#define EXPORT_VERSION          1
+
+#define EXPORT_FORMAT_BINARY    0
+#define EXPORT_FORMAT_CSV       1
+
+// Staging buffer; nothing larger than this is ever held for an export
+#define EXPORT_BUFFER_SIZE      512
+
+// Longest an export waits for a free storage buffer before failing
+#define EXPORT_STORAGE_WAIT_MS  1000
+
+// Bytes produced per job step, so other work keeps running on the worker
+#define EXPORT_STEP_BYTES_FILE  4096
+#define EXPORT_STEP_BYTES_BLE   360
+
+// Raw bytes per BLE notification, base64 brings this to 240 characters
+#define EXPORT_BLE_CHUNK        180
+
+// Section ids
+#define EXPORT_SECTION_APS      1
+#define EXPORT_SECTION_STATS    2
+#define EXPORT_SECTION_CHANNELS 3
+#define EXPORT_SECTION_END      0xFF
+
+// Column value types
+#define EXPORT_TYPE_U8          1
+#define EXPORT_TYPE_I8          2
+#define EXPORT_TYPE_U16         3
+#define EXPORT_TYPE_U32         4
+#define EXPORT_TYPE_MAC         5
+#define EXPORT_TYPE_STR         6
+
+struct ExportColumn {
+    uint8_t id;
+    uint8_t type;
+    const char* name;
+};
+
+struct ExportSection {
+    uint8_t id;
+    const char* name;
+    const ExportColumn* columns;
+    uint8_t columnCount;
+};
+
+// Destination for exported bytes
+class ExportSink {
+public:
+    virtual ~ExportSink() {}
+    virtual bool write(const uint8_t* data, size_t len) = 0;
+    virtual bool close() = 0;
+    virtual size_t getStepBytes() const = 0;
+    virtual const char* getName() const = 0;
+};
+
+// Writes through the storage write-behind queue, waiting for buffers rather than dropping
+class StorageExportSink : public ExportSink {
+private:
+    StorageStream* stream;
+
+public:
+    explicit StorageExportSink(StorageStream* s) : stream(s) {}
+    
+    bool write(const uint8_t* data, size_t len) override;
+    bool close() override;
+    size_t getStepBytes() const override { return EXPORT_STEP_BYTES_FILE; }
+    const char* getName() const override { return "sd"; }
+};
+
+// Sends {"type":"export","seq":n,"data":"<base64>"} on the data characteristic
+class BLEExportSink : public ExportSink {
+private:
+    BLEManager* bleManager;
+    uint32_t sequence;
+    
+    bool sendChunk(const uint8_t* data, size_t len);
+
+public:
+    explicit BLEExportSink(BLEManager* ble) : bleManager(ble), sequence(0) {}
+    
+    bool write(const uint8_t* data, size_t len) override;
+    bool close() override;
+    size_t getStepBytes() const override { return EXPORT_STEP_BYTES_BLE; }
+    const char* getName() const override { return "ble"; }
+};
+
+class DataExporter {
+private:
+    WiFiScanner* wifiScanner;
+    PacketMonitor* packetMonitor;
+    ChannelAnalyzer* channelAnalyzer;
+    
+    ExportSink* sink;
+    uint8_t format;
+    bool active;
+    bool failed;
+    
+    uint8_t buffer[EXPORT_BUFFER_SIZE];
+    size_t bufferUsed;
+    uint32_t bytesWritten;
+    uint32_t crc;
+    uint32_t checksum;
+    uint32_t startTime;
+    uint32_t endTime;
+    
+    // Cursor; binary walks columns then rows, CSV walks rows then columns
+    bool headerWritten;
+    uint8_t sectionIndex;
+    bool sectionStarted;
+    uint8_t columnIndex;
+    uint32_t rowIndex;
+    uint32_t rowCount;
+    bool columnStarted;
+    
+    static const ExportSection sections[];
+    static const uint8_t sectionCount;
+    
+    uint32_t getRowCount(const ExportSection& section) const;
+    
+    void writeBytes(const void* data, size_t len);
+    void writeU8(uint8_t value) { writeBytes(&value, 1); }
+    void writeU16(uint16_t value);
+    void writeU32(uint32_t value);
+    void writeText(const char* text);
+    void writeCSVString(const char* text);
+    void flush();
+    
+    void writeHeader();
+    void writeSectionHeader(const ExportSection& section);
+    void writeColumnHeader(const ExportColumn& column);
+    void writeValue(const ExportSection& section, const ExportColumn& column, uint32_t row);
+    void nextSection();
+    void writeTrailer();
+    bool advance();
+
+public:
+    DataExporter(WiFiScanner* wifi, PacketMonitor* monitor, ChannelAnalyzer* analyzer);
+    
+    // Takes ownership of the sink
+    bool begin(ExportSink* exportSink, uint8_t exportFormat);
+    
+    // Produces up to one step's worth of output; false once finished or failed
+    bool step();
+    void abort();
+    
+    bool isActive() const { return active; }
+    bool hasFailed() const { return failed; }
+    uint8_t getFormat() const { return format; }
+    uint8_t getProgress() const;
+    uint32_t getBytesWritten() const { return bytesWritten; }
+    uint32_t getElapsed() const;
+    uint32_t getThroughput() const;   // Bytes per second
+    uint32_t getChecksum() const { return checksum; }   // Binary only, valid once finished
+    
+    static const char* formatName(uint8_t format);
+};
+
+#endif // DATA_EXPORTER_H
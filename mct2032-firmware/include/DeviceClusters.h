@@ -0,0 +1,95 @@
+/**
+ * Device Clusters for MCT2032
+ * Estimated physical devices behind randomized probe request addresses
+ *
+ * Phones rotate locally administered MACs, so counting addresses overcounts
+ * devices. The information elements of a probe request stay the same across
+ * rotations for a given device and OS build: supported rates, HT/VHT/HE and
+ * extended capabilities, vendor elements and the order they come in. These
+ * are hashed into a 32-bit signature, skipping the SSID and DS parameter
+ * elements and taking only the OUI and type of vendor elements.
+ *
+ * A new randomized address joins the cluster with the same signature that
+ * went quiet most recently, if it was last heard between DEVICE_OVERLAP_MS
+ * and DEVICE_ROTATION_MS ago: a device that rotates stops using its old
+ * address, while two devices of one model tend to probe at the same time.
+ * Otherwise it starts a new cluster. Globally administered addresses count
+ * as one device each. Tables are fixed size; the stalest entry is replaced.
+ * Identical devices whose probing never overlaps fold into one, so the
+ * estimate leans low where address counts lean high.
+ */
+
+#ifndef DEVICE_CLUSTERS_H
+#define DEVICE_CLUSTERS_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include "MacTable.h"
+
+#define DEVICE_MACS             256
+#define DEVICE_CLUSTERS         64
+#define DEVICE_OVERLAP_MS       1000    // Heard this recently: another device
+#define DEVICE_ROTATION_MS      900000  // Quiet this long: no longer joinable
+#define DEVICE_ACTIVE_MS        300000  // Window for the active counts
+#define DEVICE_MIN_ELEMENTS     2       // Fewer hashed elements: too weak to cluster
+#define DEVICE_NO_CLUSTER       0xFF
+#define DEVICE_REPORT_MAX       16
+
+struct DeviceMac {
+    uint32_t lastSeen;
+    uint16_t generation;        // Of the cluster when joined
+    uint8_t cluster;            // DEVICE_NO_CLUSTER for global or unclustered addresses
+};
+
+struct DeviceCluster {
+    uint32_t signature;
+    uint32_t firstSeen;
+    uint32_t lastSeen;
+    uint32_t probes;
+    uint16_t macs;
+    uint16_t generation;
+    bool used;
+};
+
+struct DeviceEstimate {
+    uint32_t macs;              // Distinct addresses seen this session
+    uint32_t randomized;
+    uint32_t devices;           // Estimated physical devices this session
+    uint16_t activeMacs;        // Within DEVICE_ACTIVE_MS
+    uint16_t activeDevices;
+};
+
+class DeviceClusters {
+private:
+    MacTable<DeviceMac, DEVICE_MACS> macs;
+    DeviceCluster clusters[DEVICE_CLUSTERS];
+    uint32_t macsSeen;
+    uint32_t randomizedSeen;
+    uint32_t devicesSeen;
+    uint32_t clusterEvictions;
+    portMUX_TYPE lock;
+    
+    // Called with the lock held
+    uint8_t join(uint32_t signature, uint32_t now);
+
+public:
+    DeviceClusters();
+    
+    void reset();
+    
+    // Element signature of a probe request; false if too weak to cluster on
+    static bool signature(const uint8_t* frame, uint16_t len, uint32_t* out);
+    
+    // Promiscuous callback, probe requests only; cluster probe counts are
+    // scaled by the sample weight
+    void observe(const uint8_t* frame, uint16_t len, uint16_t weight, uint32_t now);
+    
+    void getEstimate(uint32_t now, DeviceEstimate* out);
+    
+    // Clusters with the most addresses first
+    uint8_t getClusters(DeviceCluster* out, uint8_t k);
+    
+    uint32_t getClusterEvictions() const { return clusterEvictions; }
+};
+
+#endif // DEVICE_CLUSTERS_H
@@ -0,0 +1,66 @@
+/**
+ * Distinct Counters for MCT2032
+ * Unique transmitters, probing clients and BSSIDs per channel and time window
+ *
+ * One HyperLogLog sketch per kind, channel and window, updated for every
+ * frame. Windows form a ring of DISTINCT_WINDOW_MS slices; a query merges
+ * the sketches for any set of channels over the most recent slices, so
+ * "unique devices in the last hour" is a few kilobytes of byte-wise max.
+ * The ring lives in PSRAM when present; otherwise a short ring fits in
+ * internal RAM.
+ */
+
+#ifndef DISTINCT_COUNTERS_H
+#define DISTINCT_COUNTERS_H
+
+#include <Arduino.h>
+#include "HyperLogLog.h"
+
+#define DISTINCT_TX             0
+#define DISTINCT_PROBERS        1
+#define DISTINCT_BSSIDS         2
+#define DISTINCT_KINDS          3
+
+#define DISTINCT_CHANNELS       14
+#define DISTINCT_WINDOW_MS      300000  // Five-minute slices
+#define DISTINCT_MAX_WINDOWS    12      // An hour in PSRAM
+#define DISTINCT_INTERNAL_MAX   (32 * 1024)
+
+// All kinds for all channels in one slice
+#define DISTINCT_SLICE_BYTES    (DISTINCT_CHANNELS * DISTINCT_KINDS * HLL_REGISTERS)
+
+class DistinctCounters {
+private:
+    uint8_t* sketches;              // [window][channel - 1][kind][register]
+    uint32_t windowStart[DISTINCT_MAX_WINDOWS];
+    uint8_t windowCount;
+    uint8_t current;
+    bool inPSRAM;
+    
+    uint8_t* sketch(uint8_t window, uint8_t channel, uint8_t kind) {
+        return sketches + ((window * DISTINCT_CHANNELS + channel - 1) * DISTINCT_KINDS + kind) * HLL_REGISTERS;
+    }
+    
+    void rotate(uint32_t now);
+
+public:
+    DistinctCounters();
+    
+    bool begin();
+    void reset();
+    
+    // Promiscuous callback, every frame that passed the filter
+    void observe(const uint8_t* frame, uint16_t len, uint8_t channel, uint32_t now);
+    
+    // Distinct counts per kind over the channels in channelMask (bit per
+    // channel) and the slices overlapping the last spanMs; returns the span covered
+    uint32_t count(uint16_t channelMask, uint32_t spanMs, uint32_t now, uint32_t* counts);
+    
+    bool isReady() const { return sketches != nullptr; }
+    bool isInPSRAM() const { return inPSRAM; }
+    uint32_t getMaxSpanMs() const { return windowCount * DISTINCT_WINDOW_MS; }
+    
+    static const char* kindName(uint8_t kind);
+};
+
+#endif // DISTINCT_COUNTERS_H
@@ -0,0 +1,135 @@
+/**
+ * 802.11 header helpers for MCT2032
+ * Address lookups on raw frames from the promiscuous callback
+ *
+ * Which address field holds the transmitter and the BSSID depends on the
+ * frame type and, for data frames, the To/From DS bits. Each helper returns
+ * a pointer into the frame, or nullptr when the frame is too short or has
+ * no such address.
+ */
+
+#ifndef DOT11_H
+#define DOT11_H
+
+#include <Arduino.h>
+
+#define DOT11_TYPE_MGMT         0
+#define DOT11_TYPE_CTRL         1
+#define DOT11_TYPE_DATA         2
+
+#define DOT11_FC_TO_DS          0x01    // Second frame control byte
+#define DOT11_FC_FROM_DS        0x02
+#define DOT11_FC_RETRY          0x08
+#define DOT11_FC_PROTECTED      0x40
+#define DOT11_FC_ORDER          0x80    // HT Control field present on QoS frames
+
+#define DOT11_ADDR_1            4       // Offsets into the header
+#define DOT11_ADDR_2            10
+#define DOT11_ADDR_3            16
+#define DOT11_ADDR_4            24      // WDS frames only
+
+#define DOT11_FCS_LEN           4       // sig_len includes the FCS
+
+#define DOT11_MGMT_HEADER       24
+#define DOT11_IE_SSID           0
+#define DOT11_SSID_MAX          32
+
+inline uint8_t dot11Type(const uint8_t* frame) {
+    return (frame[0] >> 2) & 0x03;
+}
+
+inline uint8_t dot11Subtype(const uint8_t* frame) {
+    return frame[0] >> 4;
+}
+
+// Address 2; control frames such as ACK and CTS carry none
+inline const uint8_t* dot11Transmitter(const uint8_t* frame, uint16_t len) {
+    return len >= DOT11_ADDR_2 + 6 ? frame + DOT11_ADDR_2 : nullptr;
+}
+
+// The BSS a management or data frame belongs to; none for WDS and control frames
+inline const uint8_t* dot11Bssid(const uint8_t* frame, uint16_t len) {
+    if (len < 24) {
+        return nullptr;
+    }
+    switch (dot11Type(frame)) {
+        case DOT11_TYPE_MGMT:
+            return frame + DOT11_ADDR_3;
+        case DOT11_TYPE_DATA:
+            switch (frame[1] & (DOT11_FC_TO_DS | DOT11_FC_FROM_DS)) {
+                case 0:                     return frame + DOT11_ADDR_3;
+                case DOT11_FC_TO_DS:        return frame + DOT11_ADDR_1;
+                case DOT11_FC_FROM_DS:      return frame + DOT11_ADDR_2;
+                default:                    return nullptr;
+            }
+        default:
+            return nullptr;
+    }
+}
+
+// A data frame seen from the infrastructure side
+struct Dot11Data {
+    const uint8_t* station;     // Non-AP end; nullptr for WDS, IBSS and group destinations
+    const uint8_t* bssid;       // nullptr for WDS
+    bool uplink;                // To DS: station to AP
+    int8_t tid;                 // -1 without QoS
+    uint16_t payload;           // Frame body bytes, past the header and before the FCS
+};
+
+inline bool dot11ParseData(const uint8_t* frame, uint16_t len, Dot11Data* out) {
+    if (len < 24 || dot11Type(frame) != DOT11_TYPE_DATA) {
+        return false;
+    }
+    
+    uint8_t ds = frame[1] & (DOT11_FC_TO_DS | DOT11_FC_FROM_DS);
+    uint16_t header = 24;
+    if (ds == (DOT11_FC_TO_DS | DOT11_FC_FROM_DS)) {
+        header += 6;
+    }
+    out->tid = -1;
+    if (dot11Subtype(frame) & 0x08) {
+        if (len < header + 2) {
+            return false;
+        }
+        out->tid = frame[header] & 0x0F;
+        header += 2;
+        if (frame[1] & DOT11_FC_ORDER) {
+            header += 4;
+        }
+    }
+    out->payload = len > header + DOT11_FCS_LEN ? len - header - DOT11_FCS_LEN : 0;
+    
+    out->uplink = ds == DOT11_FC_TO_DS;
+    out->bssid = dot11Bssid(frame, len);
+    switch (ds) {
+        case DOT11_FC_TO_DS:    out->station = frame + DOT11_ADDR_2; break;
+        case DOT11_FC_FROM_DS:  out->station = frame + DOT11_ADDR_1; break;
+        default:                out->station = nullptr; break;
+    }
+    if (out->station && (out->station[0] & 0x01)) {
+        out->station = nullptr;
+    }
+    return true;
+}
+
+// Information elements from offset to the FCS: fn(id, data, len) for each
+// whole element, stopping early if fn returns false
+template <typename Fn>
+inline void dot11ForEachIE(const uint8_t* frame, uint16_t len, uint16_t offset, Fn fn) {
+    if (len < offset + DOT11_FCS_LEN) {
+        return;
+    }
+    uint16_t end = len - DOT11_FCS_LEN;
+    while (offset + 2 <= end) {
+        uint8_t ieLen = frame[offset + 1];
+        if (offset + 2 + ieLen > end) {
+            return;
+        }
+        if (!fn(frame[offset], frame + offset + 2, ieLen)) {
+            return;
+        }
+        offset += 2 + ieLen;
+    }
+}
+
+#endif // DOT11_H
@@ -0,0 +1,141 @@
+/**
+ * Flight Recorder for MCT2032
+ * Pre-trigger capture ring that dumps the frames around an incident to PCAP
+ *
+ * While armed every frame is copied into a ring (PSRAM when present) as a
+ * ready-made PCAP record, evicting the oldest frames when full. A trigger
+ * freezes eviction; the worker then drops records older than the pre-trigger
+ * window and drains the rest, plus the post-trigger window, to the capture
+ * file. The WiFi task only ever appends, the worker only ever consumes, and
+ * the two meet under a short spinlock around the ring indices.
+ */
+
+#ifndef FLIGHT_RECORDER_H
+#define FLIGHT_RECORDER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include "Storage.h"
+
+// Ring sizing; without PSRAM the ring is capped to keep internal RAM free
+#define FLIGHT_DEFAULT_BYTES    (512 * 1024)
+#define FLIGHT_MIN_BYTES        (16 * 1024)
+#define FLIGHT_INTERNAL_MAX     (64 * 1024)
+
+#define FLIGHT_DEFAULT_PRE_MS   10000
+#define FLIGHT_DEFAULT_POST_MS  5000
+
+// Deauth burst trigger defaults
+#define FLIGHT_DEAUTH_COUNT     10
+#define FLIGHT_DEAUTH_WINDOW_MS 1000
+
+// Each ring record is a PCAP record header followed by the frame
+#define FLIGHT_RECORD_HEADER    16
+
+// Drain in chunks so the worker stays responsive between steps
+#define FLIGHT_DRAIN_CHUNK      2048
+#define FLIGHT_DRAIN_CHUNKS     8
+#define FLIGHT_WRITE_WAIT_MS    20
+
+// Triggers
+#define FLIGHT_TRIGGER_MANUAL   0x01
+#define FLIGHT_TRIGGER_DEAUTH   0x02    // Deauth/disassoc burst
+#define FLIGHT_TRIGGER_MAC      0x04    // Watched MAC in any address field
+#define FLIGHT_TRIGGER_RSSI     0x08    // Frame at or above an RSSI threshold
+
+// States
+#define FLIGHT_STATE_IDLE       0
+#define FLIGHT_STATE_ARMED      1
+#define FLIGHT_STATE_TRIGGERED  2       // Collecting the post-trigger window
+#define FLIGHT_STATE_DRAINING   3       // Window closed, writing out the rest
+
+struct FlightConfig {
+    uint32_t ringBytes;
+    uint32_t preMs;
+    uint32_t postMs;
+    uint8_t triggers;
+    uint8_t mac[6];
+    int8_t rssiThreshold;
+    uint16_t deauthCount;
+    uint32_t deauthWindowMs;
+};
+
+class FlightRecorder {
+private:
+    FlightConfig config;
+    
+    uint8_t* ring;
+    uint32_t capacity;
+    bool inPSRAM;
+    
+    // Valid data is [tail, head), or [tail, wrapEnd) + [0, head) when wrapped
+    volatile uint32_t head;
+    volatile uint32_t tail;
+    volatile uint32_t wrapEnd;
+    volatile bool wrapped;
+    volatile bool writing;      // WiFi task is between reserve and commit
+    volatile uint8_t state;
+    portMUX_TYPE lock;
+    
+    uint8_t firedBy;
+    uint32_t triggerTime;
+    bool windowTrimmed;
+    StorageStream* stream;
+    
+    // Deauth burst window, WiFi task only
+    uint32_t deauthWindowStart;
+    uint16_t deauthSeen;
+    
+    // Statistics
+    uint32_t framesRecorded;
+    uint32_t framesEvicted;
+    uint32_t framesDropped;
+    uint32_t bytesDumped;
+    
+    bool reserve(uint32_t need, uint32_t* pos, bool* wrap);
+    bool evictOldest();
+    void advanceTail(uint32_t bytes);
+    uint8_t checkTriggers(const uint8_t* frame, uint16_t len, int8_t rssi, uint32_t timestamp);
+    bool fire(uint8_t source, uint32_t timestamp);
+    void trimPreWindow();
+    uint32_t bufferedBytes() const;
+    void release();
+
+public:
+    FlightRecorder();
+    ~FlightRecorder();
+    
+    static FlightConfig defaultConfig();
+    
+    // Takes ownership of the stream, which already holds the PCAP header
+    bool arm(const FlightConfig& cfg, StorageStream* output);
+    void disarm();
+    bool trigger() { return fire(FLIGHT_TRIGGER_MANUAL, millis()); }
+    
+    // Ends the post-trigger window early, e.g. when the monitor stops
+    void closeWindow();
+    
+    // WiFi task; costs one copy per frame unless a trigger fires
+    void record(const uint8_t* frame, uint16_t len, int8_t rssi, uint32_t timestamp);
+    
+    // Worker; trims and drains the ring after a trigger. True once the dump is complete
+    bool service();
+    
+    uint8_t getState() const { return state; }
+    bool isActive() const { return state != FLIGHT_STATE_IDLE; }
+    uint8_t getFiredBy() const { return firedBy; }
+    uint32_t getTriggerTime() const { return triggerTime; }
+    uint32_t getCapacity() const { return capacity; }
+    uint32_t getBufferedBytes() const { return bufferedBytes(); }
+    bool isInPSRAM() const { return inPSRAM; }
+    const FlightConfig& getConfig() const { return config; }
+    uint32_t getFramesRecorded() const { return framesRecorded; }
+    uint32_t getFramesEvicted() const { return framesEvicted; }
+    uint32_t getFramesDropped() const { return framesDropped; }
+    uint32_t getBytesDumped() const { return bytesDumped; }
+    
+    static const char* stateName(uint8_t state);
+    static const char* triggerName(uint8_t trigger);
+};
+
+#endif // FLIGHT_RECORDER_H
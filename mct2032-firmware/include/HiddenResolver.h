@@ -0,0 +1,76 @@
+/**
+ * Hidden Resolver for MCT2032
+ * Passive recovery of the SSIDs behind hidden-network beacons
+ *
+ * Hidden APs beacon with an empty or zeroed SSID, but still answer directed
+ * probes and accept associations by name. BSSIDs seen hidden, from beacons
+ * or scan results, go into a small BSSID-keyed pending table. Probe
+ * responses and (re)association requests for a pending BSSID carry the real
+ * SSID, which is stored against it and posted as an AP event. Frames for
+ * other BSSIDs cost one table lookup; nothing else is parsed.
+ *
+ * Pending entries not heard from within HIDDEN_EXPIRY_MS are ignored and
+ * recycled by the table. Resolved names are kept while the AP keeps
+ * beaconing, so later scans can be filled in too.
+ */
+
+#ifndef HIDDEN_RESOLVER_H
+#define HIDDEN_RESOLVER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include "MacTable.h"
+#include "ApEvents.h"
+#include "Dot11.h"
+
+#define HIDDEN_APS              32
+#define HIDDEN_EXPIRY_MS        600000
+
+// Where a name came from, also the AP event kind
+#define HIDDEN_SOURCE_PROBE_RESP    1
+#define HIDDEN_SOURCE_ASSOC_REQ     2
+#define HIDDEN_SOURCE_REASSOC_REQ   3
+
+struct HiddenAp {
+    uint32_t lastSeen;          // Last hidden beacon or scan result
+    uint32_t resolvedAt;
+    uint8_t channel;
+    uint8_t ssidLen;            // 0 while pending
+    uint8_t source;             // HIDDEN_SOURCE_*
+    char ssid[DOT11_SSID_MAX + 1];
+};
+
+class HiddenResolver {
+private:
+    MacTable<HiddenAp, HIDDEN_APS> aps;
+    ApEventQueue* events;
+    uint32_t resolved;
+    portMUX_TYPE lock;
+    
+    void resolve(const uint8_t* frame, uint16_t len, uint16_t offset, uint8_t source, uint32_t now);
+    void track(const uint8_t* bssid, uint8_t channel, uint32_t now);
+
+public:
+    HiddenResolver();
+    
+    void begin(ApEventQueue* queue);
+    
+    // Promiscuous callback
+    void observeBeacon(const uint8_t* frame, uint16_t len, uint8_t rxChannel, uint32_t now);
+    void observeProbeResponse(const uint8_t* frame, uint16_t len, uint32_t now);
+    void observeAssocRequest(const uint8_t* frame, uint16_t len, bool reassoc, uint32_t now);
+    
+    // Command worker, for hidden scan results
+    void observeScan(const uint8_t* bssid, uint8_t channel, uint32_t now);
+    
+    // Copies the resolved SSID into ssid, false when unknown
+    bool lookup(const uint8_t* bssid, char* ssid, size_t len);
+    
+    uint16_t getPending(uint32_t now);
+    uint32_t getResolved() const { return resolved; }
+    
+    static bool isHidden(const uint8_t* ssid, uint8_t len);
+    static const char* sourceName(uint8_t source);
+};
+
+#endif // HIDDEN_RESOLVER_H
@@ -0,0 +1,44 @@
+/**
+ * HyperLogLog for MCT2032
+ * Fixed-size distinct-count sketches over 64-bit keys
+ *
+ * A sketch is HLL_REGISTERS bytes owned by the caller. Adding is a hash and
+ * one byte max; merging is a byte-wise max, so sketches for different
+ * channels or time windows combine losslessly into one for their union.
+ * With 256 registers the standard error is about 6.5%.
+ */
+
+#ifndef HYPER_LOG_LOG_H
+#define HYPER_LOG_LOG_H
+
+#include <Arduino.h>
+
+#define HLL_PRECISION           8
+#define HLL_REGISTERS           (1 << HLL_PRECISION)
+
+class HyperLogLog {
+public:
+    // 64-bit finalizer, so addresses from one vendor still spread evenly
+    static uint64_t hash(uint64_t key) {
+        key ^= key >> 33;
+        key *= 0xFF51AFD7ED558CCDULL;
+        key ^= key >> 33;
+        key *= 0xC4CEB9FE1A85EC53ULL;
+        key ^= key >> 33;
+        return key;
+    }
+    
+    static void add(uint8_t* registers, uint64_t hashed) {
+        uint16_t index = hashed >> (64 - HLL_PRECISION);
+        uint64_t rest = hashed << HLL_PRECISION;
+        uint8_t rank = rest ? __builtin_clzll(rest) + 1 : 64 - HLL_PRECISION + 1;
+        if (rank > registers[index]) {
+            registers[index] = rank;
+        }
+    }
+    
+    static void merge(uint8_t* into, const uint8_t* from);
+    static uint32_t estimate(const uint8_t* registers);
+};
+
+#endif // HYPER_LOG_LOG_H
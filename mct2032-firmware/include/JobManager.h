@@ -0,0 +1,75 @@
+/**
+ * Job Manager for MCT2032
+ * Tracks long-running operations and the resources they hold
+ */
+
+#ifndef JOB_MANAGER_H
+#define JOB_MANAGER_H
+
+#include <Arduino.h>
+
+#define MAX_JOBS            6
+
+// Job types
+#define JOB_SCAN            0
+#define JOB_MONITOR         1
+#define JOB_CAPTURE         2
+#define JOB_EXPORT          3
+#define JOB_STATS_STREAM    4
+#define JOB_FLIGHT          5
+#define JOB_TYPE_COUNT      6
+
+// Job states
+#define JOB_STATE_FREE      0
+#define JOB_STATE_RUNNING   1
+#define JOB_STATE_DONE      2
+#define JOB_STATE_CANCELLED 3
+#define JOB_STATE_FAILED    4
+
+// Resources a job can claim, either exclusively or shared
+#define JOB_RES_RADIO       0x01
+#define JOB_RES_SD          0x02
+#define JOB_RES_BLE_BW      0x04
+
+#define JOB_PROGRESS_UNKNOWN 0xFF
+
+struct Job {
+    uint16_t id;
+    uint8_t type;
+    uint8_t state;
+    uint8_t progress;           // Percent, or JOB_PROGRESS_UNKNOWN
+    uint8_t reportedProgress;   // Last progress sent to the client
+    uint8_t exclusiveClaims;
+    uint8_t sharedClaims;
+    uint16_t parentId;          // Job this one depends on, 0 if none
+    uint32_t startTime;
+    uint32_t duration;          // Auto-stop after this many ms, 0 = until stopped
+    uint32_t interval;          // Period for periodic jobs
+    uint32_t lastTick;          // Last periodic step
+    uint32_t lastEventTime;     // Last progress event sent
+};
+
+class JobManager {
+private:
+    Job jobs[MAX_JOBS];
+    uint16_t nextId;
+    
+public:
+    JobManager();
+    
+    // Returns nullptr and sets reason if the claims conflict with a running job
+    Job* start(uint8_t type, uint8_t exclusiveClaims, uint8_t sharedClaims, const char** reason);
+    void release(Job* job);
+    
+    Job* find(uint16_t id);
+    Job* findByType(uint8_t type);
+    Job* getSlot(size_t index) { return &jobs[index]; }
+    
+    bool canClaim(uint8_t exclusiveClaims, uint8_t sharedClaims) const;
+    size_t getActiveCount() const;
+    
+    static const char* typeName(uint8_t type);
+    static const char* stateName(uint8_t state);
+};
+
+#endif // JOB_MANAGER_H
@@ -0,0 +1,153 @@
+/**
+ * MAC Table for MCT2032
+ * Fixed-size hash table keyed by 48-bit addresses, for per-transmitter state
+ *
+ * Open addressing over a power-of-two slot array with a short probe window.
+ * Slots are never emptied once used, so probe chains stay valid without
+ * tombstones: when a key is new and its window is full, the entry seen least
+ * recently in that window is replaced. Memory is fixed at construction and
+ * every operation is O(MAC_TABLE_PROBES).
+ *
+ * Entries must carry a uint32_t lastSeen field, which the table reads to
+ * pick a victim and the caller keeps up to date. Bits 48-62 of a key are free
+ * for callers that keep more than one entry per address.
+ */
+
+#ifndef MAC_TABLE_H
+#define MAC_TABLE_H
+
+#include <Arduino.h>
+
+#define MAC_TABLE_PROBES        8
+#define MAC_TABLE_USED          (1ULL << 63)
+
+inline uint64_t macToKey(const uint8_t* mac) {
+    uint64_t key = 0;
+    memcpy(&key, mac, 6);
+    return key;
+}
+
+inline void keyToMac(uint64_t key, uint8_t* mac) {
+    memcpy(mac, &key, 6);
+}
+
+#define MAC_STRING_LEN          18
+
+inline void macToString(const uint8_t* mac, char* out) {
+    snprintf(out, MAC_STRING_LEN, "%02X:%02X:%02X:%02X:%02X:%02X",
+             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+}
+
+// Reads "aa:bb:cc:dd:ee:ff" in either case; mac is left alone on failure
+inline bool parseMac(const char* text, uint8_t* mac) {
+    unsigned int b[6];
+    if (!text || sscanf(text, "%x:%x:%x:%x:%x:%x", &b[0], &b[1], &b[2], &b[3], &b[4], &b[5]) != 6) {
+        return false;
+    }
+    for (int i = 0; i < 6; i++) {
+        if (b[i] > 0xFF) {
+            return false;
+        }
+    }
+    for (int i = 0; i < 6; i++) {
+        mac[i] = (uint8_t)b[i];
+    }
+    return true;
+}
+
+template <typename Entry, uint16_t CAPACITY>
+class MacTable {
+    static_assert(CAPACITY >= MAC_TABLE_PROBES && (CAPACITY & (CAPACITY - 1)) == 0,
+                  "MacTable capacity must be a power of two");
+
+private:
+    uint64_t keys[CAPACITY];        // MAC_TABLE_USED | key, 0 when the slot is free
+    Entry entries[CAPACITY];
+    uint16_t used;
+    uint32_t evictions;
+    
+    static uint16_t home(uint64_t key) {
+        return (uint16_t)((key * 0x9E3779B97F4A7C15ULL) >> 48) & (CAPACITY - 1);
+    }
+
+public:
+    MacTable() {
+        clear();
+    }
+    
+    void clear() {
+        memset(keys, 0, sizeof(keys));
+        used = 0;
+        evictions = 0;
+    }
+    
+    Entry* find(uint64_t key) {
+        uint64_t tagged = key | MAC_TABLE_USED;
+        uint16_t slot = home(key);
+        for (uint8_t i = 0; i < MAC_TABLE_PROBES; i++) {
+            if (keys[slot] == tagged) {
+                return &entries[slot];
+            }
+            if (keys[slot] == 0) {
+                return nullptr;
+            }
+            slot = (slot + 1) & (CAPACITY - 1);
+        }
+        return nullptr;
+    }
+    
+    // New entries come back zeroed with *inserted set
+    Entry* findOrInsert(uint64_t key, bool* inserted) {
+        uint64_t tagged = key | MAC_TABLE_USED;
+        uint16_t slot = home(key);
+        uint16_t victim = slot;
+        for (uint8_t i = 0; i < MAC_TABLE_PROBES; i++) {
+            if (keys[slot] == tagged) {
+                *inserted = false;
+                return &entries[slot];
+            }
+            if (keys[slot] == 0) {
+                used++;
+                victim = slot;
+                break;
+            }
+            if ((int32_t)(entries[slot].lastSeen - entries[victim].lastSeen) < 0) {
+                victim = slot;
+            }
+            if (i == MAC_TABLE_PROBES - 1) {
+                evictions++;
+            }
+            slot = (slot + 1) & (CAPACITY - 1);
+        }
+        
+        keys[victim] = tagged;
+        memset(&entries[victim], 0, sizeof(Entry));
+        *inserted = true;
+        return &entries[victim];
+    }
+    
+    // fn(key, entry) for every used slot
+    template <typename Fn>
+    void forEach(Fn fn) const {
+        for (uint16_t slot = 0; slot < CAPACITY; slot++) {
+            if (keys[slot]) {
+                fn(keys[slot] & ~MAC_TABLE_USED, entries[slot]);
+            }
+        }
+    }
+    
+    template <typename Fn>
+    void forEach(Fn fn) {
+        for (uint16_t slot = 0; slot < CAPACITY; slot++) {
+            if (keys[slot]) {
+                fn(keys[slot] & ~MAC_TABLE_USED, entries[slot]);
+            }
+        }
+    }
+    
+    uint16_t getUsed() const { return used; }
+    uint16_t getCapacity() const { return CAPACITY; }
+    uint32_t getEvictions() const { return evictions; }
+};
+
+#endif // MAC_TABLE_H
@@ -0,0 +1,41 @@
+/**
+ * OUI Table for MCT2032
+ * Vendor lookup for MAC addresses from a table compiled into flash
+ *
+ * scripts/build-oui-table.py turns the IEEE MA-L registry into OuiData.h.
+ * OUIs are sorted and split by their first byte, so each entry keeps only
+ * its low 16 bits and a 16-bit vendor id. Vendor names are sorted and
+ * front-coded in buckets of OUI_NAME_BUCKET. A lookup is a binary search
+ * inside one first-byte range, and a name decodes at most one bucket;
+ * nothing is copied to RAM, so tables can hold vendor ids instead of names.
+ *
+ * OuiData.h is generated and not checked in. Without it the table is empty
+ * and every lookup returns OUI_UNKNOWN. Only standard headers are used so
+ * the script's host benchmark can build this file as is.
+ */
+
+#ifndef OUI_TABLE_H
+#define OUI_TABLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define OUI_UNKNOWN         0xFFFF
+#define OUI_NAME_MAX        32      // Longest vendor name, with the terminator
+#define OUI_NAME_BUCKET     16
+
+class OuiTable {
+public:
+    // Vendor id for an address or a 24-bit OUI; locally administered addresses have none
+    static uint16_t lookup(const uint8_t* mac);
+    static uint16_t lookup(uint32_t oui);
+    
+    // Copies the vendor's name, false for OUI_UNKNOWN
+    static bool name(uint16_t vendor, char* out, size_t len);
+    
+    static uint32_t getCount();
+    static uint16_t getVendorCount();
+    static uint32_t getFlashBytes();
+};
+
+#endif // OUI_TABLE_H
@@ -0,0 +1,82 @@
+/**
+ * Overload Controller for MCT2032
+ * Sheds per-frame analytics work when the promiscuous callback falls behind
+ *
+ * The callback's own run time is summed over short windows. When it takes
+ * more than OVERLOAD_HIGH_PCT of the window the controller steps down from
+ * full processing to 1-in-N sampling (N doubling each step), and past
+ * OVERLOAD_MAX_SAMPLE to counters only. It steps back up after several calm
+ * windows. Counters stay exact at every level; sampled frames carry a weight
+ * of N so analytics scale back to true totals.
+ */
+
+#ifndef OVERLOAD_CONTROLLER_H
+#define OVERLOAD_CONTROLLER_H
+
+#include <Arduino.h>
+
+// Levels
+#define OVERLOAD_FULL           0
+#define OVERLOAD_SAMPLED        1
+#define OVERLOAD_COUNTERS_ONLY  2
+
+#define OVERLOAD_WINDOW_MS      250
+#define OVERLOAD_HIGH_PCT       60      // Share of the window spent in the callback
+#define OVERLOAD_LOW_PCT        25
+#define OVERLOAD_CALM_WINDOWS   8       // Calm windows before stepping back up
+#define OVERLOAD_MAX_SAMPLE     64
+
+class OverloadController {
+private:
+    uint8_t level;
+    uint16_t sampleN;
+    uint16_t sampleTick;
+    
+    // Current window
+    uint32_t windowStart;
+    uint32_t busyUs;
+    uint8_t calmWindows;
+    uint8_t busyPct;            // Last completed window
+    
+    uint32_t framesShed;        // Frames that skipped analytics
+    uint32_t levelChanges;
+    
+    void evaluate(uint32_t now);
+    void setLevel(uint8_t newLevel, uint16_t n);
+
+public:
+    OverloadController();
+    
+    void reset();
+    
+    // Per frame: how many frames this one stands for in analytics, 0 to skip it
+    uint16_t admit() {
+        if (level == OVERLOAD_FULL) {
+            return 1;
+        }
+        if (level == OVERLOAD_SAMPLED && ++sampleTick >= sampleN) {
+            sampleTick = 0;
+            return sampleN;
+        }
+        framesShed++;
+        return 0;
+    }
+    
+    // Per frame, with the time the callback spent on it
+    void account(uint32_t elapsedUs, uint32_t now) {
+        busyUs += elapsedUs;
+        if (now - windowStart >= OVERLOAD_WINDOW_MS) {
+            evaluate(now);
+        }
+    }
+    
+    uint8_t getLevel() const { return level; }
+    uint16_t getSampleN() const { return level == OVERLOAD_SAMPLED ? sampleN : 1; }
+    uint8_t getBusyPercent() const { return busyPct; }
+    uint32_t getFramesShed() const { return framesShed; }
+    uint32_t getLevelChanges() const { return levelChanges; }
+    
+    static const char* levelName(uint8_t level);
+};
+
+#endif // OVERLOAD_CONTROLLER_H
@@ -11,8 +11,22 @@
 #include <esp_wifi.h>
 #include <vector>
 #include <functional>
-#include <SD.h>
-#include <FS.h>
+#include "Storage.h"
+#include "FlightRecorder.h"
+#include "CaptureFilter.h"
+#include "OverloadController.h"
+#include "SeqLossTracker.h"
+#include "RetryDedup.h"
+#include "TopTalkers.h"
+#include "DistinctCounters.h"
+#include "TrafficGraph.h"
+#include "AirtimeMeter.h"
+#include "PhyStats.h"
+#include "ProbeTracker.h"
+#include "DeviceClusters.h"
+#include "ApEvents.h"
+#include "RogueDetector.h"
+#include "HiddenResolver.h"
 
 // Frame types
 #define FRAME_TYPE_MGMT     0x00
@@ -27,6 +41,10 @@
 #define FRAME_SUBTYPE_AUTH          0x0B
 #define FRAME_SUBTYPE_ASSOC_REQ     0x00
 #define FRAME_SUBTYPE_ASSOC_RESP    0x01
+#define FRAME_SUBTYPE_REASSOC_REQ   0x02
+
+// Control frame subtypes
+#define FRAME_SUBTYPE_PS_POLL       0x0A
 
 struct PacketInfo {
     uint8_t type;
@@ -37,6 +55,7 @@ struct PacketInfo {
     uint8_t dstMAC[6];
     uint32_t timestamp;
     uint16_t length;
+    uint16_t weight;            // Frames this one stands for; above 1 when sampling under load
 };
 
 class PacketMonitor {
@@ -53,6 +72,46 @@ private:
     uint32_t mgmtCount;
     uint32_t ctrlCount;
     
+    // Capture filter, checked before any per-frame work
+    CaptureFilter filter;
+    uint32_t framesFiltered;
+    
+    // Load shedding for the analytics stages
+    OverloadController overload;
+    
+    // Radio-level loss, from sequence number gaps
+    SeqLossTracker seqLoss;
+    
+    // Optional drop of exact retransmissions ahead of stats and capture
+    RetryDedup dedup;
+    bool dedupEnabled;
+    
+    // Heavy hitters over a sliding window, fed with the analytics
+    TopTalkers talkers;
+    
+    // Unique devices per channel and window; kept across monitor sessions
+    DistinctCounters distinct;
+    
+    // Data traffic per station and BSSID, and who is using which AP
+    TrafficGraph traffic;
+    
+    // Time on air per channel, class and BSSID
+    AirtimeMeter airtime;
+    
+    // RF quality per channel from rx_ctrl
+    PhyStats phy;
+    
+    // Networks clients are probing for
+    ProbeTracker probes;
+    
+    // Physical devices behind rotating probe addresses
+    DeviceClusters devices;
+    
+    // AP inventory checks, reporting through the event queue; kept across sessions
+    ApEventQueue events;
+    RogueDetector rogue;
+    HiddenResolver hidden;
+    
     // Timing
     uint32_t startTime;
     uint32_t lastPacketTime;
@@ -60,34 +119,49 @@ private:
     // Callbacks
     std::function<void(const PacketInfo&)> packetCallback;
     
-    // PCAP capture
+    // PCAP capture, written behind through storage
+    Storage* storage;
     bool pcapActive;
-    File pcapFile;
+    volatile bool pcapWriting;  // WiFi task is inside writePCAP_Packet
+    portMUX_TYPE pcapLock;
+    StorageStream* pcapStream;
+    uint32_t pcapDropped;
+    
+    // Pre-trigger ring, dumped to its own capture file
+    FlightRecorder flightRecorder;
     
     // Static callback for promiscuous mode
     static void promiscuousCallback(void* buf, wifi_promiscuous_pkt_type_t type);
     static PacketMonitor* instance;
     
     // Helper methods
-    void processMgmtFrame(const uint8_t* payload, uint16_t len, int8_t rssi);
-    void processDataFrame(const uint8_t* payload, uint16_t len, int8_t rssi);
-    void processCtrlFrame(const uint8_t* payload, uint16_t len, int8_t rssi);
+    // weight is the admit() decision (0 when shed); full is false only in counters-only mode
+    void processMgmtFrame(const uint8_t* payload, uint16_t len, int8_t rssi, uint16_t weight, bool full);
+    void processDataFrame(const uint8_t* payload, uint16_t len, int8_t rssi, uint16_t weight);
+    void processCtrlFrame(const uint8_t* payload, uint16_t len, int8_t rssi, uint16_t weight);
     
-    void writePCAP_GlobalHeader();
-    void writePCAP_PacketHeader(uint32_t ts_sec, uint32_t ts_usec, uint32_t len);
-    void writePCAP_PacketData(const uint8_t* data, uint32_t len);
+    static bool writePCAP_GlobalHeader(StorageStream* stream);
+    void writePCAP_Packet(uint32_t ts_sec, uint32_t ts_usec, const uint8_t* data, uint32_t len);
     
 public:
     PacketMonitor();
     
     void init();
+    void setStorage(Storage* s) { storage = s; }
     bool startMonitor(uint8_t channel = 0);
     void stopMonitor();
     bool isMonitoring() const { return monitoring; }
     
+    // Takes effect at the next startMonitor(); false while monitoring
+    bool setFilter(const CaptureFilter& f);
+    const CaptureFilter& getFilter() const { return filter; }
+    bool setDedup(bool enabled);
+    bool isDedupEnabled() const { return dedupEnabled; }
+    
     // Channel hopping
     void setChannel(uint8_t channel);
     void hopChannel();
+    uint8_t getChannel() const { return currentChannel; }
     
     // Packet injection
     bool injectPacket(const uint8_t* data, uint16_t len);
@@ -98,6 +172,12 @@ public:
     bool startPCAP(const char* filename);
     void stopPCAP();
     bool isPCAPActive() const { return pcapActive; }
+    uint32_t getPCAPDropped() const { return pcapDropped; }
+    
+    // Flight recorder
+    bool startFlightRecorder(const FlightConfig& config, const char* filename);
+    void stopFlightRecorder() { flightRecorder.disarm(); }
+    FlightRecorder& getFlightRecorder() { return flightRecorder; }
     
     // Statistics
     uint32_t getPacketsTotal() const { return packetsTotal; }
@@ -107,6 +187,20 @@ public:
     uint32_t getDeauthCount() const { return deauthCount; }
     uint32_t getDataCount() const { return dataCount; }
     uint32_t getMgmtCount() const { return mgmtCount; }
+    uint32_t getFramesFiltered() const { return framesFiltered; }
+    const OverloadController& getOverload() const { return overload; }
+    const SeqLossTracker& getSeqLoss() const { return seqLoss; }
+    const RetryDedup& getDedup() const { return dedup; }
+    TopTalkers& getTalkers() { return talkers; }
+    DistinctCounters& getDistinct() { return distinct; }
+    TrafficGraph& getTraffic() { return traffic; }
+    AirtimeMeter& getAirtime() { return airtime; }
+    const PhyStats& getPhy() const { return phy; }
+    ProbeTracker& getProbes() { return probes; }
+    DeviceClusters& getDevices() { return devices; }
+    ApEventQueue& getEvents() { return events; }
+    RogueDetector& getRogue() { return rogue; }
+    HiddenResolver& getHidden() { return hidden; }
     
     void resetStats();
     
@@ -0,0 +1,81 @@
+/**
+ * PHY Statistics for MCT2032
+ * Per-channel RSSI, noise floor, rate/MCS and bandwidth histograms
+ *
+ * Fixed buckets per channel, filled from rx_ctrl in the promiscuous callback.
+ * The callback is the only writer and every counter is a single aligned
+ * word, so there is no lock: a reader may see one channel part-way through
+ * a frame's update, never a torn counter. SNR is RSSI over the reported
+ * noise floor, kept as a running average in 1/16 dB.
+ *
+ * Binary blob (little endian, version PHY_BLOB_VERSION):
+ *   header   "MCTP" u8 version, u8 channel count, then u8 bucket count, i8
+ *            lowest bucket, u8 bucket width for RSSI and for noise floor,
+ *            then u8 rate bucket count
+ *   channel  u8 channel, varint frames, i16 SNR average in 1/16 dB, then
+ *            varint counts: RSSI buckets, noise buckets, rate buckets,
+ *            20 MHz, 40 MHz
+ *   trailer  u32 CRC-32 of all bytes before it
+ *
+ * Varints are unsigned LEB128. Values below the lowest bucket count in the
+ * first, values above the highest in the last. Rate buckets 0-15 are the
+ * legacy rate codes, 16-31 HT MCS 0-15 (VHT MCS maps onto the same slots).
+ */
+
+#ifndef PHY_STATS_H
+#define PHY_STATS_H
+
+#include <Arduino.h>
+#include <esp_wifi.h>
+
+#define PHY_CHANNELS            14
+#define PHY_RSSI_BUCKETS        16
+#define PHY_RSSI_BASE           -100
+#define PHY_RSSI_STEP           5
+#define PHY_NOISE_BUCKETS       8
+#define PHY_NOISE_BASE          -100
+#define PHY_NOISE_STEP          5
+#define PHY_RATE_LEGACY         16
+#define PHY_RATE_BUCKETS        32
+#define PHY_BW_BUCKETS          2
+
+#define PHY_BLOB_MAGIC          "MCTP"
+#define PHY_BLOB_VERSION        1
+#define PHY_BLOB_HEADER         13
+#define PHY_VARINT_MAX          5
+
+// Largest possible blob, every channel with full-width counts
+#define PHY_BLOB_MAX            (PHY_BLOB_HEADER + 4 + PHY_CHANNELS * (3 + PHY_VARINT_MAX * \
+                                 (1 + PHY_RSSI_BUCKETS + PHY_NOISE_BUCKETS + PHY_RATE_BUCKETS + PHY_BW_BUCKETS)))
+
+struct PhyChannel {
+    uint32_t frames;
+    int32_t snrX16;             // Running average, 1/16 dB
+    uint32_t rssi[PHY_RSSI_BUCKETS];
+    uint32_t noise[PHY_NOISE_BUCKETS];
+    uint32_t rate[PHY_RATE_BUCKETS];
+    uint32_t bandwidth[PHY_BW_BUCKETS];
+};
+
+class PhyStats {
+private:
+    PhyChannel channels[PHY_CHANNELS];
+    
+    static uint8_t bucket(int16_t value, int16_t base, uint8_t step, uint8_t count);
+
+public:
+    PhyStats();
+    
+    void reset();
+    
+    // Promiscuous callback only
+    void observe(const wifi_pkt_rx_ctrl_t& ctrl);
+    
+    const PhyChannel& getChannel(uint8_t channel) const { return channels[channel - 1]; }
+    
+    // Channels in mask (bit n for channel n) that have frames; returns the
+    // length, or 0 if out is smaller than needed
+    size_t serialize(uint8_t* out, size_t cap, uint16_t channelMask) const;
+};
+
+#endif // PHY_STATS_H
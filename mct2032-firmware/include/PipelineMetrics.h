@@ -0,0 +1,108 @@
+/**
+ * Pipeline Metrics for MCT2032
+ * Per-stage counts, drops and cycle-count latency histograms for the capture path
+ *
+ * Frames pass driver receipt (rx), the capture filter, retry
+ * de-duplication, analysis, PCAP capture, the write-behind queue to the card and, for results, BLE
+ * streaming to the client. Each stage counts what enters it, what it drops,
+ * and how many CPU cycles it took in log2 buckets, so the point where frames
+ * are lost at a given rate can be read straight off GET_METRICS.
+ *
+ * Each core has its own cycle counter and the two are not in step, so stages
+ * timed in tasks free to move between cores (BLE streaming, and queue appends
+ * from the worker tasks) use esp_timer instead, converted to cycles at the
+ * current CPU clock so every stage reports in the same unit.
+ *
+ * Built only with MCT_PIPELINE_METRICS=1 (see platformio.ini). Otherwise the
+ * PIPE_* macros expand to nothing and the capture path is unchanged.
+ */
+
+#ifndef PIPELINE_METRICS_H
+#define PIPELINE_METRICS_H
+
+// Cycle counters are a device feature; host builds of shared code never measure
+#ifndef ARDUINO
+#undef MCT_PIPELINE_METRICS
+#endif
+#ifndef MCT_PIPELINE_METRICS
+#define MCT_PIPELINE_METRICS 0
+#endif
+
+#if MCT_PIPELINE_METRICS
+
+#include <Arduino.h>
+#include <esp_timer.h>
+
+// Stages
+#define PIPE_STAGE_RX           0   // Whole promiscuous callback, every frame from the driver
+#define PIPE_STAGE_FILTER       1   // Capture filter; drops are rejected frames
+#define PIPE_STAGE_DEDUP        2   // Retry de-duplication; drops are retransmissions
+#define PIPE_STAGE_ANALYSIS     3   // Counters and analytics; drops are frames shed under load
+#define PIPE_STAGE_PCAP         4   // PCAP record into the write-behind stream
+#define PIPE_STAGE_QUEUE        5   // Write-behind append; drops are records refused when full
+#define PIPE_STAGE_STREAM       6   // BLE notifications to the client
+#define PIPE_STAGE_COUNT        7
+
+// Bucket i holds samples of 2^i to 2^(i+1)-1 cycles; the last is open ended
+#define PIPE_HIST_BUCKETS       24
+
+struct PipelineStage {
+    uint32_t count;
+    uint32_t drops;
+    uint32_t cyclesMax;
+    uint64_t cyclesTotal;
+    uint32_t histogram[PIPE_HIST_BUCKETS];
+};
+
+// Updated without locks; a rare lost increment between tasks is accepted
+class PipelineMetrics {
+private:
+    PipelineStage stages[PIPE_STAGE_COUNT];
+
+public:
+    PipelineMetrics();
+    
+    void reset();
+    
+    void record(uint8_t stage, uint32_t cycles) {
+        PipelineStage& s = stages[stage];
+        s.count++;
+        s.cyclesTotal += cycles;
+        if (cycles > s.cyclesMax) {
+            s.cyclesMax = cycles;
+        }
+        uint8_t bucket = cycles ? 31 - __builtin_clz(cycles) : 0;
+        s.histogram[bucket < PIPE_HIST_BUCKETS ? bucket : PIPE_HIST_BUCKETS - 1]++;
+    }
+    
+    void drop(uint8_t stage) {
+        stages[stage].drops++;
+    }
+    
+    const PipelineStage& getStage(uint8_t stage) const { return stages[stage]; }
+    
+    static const char* stageName(uint8_t stage);
+};
+
+extern PipelineMetrics pipelineMetrics;
+
+#define PIPE_START(var)         uint32_t var = ESP.getCycleCount()
+#define PIPE_STOP(stage, var)   pipelineMetrics.record(stage, ESP.getCycleCount() - (var))
+#define PIPE_DROP(stage)        pipelineMetrics.drop(stage)
+
+// For code that may run on either core; microsecond resolution
+#define PIPE_START_ANY_CORE(var)        int64_t var = esp_timer_get_time()
+#define PIPE_STOP_ANY_CORE(stage, var)  \
+    pipelineMetrics.record(stage, (uint32_t)(esp_timer_get_time() - (var)) * ESP.getCpuFreqMHz())
+
+#else
+
+#define PIPE_START(var)
+#define PIPE_STOP(stage, var)
+#define PIPE_DROP(stage)
+#define PIPE_START_ANY_CORE(var)
+#define PIPE_STOP_ANY_CORE(stage, var)
+
+#endif // MCT_PIPELINE_METRICS
+
+#endif // PIPELINE_METRICS_H
@@ -0,0 +1,137 @@
+/**
+ * Probe Tracker for MCT2032
+ * Which networks clients probe for, in fixed memory
+ *
+ * SSIDs from directed probe requests are interned once: the bytes go into a
+ * packed arena and each SSID gets a small id, found again through a hash
+ * index. Every client keeps the ids of the first PROBE_CLIENT_SET SSIDs it
+ * asks for; past that, further SSIDs go into a 64-bit Bloom filter on the
+ * SSID hash, which answers "seen before?" but cannot list them. Each SSID
+ * counts the distinct clients probing it as pairs are first seen.
+ *
+ * The promiscuous callback only ever appends. The worker's service() keeps
+ * PROBE_FREE_IDS ids and PROBE_FREE_BYTES of arena free by dropping the
+ * SSIDs heard least recently: one client pass takes them out of every set,
+ * one pass in arena order compacts the arena and the index is rebuilt, so
+ * memory stays fixed however long the session runs. A new SSID that finds
+ * the headroom used up before the worker comes round is counted and not
+ * tracked. Client counts are lower bounds once Bloom filters are in use,
+ * and a client that drops out of the client table and returns is counted
+ * again.
+ */
+
+#ifndef PROBE_TRACKER_H
+#define PROBE_TRACKER_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include "MacTable.h"
+#include "Dot11.h"
+
+#define PROBE_SSIDS             128     // Interned SSIDs, at most 255
+#define PROBE_ARENA_BYTES       2048
+#define PROBE_INDEX_SLOTS       256     // Hash index, power of two
+#define PROBE_CLIENTS           128
+#define PROBE_CLIENT_SET        8       // SSIDs kept by id before the Bloom filter
+#define PROBE_BLOOM_HASHES      3
+#define PROBE_NO_SSID           0xFF
+#define PROBE_REPORT_MAX        16      // Most SSIDs or clients in one report
+#define PROBE_FREE_IDS          8       // Headroom kept for the callback
+#define PROBE_FREE_BYTES        256
+
+struct ProbeSsid {
+    uint32_t hash;
+    uint32_t lastSeen;
+    uint32_t probes;
+    uint16_t clients;
+    uint16_t offset;            // Into the arena
+    uint8_t len;
+    bool used;
+};
+
+struct ProbeClient {
+    uint32_t lastSeen;
+    uint32_t probes;
+    uint32_t wildcard;          // Broadcast probes with an empty SSID
+    uint64_t bloom;             // SSIDs past the set
+    uint8_t ids[PROBE_CLIENT_SET];
+    uint8_t idCount;
+    uint8_t overflow;           // SSIDs added to the Bloom filter, saturating
+};
+
+// Copies handed out to reports
+struct ProbeSsidReport {
+    char ssid[DOT11_SSID_MAX + 1];
+    uint16_t clients;
+    uint32_t probes;
+    uint32_t lastSeen;
+};
+
+struct ProbeClientReport {
+    uint8_t mac[6];
+    uint32_t probes;
+    uint32_t wildcard;
+    uint32_t lastSeen;
+    uint8_t overflow;
+    uint8_t ssidCount;
+    char ssids[PROBE_CLIENT_SET][DOT11_SSID_MAX + 1];
+};
+
+class ProbeTracker {
+private:
+    ProbeSsid ssids[PROBE_SSIDS];
+    char arena[PROBE_ARENA_BYTES];
+    uint16_t arenaUsed;
+    uint16_t ssidBytes;         // Live bytes in the arena
+    uint8_t ssidCount;
+    uint8_t order[PROBE_SSIDS];         // Ids in arena order, evicted ones included
+    uint8_t orderCount;
+    uint8_t index[PROBE_INDEX_SLOTS];   // Id + 1, 0 when free
+    MacTable<ProbeClient, PROBE_CLIENTS> clients;
+    
+    uint32_t probeFrames;
+    uint32_t wildcardFrames;
+    uint32_t ssidEvictions;
+    uint32_t ssidDrops;         // New SSIDs not tracked for want of headroom
+    portMUX_TYPE lock;
+    
+    // Called with the lock held
+    uint8_t lookup(uint32_t hash, const uint8_t* ssid, uint8_t len) const;
+    uint8_t intern(uint32_t hash, const uint8_t* ssid, uint8_t len, uint32_t now);
+    uint8_t evictStalest();
+    void compact();
+    bool needsSpace() const;
+    void rebuildIndex();
+    bool addToClient(ProbeClient* client, uint8_t id, uint32_t hash);
+    void copySsid(uint8_t id, char* out) const;
+    
+    static uint32_t hashSsid(const uint8_t* ssid, uint8_t len);
+    static uint64_t bloomBits(uint32_t hash);
+
+public:
+    ProbeTracker();
+    
+    void reset();
+    
+    // Promiscuous callback, probe requests only; probe counts are scaled by
+    // the sample weight, client counts are of distinct pairs and are not
+    void observe(const uint8_t* frame, uint16_t len, uint16_t weight, uint32_t now);
+    
+    // Worker: restore the callback's headroom
+    void service();
+    
+    // Most clients first
+    uint8_t getTopSsids(ProbeSsidReport* out, uint8_t k);
+    
+    // Clients probing the most SSIDs first, or just the one given
+    uint8_t getClients(ProbeClientReport* out, uint8_t k, const uint8_t* only);
+    
+    uint32_t getProbeFrames() const { return probeFrames; }
+    uint32_t getWildcardFrames() const { return wildcardFrames; }
+    uint8_t getSsidCount() const { return ssidCount; }
+    uint32_t getSsidEvictions() const { return ssidEvictions; }
+    uint32_t getSsidDrops() const { return ssidDrops; }
+    uint16_t getClientCount() const { return clients.getUsed(); }
+};
+
+#endif // PROBE_TRACKER_H
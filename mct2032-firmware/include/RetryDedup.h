@@ -0,0 +1,46 @@
+/**
+ * Retry De-duplication for MCT2032
+ * Drops exact retransmissions before they reach stats and capture
+ *
+ * A frame with the retry bit set whose sequence control field (number and
+ * fragment) matches one of the last few frames from the same transmitter,
+ * or the same QoS TID, is a copy of a frame already passed on. Each
+ * sequence space keeps a tiny ring of recent values in a bounded MacTable,
+ * so a check is one table probe and a handful of compares in fixed memory.
+ */
+
+#ifndef RETRY_DEDUP_H
+#define RETRY_DEDUP_H
+
+#include <Arduino.h>
+#include "MacTable.h"
+
+#define DEDUP_TABLE_SIZE        256
+#define DEDUP_RECENT            4       // Sequence control values kept per space
+
+struct DedupEntry {
+    uint32_t lastSeen;
+    uint16_t recent[DEDUP_RECENT];
+    uint8_t next;
+    uint8_t filled;
+};
+
+class RetryDedup {
+private:
+    MacTable<DedupEntry, DEDUP_TABLE_SIZE> table;
+    uint32_t duplicates;
+    uint32_t bytesSaved;
+
+public:
+    RetryDedup();
+    
+    void reset();
+    
+    // Promiscuous callback; true for a retransmission of a frame already passed
+    bool isDuplicate(const uint8_t* frame, uint16_t len, uint32_t now);
+    
+    uint32_t getDuplicates() const { return duplicates; }
+    uint32_t getBytesSaved() const { return bytesSaved; }
+};
+
+#endif // RETRY_DEDUP_H
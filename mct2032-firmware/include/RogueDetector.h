@@ -0,0 +1,155 @@
+/**
+ * Rogue Detector for MCT2032
+ * Evil-twin and rogue AP checks over the passive AP inventory
+ *
+ * Beacons from the monitor and WiFiScanner results feed one inventory: a
+ * MacTable of APs and a hashed SSID -> BSSID-set index. Every beacon costs
+ * one AP lookup, one SSID group lookup and a pass over that group's few
+ * members, and is checked for:
+ *   - the SSID advertised with a different security class than its group
+ *   - the SSID from a vendor OUI no other member of its group uses
+ *   - a BSSID missing from the SSID's allow-list, when one is configured
+ *   - the AP moving channel
+ *   - a change of beacon interval, or a TSF that does not follow the local
+ *     clock since the last beacon, as a clone interleaving its own beacons
+ *     or a restarted impostor would show; the TSF slack grows with the gap
+ *     so clock drift over a long absence is not taken for a reset
+ *
+ * A hidden AP's beacons carry no name while scans and probe responses do,
+ * so a sighting without a name never replaces the name an AP already has,
+ * and a first name for an AP only seen hidden is not an SSID change.
+ *
+ * Alerts go out as AP events. Each kind is raised at most once per AP per
+ * ROGUE_REALERT_MS. Hidden SSIDs only get the per-AP checks. The inventory
+ * persists across monitor sessions; allow-lists are set from the client.
+ */
+
+#ifndef ROGUE_DETECTOR_H
+#define ROGUE_DETECTOR_H
+
+#include <Arduino.h>
+#include <esp_wifi.h>
+#include <freertos/FreeRTOS.h>
+#include "MacTable.h"
+#include "ApEvents.h"
+
+#define ROGUE_APS               128
+#define ROGUE_SSIDS             64
+#define ROGUE_SSID_SLOTS        128     // Hash index, power of two
+#define ROGUE_GROUP_BSSIDS      8
+#define ROGUE_GROUP_OUIS        4
+#define ROGUE_ALLOW_SSIDS       4
+#define ROGUE_ALLOW_BSSIDS      8
+#define ROGUE_TSF_SLACK_US      100000  // TSF may stray this far from the local clock
+#define ROGUE_TSF_DRIFT_PPM     200     // Plus this share of the time since the last beacon
+#define ROGUE_REALERT_MS        60000
+#define ROGUE_NONE              0xFF
+
+// Alert kinds, also used as the survey log alert kind
+#define ROGUE_ALERT_SECURITY    1
+#define ROGUE_ALERT_VENDOR      2
+#define ROGUE_ALERT_UNLISTED    3
+#define ROGUE_ALERT_CHANNEL     4
+#define ROGUE_ALERT_INTERVAL    5
+#define ROGUE_ALERT_TSF         6
+
+// Security classes, weakest first
+#define ROGUE_SEC_OPEN          0
+#define ROGUE_SEC_WEP           1
+#define ROGUE_SEC_WPA           2
+#define ROGUE_SEC_WPA2          3
+#define ROGUE_SEC_WPA3          4
+
+struct RogueAp {
+    uint32_t lastSeen;
+    uint32_t ssidHash;          // 0 while hidden and not yet named
+    uint64_t lastTsf;
+    uint32_t lastBeacon;        // Local time of lastTsf; 0 before the first beacon
+    uint32_t lastAlert;
+    uint16_t interval;          // TU
+    uint8_t channel;
+    uint8_t alerted;            // Bit per alert kind since lastAlert
+};
+
+struct RogueGroup {
+    uint32_t hash;
+    uint32_t lastSeen;
+    uint64_t bssids[ROGUE_GROUP_BSSIDS];
+    uint32_t ouis[ROGUE_GROUP_OUIS];
+    uint8_t bssidCount;
+    uint8_t ouiCount;
+    uint8_t security;           // As first seen
+    uint8_t allow;              // Allow-list index or ROGUE_NONE
+    bool used;
+};
+
+struct RogueAllow {
+    uint32_t hash;
+    uint64_t bssids[ROGUE_ALLOW_BSSIDS];
+    uint8_t count;
+    bool used;
+};
+
+// One AP sighting, from a beacon or a scan result
+struct RogueSighting {
+    const uint8_t* bssid;
+    const uint8_t* ssid;
+    uint8_t ssidLen;
+    uint8_t channel;
+    uint8_t security;
+    bool timing;                // tsf and interval are valid
+    uint64_t tsf;
+    uint16_t interval;
+};
+
+class RogueDetector {
+private:
+    MacTable<RogueAp, ROGUE_APS> aps;
+    RogueGroup groups[ROGUE_SSIDS];
+    uint8_t index[ROGUE_SSID_SLOTS];    // Group + 1, 0 when free
+    RogueAllow allows[ROGUE_ALLOW_SSIDS];
+    ApEventQueue* events;
+    uint32_t beacons;
+    uint32_t alerts;
+    portMUX_TYPE lock;
+    
+    // Called with the lock held
+    RogueGroup* findGroup(uint32_t hash, bool create, uint32_t now);
+    void rebuildIndex();
+    void checkGroup(RogueGroup* group, RogueAp* ap, uint64_t key, uint8_t security,
+                    ApEvent* out, uint8_t* count, uint32_t now);
+    bool raise(RogueAp* ap, uint8_t kind, uint32_t now);
+    int8_t findAllow(uint32_t hash) const;
+    
+    void observe(const RogueSighting& sighting, uint32_t now);
+    
+    static uint32_t ouiOf(uint64_t key);
+    static uint32_t hashSsid(const uint8_t* ssid, uint8_t len);
+
+public:
+    RogueDetector();
+    
+    void begin(ApEventQueue* queue);
+    
+    // Promiscuous callback, beacons only
+    void observeBeacon(const uint8_t* frame, uint16_t len, uint8_t rxChannel, uint32_t now);
+    
+    // Command worker, after a scan
+    void observeScan(const uint8_t* bssid, const char* ssid, uint8_t channel, wifi_auth_mode_t auth, uint32_t now);
+    
+    // Replaces the allow-list for an SSID; no BSSIDs removes it
+    bool setAllowList(const char* ssid, const uint8_t (*bssids)[6], uint8_t count);
+    uint8_t getAllowListCount() const;
+    
+    uint32_t getBeacons() const { return beacons; }
+    uint32_t getAlerts() const { return alerts; }
+    uint16_t getApCount() const { return aps.getUsed(); }
+    
+    static uint8_t securityFromAuth(wifi_auth_mode_t auth);
+    static uint8_t parseSecurity(const uint8_t* frame, uint16_t len, uint16_t offset, bool privacy);
+    static const char* kindName(uint8_t kind);
+    static const char* securityName(uint8_t security);
+    static void describe(const ApEvent& event, char* out, size_t len);
+};
+
+#endif // ROGUE_DETECTOR_H
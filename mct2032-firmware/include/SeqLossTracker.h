@@ -0,0 +1,93 @@
+/**
+ * Sequence Loss Tracker for MCT2032
+ * Estimates frames the radio missed from gaps in 802.11 sequence numbers
+ *
+ * Every transmitter numbers its frames modulo 4096, QoS data separately per
+ * TID. Following each sequence space in a bounded MacTable, a step of k
+ * means k-1 frames went by unheard. Retransmissions (same number, usually
+ * with the retry bit) are counted apart and never as loss. Gaps too large to
+ * be plain loss, a change of channel (an epoch) or a long silence resync the
+ * space instead of counting, so the estimate errs low rather than high.
+ */
+
+#ifndef SEQ_LOSS_TRACKER_H
+#define SEQ_LOSS_TRACKER_H
+
+#include <Arduino.h>
+#include "MacTable.h"
+
+#define SEQ_LOSS_TABLE_SIZE     256
+#define SEQ_LOSS_MAX_GAP        128     // Larger steps resync instead of counting as loss
+#define SEQ_LOSS_REORDER        64      // Steps back within this are late frames
+#define SEQ_LOSS_IDLE_MS        5000    // Silence after which a space resyncs
+#define SEQ_LOSS_CHANNELS       15      // Index by channel 1-14
+#define SEQ_LOSS_WORST          3       // Transmitters listed in reports
+
+// One sequence space: a transmitter, or one of its QoS TIDs
+struct SeqLossEntry {
+    uint32_t lastSeen;
+    uint32_t received;
+    uint32_t lost;
+    uint16_t retries;
+    uint16_t lastSeq;
+    uint8_t channel;
+    uint8_t epoch;
+};
+
+struct SeqLossChannel {
+    uint32_t received;
+    uint32_t lost;
+};
+
+struct SeqLossReport {
+    uint8_t mac[6];
+    int8_t tid;                 // -1 for management and non-QoS data
+    uint32_t received;
+    uint32_t lost;
+};
+
+class SeqLossTracker {
+private:
+    MacTable<SeqLossEntry, SEQ_LOSS_TABLE_SIZE> table;
+    SeqLossChannel channels[SEQ_LOSS_CHANNELS];
+    uint32_t received;
+    uint32_t lost;
+    uint32_t retries;
+    uint32_t reordered;
+    uint32_t resyncs;
+    uint8_t epoch;
+
+public:
+    SeqLossTracker();
+    
+    void reset();
+    
+    // Channel changed; every space resyncs on its next frame
+    void newEpoch() { epoch++; }
+    
+    // Promiscuous callback, every frame that passed the filter
+    void observe(const uint8_t* frame, uint16_t len, uint8_t channel, uint32_t now);
+    
+    uint32_t getReceived() const { return received; }
+    uint32_t getLost() const { return lost; }
+    uint32_t getRetries() const { return retries; }
+    uint32_t getReordered() const { return reordered; }
+    uint32_t getResyncs() const { return resyncs; }
+    uint16_t getTracked() const { return table.getUsed(); }
+    uint32_t getEvictions() const { return table.getEvictions(); }
+    const SeqLossChannel& getChannel(uint8_t channel) const { return channels[channel]; }
+    
+    // Sequence spaces with the most estimated loss, most first; returns how many
+    uint8_t getWorst(SeqLossReport* out, uint8_t maxCount) const;
+    
+    // Key of the sequence space a frame is numbered in, false when it has none
+    static bool spaceKey(const uint8_t* frame, uint16_t len, uint64_t* key);
+    
+    // Loss as a share of frames sent, in tenths of a percent
+    static uint16_t lossPermille(uint32_t received, uint32_t lost) {
+        uint32_t sent = received + lost;
+        return sent ? (uint16_t)((uint64_t)lost * 1000 / sent) : 0;
+    }
+};
+
+#endif // SEQ_LOSS_TRACKER_H
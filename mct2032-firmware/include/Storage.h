@@ -0,0 +1,208 @@
+/**
+ * Storage for MCT2032
+ * SD card mounting and buffered append streams written by one I/O task
+ *
+ * On the device the card is driven through SD_MMC in 1-bit mode. Built
+ * without ARDUINO, the same API writes to a directory on the host
+ * (MCT_STORAGE_ROOT, default /tmp/mct2032) so capture and export paths
+ * can be exercised and benchmarked on Linux.
+ */
+
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <FS.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#else
+#include <stdio.h>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#endif
+
+// SD card pins on the Waveshare ESP32-S3-LCD-1.47 (SDMMC, 1-bit bus)
+#define SD_PIN_CLK              14
+#define SD_PIN_CMD              15
+#define SD_PIN_D0               16
+#define STORAGE_MOUNT_POINT     "/sdcard"
+#define STORAGE_HOST_ROOT       "/tmp/mct2032"
+
+// Write-behind blocks; a multiple of the 512 byte sector so writes stay aligned
+#define STORAGE_BLOCK_SIZE      4096
+#define STORAGE_BLOCK_COUNT     6
+#define STORAGE_BLOCK_ALIGN     32
+#define STORAGE_MAX_STREAMS     4
+#define STORAGE_PATH_MAX        64
+
+// Write speed probe run at mount time
+#define STORAGE_SPEED_TEST_BYTES (64 * 1024)
+#define STORAGE_SPEED_TEST_FILE "/.speedtest"
+
+#define STORAGE_WAIT_FOREVER    0xFFFFFFFF
+#define STORAGE_STOP_MARKER     0xFF
+
+#define STORAGE_TASK_STACK_SIZE 4096
+#define STORAGE_TASK_PRIORITY   1
+
+#ifdef ARDUINO
+typedef File StorageFile;
+#else
+typedef FILE* StorageFile;
+#endif
+
+class Storage;
+
+// Append-only file fed through the write-behind queue
+class StorageStream {
+private:
+    friend class Storage;
+    
+    Storage* owner;
+    StorageFile file;
+    bool open;
+    bool closing;
+    int8_t current;             // Block being filled, -1 if none
+    uint32_t bytesQueued;
+    uint32_t bytesDropped;
+    char path[STORAGE_PATH_MAX];
+
+public:
+    StorageStream();
+    
+    // All-or-nothing; waitMs 0 never blocks, so it is safe from the WiFi task
+    bool write(const void* data, size_t len, uint32_t waitMs = 0);
+    bool writeRecord(const void* head, size_t headLen, const void* body, size_t bodyLen, uint32_t waitMs = 0);
+    
+    // Hands the partly filled block to the I/O task
+    void flush();
+    
+    // Like flush, and the file is flushed to the card (size and FAT included)
+    // right after that block is written, before any block queued later
+    void sync();
+    
+    // Queues everything written so far and closes the file behind it
+    void close();
+    
+    bool isOpen() const { return open && !closing; }
+    uint32_t getBytesQueued() const { return bytesQueued; }
+    uint32_t getBytesDropped() const { return bytesDropped; }
+    const char* getPath() const { return path; }
+};
+
+struct StorageStats {
+    uint32_t bytesWritten;
+    uint32_t blocksWritten;
+    uint32_t writeErrors;
+    uint32_t bytesDropped;
+    uint32_t writeTimeUs;       // Time spent in the I/O task writing blocks
+    uint32_t writeMaxUs;
+    uint8_t pendingHigh;        // Most blocks ever waiting for the I/O task
+};
+
+class Storage {
+private:
+    friend class StorageStream;
+    
+    bool mounted;
+    uint64_t totalBytes;
+    uint64_t usedBytes;
+    uint32_t writeSpeedKBps;    // Measured at mount
+    
+    uint8_t* blockMemory;
+    uint8_t* blocks[STORAGE_BLOCK_COUNT];
+    uint16_t blockUsed[STORAGE_BLOCK_COUNT];
+    uint8_t blockStream[STORAGE_BLOCK_COUNT];
+    bool blockClose[STORAGE_BLOCK_COUNT];
+    bool blockSync[STORAGE_BLOCK_COUNT];
+    
+    StorageStream streams[STORAGE_MAX_STREAMS];
+    StorageStats stats;
+
+#ifdef ARDUINO
+    QueueHandle_t freeQueue;
+    QueueHandle_t pendingQueue;
+    SemaphoreHandle_t streamLock;
+    TaskHandle_t ioTask;
+    
+    static void ioTaskEntry(void* arg);
+#else
+    char hostRoot[STORAGE_PATH_MAX];
+    std::thread ioThread;
+    std::timed_mutex streamLock;
+    std::mutex queueLock;
+    std::condition_variable queueSignal;
+    std::deque<uint8_t> freeBlocks;
+    std::deque<uint8_t> pendingBlocks;
+    bool stopping;
+#endif
+    
+    // Platform glue
+    bool backendMount();
+    void backendUnmount();
+    void backendRefreshUsage();
+    StorageFile backendOpen(const char* path, bool truncate);
+    size_t backendWrite(StorageFile& file, const uint8_t* data, size_t len);
+    void backendSync(StorageFile& file);
+    void backendClose(StorageFile& file);
+    bool backendRemove(const char* path);
+    bool backendExists(const char* path);
+    uint32_t nowMicros() const;
+    
+    bool lockStreams(uint32_t waitMs);
+    void unlockStreams();
+    bool takeFreeBlock(uint8_t* index, uint32_t waitMs);
+    size_t getFreeBlockCount();
+    size_t getHeldBlockCount() const;
+    void queueBlock(uint8_t index);
+    bool nextPendingBlock(uint8_t* index);
+    void returnBlock(uint8_t index);
+    
+    bool startIO();
+    void stopIO();
+    void ioLoop();
+    void writeBlock(uint8_t index);
+    
+    bool append(StorageStream* stream, const void* head, size_t headLen,
+                const void* body, size_t bodyLen, uint32_t waitMs);
+    void submitCurrent(StorageStream* stream, bool close, bool sync = false);
+    
+    void measureWriteSpeed();
+
+public:
+    Storage();
+    ~Storage();
+    
+    // Mounts the card and starts the I/O task; false if no card
+    bool begin();
+    void end();
+    
+    bool isMounted() const { return mounted; }
+    uint64_t getTotalBytes() const { return totalBytes; }
+    uint64_t getUsedBytes() const { return usedBytes; }
+    uint32_t getWriteSpeed() const { return writeSpeedKBps; }
+    const StorageStats& getStats() const { return stats; }
+    size_t getOpenStreamCount() const;
+    
+    // Returns nullptr when unmounted, out of stream slots or the open fails
+    StorageStream* openAppend(const char* path, bool truncate = false);
+    
+    bool remove(const char* path);
+    bool exists(const char* path);
+    
+    // Synchronous reads for small files (bypass the write-behind queue)
+    size_t readFile(const char* path, uint32_t offset, uint8_t* data, size_t len);
+    uint32_t fileSize(const char* path);
+    
+    void refreshUsage() { backendRefreshUsage(); }
+};
+
+#endif // STORAGE_H
@@ -0,0 +1,146 @@
+/**
+ * Survey Log for MCT2032
+ * Append-only record of scans, statistics and alerts that survives reboots
+ *
+ * Every record is a 12 byte header (magic, type, payload length, uptime ms,
+ * CRC-32 of type/length/time and payload) followed by its payload. A
+ * checkpoint record carries the survey totals and is followed by the AP
+ * list, so replay only has to start at the newest checkpoint. Checkpoint
+ * offsets go to a sidecar index.
+ *
+ * Records collect in a storage block in RAM until it fills, so scan, stats
+ * and alert records sync the log as they are written; at most the records
+ * since the last of those are lost in a crash. A checkpoint syncs the log
+ * before its index entry is written and syncs the index after it, and the
+ * single storage I/O task does both in that order, so the index never
+ * points past what is on the card.
+ */
+
+#ifndef SURVEY_LOG_H
+#define SURVEY_LOG_H
+
+#include <Arduino.h>
+#include "Storage.h"
+#include "WiFiScanner.h"
+#include "PacketMonitor.h"
+#include "ChannelAnalyzer.h"
+
+#define SURVEY_LOG_FILE         "/survey.log"
+#define SURVEY_INDEX_FILE       "/survey.idx"
+
+#define SURVEY_RECORD_MAGIC     0xA5
+#define SURVEY_HEADER_SIZE      12
+#define SURVEY_MAX_PAYLOAD      240
+
+// Record types
+#define SURVEY_REC_SESSION      1   // Boot marker: u32 session
+#define SURVEY_REC_SCAN         2   // Scan result follows: u8 channel, u16 AP count
+#define SURVEY_REC_AP           3   // MAC, channel, rssi, auth, hidden, SSID
+#define SURVEY_REC_STATS        4   // Monitor counter deltas since the previous record
+#define SURVEY_REC_ALERT        5   // u8 kind, u8 severity, MAC, text
+#define SURVEY_REC_CHECKPOINT   6   // Totals, followed by the AP list like a scan
+
+// Checkpoint once this many records or bytes have gone by
+#define SURVEY_CHECKPOINT_RECORDS   512
+#define SURVEY_CHECKPOINT_BYTES     (32 * 1024)
+
+// Monitor counters are logged at this period while monitoring
+#define SURVEY_STATS_INTERVAL   10000
+
+// How long a log write may wait for a storage buffer
+#define SURVEY_WRITE_WAIT_MS    100
+
+// Replay reads the log in chunks of this size
+#define SURVEY_READ_CHUNK       1024
+
+// Alert severities
+#define SURVEY_SEVERITY_INFO    0
+#define SURVEY_SEVERITY_WARNING 1
+#define SURVEY_SEVERITY_CRITICAL 2
+
+struct SurveyTotals {
+    uint32_t packets;
+    uint32_t beacons;
+    uint32_t probes;
+    uint32_t deauths;
+    uint32_t data;
+    uint32_t mgmt;
+    uint32_t scans;
+    uint32_t alerts;
+};
+
+struct SurveyReplayStats {
+    uint32_t startOffset;       // Where replay began (a checkpoint, or 0)
+    uint32_t records;           // Records applied
+    uint32_t skippedBytes;      // Corrupt or torn bytes stepped over
+    uint32_t durationMs;
+};
+
+class SurveyLog {
+private:
+    Storage* storage;
+    WiFiScanner* wifiScanner;
+    PacketMonitor* packetMonitor;
+    ChannelAnalyzer* channelAnalyzer;
+    
+    StorageStream* stream;
+    StorageStream* indexStream;
+    uint32_t logOffset;         // File size when opened; stream bytes are added on top
+    uint32_t session;
+    
+    SurveyTotals totals;
+    SurveyReplayStats replay;
+    
+    // Checkpoint scheduling
+    uint32_t recordsSinceCheckpoint;
+    uint32_t bytesSinceCheckpoint;
+    uint32_t recordsWritten;
+    uint32_t checkpointsWritten;
+    uint32_t writeFailures;
+    
+    // Monitor counters as of the last stats record, for deltas
+    bool wasMonitoring;
+    uint32_t lastStatsTime;
+    uint32_t lastCounters[6];
+    
+    uint32_t currentOffset() const;
+    bool writeRecord(uint8_t type, const uint8_t* payload, size_t len);
+    bool writeNetwork(const NetworkInfo& net);
+    void writeNetworks(const std::vector<NetworkInfo>& networks);
+    void logStats();
+    void readCounters(uint32_t* counters) const;
+    void clearNetworks();
+    
+    // Replay
+    uint32_t findReplayStart();
+    bool readRecordAt(uint32_t offset, uint8_t* type, uint8_t* payload, uint16_t* len);
+    void applyRecord(uint8_t type, const uint8_t* payload, uint16_t len);
+    void restoreNetwork(const uint8_t* payload, uint16_t len);
+    
+    static bool parseHeader(const uint8_t* header, uint8_t* type, uint16_t* len, uint32_t* crc);
+    static uint32_t recordChecksum(const uint8_t* header, const uint8_t* payload, uint16_t len);
+
+public:
+    SurveyLog(Storage* store, WiFiScanner* wifi, PacketMonitor* monitor, ChannelAnalyzer* analyzer);
+    
+    // Replays the existing log, then opens it for appending and starts a new session
+    bool begin();
+    void end();
+    bool isActive() const { return stream != nullptr; }
+    
+    void logScan(uint8_t channel);
+    void logAlert(uint8_t kind, uint8_t severity, const uint8_t* mac, const char* text);
+    void checkpoint();
+    
+    // Periodic stats and checkpoints; called from the command worker
+    void service();
+    
+    const SurveyTotals& getTotals() const { return totals; }
+    const SurveyReplayStats& getReplayStats() const { return replay; }
+    uint32_t getSession() const { return session; }
+    uint32_t getRecordsWritten() const { return recordsWritten; }
+    uint32_t getCheckpointsWritten() const { return checkpointsWritten; }
+    uint32_t getLogSize() const { return currentOffset(); }
+};
+
+#endif // SURVEY_LOG_H
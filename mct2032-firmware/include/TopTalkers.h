@@ -0,0 +1,91 @@
+/**
+ * Top Talkers for MCT2032
+ * Bounded-memory heavy hitters by transmitter and BSSID, frames and bytes
+ *
+ * Each ranking is a Space-Saving summary of TALKER_CAPACITY counters: a new
+ * address takes over the smallest counter and inherits its value as error,
+ * so counts are overestimates by at most that error. The window slides in
+ * TALKER_SLOTS sub-windows, each with its own summaries; a query merges the
+ * live ones. An address missing from a full sub-window may still have up to
+ * that sub-window's smallest count there, which is added to the error, so
+ * every reported count comes with a hard bound: true count lies in
+ * [count - error, count].
+ *
+ * Memory and per-frame work are fixed, and a query is bounded by the
+ * constants alone whatever the traffic.
+ */
+
+#ifndef TOP_TALKERS_H
+#define TOP_TALKERS_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+
+#define TALKER_CAPACITY         64      // Counters per summary
+#define TALKER_SLOTS            4
+#define TALKER_SLOT_MS          15000   // Window is TALKER_SLOTS of these
+#define TALKER_MAX_RESULTS      20
+
+// Rankings
+#define TALKER_KIND_TX          0
+#define TALKER_KIND_BSSID       1
+#define TALKER_BY_FRAMES        0
+#define TALKER_BY_BYTES         1
+#define TALKER_RANKINGS         4       // kind * 2 + by
+
+struct TalkerCounter {
+    uint64_t key;
+    uint32_t count;
+    uint32_t error;
+};
+
+struct TalkerSketch {
+    TalkerCounter counters[TALKER_CAPACITY];
+    uint8_t used;
+    uint32_t total;
+    
+    void clear() {
+        used = 0;
+        total = 0;
+    }
+    
+    void add(uint64_t key, uint32_t amount);
+    const TalkerCounter* find(uint64_t key) const;
+    
+    // Most an address not held here can have counted
+    uint32_t floor() const;
+};
+
+struct TalkerResult {
+    uint8_t mac[6];
+    uint32_t count;
+    uint32_t error;
+};
+
+class TopTalkers {
+private:
+    TalkerSketch sketches[TALKER_SLOTS][TALKER_RANKINGS];
+    uint32_t slotStart[TALKER_SLOTS];
+    uint8_t current;
+    portMUX_TYPE lock;
+    
+    // Query copies, so merging never holds up the frame path
+    TalkerSketch scratch[TALKER_SLOTS];
+    
+    void rotate(uint32_t now);
+
+public:
+    TopTalkers();
+    
+    void reset();
+    
+    // Promiscuous callback; weight is the frames this one stands for
+    void observe(const uint8_t* frame, uint16_t len, uint16_t weight, uint32_t now);
+    
+    // Top k of one ranking, largest first; returns how many, with the window
+    // span and the ranking's total over it
+    uint8_t query(uint8_t kind, uint8_t by, TalkerResult* out, uint8_t k,
+                  uint32_t now, uint32_t* windowMs, uint32_t* total);
+};
+
+#endif // TOP_TALKERS_H
@@ -0,0 +1,114 @@
+/**
+ * Traffic Graph for MCT2032
+ * Per-station and per-BSSID data counters and the station -> BSSID graph
+ *
+ * Data frames are read from the infrastructure side: To DS frames are a
+ * station's uplink, From DS frames its downlink, and the BSSID they carry
+ * is the AP the station is actually using. Each station keeps the one edge
+ * to its current BSSID, so the graph costs nothing beyond the station table
+ * and a move to another AP shows up as a roam. PS-Poll frames add edges for
+ * dozing stations that send no data. Both tables are fixed-size MacTables
+ * behind one spinlock; reports copy the busiest entries out under it and
+ * count each AP's stations in the same station pass.
+ */
+
+#ifndef TRAFFIC_GRAPH_H
+#define TRAFFIC_GRAPH_H
+
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include "MacTable.h"
+
+#define TRAFFIC_STATIONS        128
+#define TRAFFIC_BSSES           64
+#define TRAFFIC_AC_COUNT        4       // BK, BE, VI, VO
+#define TRAFFIC_REPORT_MAX      32      // Most APs or edges in one report
+
+struct StationTraffic {
+    uint32_t lastSeen;
+    uint64_t bssid;             // Current edge, as a MacTable key
+    uint32_t framesUp;
+    uint32_t framesDown;
+    uint32_t bytesUp;
+    uint32_t bytesDown;
+    uint16_t roams;
+    uint8_t tidMask;            // Bit per QoS TID 0-7 seen
+};
+
+struct BssTraffic {
+    uint32_t lastSeen;
+    uint32_t framesUp;
+    uint32_t framesDown;
+    uint32_t bytesUp;
+    uint32_t bytesDown;
+    uint32_t acFrames[TRAFFIC_AC_COUNT];    // Non-QoS frames count as best effort
+};
+
+// Copies handed out to reports
+struct BssTrafficReport {
+    uint8_t bssid[6];
+    uint16_t stations;          // Stations whose current edge is this AP
+    uint32_t framesUp;
+    uint32_t framesDown;
+    uint32_t bytesUp;
+    uint32_t bytesDown;
+    uint32_t acFrames[TRAFFIC_AC_COUNT];
+};
+
+struct EdgeTrafficReport {
+    uint8_t station[6];
+    uint8_t bssid[6];
+    uint32_t lastSeen;
+    uint32_t framesUp;
+    uint32_t framesDown;
+    uint32_t bytesUp;
+    uint32_t bytesDown;
+    uint16_t roams;
+    uint8_t tidMask;
+};
+
+struct TrafficGraphReport {
+    uint16_t stationCount;
+    uint16_t bssCount;
+    uint32_t dataFrames;
+    uint8_t apCount;
+    uint8_t edgeCount;
+    BssTrafficReport aps[TRAFFIC_REPORT_MAX];
+    EdgeTrafficReport edges[TRAFFIC_REPORT_MAX];
+};
+
+class TrafficGraph {
+private:
+    MacTable<StationTraffic, TRAFFIC_STATIONS> stations;
+    MacTable<BssTraffic, TRAFFIC_BSSES> bsses;
+    uint32_t dataFrames;
+    uint32_t wdsFrames;
+    
+    portMUX_TYPE lock;
+    
+    static const uint8_t tidToAc[8];
+    
+    // Called with the lock held
+    void link(StationTraffic* station, uint64_t bssid);
+
+public:
+    TrafficGraph();
+    
+    void reset();
+    
+    // Promiscuous callback
+    void observeData(const uint8_t* frame, uint16_t len, uint16_t weight, uint32_t now);
+    void observePsPoll(const uint8_t* frame, uint16_t len, uint32_t now);
+    
+    // Busiest APs and edges first, by bytes both ways, or only those of one AP
+    void getGraph(TrafficGraphReport* out, uint8_t k, const uint8_t* only);
+    
+    uint16_t getStationCount() const { return stations.getUsed(); }
+    uint16_t getBssCount() const { return bsses.getUsed(); }
+    uint32_t getDataFrames() const { return dataFrames; }
+    uint32_t getWdsFrames() const { return wdsFrames; }
+    
+    static const char* acName(uint8_t ac);
+};
+
+#endif // TRAFFIC_GRAPH_H
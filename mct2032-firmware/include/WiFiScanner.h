@@ -9,7 +9,13 @@
 #include <Arduino.h>
 #include <WiFi.h>
 #include <vector>
+#include <functional>
 #include <ArduinoJson.h>
+#include "OuiTable.h"
+
+// Passive dwell per channel and overall scan timeout
+#define SCAN_DWELL_MS       300
+#define SCAN_TIMEOUT_MS     10000
 
 struct NetworkInfo {
     String ssid;
@@ -18,6 +24,7 @@ struct NetworkInfo {
     uint8_t channel;
     wifi_auth_mode_t encryptionType;
     bool hidden;
+    uint16_t vendor;            // OuiTable id, OUI_UNKNOWN if not listed
     
     String getSecurityString() const;
 };
@@ -28,18 +35,43 @@ private:
     bool scanning;
     unsigned long scanStartTime;
     
+    // Result cache bookkeeping
+    bool resultsValid;
+    unsigned long resultsTime;
+    uint8_t scanChannel;
+    uint8_t resultsChannel;
+    
+    // Called once per network as results are processed
+    std::function<void(const NetworkInfo&)> networkCallback;
+    
 public:
     WiFiScanner();
     
     void init();
     bool startScan(uint8_t channel = 0);
     bool isScanning();
+    uint8_t getScanChannel() const { return scanChannel; }
     void stopScan();
     void processScanResults();
     
+    // Result cache
+    bool hasResults() const { return resultsValid; }
+    bool hasCachedResults(uint8_t channel, uint32_t maxAge) const;
+    uint32_t getResultAge() const;
+    uint8_t getResultsChannel() const { return resultsChannel; }
+    void clearResults();
+    
+    // Re-adds a network recorded before a reboot; not treated as a fresh scan
+    void restoreNetwork(const NetworkInfo& info);
+    
     std::vector<NetworkInfo>& getResults() { return networks; }
     size_t getNetworkCount() const { return networks.size(); }
     
+    // Callback
+    void setNetworkCallback(std::function<void(const NetworkInfo&)> callback) {
+        networkCallback = callback;
+    }
+    
     // JSON serialization
     void toJSON(DynamicJsonDocument& doc);
     String toJSONString();
@@ -22,6 +22,19 @@
 #define CMD_EXPORT_DATA     "EXPORT_DATA"
 #define CMD_SET_MODE        "SET_MODE"
 #define CMD_CLEAR_DATA      "CLEAR_DATA"
+#define CMD_CHANNEL_REPORT  "CHANNEL_REPORT"
+#define CMD_GET_METRICS     "GET_METRICS"
+#define CMD_JOB_LIST        "JOB_LIST"
+#define CMD_JOB_CANCEL      "JOB_CANCEL"
+#define CMD_STATS_STREAM    "STATS_STREAM"
+#define CMD_BATCH           "BATCH"
+#define CMD_TOP_TALKERS     "TOP_TALKERS"
+#define CMD_DISTINCT_COUNT  "DISTINCT_COUNT"
+#define CMD_ASSOC_GRAPH     "ASSOC_GRAPH"
+#define CMD_AIRTIME         "AIRTIME"
+#define CMD_PHY_STATS       "PHY_STATS"
+#define CMD_PROBE_REPORT    "PROBE_REPORT"
+#define CMD_ROGUE_ALLOW     "ROGUE_ALLOW"
 
 // Advanced Commands (Marauder-inspired)
 #define CMD_DEAUTH_ATTACK   "DEAUTH_ATTACK"
@@ -32,6 +45,9 @@
 #define CMD_PCAP_START      "PCAP_START"
 #define CMD_PCAP_STOP       "PCAP_STOP"
 #define CMD_PACKET_INJECT   "PACKET_INJECT"
+#define CMD_FLIGHT_ARM      "FLIGHT_ARM"
+#define CMD_FLIGHT_TRIGGER  "FLIGHT_TRIGGER"
+#define CMD_FLIGHT_DISARM   "FLIGHT_DISARM"
 
 // Response Status Codes
 #define STATUS_SUCCESS      "success"
@@ -39,6 +55,8 @@
 #define STATUS_BUSY         "busy"
 #define STATUS_INVALID_CMD  "invalid_command"
 #define STATUS_TIMEOUT      "timeout"
+#define STATUS_PENDING      "pending"
+#define STATUS_CHUNKED      "chunked"
 
 // Error Codes
 #define ERR_NONE            0
@@ -64,6 +82,7 @@
 // Maximum sizes
 #define MAX_COMMAND_SIZE    512
 #define MAX_RESPONSE_SIZE   4096
+#define MAX_NOTIFY_SIZE     512     // NimBLE refuses longer characteristic values
 #define MAX_SSID_LENGTH     32
 #define MAX_BSSID_LENGTH    18
 #define MAX_NETWORKS        50
@@ -77,6 +96,12 @@
 #define JSON_TYPE           "type"
 #define JSON_TIMESTAMP      "timestamp"
 
+// Transport JSON Keys
+#define JSON_CHUNK_INDEX    "chunkIndex"
+#define JSON_TOTAL_CHUNKS   "totalChunks"
+#define JSON_KEY            "key"
+#define JSON_ITEM           "item"
+
 // WiFi Scan JSON Keys
 #define JSON_NETWORKS       "networks"
 #define JSON_SSID           "ssid"
@@ -85,6 +110,7 @@
 #define JSON_RSSI           "rssi"
 #define JSON_SECURITY       "security"
 #define JSON_HIDDEN         "hidden"
+#define JSON_VENDOR         "vendor"
 
 // BLE Scan JSON Keys
 #define JSON_DEVICES        "devices"
@@ -102,6 +128,13 @@
 #define JSON_WIFI_STATUS    "wifi_connected"
 #define JSON_BLE_STATUS     "ble_connected"
 
+// Scan Cache JSON Keys
+#define JSON_SCAN_CACHE     "scan_cache"
+#define JSON_CACHE_HITS     "hits"
+#define JSON_CACHE_MISSES   "misses"
+#define JSON_CACHE_COALESCED "coalesced"
+#define JSON_CACHE_MAX_AGE  "max_age"
+
 // Packet Monitor JSON Keys
 #define JSON_PACKETS_TOTAL  "packets_total"
 #define JSON_PACKETS_SEC    "packets_per_sec"
@@ -110,6 +143,208 @@
 #define JSON_DATA_COUNT     "data_count"
 #define JSON_MGMT_COUNT     "mgmt_count"
 
+// Load Shedding JSON Keys
+#define JSON_LOAD           "load"
+#define JSON_LEVEL          "level"
+#define JSON_SAMPLE_N       "sample_n"
+#define JSON_BUSY_PCT       "busy_pct"
+#define JSON_SHED           "shed"
+
+// Capture Loss JSON Keys
+#define JSON_LOSS           "loss"
+#define JSON_RECEIVED       "received"
+#define JSON_LOST           "lost"
+#define JSON_LOSS_PERMILLE  "loss_permille"
+#define JSON_RETRIES        "retries"
+#define JSON_REORDERED      "reordered"
+#define JSON_RESYNCS        "resyncs"
+#define JSON_TRACKED        "tracked"
+#define JSON_WORST          "worst"
+#define JSON_TID            "tid"
+
+// Retry De-duplication JSON Keys
+#define JSON_DEDUP          "dedup"
+
+// Top Talkers JSON Keys
+#define JSON_KIND           "kind"
+#define JSON_BY             "by"
+#define JSON_TOP_K          "k"
+#define JSON_WINDOW_MS      "window_ms"
+#define JSON_TALKERS        "talkers"
+#define JSON_ERROR_BOUND    "error_bound"
+
+// Distinct Count JSON Keys
+#define JSON_WINDOW_S       "window_s"
+#define JSON_MAX_WINDOW_S   "max_window_s"
+
+// Association Graph JSON Keys
+#define JSON_LIMIT          "limit"
+#define JSON_STATIONS       "stations"
+#define JSON_APS            "aps"
+#define JSON_EDGES          "edges"
+#define JSON_STATION        "sta"
+#define JSON_FRAMES_UP      "frames_up"
+#define JSON_FRAMES_DOWN    "frames_down"
+#define JSON_BYTES_UP       "bytes_up"
+#define JSON_BYTES_DOWN     "bytes_down"
+#define JSON_AC_FRAMES      "ac_frames"
+#define JSON_TIDS           "tids"
+#define JSON_ROAMS          "roams"
+#define JSON_AGE_S          "age_s"
+#define JSON_DATA_FRAMES    "data_frames"
+
+// Airtime JSON Keys
+#define JSON_AIRTIME        "airtime"
+#define JSON_AIRTIME_MS     "airtime_ms"
+#define JSON_UTIL_SHORT     "util_10s"
+#define JSON_UTIL_LONG      "util_60s"
+#define JSON_LISTEN_S       "listen_s"
+#define JSON_BSSIDS         "bssids"
+#define JSON_SHARE_PCT      "share_pct"
+
+// Probe Report JSON Keys
+#define JSON_PROBES         "probes"
+#define JSON_WILDCARD       "wildcard"
+#define JSON_SSIDS          "ssids"
+#define JSON_CLIENTS        "clients"
+#define JSON_OVERFLOW       "overflow"
+#define JSON_RANDOMIZED     "randomized"
+
+// Device Estimate JSON Keys
+#define JSON_DEVICES        "devices"
+#define JSON_MACS           "macs"
+#define JSON_ESTIMATED      "estimated"
+#define JSON_ACTIVE_MACS    "active_macs"
+#define JSON_ACTIVE_DEVICES "active_estimated"
+#define JSON_CLUSTERS       "clusters"
+#define JSON_SIGNATURE      "signature"
+#define JSON_SPAN_S         "span_s"
+
+// AP Alert JSON Keys
+#define JSON_SEVERITY       "severity"
+#define JSON_BEFORE         "before"
+#define JSON_AFTER          "after"
+#define JSON_TEXT           "text"
+
+// Hidden SSID JSON Keys
+#define JSON_SOURCE         "source"
+#define JSON_PENDING        "pending"
+#define JSON_RESOLVED       "resolved"
+#define JSON_ALLOW_LISTS    "allow_lists"
+#define JSON_ALERTS         "alerts"
+
+// Channel Report JSON Keys
+#define JSON_CHANNELS       "channels"
+#define JSON_RECOMMENDED    "recommended_channel"
+#define JSON_AP_COUNT       "ap_count"
+#define JSON_STRONGEST_RSSI "strongest_rssi"
+#define JSON_AGGREGATE_RSSI "aggregate_rssi"
+#define JSON_INTERFERENCE   "interference"
+#define JSON_FRAMES         "frames"
+#define JSON_FRAME_LOAD     "frame_load"
+
+// Metrics JSON Keys
+#define JSON_QUEUE          "queue"
+#define JSON_QUEUE_HIGH     "high_depth"
+#define JSON_QUEUE_NORMAL   "normal_depth"
+#define JSON_QUEUE_REJECTED "rejected"
+#define JSON_COMMANDS       "commands"
+#define JSON_COUNT          "count"
+#define JSON_WAIT_AVG_US    "wait_avg_us"
+#define JSON_WAIT_MAX_US    "wait_max_us"
+#define JSON_EXEC_AVG_US    "exec_avg_us"
+#define JSON_EXEC_MAX_US    "exec_max_us"
+
+// Pipeline Metrics JSON Keys
+#define JSON_PIPELINE       "pipeline"
+#define JSON_CPU_MHZ        "cpu_mhz"
+#define JSON_STAGES         "stages"
+#define JSON_STAGE          "stage"
+#define JSON_AVG_CYCLES     "avg_cycles"
+#define JSON_MAX_CYCLES     "max_cycles"
+#define JSON_HISTOGRAM      "hist"
+#define JSON_RESET          "reset"
+
+// Job JSON Keys
+#define JSON_JOBS           "jobs"
+#define JSON_JOB_ID         "job_id"
+#define JSON_JOB_TYPE       "job"
+#define JSON_JOB_STATE      "state"
+#define JSON_JOB_PROGRESS   "progress"
+#define JSON_JOB_ELAPSED    "elapsed"
+
+// Batch JSON Keys
+#define JSON_RESULTS        "results"
+#define JSON_EXECUTED       "executed"
+#define JSON_SEPARATE       "separate"
+#define JSON_TOTAL          "total"
+
+// Export JSON Keys
+#define JSON_TARGET         "target"
+#define JSON_FORMAT         "format"
+#define JSON_FILENAME       "filename"
+#define JSON_SEQ            "seq"
+#define JSON_BYTES          "bytes"
+#define JSON_ELAPSED_MS     "elapsed_ms"
+#define JSON_BYTES_PER_SEC  "bytes_per_sec"
+#define JSON_CRC32          "crc32"
+
+// Storage JSON Keys
+#define JSON_STORAGE        "storage"
+#define JSON_TOTAL_MB       "total_mb"
+#define JSON_USED_MB        "used_mb"
+#define JSON_WRITE_KBPS     "write_kbps"
+#define JSON_WRITTEN        "written"
+#define JSON_BLOCKS         "blocks"
+#define JSON_ERRORS         "errors"
+#define JSON_DROPPED        "dropped"
+#define JSON_WRITE_AVG_US   "write_avg_us"
+#define JSON_WRITE_MAX_US   "write_max_us"
+#define JSON_PENDING_HIGH   "pending_high"
+#define JSON_STREAMS        "streams"
+
+// Survey JSON Keys
+#define JSON_SURVEY         "survey"
+#define JSON_SESSION        "session"
+#define JSON_RECORDS        "records"
+#define JSON_CHECKPOINTS    "checkpoints"
+#define JSON_LOG_BYTES      "log_bytes"
+#define JSON_REPLAYED       "replayed"
+#define JSON_REPLAY_MS      "replay_ms"
+#define JSON_SKIPPED        "skipped"
+#define JSON_TOTAL_PACKETS  "total_packets"
+
+// Capture Filter JSON Keys
+#define JSON_FILTER         "filter"
+#define JSON_MACS           "macs"
+#define JSON_ADDR           "addr"
+#define JSON_MASK           "mask"
+#define JSON_FIELD          "field"
+#define JSON_RSSI_MIN       "rssi_min"
+#define JSON_RSSI_MAX       "rssi_max"
+#define JSON_LEN_MIN        "len_min"
+#define JSON_LEN_MAX        "len_max"
+#define JSON_CHECKS         "checks"
+#define JSON_HW_MASK        "hw_mask"
+#define JSON_CTRL_MASK      "ctrl_mask"
+#define JSON_FILTERED       "filtered"
+
+// Flight Recorder JSON Keys
+#define JSON_FLIGHT         "flight"
+#define JSON_TRIGGERS       "triggers"
+#define JSON_TRIGGER        "trigger"
+#define JSON_MAC            "mac"
+#define JSON_SIZE_KB        "size_kb"
+#define JSON_PRE_MS         "pre_ms"
+#define JSON_POST_MS        "post_ms"
+#define JSON_DEAUTH_COUNT   "deauth_count"
+#define JSON_DEAUTH_WINDOW  "deauth_window_ms"
+#define JSON_PSRAM          "psram"
+#define JSON_BUFFERED       "buffered"
+#define JSON_CAPACITY       "capacity"
+#define JSON_RECORDED       "recorded"
+#define JSON_EVICTED        "evicted"
+
 // Security Types
 #define SECURITY_OPEN       "OPEN"
 #define SECURITY_WEP        "WEP"
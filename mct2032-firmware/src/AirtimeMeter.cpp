@@ -0,0 +1,264 @@
+/**
+ * Airtime Meter implementation
+ */
+
+#include "AirtimeMeter.h"
+#include "Dot11.h"
+
+// Legacy rate codes from the driver, in units of 0.5 Mbps; codes 5-7 are the
+// short-preamble CCK rates and 8-15 are OFDM
+static const uint8_t LEGACY_HALF_MBPS[16] = {
+    2, 4, 11, 22, 0, 4, 11, 22,
+    96, 48, 24, 12, 108, 72, 36, 18
+};
+
+// Data bits per OFDM symbol for one spatial stream, MCS 0-9
+static const uint16_t HT_BITS_20[10] = {26, 52, 78, 104, 156, 208, 234, 260, 312, 347};
+static const uint16_t HT_BITS_40[10] = {54, 108, 162, 216, 324, 432, 486, 540, 648, 720};
+
+#define DSSS_LONG_PREAMBLE_US   192
+#define DSSS_SHORT_PREAMBLE_US  96
+#define OFDM_PREAMBLE_US        20      // L-STF, L-LTF and L-SIG
+#define HT_SIG_US               12      // HT-SIG and HT-STF
+#define HT_LTF_US               4       // Per spatial stream
+#define OFDM_SYMBOL_US          4
+#define SIGNAL_EXTENSION_US     6       // ERP-OFDM in 2.4 GHz
+#define OFDM_OVERHEAD_BITS      22      // SERVICE and tail
+#define AMPDU_DELIMITER_LEN     4
+#define AMPDU_GAP_US            16      // SIFS; a longer gap means another PPDU
+
+static const char* CLASS_NAMES[AIRTIME_CLASSES] = {"beacon", "mgmt", "ctrl", "data"};
+
+AirtimeMeter::AirtimeMeter() : listenChannel(0) {
+    portMUX_INITIALIZE(&lock);
+    reset();
+}
+
+void AirtimeMeter::reset() {
+    uint32_t now = millis();
+    portENTER_CRITICAL(&lock);
+    memset(buckets, 0, sizeof(buckets));
+    memset(channels, 0, sizeof(channels));
+    bsses.clear();
+    totalUs = 0;
+    bucket = 0;
+    bucketStart = now;
+    listenMark = now;
+    ampduOpen = false;
+    ampduEndUs = 0;
+    portEXIT_CRITICAL(&lock);
+}
+
+uint32_t AirtimeMeter::frameAirtimeUs(const wifi_pkt_rx_ctrl_t& ctrl, bool sharedPreamble) {
+    uint32_t len = ctrl.sig_len;
+    
+    if (ctrl.sig_mode == 0) {
+        uint8_t code = ctrl.rate & 0x0F;
+        uint32_t halfMbps = LEGACY_HALF_MBPS[code];
+        if (halfMbps == 0) {
+            return 0;
+        }
+        
+        if (code < 8) {
+            uint32_t preamble = code >= 5 ? DSSS_SHORT_PREAMBLE_US : DSSS_LONG_PREAMBLE_US;
+            return preamble + (16 * len + halfMbps - 1) / halfMbps;
+        }
+        
+        uint32_t bitsPerSymbol = halfMbps * 2;
+        uint32_t symbols = (OFDM_OVERHEAD_BITS + 8 * len + bitsPerSymbol - 1) / bitsPerSymbol;
+        return OFDM_PREAMBLE_US + symbols * OFDM_SYMBOL_US + SIGNAL_EXTENSION_US;
+    }
+    
+    // HT, and VHT as one stream
+    uint8_t mcs = ctrl.mcs;
+    uint8_t streams = 1;
+    if (ctrl.sig_mode == 1) {
+        streams = (mcs >> 3) + 1;
+        mcs &= 0x07;
+    } else if (mcs > 9) {
+        return 0;
+    }
+    uint32_t bitsPerSymbol = (ctrl.cwb ? HT_BITS_40[mcs] : HT_BITS_20[mcs]) * streams;
+    
+    // Later A-MPDU subframes ride on the first one's preamble
+    uint32_t bits = 8 * len;
+    uint32_t overhead = 0;
+    if (ctrl.aggregation) {
+        bits += 8 * AMPDU_DELIMITER_LEN;
+    }
+    if (!sharedPreamble) {
+        bits += OFDM_OVERHEAD_BITS;
+        overhead = OFDM_PREAMBLE_US + HT_SIG_US + HT_LTF_US * streams + SIGNAL_EXTENSION_US;
+    }
+    uint32_t symbols = (bits + bitsPerSymbol - 1) / bitsPerSymbol;
+    
+    // Short guard interval: 3.6 us symbols
+    uint32_t dataUs = ctrl.sgi ? (symbols * 36 + 9) / 10 : symbols * OFDM_SYMBOL_US;
+    return overhead + dataUs;
+}
+
+const char* AirtimeMeter::className(uint8_t frameClass) {
+    return frameClass < AIRTIME_CLASSES ? CLASS_NAMES[frameClass] : "unknown";
+}
+
+uint8_t AirtimeMeter::percent(uint32_t busyUs, uint32_t listenMs) {
+    if (listenMs == 0) {
+        return 0;
+    }
+    // busyUs * 100 / (listenMs * 1000)
+    uint32_t pct = busyUs / (listenMs * 10);
+    return pct > 100 ? 100 : (uint8_t)pct;
+}
+
+void AirtimeMeter::creditListen(uint32_t until) {
+    // Called with the lock held
+    if (listenChannel != 0 && listenChannel <= AIRTIME_CHANNELS) {
+        uint32_t ms = until - listenMark;
+        uint8_t ch = listenChannel - 1;
+        buckets[bucket][ch].listenMs += ms;
+        channels[ch].shortListenMs += ms;
+        channels[ch].longListenMs += ms;
+    }
+    listenMark = until;
+}
+
+void AirtimeMeter::advance(uint32_t now) {
+    // Called with the lock held
+    if (now - bucketStart < AIRTIME_BUCKET_MS) {
+        return;
+    }
+    
+    // Idle past the whole window: start over
+    if (now - bucketStart >= (uint32_t)AIRTIME_BUCKETS * AIRTIME_BUCKET_MS) {
+        memset(buckets, 0, sizeof(buckets));
+        for (uint8_t ch = 0; ch < AIRTIME_CHANNELS; ch++) {
+            channels[ch].shortBusyUs = 0;
+            channels[ch].shortListenMs = 0;
+            channels[ch].longBusyUs = 0;
+            channels[ch].longListenMs = 0;
+        }
+        bucketStart = now;
+        listenMark = now;
+        return;
+    }
+    
+    while (now - bucketStart >= AIRTIME_BUCKET_MS) {
+        bucketStart += AIRTIME_BUCKET_MS;
+        creditListen(bucketStart);
+        bucket = (bucket + 1) % AIRTIME_BUCKETS;
+        
+        // One bucket leaves the short window, and the one being reused leaves the long one
+        uint8_t leaving = (bucket + AIRTIME_BUCKETS - AIRTIME_SHORT_BUCKETS) % AIRTIME_BUCKETS;
+        for (uint8_t ch = 0; ch < AIRTIME_CHANNELS; ch++) {
+            AirtimeChannel& c = channels[ch];
+            c.shortBusyUs -= buckets[leaving][ch].busyUs;
+            c.shortListenMs -= buckets[leaving][ch].listenMs;
+            c.longBusyUs -= buckets[bucket][ch].busyUs;
+            c.longListenMs -= buckets[bucket][ch].listenMs;
+            buckets[bucket][ch].busyUs = 0;
+            buckets[bucket][ch].listenMs = 0;
+        }
+    }
+}
+
+void AirtimeMeter::setListening(uint8_t channel, uint32_t now) {
+    portENTER_CRITICAL(&lock);
+    advance(now);
+    creditListen(now);
+    listenChannel = channel;
+    portEXIT_CRITICAL(&lock);
+}
+
+void AirtimeMeter::observe(const uint8_t* frame, const wifi_pkt_rx_ctrl_t& ctrl, uint32_t now) {
+    uint8_t channel = ctrl.channel;
+    if (channel == 0 || channel > AIRTIME_CHANNELS) {
+        return;
+    }
+    
+    // Only a subframe following another of the same PPDU shares its preamble
+    bool shared = ctrl.aggregation && ampduOpen && (int32_t)(ctrl.timestamp - ampduEndUs) <= AMPDU_GAP_US;
+    uint32_t us = frameAirtimeUs(ctrl, shared);
+    ampduOpen = ctrl.aggregation && us != 0;
+    ampduEndUs = ctrl.timestamp + us;
+    if (us == 0) {
+        return;
+    }
+    
+    uint16_t len = ctrl.sig_len;
+    uint8_t frameClass;
+    switch (dot11Type(frame)) {
+        case DOT11_TYPE_MGMT:
+            frameClass = dot11Subtype(frame) == 0x08 ? AIRTIME_BEACON : AIRTIME_MGMT;
+            break;
+        case DOT11_TYPE_CTRL:
+            frameClass = AIRTIME_CTRL;
+            break;
+        default:
+            frameClass = AIRTIME_DATA;
+            break;
+    }
+    const uint8_t* bssid = dot11Bssid(frame, len);
+    
+    portENTER_CRITICAL(&lock);
+    advance(now);
+    AirtimeChannel& c = channels[channel - 1];
+    buckets[bucket][channel - 1].busyUs += us;
+    c.shortBusyUs += us;
+    c.longBusyUs += us;
+    c.classUs[frameClass] += us;
+    totalUs += us;
+    
+    if (bssid && !(bssid[0] & 0x01)) {
+        bool inserted;
+        BssAirtime* bss = bsses.findOrInsert(macToKey(bssid), &inserted);
+        bss->lastSeen = now;
+        bss->frames++;
+        bss->airtimeUs += us;
+    }
+    portEXIT_CRITICAL(&lock);
+}
+
+void AirtimeMeter::getChannel(uint8_t channel, uint32_t now, AirtimeReport* report) {
+    memset(report, 0, sizeof(AirtimeReport));
+    if (channel == 0 || channel > AIRTIME_CHANNELS) {
+        return;
+    }
+    
+    portENTER_CRITICAL(&lock);
+    advance(now);
+    creditListen(now);
+    const AirtimeChannel& c = channels[channel - 1];
+    report->shortPct = percent(c.shortBusyUs, c.shortListenMs);
+    report->longPct = percent(c.longBusyUs, c.longListenMs);
+    report->longListenMs = c.longListenMs;
+    memcpy(report->classUs, c.classUs, sizeof(report->classUs));
+    portEXIT_CRITICAL(&lock);
+}
+
+uint8_t AirtimeMeter::getTopBss(BssAirtimeReport* out, uint8_t k, uint64_t* total) {
+    uint8_t count = 0;
+    
+    portENTER_CRITICAL(&lock);
+    *total = totalUs;
+    bsses.forEach([&](uint64_t key, const BssAirtime& bss) {
+        uint8_t pos = count;
+        while (pos > 0 && out[pos - 1].airtimeUs < bss.airtimeUs) {
+            pos--;
+        }
+        if (pos >= k) {
+            return;
+        }
+        for (uint8_t n = count < k ? count : k - 1; n > pos; n--) {
+            out[n] = out[n - 1];
+        }
+        keyToMac(key, out[pos].bssid);
+        out[pos].frames = bss.frames;
+        out[pos].airtimeUs = bss.airtimeUs;
+        if (count < k) {
+            count++;
+        }
+    });
+    portEXIT_CRITICAL(&lock);
+    
+    return count;
+}
@@ -3,6 +3,8 @@
  */
 
 #include "BLEManager.h"
+#include "PipelineMetrics.h"
+#include <mbedtls/base64.h>
 
 BLEManager::BLEManager() : 
     server(nullptr), 
@@ -68,23 +70,30 @@ void BLEManager::startAdvertising() {
     advertising->start();
 }
 
-void BLEManager::setCommandCallback(std::function<void(String)> callback) {
+void BLEManager::setCommandCallback(std::function<void(const char*, size_t)> callback) {
     commandCallback = callback;
 }
 
 bool BLEManager::sendData(const String& data) {
     if (!deviceConnected) {
         Serial.println("BLE: Not connected, cannot send data");
+        PIPE_DROP(PIPE_STAGE_STREAM);
         return false;
     }
     
+    // NimBLE refuses a longer value and would notify the previous one again
+    if (data.length() > MAX_NOTIFY_SIZE) {
+        return sendParts(data);
+    }
+    
     try {
         Serial.printf("BLE: Sending data, length: %d\n", data.length());
-        Serial.printf("BLE: Data content: %s\n", data.c_str());
         
         // Use uint8_t array to ensure proper data transmission
+        PIPE_START_ANY_CORE(streamStart);
         dataCharacteristic->setValue((uint8_t*)data.c_str(), data.length());
         dataCharacteristic->notify();
+        PIPE_STOP_ANY_CORE(PIPE_STAGE_STREAM, streamStart);
         
         Serial.println("BLE: Data sent successfully");
         return true;
@@ -94,15 +103,51 @@ bool BLEManager::sendData(const String& data) {
     }
 }
 
+bool BLEManager::sendParts(const String& data) {
+    // {"type":"part","seq":n,"total":N,"data":"<base64>"}; the client joins
+    // the decoded parts and handles the result as one message
+    size_t total = (data.length() + BLE_PART_BYTES - 1) / BLE_PART_BYTES;
+    Serial.printf("BLE: Sending %d bytes in %d parts\n", data.length(), total);
+    
+    const uint8_t* bytes = (const uint8_t*)data.c_str();
+    char encoded[((BLE_PART_BYTES + 2) / 3) * 4 + 1];
+    for (size_t seq = 0; seq < total; seq++) {
+        size_t offset = seq * BLE_PART_BYTES;
+        size_t len = data.length() - offset < BLE_PART_BYTES ? data.length() - offset : BLE_PART_BYTES;
+        size_t encodedLen = 0;
+        if (mbedtls_base64_encode((unsigned char*)encoded, sizeof(encoded), &encodedLen, bytes + offset, len) != 0) {
+            return false;
+        }
+        encoded[encodedLen] = '\0';
+        
+        DynamicJsonDocument part(384);
+        part[JSON_TYPE] = "part";
+        part[JSON_SEQ] = seq;
+        part[JSON_TOTAL] = total;
+        part[JSON_DATA] = (const char*)encoded;
+        
+        String output;
+        serializeJson(part, output);
+        if (!sendData(output)) {
+            return false;
+        }
+        delay(BLE_PART_GAP_MS);
+    }
+    return true;
+}
+
 bool BLEManager::sendStatus(const String& status) {
     if (!deviceConnected) {
+        PIPE_DROP(PIPE_STAGE_STREAM);
         return false;
     }
     
     try {
         // Use uint8_t array to ensure proper data transmission
+        PIPE_START_ANY_CORE(streamStart);
         statusCharacteristic->setValue((uint8_t*)status.c_str(), status.length());
         statusCharacteristic->notify();
+        PIPE_STOP_ANY_CORE(PIPE_STAGE_STREAM, streamStart);
         return true;
     } catch(...) {
         Serial.println("BLE: Error sending status");
@@ -118,7 +163,9 @@ bool BLEManager::sendResponse(const String& command, const String& status, const
     
     Serial.printf("BLE: Preparing response for command: %s, status: %s\n", command.c_str(), status.c_str());
     
-    DynamicJsonDocument response(1024);
+    // The envelope holds a copy of the payload; sendData splits anything
+    // longer than one notification into parts
+    DynamicJsonDocument response(data.memoryUsage() + 256);
     response["type"] = "response";
     response["cmd"] = command;
     response["status"] = status;
@@ -127,8 +174,6 @@ bool BLEManager::sendResponse(const String& command, const String& status, const
     String output;
     serializeJson(response, output);
     
-    Serial.printf("BLE: Response JSON: %s\n", output.c_str());
-    
     return sendData(output);
 }
 
@@ -149,6 +194,23 @@ bool BLEManager::sendError(const String& command, const String& error) {
     return sendData(output);
 }
 
+bool BLEManager::sendBusy(const String& command, const String& reason) {
+    if (!deviceConnected) {
+        return false;
+    }
+    
+    DynamicJsonDocument response(256);
+    response["type"] = "response";
+    response["cmd"] = command;
+    response["status"] = STATUS_BUSY;
+    response["error"] = reason;
+    
+    String output;
+    serializeJson(response, output);
+    
+    return sendData(output);
+}
+
 void BLEManager::notifyData(const String& data) {
     if (deviceConnected) {
         dataCharacteristic->setValue(data.c_str());
@@ -163,82 +225,103 @@ void BLEManager::notifyStatus(const String& status) {
     }
 }
 
-bool BLEManager::sendChunkedResponse(const String& command, const String& status, DynamicJsonDocument& data) {
+// Calls fn(parent, key, array) for each array at the top level or in a top-level object
+template <typename Fn>
+static void forEachChunkArray(JsonObjectConst root, Fn fn) {
+    for (JsonPairConst member : root) {
+        if (member.value().is<JsonArrayConst>()) {
+            fn(nullptr, member.key().c_str(), member.value().as<JsonArrayConst>());
+        } else if (member.value().is<JsonObjectConst>()) {
+            for (JsonPairConst inner : member.value().as<JsonObjectConst>()) {
+                if (inner.value().is<JsonArrayConst>()) {
+                    fn(member.key().c_str(), inner.key().c_str(), inner.value().as<JsonArrayConst>());
+                }
+            }
+        }
+    }
+}
+
+bool BLEManager::sendChunkedResponse(const String& command, const String& status, const DynamicJsonDocument& data) {
     if (!deviceConnected) {
         Serial.println("BLE: Not connected for sendChunkedResponse");
         return false;
     }
     
-    Serial.printf("BLE: Preparing chunked response for command: %s\n", command.c_str());
+    // Each item goes out on its own under the dotted path of its array, and
+    // the client puts the arrays back into the final response's data
+    JsonObjectConst root = data.as<JsonObjectConst>();
+    size_t totalChunks = 0;
+    forEachChunkArray(root, [&](const char* parent, const char* key, JsonArrayConst items) {
+        totalChunks += items.size();
+    });
+    if (totalChunks == 0) {
+        return sendResponse(command, status, data);
+    }
     
-    // Convert data to JSON array of networks
-    String jsonData;
-    serializeJson(data, jsonData);
+    Serial.printf("BLE: Sending %s as %d chunks\n", command.c_str(), totalChunks);
     
-    // For WiFi scan results, we'll send each network individually
-    if (data.containsKey("networks")) {
-        JsonArray networks = data["networks"];
-        int totalNetworks = networks.size();
-        
-        Serial.printf("BLE: Sending %d networks in chunks\n", totalNetworks);
-        
-        // Send initial response with total count
-        DynamicJsonDocument startResponse(256);
-        startResponse["type"] = "response";
-        startResponse["cmd"] = command;
-        startResponse["status"] = "chunked";
-        startResponse["totalChunks"] = totalNetworks;
-        
-        String startOutput;
-        serializeJson(startResponse, startOutput);
-        
-        if (!sendData(startOutput)) {
-            Serial.println("BLE: Failed to send chunk start");
-            return false;
-        }
-        
-        delay(50); // Small delay between chunks
-        
-        // Send each network as a separate chunk
-        int chunkIndex = 0;
-        for (JsonVariant network : networks) {
-            DynamicJsonDocument chunkDoc(512);
+    DynamicJsonDocument startResponse(256);
+    startResponse["type"] = "response";
+    startResponse["cmd"] = command;
+    startResponse["status"] = STATUS_CHUNKED;
+    startResponse[JSON_TOTAL_CHUNKS] = totalChunks;
+    
+    String startOutput;
+    serializeJson(startResponse, startOutput);
+    if (!sendData(startOutput)) {
+        Serial.println("BLE: Failed to send chunk start");
+        return false;
+    }
+    delay(BLE_CHUNK_GAP_MS);
+    
+    size_t chunkIndex = 0;
+    bool ok = true;
+    forEachChunkArray(root, [&](const char* parent, const char* key, JsonArrayConst items) {
+        char path[64];
+        snprintf(path, sizeof(path), "%s%s%s", parent ? parent : "", parent ? "." : "", key);
+        for (JsonVariantConst item : items) {
+            if (!ok) {
+                return;
+            }
+            DynamicJsonDocument chunkDoc(item.memoryUsage() + 256);
             chunkDoc["type"] = "chunk";
             chunkDoc["cmd"] = command;
-            chunkDoc["chunkIndex"] = chunkIndex;
-            chunkDoc["totalChunks"] = totalNetworks;
-            chunkDoc["network"] = network;
+            chunkDoc[JSON_CHUNK_INDEX] = chunkIndex++;
+            chunkDoc[JSON_TOTAL_CHUNKS] = totalChunks;
+            chunkDoc[JSON_KEY] = path;
+            chunkDoc[JSON_ITEM] = item;
             
             String chunkOutput;
             serializeJson(chunkDoc, chunkOutput);
-            
-            Serial.printf("BLE: Sending chunk %d/%d, size: %d\n", 
-                          chunkIndex + 1, totalNetworks, chunkOutput.length());
-            
-            if (!sendData(chunkOutput)) {
-                Serial.printf("BLE: Failed to send chunk %d\n", chunkIndex);
-                return false;
-            }
-            
-            chunkIndex++;
-            delay(20); // Small delay between chunks to avoid overwhelming
+            ok = sendData(chunkOutput);
+            delay(BLE_CHUNK_GAP_MS);
         }
-        
-        // Send completion message
-        DynamicJsonDocument endResponse(256);
-        endResponse["type"] = "response";
-        endResponse["cmd"] = command;
-        endResponse["status"] = STATUS_SUCCESS;
-        endResponse["message"] = "All chunks sent";
-        
-        String endOutput;
-        serializeJson(endResponse, endOutput);
-        
-        return sendData(endOutput);
+    });
+    if (!ok) {
+        Serial.printf("BLE: Failed to send chunk %d\n", chunkIndex - 1);
+        return false;
     }
     
-    // For non-network data, fall back to regular send
-    return sendResponse(command, status, data);
+    // The rest of the report, its arrays left empty, completes the response
+    DynamicJsonDocument summary(data.memoryUsage());
+    for (JsonPairConst member : root) {
+        const char* key = member.key().c_str();
+        if (member.value().is<JsonArrayConst>()) {
+            summary.createNestedArray(key);
+        } else if (member.value().is<JsonObjectConst>()) {
+            JsonObject obj = summary.createNestedObject(key);
+            for (JsonPairConst inner : member.value().as<JsonObjectConst>()) {
+                if (inner.value().is<JsonArrayConst>()) {
+                    obj.createNestedArray(inner.key().c_str());
+                } else {
+                    obj[inner.key().c_str()] = inner.value();
+                }
+            }
+        } else {
+            summary[key] = member.value();
+        }
+    }
+    return sendResponse(command, status, summary);
 }
 
 void BLEManager::checkConnection() {
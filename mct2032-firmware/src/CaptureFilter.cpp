@@ -0,0 +1,183 @@
+/**
+ * Capture Filter implementation
+ */
+
+#include "CaptureFilter.h"
+#include "MacTable.h"
+#include "Dot11.h"
+
+namespace {
+
+struct FrameName {
+    const char* name;
+    uint64_t bits;
+};
+
+#define FRAME_BIT(type, subtype) (1ULL << (((type) << 4) | (subtype)))
+
+const FrameName frameNames[] = {
+    {"mgmt",            CAPTURE_FRAMES_MGMT},
+    {"ctrl",            CAPTURE_FRAMES_CTRL},
+    {"data",            CAPTURE_FRAMES_DATA},
+    {"assoc_req",       FRAME_BIT(0, 0)},
+    {"assoc_resp",      FRAME_BIT(0, 1)},
+    {"reassoc_req",     FRAME_BIT(0, 2)},
+    {"reassoc_resp",    FRAME_BIT(0, 3)},
+    {"probe_req",       FRAME_BIT(0, 4)},
+    {"probe_resp",      FRAME_BIT(0, 5)},
+    {"beacon",          FRAME_BIT(0, 8)},
+    {"disassoc",        FRAME_BIT(0, 10)},
+    {"auth",            FRAME_BIT(0, 11)},
+    {"deauth",          FRAME_BIT(0, 12)},
+    {"action",          FRAME_BIT(0, 13)},
+    {"block_ack_req",   FRAME_BIT(1, 8)},
+    {"block_ack",       FRAME_BIT(1, 9)},
+    {"ps_poll",         FRAME_BIT(1, 10)},
+    {"rts",             FRAME_BIT(1, 11)},
+    {"cts",             FRAME_BIT(1, 12)},
+    {"ack",             FRAME_BIT(1, 13)},
+    {"null",            FRAME_BIT(2, 4)},
+    {"qos_data",        FRAME_BIT(2, 8)},
+    {"qos_null",        FRAME_BIT(2, 12)},
+};
+
+// Control subtype -> driver control filter bit
+const uint32_t ctrlFilterBits[16] = {
+    0, 0, 0, 0, 0, 0, 0,
+    WIFI_PROMIS_CTRL_FILTER_MASK_WRAPPER,
+    WIFI_PROMIS_CTRL_FILTER_MASK_BAR,
+    WIFI_PROMIS_CTRL_FILTER_MASK_BA,
+    WIFI_PROMIS_CTRL_FILTER_MASK_PSPOLL,
+    WIFI_PROMIS_CTRL_FILTER_MASK_RTS,
+    WIFI_PROMIS_CTRL_FILTER_MASK_CTS,
+    WIFI_PROMIS_CTRL_FILTER_MASK_ACK,
+    WIFI_PROMIS_CTRL_FILTER_MASK_CFEND,
+    (uint32_t)WIFI_PROMIS_CTRL_FILTER_MASK_CFENDACK,
+};
+
+}
+
+CaptureFilter::CaptureFilter() {
+    clear();
+}
+
+void CaptureFilter::clear() {
+    checks = 0;
+    channelMask = 0;
+    rssiMin = -128;
+    rssiMax = 127;
+    lengthMin = 0;
+    lengthMax = 0xFFFF;
+    frameMask = 0;
+    macCount = 0;
+}
+
+bool CaptureFilter::addChannel(uint8_t channel) {
+    if (channel < 1 || channel > 14) {
+        return false;
+    }
+    channelMask |= 1 << channel;
+    checks |= CAPTURE_CHECK_CHANNEL;
+    return true;
+}
+
+void CaptureFilter::setRssiRange(int8_t minimum, int8_t maximum) {
+    rssiMin = minimum;
+    rssiMax = maximum;
+    checks |= CAPTURE_CHECK_RSSI;
+}
+
+void CaptureFilter::setLengthRange(uint16_t minimum, uint16_t maximum) {
+    lengthMin = minimum;
+    lengthMax = maximum;
+    checks |= CAPTURE_CHECK_LENGTH;
+}
+
+bool CaptureFilter::addFrames(const char* name) {
+    for (const auto& entry : frameNames) {
+        if (strcmp(entry.name, name) == 0) {
+            frameMask |= entry.bits;
+            checks |= CAPTURE_CHECK_FRAME;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CaptureFilter::addMac(const char* addr, const char* mask, uint8_t fields) {
+    uint8_t mac[6];
+    uint8_t bits[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+    if (macCount >= CAPTURE_FILTER_MAX_MACS || fields == 0 || !parseMac(addr, mac)) {
+        return false;
+    }
+    if (mask && !parseMac(mask, bits)) {
+        return false;
+    }
+    
+    CaptureMacRule& rule = macs[macCount++];
+    rule.mask = readAddress(bits);
+    rule.addr = readAddress(mac) & rule.mask;
+    rule.fields = fields;
+    checks |= CAPTURE_CHECK_MAC;
+    return true;
+}
+
+bool CaptureFilter::matchMac(const uint8_t* frame, uint16_t len) const {
+    // Control frames may stop after the first or second address
+    uint8_t present = 0;
+    if (len >= 10) present |= CAPTURE_ADDR_1;
+    if (len >= 16) present |= CAPTURE_ADDR_2;
+    if (len >= 22) present |= CAPTURE_ADDR_3;
+    
+    // Address 3 in management and plain data frames, address 1 or 2 in
+    // frames to or from the DS; control and WDS frames have none
+    const uint8_t* bssid = dot11Bssid(frame, len);
+    if (bssid) present |= CAPTURE_ADDR_BSSID;
+    
+    for (uint8_t i = 0; i < macCount; i++) {
+        const CaptureMacRule& rule = macs[i];
+        uint8_t fields = rule.fields & present;
+        if (((fields & CAPTURE_ADDR_1) && (readAddress(frame + 4) & rule.mask) == rule.addr) ||
+            ((fields & CAPTURE_ADDR_2) && (readAddress(frame + 10) & rule.mask) == rule.addr) ||
+            ((fields & CAPTURE_ADDR_3) && (readAddress(frame + 16) & rule.mask) == rule.addr) ||
+            ((fields & CAPTURE_ADDR_BSSID) && (readAddress(bssid) & rule.mask) == rule.addr)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t CaptureFilter::getHardwareMask() const {
+    if (!(checks & CAPTURE_CHECK_FRAME)) {
+        return CAPTURE_HW_DEFAULT_MASK;
+    }
+    
+    // The driver filters by type only; subtypes are left to match()
+    uint32_t mask = 0;
+    if (frameMask & CAPTURE_FRAMES_MGMT) mask |= WIFI_PROMIS_FILTER_MASK_MGMT;
+    if (frameMask & CAPTURE_FRAMES_CTRL) mask |= WIFI_PROMIS_FILTER_MASK_CTRL;
+    if (frameMask & CAPTURE_FRAMES_DATA) mask |= WIFI_PROMIS_FILTER_MASK_DATA;
+    return mask;
+}
+
+uint32_t CaptureFilter::getCtrlMask() const {
+    if (!(checks & CAPTURE_CHECK_FRAME)) {
+        return WIFI_PROMIS_CTRL_FILTER_MASK_ALL;
+    }
+    
+    uint32_t mask = 0;
+    for (uint8_t subtype = 0; subtype < 16; subtype++) {
+        if ((frameMask >> (16 + subtype)) & 1) {
+            mask |= ctrlFilterBits[subtype];
+        }
+    }
+    return mask;
+}
+
+uint8_t CaptureFilter::fieldsFromName(const char* name) {
+    if (strcmp(name, "any") == 0) return CAPTURE_ADDR_ANY;
+    if (strcmp(name, "dst") == 0) return CAPTURE_ADDR_1;
+    if (strcmp(name, "src") == 0) return CAPTURE_ADDR_2;
+    if (strcmp(name, "bssid") == 0) return CAPTURE_ADDR_BSSID;
+    return 0;
+}
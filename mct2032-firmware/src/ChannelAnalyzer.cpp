@@ -0,0 +1,148 @@
+/**
+ * Channel Analyzer implementation
+ */
+
+#include "ChannelAnalyzer.h"
+#include "protocol.h"
+#include <math.h>
+
+// Spectral overlap of 22 MHz DSSS/OFDM masks at 0, 5, 10, 15 and 20 MHz offset
+const uint8_t ChannelAnalyzer::overlapWeight[ANALYZER_OVERLAP_SPAN + 1] = {
+    100, 80, 50, 20, 5
+};
+
+ChannelAnalyzer::ChannelAnalyzer() {
+    resetNetworks();
+    resetFrames();
+}
+
+float ChannelAnalyzer::dbmToMw(int32_t dbm) {
+    return powf(10.0f, dbm / 10.0f);
+}
+
+float ChannelAnalyzer::mwToDbm(float mw) {
+    if (mw <= 0.0f) {
+        return -100.0f;
+    }
+    return 10.0f * log10f(mw);
+}
+
+void ChannelAnalyzer::addNetwork(uint8_t channel, int32_t rssi) {
+    if (channel < 1 || channel > ANALYZER_MAX_CHANNEL) {
+        return;
+    }
+    
+    ChannelStats& stats = channels[channel];
+    float mw = dbmToMw(rssi);
+    
+    stats.apCount++;
+    stats.aggregateMw += mw;
+    if (stats.apCount == 1 || rssi > stats.strongestRssi) {
+        stats.strongestRssi = rssi;
+    }
+    
+    // Spread this AP's power into every channel it overlaps
+    for (int offset = -ANALYZER_OVERLAP_SPAN; offset <= ANALYZER_OVERLAP_SPAN; offset++) {
+        int target = channel + offset;
+        if (target < 1 || target > ANALYZER_MAX_CHANNEL) {
+            continue;
+        }
+        channels[target].interferenceMw += mw * overlapWeight[abs(offset)] / 100.0f;
+    }
+}
+
+void ChannelAnalyzer::recordFrame(uint8_t channel, int8_t rssi, uint16_t weight) {
+    if (channel < 1 || channel > ANALYZER_MAX_CHANNEL) {
+        return;
+    }
+    
+    channels[channel].frameCount += weight;
+    
+    for (int offset = -ANALYZER_OVERLAP_SPAN; offset <= ANALYZER_OVERLAP_SPAN; offset++) {
+        int target = channel + offset;
+        if (target < 1 || target > ANALYZER_MAX_CHANNEL) {
+            continue;
+        }
+        channels[target].frameLoad += overlapWeight[abs(offset)] * weight;
+    }
+}
+
+void ChannelAnalyzer::resetNetworks() {
+    for (int ch = 0; ch <= ANALYZER_MAX_CHANNEL; ch++) {
+        channels[ch].apCount = 0;
+        channels[ch].strongestRssi = -100;
+        channels[ch].aggregateMw = 0.0f;
+        channels[ch].interferenceMw = 0.0f;
+    }
+}
+
+void ChannelAnalyzer::resetNetworks(uint8_t channel) {
+    if (channel < 1 || channel > ANALYZER_MAX_CHANNEL) {
+        return;
+    }
+    
+    // The channel's APs spread aggregateMw in total, so take back that much
+    ChannelStats& stats = channels[channel];
+    for (int offset = -ANALYZER_OVERLAP_SPAN; offset <= ANALYZER_OVERLAP_SPAN; offset++) {
+        int target = channel + offset;
+        if (target < 1 || target > ANALYZER_MAX_CHANNEL) {
+            continue;
+        }
+        float remaining = channels[target].interferenceMw - stats.aggregateMw * overlapWeight[abs(offset)] / 100.0f;
+        channels[target].interferenceMw = remaining > 0.0f ? remaining : 0.0f;
+    }
+    stats.apCount = 0;
+    stats.strongestRssi = -100;
+    stats.aggregateMw = 0.0f;
+}
+
+void ChannelAnalyzer::resetFrames() {
+    for (int ch = 0; ch <= ANALYZER_MAX_CHANNEL; ch++) {
+        channels[ch].frameCount = 0;
+        channels[ch].frameLoad = 0;
+    }
+}
+
+uint8_t ChannelAnalyzer::getRecommendedChannel() const {
+    // Channel 14 is 802.11b-only in Japan, so never recommend it
+    uint8_t best = 1;
+    for (uint8_t ch = 2; ch < ANALYZER_MAX_CHANNEL; ch++) {
+        const ChannelStats& candidate = channels[ch];
+        const ChannelStats& current = channels[best];
+        
+        if (candidate.interferenceMw < current.interferenceMw) {
+            best = ch;
+        } else if (candidate.interferenceMw == current.interferenceMw &&
+                   candidate.frameLoad < current.frameLoad) {
+            // Live traffic breaks ties, e.g. when no APs were scanned
+            best = ch;
+        }
+    }
+    return best;
+}
+
+void ChannelAnalyzer::toJSON(DynamicJsonDocument& doc) {
+    doc[JSON_RECOMMENDED] = getRecommendedChannel();
+    
+    JsonArray channelArray = doc.createNestedArray(JSON_CHANNELS);
+    
+    for (uint8_t ch = 1; ch <= ANALYZER_MAX_CHANNEL; ch++) {
+        const ChannelStats& stats = channels[ch];
+        
+        // Skip channels with nothing on or near them to keep the report small
+        if (stats.interferenceMw == 0.0f && stats.frameLoad == 0) {
+            continue;
+        }
+        
+        JsonObject chObj = channelArray.createNestedObject();
+        chObj[JSON_CHANNEL] = ch;
+        chObj[JSON_AP_COUNT] = stats.apCount;
+        if (stats.apCount > 0) {
+            chObj[JSON_STRONGEST_RSSI] = stats.strongestRssi;
+            chObj[JSON_AGGREGATE_RSSI] = (int)roundf(mwToDbm(stats.aggregateMw));
+        }
+        chObj[JSON_INTERFERENCE] = (int)roundf(mwToDbm(stats.interferenceMw));
+        chObj[JSON_FRAMES] = stats.frameCount;
+        chObj[JSON_FRAME_LOAD] = stats.frameLoad / 100;
+    }
+}
@@ -3,44 +3,224 @@
  */
 
 #include "CommandProcessor.h"
-#include <SD.h>
+#include "PipelineMetrics.h"
+#include <mbedtls/base64.h>
 
-CommandProcessor::CommandProcessor(BLEManager* ble, WiFiScanner* wifi, PacketMonitor* monitor) :
+CommandProcessor::CommandProcessor(BLEManager* ble, WiFiScanner* wifi, PacketMonitor* monitor, ChannelAnalyzer* analyzer, Storage* store, SurveyLog* survey) :
     bleManager(ble),
     wifiScanner(wifi),
     packetMonitor(monitor),
+    channelAnalyzer(analyzer),
+    storage(store),
+    surveyLog(survey),
     currentMode(MODE_IDLE),
-    startTime(millis()) {
+    startTime(millis()),
+    exporter(wifi, monitor, analyzer),
+    scanCacheMaxAge(SCAN_CACHE_MAX_AGE),
+    scanCacheHits(0),
+    scanCacheMisses(0),
+    scanCoalesced(0),
+    alertCount(0),
+    highQueue(nullptr),
+    normalQueue(nullptr),
+    workerTask(nullptr),
+    commandsRejected(0),
+    batchDoc(nullptr),
+    batchResults(nullptr),
+    batchReserve(0),
+    batchResponded(false),
+    batchFailed(false) {
+    memset(commandStats, 0, sizeof(commandStats));
+    alertText[0] = '\0';
+    portMUX_INITIALIZE(&alertLock);
 }
 
-void CommandProcessor::init() {
-    // Register command handlers
-    commandHandlers[CMD_SCAN_WIFI] = [this](JsonVariant params) { handleScanWiFi(params); };
-    commandHandlers[CMD_SCAN_BLE] = [this](JsonVariant params) { handleScanBLE(params); };
-    commandHandlers[CMD_GET_STATUS] = [this](JsonVariant params) { handleGetStatus(params); };
-    commandHandlers[CMD_SET_CHANNEL] = [this](JsonVariant params) { handleSetChannel(params); };
-    commandHandlers[CMD_MONITOR_START] = [this](JsonVariant params) { handleMonitorStart(params); };
-    commandHandlers[CMD_MONITOR_STOP] = [this](JsonVariant params) { handleMonitorStop(params); };
-    commandHandlers[CMD_EXPORT_DATA] = [this](JsonVariant params) { handleExportData(params); };
-    commandHandlers[CMD_CLEAR_DATA] = [this](JsonVariant params) { handleClearData(params); };
+namespace {
+
+// Vendor name from the flash OUI table, left out when the OUI isn't listed
+void addVendor(JsonObject obj, const uint8_t* mac) {
+    char vendor[OUI_NAME_MAX];
+    if (OuiTable::name(OuiTable::lookup(mac), vendor, sizeof(vendor))) {
+        obj[JSON_VENDOR] = vendor;
+    }
+}
+
+} // namespace
+
+constexpr CommandProcessor::CommandEntry CommandProcessor::commandTable[] = {
+    {CMD_SCAN_WIFI,        &CommandProcessor::handleScanWiFi,        CMD_PRIORITY_NORMAL},
+    {CMD_SCAN_BLE,         &CommandProcessor::handleScanBLE,         CMD_PRIORITY_NORMAL},
+    {CMD_GET_STATUS,       &CommandProcessor::handleGetStatus,       CMD_PRIORITY_HIGH},
+    {CMD_SET_CHANNEL,      &CommandProcessor::handleSetChannel,      CMD_PRIORITY_NORMAL},
+    {CMD_MONITOR_START,    &CommandProcessor::handleMonitorStart,    CMD_PRIORITY_NORMAL},
+    {CMD_MONITOR_STOP,     &CommandProcessor::handleMonitorStop,     CMD_PRIORITY_HIGH},
+    {CMD_EXPORT_DATA,      &CommandProcessor::handleExportData,      CMD_PRIORITY_NORMAL},
+    {CMD_CLEAR_DATA,       &CommandProcessor::handleClearData,       CMD_PRIORITY_NORMAL},
+    {CMD_CHANNEL_REPORT,   &CommandProcessor::handleChannelReport,   CMD_PRIORITY_HIGH},
+    {CMD_GET_METRICS,      &CommandProcessor::handleGetMetrics,      CMD_PRIORITY_HIGH},
+    {CMD_JOB_LIST,         &CommandProcessor::handleJobList,         CMD_PRIORITY_HIGH},
+    {CMD_JOB_CANCEL,       &CommandProcessor::handleJobCancel,       CMD_PRIORITY_HIGH},
+    {CMD_STATS_STREAM,     &CommandProcessor::handleStatsStream,     CMD_PRIORITY_NORMAL},
+    {CMD_BATCH,            &CommandProcessor::handleBatch,           CMD_PRIORITY_NORMAL},
+    {CMD_TOP_TALKERS,      &CommandProcessor::handleTopTalkers,      CMD_PRIORITY_HIGH},
+    {CMD_DISTINCT_COUNT,   &CommandProcessor::handleDistinctCount,   CMD_PRIORITY_HIGH},
+    {CMD_ASSOC_GRAPH,      &CommandProcessor::handleAssocGraph,      CMD_PRIORITY_HIGH},
+    {CMD_AIRTIME,          &CommandProcessor::handleAirtime,         CMD_PRIORITY_HIGH},
+    {CMD_PHY_STATS,        &CommandProcessor::handlePhyStats,        CMD_PRIORITY_HIGH},
+    {CMD_PROBE_REPORT,     &CommandProcessor::handleProbeReport,     CMD_PRIORITY_HIGH},
+    {CMD_ROGUE_ALLOW,      &CommandProcessor::handleRogueAllow,      CMD_PRIORITY_HIGH},
     
     // Advanced command handlers
-    commandHandlers[CMD_DEAUTH_ATTACK] = [this](JsonVariant params) { handleDeauthAttack(params); };
-    commandHandlers[CMD_BEACON_SPAM] = [this](JsonVariant params) { handleBeaconSpam(params); };
-    commandHandlers[CMD_RICKROLL] = [this](JsonVariant params) { handleRickroll(params); };
-    commandHandlers[CMD_PCAP_START] = [this](JsonVariant params) { handlePCAPStart(params); };
-    commandHandlers[CMD_PCAP_STOP] = [this](JsonVariant params) { handlePCAPStop(params); };
+    {CMD_DEAUTH_ATTACK,    &CommandProcessor::handleDeauthAttack,    CMD_PRIORITY_NORMAL},
+    {CMD_BEACON_SPAM,      &CommandProcessor::handleBeaconSpam,      CMD_PRIORITY_NORMAL},
+    {CMD_RICKROLL,         &CommandProcessor::handleRickroll,        CMD_PRIORITY_NORMAL},
+    {CMD_PCAP_START,       &CommandProcessor::handlePCAPStart,       CMD_PRIORITY_NORMAL},
+    {CMD_PCAP_STOP,        &CommandProcessor::handlePCAPStop,        CMD_PRIORITY_HIGH},
+    {CMD_FLIGHT_ARM,       &CommandProcessor::handleFlightArm,       CMD_PRIORITY_NORMAL},
+    {CMD_FLIGHT_TRIGGER,   &CommandProcessor::handleFlightTrigger,   CMD_PRIORITY_HIGH},
+    {CMD_FLIGHT_DISARM,    &CommandProcessor::handleFlightDisarm,    CMD_PRIORITY_HIGH},
+};
+
+constexpr CommandSlots CommandProcessor::commandSlots = buildCommandSlots(CommandProcessor::commandTable);
+
+void CommandProcessor::init() {
+    static_assert(commandSlots.valid, "No collision-free seed for command table");
+    
+    highQueue = xQueueCreate(CMD_QUEUE_HIGH_DEPTH, sizeof(QueuedCommand));
+    normalQueue = xQueueCreate(CMD_QUEUE_NORMAL_DEPTH, sizeof(QueuedCommand));
+    
+    xTaskCreatePinnedToCore(workerTaskEntry, "cmd_worker", CMD_TASK_STACK_SIZE,
+                            this, CMD_TASK_PRIORITY, &workerTask, tskNO_AFFINITY);
+    
+    Serial.printf("Command processor initialized with %d commands (hash seed %u)\n",
+                  (int)(sizeof(commandTable) / sizeof(commandTable[0])), commandSlots.seed);
+}
+
+const CommandProcessor::CommandEntry* CommandProcessor::findCommand(const char* name) const {
+    return findCommandEntry(commandSlots, commandTable, name);
+}
+
+bool CommandProcessor::peekCommandName(const char* data, size_t length, char* name, size_t nameSize) {
+    // Cheap scan for "cmd":"NAME" so priority can be picked without a JSON parse
+    static const char key[] = "\"" JSON_CMD "\"";
+    const char* end = data + length;
+    const char* p = data;
+    
+    while (p + sizeof(key) - 1 <= end && memcmp(p, key, sizeof(key) - 1) != 0) {
+        p++;
+    }
+    if (p + sizeof(key) - 1 > end) {
+        return false;
+    }
+    p += sizeof(key) - 1;
+    
+    while (p < end && (*p == ' ' || *p == ':')) {
+        p++;
+    }
+    if (p >= end || *p != '"') {
+        return false;
+    }
+    p++;
+    
+    size_t n = 0;
+    while (p < end && *p != '"' && n < nameSize - 1) {
+        name[n++] = *p++;
+    }
+    name[n] = '\0';
+    return p < end && *p == '"';
+}
+
+bool CommandProcessor::enqueueCommand(const char* data, size_t length) {
+    char name[32];
+    const CommandEntry* entry = nullptr;
+    if (peekCommandName(data, length, name, sizeof(name))) {
+        entry = findCommand(name);
+    } else {
+        name[0] = '\0';
+    }
+    
+    if (length > MAX_COMMAND_SIZE) {
+        bleManager->sendError(name, "Command too large");
+        return false;
+    }
+    
+    QueuedCommand item;
+    item.index = entry ? (uint8_t)(entry - commandTable) : 0xFF;
+    item.length = length;
+    item.enqueueTime = micros();
+    memcpy(item.data, data, length);
+    item.data[length] = '\0';
+    
+    QueueHandle_t queue = (entry && entry->priority == CMD_PRIORITY_HIGH) ? highQueue : normalQueue;
+    if (xQueueSend(queue, &item, 0) != pdTRUE) {
+        commandsRejected++;
+        Serial.printf("Command queue full, rejecting '%s'\n", name);
+        bleManager->sendBusy(name, "Command queue full");
+        return false;
+    }
     
-    Serial.println("Command processor initialized with advanced features");
+    xTaskNotifyGive(workerTask);
+    return true;
 }
 
-void CommandProcessor::processCommand(const String& commandStr) {
+void CommandProcessor::workerTaskEntry(void* arg) {
+    static_cast<CommandProcessor*>(arg)->workerLoop();
+}
+
+void CommandProcessor::workerLoop() {
+    // QueuedCommand is too big for the stack alongside handler JSON documents
+    static QueuedCommand item;
+    
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(CMD_TASK_IDLE_MS));
+        
+        // Drain status queries first, then take one normal command at a time
+        // so a burst of scans can't starve a later status request
+        for (;;) {
+            if (xQueueReceive(highQueue, &item, 0) == pdTRUE) {
+                executeQueued(item);
+            } else if (xQueueReceive(normalQueue, &item, 0) == pdTRUE) {
+                executeQueued(item);
+            } else {
+                break;
+            }
+        }
+        
+        serviceJobs();
+        serviceApEvents();
+        packetMonitor->getProbes().service();
+        surveyLog->service();
+    }
+}
+
+void CommandProcessor::executeQueued(const QueuedCommand& item) {
+    uint32_t startUs = micros();
+    processCommand(item.data, item.length);
+    uint32_t endUs = micros();
+    
+    if (item.index == 0xFF) {
+        return;
+    }
+    
+    CommandStats& stats = commandStats[item.index];
+    uint32_t waitUs = startUs - item.enqueueTime;
+    uint32_t execUs = endUs - startUs;
+    
+    stats.count++;
+    stats.waitTotalUs += waitUs;
+    stats.execTotalUs += execUs;
+    if (waitUs > stats.waitMaxUs) stats.waitMaxUs = waitUs;
+    if (execUs > stats.execMaxUs) stats.execMaxUs = execUs;
+}
+
+void CommandProcessor::processCommand(const char* commandStr, size_t length) {
     Serial.println("=== COMMAND PROCESSOR ===");
-    Serial.printf("Received command string: '%s'\n", commandStr.c_str());
-    Serial.printf("Command length: %d\n", commandStr.length());
+    Serial.printf("Received command string: '%s'\n", commandStr);
+    Serial.printf("Command length: %d\n", length);
     
-    DynamicJsonDocument doc(512);
-    DeserializationError error = deserializeJson(doc, commandStr);
+    // Leave headroom over the raw size for BATCH payloads
+    DynamicJsonDocument doc(MAX_COMMAND_SIZE * 2);
+    DeserializationError error = deserializeJson(doc, commandStr, length);
     
     if (error) {
         Serial.printf("Failed to parse command: %s\n", error.c_str());
@@ -51,60 +231,174 @@ void CommandProcessor::processCommand(const String& commandStr) {
     
     Serial.println("JSON parsed successfully");
     
-    String cmd = doc[JSON_CMD] | "";
-    if (cmd.isEmpty()) {
-        bleManager->sendError("", "Missing command");
+    const char* cmd = doc[JSON_CMD] | "";
+    if (cmd[0] == '\0') {
+        respondError("", "Missing command");
         return;
     }
     
-    Serial.printf("Processing command: %s\n", cmd.c_str());
+    dispatch(cmd, doc[JSON_PARAMS]);
+}
+
+void CommandProcessor::dispatch(const char* cmd, JsonVariant params) {
+    Serial.printf("Processing command: %s\n", cmd);
     
     // Find and execute handler
-    auto it = commandHandlers.find(cmd);
-    if (it != commandHandlers.end()) {
-        JsonVariant params = doc[JSON_PARAMS];
-        it->second(params);
+    const CommandEntry* entry = findCommand(cmd);
+    if (entry) {
+        (this->*entry->handler)(params);
     } else {
-        bleManager->sendError(cmd, "Unknown command");
+        respondError(cmd, "Unknown command");
     }
 }
 
-void CommandProcessor::handleScanWiFi(JsonVariant params) {
-    Serial.println("=== handleScanWiFi called ===");
+// Handlers reply through these so BATCH can collect their responses
+void CommandProcessor::respond(const char* cmd, const char* status, const DynamicJsonDocument& data) {
+    if (!batchResults) {
+        bleManager->sendResponse(cmd, status, data);
+        return;
+    }
     
-    if (currentMode != MODE_IDLE) {
-        Serial.printf("ERROR: Device busy, current mode: %d\n", currentMode);
-        bleManager->sendError(CMD_SCAN_WIFI, "Device busy");
+    // Too big for the batch reply: send it on its own and list it there
+    if (!fitsBatch(data)) {
+        bleManager->sendResponse(cmd, status, data);
+        respondSeparately(cmd, status);
         return;
     }
     
+    JsonObject result = batchResults->createNestedObject();
+    result[JSON_CMD] = cmd;
+    result[JSON_STATUS] = status;
+    result[JSON_DATA] = data;
+    batchResponded = true;
+    
+    // The size check is an estimate; a copy that still ran out is an error, not a success
+    if (batchDoc->overflowed()) {
+        result.remove(JSON_DATA);
+        result[JSON_STATUS] = STATUS_ERROR;
+        batchFailed = true;
+    }
+}
+
+// Reports with item lists go out one item per notification unless they fit the batch reply
+void CommandProcessor::respondChunked(const char* cmd, const char* status, const DynamicJsonDocument& data) {
+    if (batchResults && fitsBatch(data)) {
+        respond(cmd, status, data);
+        return;
+    }
+    
+    if (!bleManager->sendChunkedResponse(cmd, status, data)) {
+        Serial.printf("ERROR: Failed to send %s response!\n", cmd);
+    }
+    if (batchResults) {
+        respondSeparately(cmd, status);
+    }
+}
+
+bool CommandProcessor::fitsBatch(const DynamicJsonDocument& data) const {
+    // Each entry is sent as one chunk, so it has to fit a notification
+    if (measureJson(data) + BATCH_ENTRY_OVERHEAD > MAX_NOTIFY_SIZE) {
+        return false;
+    }
+    
+    // A deep copy takes at most the source's memory plus this entry's slots
+    size_t needed = data.memoryUsage() + JSON_ARRAY_SIZE(1) + JSON_OBJECT_SIZE(3);
+    return batchDoc->memoryUsage() + needed + batchReserve <= batchDoc->capacity();
+}
+
+void CommandProcessor::respondSeparately(const char* cmd, const char* status) {
+    JsonObject result = batchResults->createNestedObject();
+    result[JSON_CMD] = cmd;
+    result[JSON_STATUS] = status;
+    result[JSON_SEPARATE] = true;
+    batchResponded = true;
+}
+
+void CommandProcessor::respondError(const char* cmd, const char* error) {
+    if (!batchResults) {
+        bleManager->sendError(cmd, error);
+        return;
+    }
+    
+    JsonObject result = batchResults->createNestedObject();
+    result[JSON_CMD] = cmd;
+    result[JSON_STATUS] = STATUS_ERROR;
+    result[JSON_ERROR] = error;
+    batchResponded = true;
+    batchFailed = true;
+}
+
+void CommandProcessor::handleScanWiFi(JsonVariant params) {
+    Serial.println("=== handleScanWiFi called ===");
+    
     int duration = params["duration"] | 3000;
     int channel = params["channel"] | 0;
+    uint32_t maxAge = params["max_age"] | scanCacheMaxAge;
+    bool force = params["force"] | false;
+    
+    Serial.printf("Scan params - duration: %d, channel: %d, max_age: %u\n", duration, channel, maxAge);
     
-    Serial.printf("Scan params - duration: %d, channel: %d\n", duration, channel);
+    // Serve recent results without touching the radio
+    if (!force && wifiScanner->hasCachedResults(channel, maxAge)) {
+        scanCacheHits++;
+        Serial.printf("Scan cache hit, age: %u ms\n", wifiScanner->getResultAge());
+        sendScanResults();      // Answers through the batch when in one
+        return;
+    }
     
-    currentMode = MODE_SCANNING;
-    Serial.printf("Mode changed to: %d\n", currentMode);
+    // Attach to the in-flight scan when it covers the channel asked for; its
+    // results go out when it completes. An all-channel scan covers any channel.
+    if (jobs.findByType(JOB_SCAN)) {
+        uint8_t inFlight = wifiScanner->getScanChannel();
+        if (inFlight != 0 && inFlight != channel) {
+            respondError(CMD_SCAN_WIFI, "Scan in progress on another channel");
+            return;
+        }
+        scanCoalesced++;
+        Serial.println("Scan already running, attaching to in-flight scan");
+        return;
+    }
+    
+    const char* reason = nullptr;
+    Job* job = jobs.start(JOB_SCAN, JOB_RES_RADIO, JOB_RES_BLE_BW, &reason);
+    if (!job) {
+        Serial.printf("ERROR: Cannot start scan: %s\n", reason);
+        respondError(CMD_SCAN_WIFI, reason);
+        return;
+    }
+    
+    scanCacheMisses++;
+    job->duration = (channel == 0 ? 14 : 1) * SCAN_DWELL_MS;
+    
+    // The scanner repopulates the analyzer as results come in; a single
+    // channel scan keeps what the others last saw
+    if (channel == 0) {
+        channelAnalyzer->resetNetworks();
+    } else {
+        channelAnalyzer->resetNetworks(channel);
+    }
     
     // Start scan
     if (wifiScanner->startScan(channel)) {
-        // Don't send immediate response - wait for scan results
-        // The main loop will send the results when scan completes
+        // Don't send immediate response - the scan job sends the
+        // results when the scan completes
         Serial.println("WiFi scan started successfully");
+        updateMode();
+        sendJobEvent(job);
     } else {
-        currentMode = MODE_IDLE;
+        jobs.release(job);
         Serial.println("ERROR: Failed to start WiFi scan!");
-        bleManager->sendError(CMD_SCAN_WIFI, "Failed to start scan");
+        respondError(CMD_SCAN_WIFI, "Failed to start scan");
     }
 }
 
 void CommandProcessor::handleScanBLE(JsonVariant params) {
     // TODO: Implement BLE scanning
-    bleManager->sendError(CMD_SCAN_BLE, "Not implemented yet");
+    respondError(CMD_SCAN_BLE, "Not implemented yet");
 }
 
 void CommandProcessor::handleGetStatus(JsonVariant params) {
-    DynamicJsonDocument status(512);
+    DynamicJsonDocument status(1024);
     
     status[JSON_UPTIME] = getUptime();
     status[JSON_FREE_HEAP] = getFreeHeap();
@@ -114,86 +408,692 @@ void CommandProcessor::handleGetStatus(JsonVariant params) {
     status[JSON_WIFI_STATUS] = WiFi.isConnected();
     status[JSON_BLE_STATUS] = bleManager->isConnected();
     
-    bleManager->sendResponse(CMD_GET_STATUS, STATUS_SUCCESS, status);
+    status[JSON_JOBS] = jobs.getActiveCount();
+    
+    HiddenResolver& resolver = packetMonitor->getHidden();
+    JsonObject hidden = status.createNestedObject(JSON_HIDDEN);
+    hidden[JSON_PENDING] = resolver.getPending(millis());
+    hidden[JSON_RESOLVED] = resolver.getResolved();
+    
+    JsonObject cache = status.createNestedObject(JSON_SCAN_CACHE);
+    cache[JSON_CACHE_HITS] = scanCacheHits;
+    cache[JSON_CACHE_MISSES] = scanCacheMisses;
+    cache[JSON_CACHE_COALESCED] = scanCoalesced;
+    cache[JSON_CACHE_MAX_AGE] = scanCacheMaxAge;
+    
+    if (isSDCardPresent()) {
+        storage->refreshUsage();
+        JsonObject sd = status.createNestedObject(JSON_STORAGE);
+        sd[JSON_TOTAL_MB] = (uint32_t)(storage->getTotalBytes() >> 20);
+        sd[JSON_USED_MB] = (uint32_t)(storage->getUsedBytes() >> 20);
+        sd[JSON_WRITE_KBPS] = storage->getWriteSpeed();
+    }
+    
+    if (packetMonitor->isMonitoring()) {
+        const OverloadController& overload = packetMonitor->getOverload();
+        JsonObject load = status.createNestedObject(JSON_LOAD);
+        load[JSON_LEVEL] = OverloadController::levelName(overload.getLevel());
+        load[JSON_SAMPLE_N] = overload.getSampleN();
+    }
+    
+    if (packetMonitor->getFlightRecorder().isActive()) {
+        fillFlightStatus(status.createNestedObject(JSON_FLIGHT));
+    }
+    
+    if (surveyLog->isActive()) {
+        const SurveyReplayStats& replay = surveyLog->getReplayStats();
+        JsonObject survey = status.createNestedObject(JSON_SURVEY);
+        survey[JSON_SESSION] = surveyLog->getSession();
+        survey[JSON_RECORDS] = surveyLog->getRecordsWritten();
+        survey[JSON_CHECKPOINTS] = surveyLog->getCheckpointsWritten();
+        survey[JSON_LOG_BYTES] = surveyLog->getLogSize();
+        survey[JSON_REPLAYED] = replay.records;
+        survey[JSON_REPLAY_MS] = replay.durationMs;
+        survey[JSON_SKIPPED] = replay.skippedBytes;
+        survey[JSON_TOTAL_PACKETS] = surveyLog->getTotals().packets;
+    }
+    
+    respond(CMD_GET_STATUS, STATUS_SUCCESS, status);
 }
 
 void CommandProcessor::handleSetChannel(JsonVariant params) {
     int channel = params["channel"] | 0;
     
     if (channel < 0 || channel > 14) {
-        bleManager->sendError(CMD_SET_CHANNEL, "Invalid channel");
+        respondError(CMD_SET_CHANNEL, "Invalid channel");
         return;
     }
     
     // TODO: Implement channel setting for monitor mode
     DynamicJsonDocument response(256);
     response["channel"] = channel;
-    bleManager->sendResponse(CMD_SET_CHANNEL, STATUS_SUCCESS, response);
+    respond(CMD_SET_CHANNEL, STATUS_SUCCESS, response);
 }
 
 void CommandProcessor::handleMonitorStart(JsonVariant params) {
-    if (currentMode != MODE_IDLE) {
-        bleManager->sendError(CMD_MONITOR_START, "Device busy");
+    int channel = params["channel"] | 0;
+    uint32_t duration = params["duration"] | 0;
+    
+    const char* reason = nullptr;
+    Job* job = jobs.start(JOB_MONITOR, 0, JOB_RES_RADIO, &reason);
+    if (!job) {
+        respondError(CMD_MONITOR_START, reason);
         return;
     }
+    job->duration = duration;
     
-    int channel = params["channel"] | 0;
+    // An absent filter clears the previous session's
+    CaptureFilter filter;
+    const char* error = nullptr;
+    if (!compileFilter(params[JSON_FILTER], filter, &error)) {
+        jobs.release(job);
+        respondError(CMD_MONITOR_START, error);
+        return;
+    }
+    packetMonitor->setFilter(filter);
+    bool dedup = params[JSON_DEDUP] | false;
+    packetMonitor->setDedup(dedup);
     
     // Start packet monitoring
     if (packetMonitor->startMonitor(channel)) {
-        currentMode = MODE_MONITORING;
+        channelAnalyzer->resetFrames();
+        updateMode();
         
-        DynamicJsonDocument response(256);
+        DynamicJsonDocument response(384);
         response["message"] = "Monitor mode started";
         response["channel"] = channel;
-        bleManager->sendResponse(CMD_MONITOR_START, STATUS_SUCCESS, response);
-        
-        // Set up periodic stats updates
-        // This will be handled in main loop
+        if (filter.isActive()) {
+            JsonObject compiled = response.createNestedObject(JSON_FILTER);
+            compiled[JSON_CHECKS] = filter.getChecks();
+            compiled[JSON_HW_MASK] = filter.getHardwareMask();
+            compiled[JSON_CTRL_MASK] = filter.getCtrlMask();
+        }
+        response[JSON_DEDUP] = dedup;
+        response[JSON_JOB_ID] = job->id;
+        respond(CMD_MONITOR_START, STATUS_SUCCESS, response);
+        sendJobEvent(job);
     } else {
-        bleManager->sendError(CMD_MONITOR_START, "Failed to start monitor mode");
+        jobs.release(job);
+        respondError(CMD_MONITOR_START, "Failed to start monitor mode");
     }
 }
 
 void CommandProcessor::handleMonitorStop(JsonVariant params) {
-    if (currentMode != MODE_MONITORING) {
-        bleManager->sendError(CMD_MONITOR_STOP, "Not in monitor mode");
+    Job* job = jobs.findByType(JOB_MONITOR);
+    if (!job) {
+        respondError(CMD_MONITOR_STOP, "Not in monitor mode");
         return;
     }
     
-    // Stop packet monitoring
-    packetMonitor->stopMonitor();
-    currentMode = MODE_IDLE;
+    // Stop packet monitoring along with anything that depends on it
+    stopMonitorJob(job, JOB_STATE_DONE);
     
     // Send final stats
-    DynamicJsonDocument response(512);
+    DynamicJsonDocument response(2048);
     response["message"] = "Monitor mode stopped";
     response["stats"]["packets_total"] = packetMonitor->getPacketsTotal();
     response["stats"]["beacons"] = packetMonitor->getBeaconCount();
     response["stats"]["probes"] = packetMonitor->getProbeCount();
     response["stats"]["deauths"] = packetMonitor->getDeauthCount();
     response["stats"]["data"] = packetMonitor->getDataCount();
+    fillLossStats(response["stats"].createNestedObject(JSON_LOSS));
     
-    bleManager->sendResponse(CMD_MONITOR_STOP, STATUS_SUCCESS, response);
+    respond(CMD_MONITOR_STOP, STATUS_SUCCESS, response);
 }
 
 void CommandProcessor::handleExportData(JsonVariant params) {
-    if (!isSDCardPresent()) {
-        bleManager->sendError(CMD_EXPORT_DATA, "SD card not present");
+    String target = params[JSON_TARGET] | "ble";
+    String formatName = params[JSON_FORMAT] | "binary";
+    
+    uint8_t format;
+    if (formatName == "binary") {
+        format = EXPORT_FORMAT_BINARY;
+    } else if (formatName == "csv") {
+        format = EXPORT_FORMAT_CSV;
+    } else {
+        respondError(CMD_EXPORT_DATA, "Unknown format");
+        return;
+    }
+    
+    bool toSD = (target == "sd");
+    if (!toSD && target != "ble") {
+        respondError(CMD_EXPORT_DATA, "Unknown target");
+        return;
+    }
+    if (toSD && !isSDCardPresent()) {
+        respondError(CMD_EXPORT_DATA, "SD card not present");
+        return;
+    }
+    
+    // Holding the radio shared keeps a new scan from replacing the AP list mid-export
+    const char* reason = nullptr;
+    Job* job = jobs.start(JOB_EXPORT, toSD ? JOB_RES_SD : JOB_RES_BLE_BW, JOB_RES_RADIO, &reason);
+    if (!job) {
+        respondError(CMD_EXPORT_DATA, reason);
+        return;
+    }
+    
+    String filename = params[JSON_FILENAME] | (format == EXPORT_FORMAT_CSV ? "/export.csv" : "/export.mctx");
+    ExportSink* sink;
+    if (toSD) {
+        StorageStream* stream = storage->openAppend(filename.c_str(), true);
+        if (!stream) {
+            jobs.release(job);
+            respondError(CMD_EXPORT_DATA, "Failed to create file");
+            return;
+        }
+        sink = new StorageExportSink(stream);
+    } else {
+        sink = new BLEExportSink(bleManager);
+    }
+    
+    if (!exporter.begin(sink, format)) {
+        jobs.release(job);
+        respondError(CMD_EXPORT_DATA, "Export already running");
         return;
     }
+    job->progress = 0;
+    updateMode();
     
-    // TODO: Implement data export
-    bleManager->sendError(CMD_EXPORT_DATA, "Not implemented yet");
+    DynamicJsonDocument response(256);
+    response["message"] = "Export started";
+    response[JSON_TARGET] = target;
+    response[JSON_FORMAT] = DataExporter::formatName(format);
+    if (toSD) {
+        response[JSON_FILENAME] = filename;
+    }
+    response[JSON_JOB_ID] = job->id;
+    respond(CMD_EXPORT_DATA, STATUS_SUCCESS, response);
+    sendJobEvent(job);
 }
 
 void CommandProcessor::handleClearData(JsonVariant params) {
     // Clear any stored data
-    wifiScanner->getResults().clear();
+    wifiScanner->clearResults();
+    channelAnalyzer->resetNetworks();
+    channelAnalyzer->resetFrames();
     
     DynamicJsonDocument response(256);
     response["message"] = "Data cleared";
-    bleManager->sendResponse(CMD_CLEAR_DATA, STATUS_SUCCESS, response);
+    respond(CMD_CLEAR_DATA, STATUS_SUCCESS, response);
+}
+
+void CommandProcessor::sendScanResults() {
+    // Use larger document size for WiFi results
+    DynamicJsonDocument doc(10240);
+    wifiScanner->toJSON(doc);
+    
+    size_t jsonSize = measureJson(doc);
+    Serial.printf("Sending %d networks, JSON size: %d bytes\n",
+                  wifiScanner->getNetworkCount(), jsonSize);
+    
+    // A cache hit inside a BATCH is listed there, inline if it fits
+    respondChunked(CMD_SCAN_WIFI, STATUS_SUCCESS, doc);
+}
+
+void CommandProcessor::handleChannelReport(JsonVariant params) {
+    DynamicJsonDocument response(2048);
+    channelAnalyzer->toJSON(response);
+    respondChunked(CMD_CHANNEL_REPORT, STATUS_SUCCESS, response);
+}
+
+void CommandProcessor::handleTopTalkers(JsonVariant params) {
+    String kindName = params[JSON_KIND] | "tx";
+    String byName = params[JSON_BY] | "frames";
+    uint8_t k = params[JSON_TOP_K] | 10;
+    
+    uint8_t kind;
+    if (kindName == "tx") {
+        kind = TALKER_KIND_TX;
+    } else if (kindName == "bssid") {
+        kind = TALKER_KIND_BSSID;
+    } else {
+        respondError(CMD_TOP_TALKERS, "Unknown kind");
+        return;
+    }
+    
+    uint8_t by;
+    if (byName == "frames") {
+        by = TALKER_BY_FRAMES;
+    } else if (byName == "bytes") {
+        by = TALKER_BY_BYTES;
+    } else {
+        respondError(CMD_TOP_TALKERS, "Unknown ranking");
+        return;
+    }
+    
+    TalkerResult top[TALKER_MAX_RESULTS];
+    uint32_t windowMs;
+    uint32_t total;
+    uint8_t count = packetMonitor->getTalkers().query(kind, by, top, k, millis(), &windowMs, &total);
+    
+    // True value of each count lies in [count - error_bound, count]
+    DynamicJsonDocument response(3072);
+    response[JSON_KIND] = kindName;
+    response[JSON_BY] = byName;
+    response[JSON_WINDOW_MS] = windowMs;
+    response[JSON_TOTAL] = total;
+    JsonArray talkers = response.createNestedArray(JSON_TALKERS);
+    for (uint8_t i = 0; i < count; i++) {
+        char mac[MAC_STRING_LEN];
+        macToString(top[i].mac, mac);
+        JsonObject talker = talkers.createNestedObject();
+        talker[JSON_MAC] = mac;
+        addVendor(talker, top[i].mac);
+        talker[JSON_COUNT] = top[i].count;
+        talker[JSON_ERROR_BOUND] = top[i].error;
+    }
+    
+    // One chunk per talker
+    respondChunked(CMD_TOP_TALKERS, STATUS_SUCCESS, response);
+}
+
+void CommandProcessor::handleDistinctCount(JsonVariant params) {
+    DistinctCounters& distinct = packetMonitor->getDistinct();
+    if (!distinct.isReady()) {
+        respondError(CMD_DISTINCT_COUNT, "Distinct counters unavailable");
+        return;
+    }
+    
+    // Clamped to what the sketches retain before scaling, so it can't wrap
+    uint32_t windowS = params[JSON_WINDOW_S] | 3600UL;
+    uint32_t maxWindowS = distinct.getMaxSpanMs() / 1000;
+    if (windowS > maxWindowS) {
+        windowS = maxWindowS;
+    }
+    uint32_t spanMs = windowS * 1000UL;
+    uint16_t channelMask = 0;
+    for (JsonVariant channel : params[JSON_CHANNELS].as<JsonArray>()) {
+        uint8_t ch = channel | 0;
+        if (ch < 1 || ch > DISTINCT_CHANNELS) {
+            respondError(CMD_DISTINCT_COUNT, "Invalid channel");
+            return;
+        }
+        channelMask |= 1 << ch;
+    }
+    if (channelMask == 0) {
+        channelMask = ((1 << DISTINCT_CHANNELS) - 1) << 1;
+    }
+    
+    // Totals are a merge across channels, so a device seen on two counts once
+    uint32_t now = millis();
+    uint32_t counts[DISTINCT_KINDS];
+    uint32_t covered = distinct.count(channelMask, spanMs, now, counts);
+    
+    DynamicJsonDocument response(3072);
+    response[JSON_WINDOW_S] = covered / 1000;
+    response[JSON_MAX_WINDOW_S] = maxWindowS;
+    for (uint8_t kind = 0; kind < DISTINCT_KINDS; kind++) {
+        response[DistinctCounters::kindName(kind)] = counts[kind];
+    }
+    
+    JsonArray channels = response.createNestedArray(JSON_CHANNELS);
+    for (uint8_t ch = 1; ch <= DISTINCT_CHANNELS; ch++) {
+        if (!(channelMask & (1 << ch))) {
+            continue;
+        }
+        distinct.count(1 << ch, spanMs, now, counts);
+        if (counts[DISTINCT_TX] == 0 && counts[DISTINCT_BSSIDS] == 0) {
+            continue;
+        }
+        JsonObject chObj = channels.createNestedObject();
+        chObj[JSON_CHANNEL] = ch;
+        for (uint8_t kind = 0; kind < DISTINCT_KINDS; kind++) {
+            chObj[DistinctCounters::kindName(kind)] = counts[kind];
+        }
+    }
+    
+    // One chunk per channel
+    respondChunked(CMD_DISTINCT_COUNT, STATUS_SUCCESS, response);
+}
+
+void CommandProcessor::handleAssocGraph(JsonVariant params) {
+    uint8_t limit = params[JSON_LIMIT] | 16;
+    if (limit == 0 || limit > TRAFFIC_REPORT_MAX) {
+        limit = TRAFFIC_REPORT_MAX;
+    }
+    
+    // Optional filter to one AP's stations
+    uint8_t only[6];
+    const char* bssidText = params[JSON_BSSID] | (const char*)nullptr;
+    if (bssidText && !parseMac(bssidText, only)) {
+        respondError(CMD_ASSOC_GRAPH, "Invalid BSSID");
+        return;
+    }
+    
+    // Copied out under the graph's lock; too big for the worker stack
+    static TrafficGraphReport graph;
+    packetMonitor->getTraffic().getGraph(&graph, limit, bssidText ? only : nullptr);
+    
+    uint32_t now = millis();
+    char mac[MAC_STRING_LEN];
+    DynamicJsonDocument response(16384);
+    response[JSON_STATIONS] = graph.stationCount;
+    response[JSON_AP_COUNT] = graph.bssCount;
+    response[JSON_DATA_FRAMES] = graph.dataFrames;
+    
+    JsonArray apArr = response.createNestedArray(JSON_APS);
+    for (uint8_t i = 0; i < graph.apCount; i++) {
+        const BssTrafficReport& bss = graph.aps[i];
+        macToString(bss.bssid, mac);
+        JsonObject ap = apArr.createNestedObject();
+        ap[JSON_BSSID] = mac;
+        addVendor(ap, bss.bssid);
+        ap[JSON_STATIONS] = bss.stations;
+        ap[JSON_FRAMES_UP] = bss.framesUp;
+        ap[JSON_FRAMES_DOWN] = bss.framesDown;
+        ap[JSON_BYTES_UP] = bss.bytesUp;
+        ap[JSON_BYTES_DOWN] = bss.bytesDown;
+        JsonObject ac = ap.createNestedObject(JSON_AC_FRAMES);
+        for (uint8_t n = 0; n < TRAFFIC_AC_COUNT; n++) {
+            ac[TrafficGraph::acName(n)] = bss.acFrames[n];
+        }
+    }
+    
+    JsonArray edgeArr = response.createNestedArray(JSON_EDGES);
+    for (uint8_t i = 0; i < graph.edgeCount; i++) {
+        const EdgeTrafficReport& station = graph.edges[i];
+        JsonObject edge = edgeArr.createNestedObject();
+        macToString(station.station, mac);
+        edge[JSON_STATION] = mac;
+        macToString(station.bssid, mac);
+        edge[JSON_BSSID] = mac;
+        edge[JSON_FRAMES_UP] = station.framesUp;
+        edge[JSON_FRAMES_DOWN] = station.framesDown;
+        edge[JSON_BYTES_UP] = station.bytesUp;
+        edge[JSON_BYTES_DOWN] = station.bytesDown;
+        edge[JSON_TIDS] = station.tidMask;
+        edge[JSON_ROAMS] = station.roams;
+        edge[JSON_AGE_S] = (now - station.lastSeen) / 1000;
+    }
+    
+    // One chunk per AP and per edge
+    respondChunked(CMD_ASSOC_GRAPH, STATUS_SUCCESS, response);
+}
+
+void CommandProcessor::handleAirtime(JsonVariant params) {
+    uint8_t limit = params[JSON_LIMIT] | 8;
+    if (limit == 0 || limit > AIRTIME_BSS_MAX) {
+        limit = AIRTIME_BSS_MAX;
+    }
+    
+    // Largest share of the session's airtime first
+    AirtimeMeter& airtime = packetMonitor->getAirtime();
+    uint32_t now = millis();
+    BssAirtimeReport top[AIRTIME_BSS_MAX];
+    uint64_t totalUs;
+    uint8_t count = airtime.getTopBss(top, limit, &totalUs);
+    
+    DynamicJsonDocument response(6144);
+    response[JSON_AIRTIME_MS] = (uint32_t)(totalUs / 1000);
+    
+    // Utilization is busy time over time spent listening on the channel
+    JsonArray channels = response.createNestedArray(JSON_CHANNELS);
+    for (uint8_t ch = 1; ch <= AIRTIME_CHANNELS; ch++) {
+        AirtimeReport report;
+        airtime.getChannel(ch, now, &report);
+        uint64_t channelUs = 0;
+        for (uint8_t c = 0; c < AIRTIME_CLASSES; c++) {
+            channelUs += report.classUs[c];
+        }
+        if (channelUs == 0 && report.longListenMs == 0) {
+            continue;
+        }
+        JsonObject chObj = channels.createNestedObject();
+        chObj[JSON_CHANNEL] = ch;
+        chObj[JSON_UTIL_SHORT] = report.shortPct;
+        chObj[JSON_UTIL_LONG] = report.longPct;
+        chObj[JSON_LISTEN_S] = report.longListenMs / 1000;
+        JsonObject classes = chObj.createNestedObject(JSON_AIRTIME_MS);
+        for (uint8_t c = 0; c < AIRTIME_CLASSES; c++) {
+            classes[AirtimeMeter::className(c)] = (uint32_t)(report.classUs[c] / 1000);
+        }
+    }
+    
+    char mac[MAC_STRING_LEN];
+    JsonArray bssids = response.createNestedArray(JSON_BSSIDS);
+    for (uint8_t i = 0; i < count; i++) {
+        macToString(top[i].bssid, mac);
+        JsonObject bss = bssids.createNestedObject();
+        bss[JSON_BSSID] = mac;
+        bss[JSON_FRAMES] = top[i].frames;
+        bss[JSON_AIRTIME_MS] = (uint32_t)(top[i].airtimeUs / 1000);
+        bss[JSON_SHARE_PCT] = totalUs ? (uint8_t)(top[i].airtimeUs * 100 / totalUs) : 0;
+    }
+    
+    // One chunk per channel and per BSSID
+    respondChunked(CMD_AIRTIME, STATUS_SUCCESS, response);
+}
+
+void CommandProcessor::handlePhyStats(JsonVariant params) {
+    uint16_t channelMask = 0;
+    for (JsonVariant channel : params[JSON_CHANNELS].as<JsonArray>()) {
+        uint8_t ch = channel | 0;
+        if (ch < 1 || ch > PHY_CHANNELS) {
+            respondError(CMD_PHY_STATS, "Invalid channel");
+            return;
+        }
+        channelMask |= 1 << ch;
+    }
+    if (channelMask == 0) {
+        channelMask = ((1 << PHY_CHANNELS) - 1) << 1;
+    }
+    
+    // Too big for the worker stack; only the worker runs handlers
+    static uint8_t blob[PHY_BLOB_MAX];
+    static char encoded[((PHY_BLOB_MAX + 2) / 3) * 4 + 1];
+    
+    size_t len = packetMonitor->getPhy().serialize(blob, sizeof(blob), channelMask);
+    size_t encodedLen = 0;
+    if (len == 0 || mbedtls_base64_encode((unsigned char*)encoded, sizeof(encoded), &encodedLen, blob, len) != 0) {
+        respondError(CMD_PHY_STATS, "Encoding failed");
+        return;
+    }
+    encoded[encodedLen] = '\0';
+    
+    DynamicJsonDocument response(encodedLen + 256);
+    response[JSON_FORMAT] = PHY_BLOB_MAGIC;
+    response[JSON_BYTES] = len;
+    response[JSON_DATA] = (const char*)encoded;
+    respond(CMD_PHY_STATS, STATUS_SUCCESS, response);
+}
+
+void CommandProcessor::handleProbeReport(JsonVariant params) {
+    uint8_t limit = params[JSON_LIMIT] | 8;
+    if (limit == 0 || limit > PROBE_REPORT_MAX) {
+        limit = PROBE_REPORT_MAX;
+    }
+    
+    // Optional single client, in place of the client ranking
+    uint8_t only[6];
+    const char* macText = params[JSON_MAC] | (const char*)nullptr;
+    if (macText && !parseMac(macText, only)) {
+        respondError(CMD_PROBE_REPORT, "Invalid MAC");
+        return;
+    }
+    
+    // Too big for the worker stack; only the worker runs handlers
+    static ProbeSsidReport ssids[PROBE_REPORT_MAX];
+    static ProbeClientReport clients[PROBE_REPORT_MAX];
+    
+    ProbeTracker& probes = packetMonitor->getProbes();
+    uint8_t ssidCount = probes.getTopSsids(ssids, limit);
+    uint8_t clientCount = probes.getClients(clients, limit, macText ? only : nullptr);
+    
+    uint32_t now = millis();
+    DynamicJsonDocument response(16384);
+    response[JSON_PROBES] = probes.getProbeFrames();
+    response[JSON_WILDCARD] = probes.getWildcardFrames();
+    response[JSON_TRACKED] = probes.getSsidCount();
+    response[JSON_EVICTED] = probes.getSsidEvictions();
+    response[JSON_DROPPED] = probes.getSsidDrops();
+    
+    JsonArray ssidArr = response.createNestedArray(JSON_SSIDS);
+    for (uint8_t i = 0; i < ssidCount; i++) {
+        JsonObject ssid = ssidArr.createNestedObject();
+        ssid[JSON_SSID] = (const char*)ssids[i].ssid;
+        ssid[JSON_CLIENTS] = ssids[i].clients;
+        ssid[JSON_PROBES] = ssids[i].probes;
+        ssid[JSON_AGE_S] = (now - ssids[i].lastSeen) / 1000;
+    }
+    
+    // Clients probing the most networks first; overflow counts SSIDs past the listed ones
+    char mac[MAC_STRING_LEN];
+    JsonArray clientArr = response.createNestedArray(JSON_CLIENTS);
+    for (uint8_t i = 0; i < clientCount; i++) {
+        const ProbeClientReport& report = clients[i];
+        macToString(report.mac, mac);
+        JsonObject client = clientArr.createNestedObject();
+        client[JSON_MAC] = mac;
+        addVendor(client, report.mac);
+        client[JSON_PROBES] = report.probes;
+        client[JSON_WILDCARD] = report.wildcard;
+        client[JSON_RANDOMIZED] = (report.mac[0] & 0x02) != 0;
+        client[JSON_OVERFLOW] = report.overflow;
+        client[JSON_AGE_S] = (now - report.lastSeen) / 1000;
+        JsonArray list = client.createNestedArray(JSON_SSIDS);
+        for (uint8_t n = 0; n < report.ssidCount; n++) {
+            list.add((const char*)report.ssids[n]);
+        }
+    }
+    
+    // Randomized addresses folded into estimated devices by element signature
+    DeviceClusters& devices = packetMonitor->getDevices();
+    DeviceEstimate estimate;
+    devices.getEstimate(now, &estimate);
+    JsonObject devObj = response.createNestedObject(JSON_DEVICES);
+    devObj[JSON_MACS] = estimate.macs;
+    devObj[JSON_RANDOMIZED] = estimate.randomized;
+    devObj[JSON_ESTIMATED] = estimate.devices;
+    devObj[JSON_ACTIVE_MACS] = estimate.activeMacs;
+    devObj[JSON_ACTIVE_DEVICES] = estimate.activeDevices;
+    devObj[JSON_EVICTED] = devices.getClusterEvictions();
+    
+    DeviceCluster clusters[DEVICE_REPORT_MAX];
+    uint8_t clusterCount = devices.getClusters(clusters, limit);
+    JsonArray clusterArr = devObj.createNestedArray(JSON_CLUSTERS);
+    for (uint8_t i = 0; i < clusterCount; i++) {
+        char signature[9];
+        snprintf(signature, sizeof(signature), "%08X", clusters[i].signature);
+        JsonObject cluster = clusterArr.createNestedObject();
+        cluster[JSON_SIGNATURE] = signature;
+        cluster[JSON_MACS] = clusters[i].macs;
+        cluster[JSON_PROBES] = clusters[i].probes;
+        cluster[JSON_SPAN_S] = (clusters[i].lastSeen - clusters[i].firstSeen) / 1000;
+        cluster[JSON_AGE_S] = (now - clusters[i].lastSeen) / 1000;
+    }
+    
+    // One chunk per SSID, client and device cluster
+    respondChunked(CMD_PROBE_REPORT, STATUS_SUCCESS, response);
+}
+
+void CommandProcessor::handleRogueAllow(JsonVariant params) {
+    const char* ssid = params[JSON_SSID] | "";
+    size_t ssidLen = strlen(ssid);
+    if (ssidLen == 0 || ssidLen > DOT11_SSID_MAX) {
+        respondError(CMD_ROGUE_ALLOW, "Invalid SSID");
+        return;
+    }
+    
+    JsonArray list = params[JSON_BSSIDS].as<JsonArray>();
+    if (list.size() > ROGUE_ALLOW_BSSIDS) {
+        respondError(CMD_ROGUE_ALLOW, "Too many BSSIDs");
+        return;
+    }
+    
+    uint8_t bssids[ROGUE_ALLOW_BSSIDS][6];
+    uint8_t count = 0;
+    for (JsonVariant entry : list) {
+        if (!parseMac(entry | "", bssids[count])) {
+            respondError(CMD_ROGUE_ALLOW, "Invalid BSSID");
+            return;
+        }
+        count++;
+    }
+    
+    RogueDetector& rogue = packetMonitor->getRogue();
+    if (!rogue.setAllowList(ssid, bssids, count)) {
+        respondError(CMD_ROGUE_ALLOW, "Allow-list table full");
+        return;
+    }
+    
+    DynamicJsonDocument response(512);
+    response[JSON_SSID] = ssid;
+    response[JSON_COUNT] = count;
+    response[JSON_ALLOW_LISTS] = rogue.getAllowListCount();
+    response[JSON_TRACKED] = rogue.getApCount();
+    response[JSON_ALERTS] = rogue.getAlerts();
+    respond(CMD_ROGUE_ALLOW, STATUS_SUCCESS, response);
+}
+
+void CommandProcessor::handleGetMetrics(JsonVariant params) {
+    DynamicJsonDocument response(6144);
+    
+    JsonObject queue = response.createNestedObject(JSON_QUEUE);
+    queue[JSON_QUEUE_HIGH] = uxQueueMessagesWaiting(highQueue);
+    queue[JSON_QUEUE_NORMAL] = uxQueueMessagesWaiting(normalQueue);
+    queue[JSON_QUEUE_REJECTED] = commandsRejected;
+    
+    JsonArray commands = response.createNestedArray(JSON_COMMANDS);
+    for (size_t i = 0; i < sizeof(commandTable) / sizeof(commandTable[0]); i++) {
+        const CommandStats& stats = commandStats[i];
+        if (stats.count == 0) {
+            continue;
+        }
+        
+        JsonObject cmdObj = commands.createNestedObject();
+        cmdObj[JSON_CMD] = commandTable[i].name;
+        cmdObj[JSON_COUNT] = stats.count;
+        cmdObj[JSON_WAIT_AVG_US] = stats.waitTotalUs / stats.count;
+        cmdObj[JSON_WAIT_MAX_US] = stats.waitMaxUs;
+        cmdObj[JSON_EXEC_AVG_US] = stats.execTotalUs / stats.count;
+        cmdObj[JSON_EXEC_MAX_US] = stats.execMaxUs;
+    }
+    
+    if (isSDCardPresent()) {
+        const StorageStats& io = storage->getStats();
+        JsonObject sd = response.createNestedObject(JSON_STORAGE);
+        sd[JSON_WRITTEN] = io.bytesWritten;
+        sd[JSON_BLOCKS] = io.blocksWritten;
+        sd[JSON_ERRORS] = io.writeErrors;
+        sd[JSON_DROPPED] = io.bytesDropped;
+        sd[JSON_WRITE_AVG_US] = io.blocksWritten ? io.writeTimeUs / io.blocksWritten : 0;
+        sd[JSON_WRITE_MAX_US] = io.writeMaxUs;
+        sd[JSON_PENDING_HIGH] = io.pendingHigh;
+        sd[JSON_STREAMS] = storage->getOpenStreamCount();
+    }
+    
+#if MCT_PIPELINE_METRICS
+    // Histograms are cut after the highest non-empty bucket
+    JsonObject pipeline = response.createNestedObject(JSON_PIPELINE);
+    pipeline[JSON_CPU_MHZ] = ESP.getCpuFreqMHz();
+    JsonArray stages = pipeline.createNestedArray(JSON_STAGES);
+    for (uint8_t i = 0; i < PIPE_STAGE_COUNT; i++) {
+        const PipelineStage& stage = pipelineMetrics.getStage(i);
+        JsonObject stageObj = stages.createNestedObject();
+        stageObj[JSON_STAGE] = PipelineMetrics::stageName(i);
+        stageObj[JSON_COUNT] = stage.count;
+        stageObj[JSON_DROPPED] = stage.drops;
+        stageObj[JSON_AVG_CYCLES] = stage.count ? (uint32_t)(stage.cyclesTotal / stage.count) : 0;
+        stageObj[JSON_MAX_CYCLES] = stage.cyclesMax;
+        
+        int last = PIPE_HIST_BUCKETS - 1;
+        while (last >= 0 && stage.histogram[last] == 0) {
+            last--;
+        }
+        JsonArray hist = stageObj.createNestedArray(JSON_HISTOGRAM);
+        for (int b = 0; b <= last; b++) {
+            hist.add(stage.histogram[b]);
+        }
+    }
+    
+    if (params[JSON_RESET] | false) {
+        pipelineMetrics.reset();
+    }
+#endif
+    
+    // One chunk per command and per pipeline stage
+    respondChunked(CMD_GET_METRICS, STATUS_SUCCESS, response);
 }
 
 uint32_t CommandProcessor::getUptime() const {
@@ -210,14 +1110,13 @@ uint8_t CommandProcessor::getBatteryLevel() const {
 }
 
 bool CommandProcessor::isSDCardPresent() const {
-    // TODO: Implement SD card detection
-    return false;
+    return storage && storage->isMounted();
 }
 
 // Advanced command handlers
 void CommandProcessor::handleDeauthAttack(JsonVariant params) {
-    if (currentMode != MODE_IDLE) {
-        bleManager->sendError(CMD_DEAUTH_ATTACK, "Device busy");
+    if (!jobs.canClaim(JOB_RES_RADIO, 0)) {
+        respondError(CMD_DEAUTH_ATTACK, "Device busy");
         return;
     }
     
@@ -226,27 +1125,24 @@ void CommandProcessor::handleDeauthAttack(JsonVariant params) {
     int duration = params["duration"] | 10; // seconds
     
     if (targetMAC.isEmpty() || apMAC.isEmpty()) {
-        bleManager->sendError(CMD_DEAUTH_ATTACK, "Missing target or AP MAC address");
+        respondError(CMD_DEAUTH_ATTACK, "Missing target or AP MAC address");
         return;
     }
     
-    currentMode = MODE_ATTACKING;
-    
     DynamicJsonDocument response(256);
     response["message"] = "Deauth attack started";
     response["target"] = targetMAC;
     response["ap"] = apMAC;
     response["duration"] = duration;
-    bleManager->sendResponse(CMD_DEAUTH_ATTACK, STATUS_SUCCESS, response);
+    respond(CMD_DEAUTH_ATTACK, STATUS_SUCCESS, response);
     
-    // TODO: Implement actual deauth attack using PacketMonitor
-    
-    currentMode = MODE_IDLE;
+    // TODO: Implement actual deauth attack using PacketMonitor, as a radio
+    // job so updateMode() can report MODE_ATTACKING while it runs
 }
 
 void CommandProcessor::handleBeaconSpam(JsonVariant params) {
-    if (currentMode != MODE_IDLE) {
-        bleManager->sendError(CMD_BEACON_SPAM, "Device busy");
+    if (!jobs.canClaim(JOB_RES_RADIO, 0)) {
+        respondError(CMD_BEACON_SPAM, "Device busy");
         return;
     }
     
@@ -254,26 +1150,23 @@ void CommandProcessor::handleBeaconSpam(JsonVariant params) {
     int interval = params["interval"] | 100; // milliseconds
     
     if (!ssids || ssids.size() == 0) {
-        bleManager->sendError(CMD_BEACON_SPAM, "No SSIDs provided");
+        respondError(CMD_BEACON_SPAM, "No SSIDs provided");
         return;
     }
     
-    currentMode = MODE_BEACON_SPAM;
-    
     DynamicJsonDocument response(256);
     response["message"] = "Beacon spam started";
     response["count"] = ssids.size();
     response["interval"] = interval;
-    bleManager->sendResponse(CMD_BEACON_SPAM, STATUS_SUCCESS, response);
+    respond(CMD_BEACON_SPAM, STATUS_SUCCESS, response);
     
-    // TODO: Implement beacon spam using PacketMonitor
-    
-    currentMode = MODE_IDLE;
+    // TODO: Implement beacon spam using PacketMonitor, as a radio job so
+    // updateMode() can report MODE_BEACON_SPAM while it runs
 }
 
 void CommandProcessor::handleRickroll(JsonVariant params) {
-    if (currentMode != MODE_IDLE) {
-        bleManager->sendError(CMD_RICKROLL, "Device busy");
+    if (!jobs.canClaim(JOB_RES_RADIO, 0)) {
+        respondError(CMD_RICKROLL, "Device busy");
         return;
     }
     
@@ -291,50 +1184,781 @@ void CommandProcessor::handleRickroll(JsonVariant params) {
         "You've Been Rickrolled"
     };
     
-    currentMode = MODE_BEACON_SPAM;
-    
     DynamicJsonDocument response(256);
     response["message"] = "Rickroll beacon spam started";
     response["song"] = "Never Gonna Give You Up";
-    bleManager->sendResponse(CMD_RICKROLL, STATUS_SUCCESS, response);
+    respond(CMD_RICKROLL, STATUS_SUCCESS, response);
     
-    // TODO: Implement rickroll beacon spam
-    
-    currentMode = MODE_IDLE;
+    // TODO: Implement rickroll beacon spam, as a radio job like beacon spam
 }
 
 void CommandProcessor::handlePCAPStart(JsonVariant params) {
     if (!isSDCardPresent()) {
-        bleManager->sendError(CMD_PCAP_START, "SD card not present");
+        respondError(CMD_PCAP_START, "SD card not present");
         return;
     }
     
     if (packetMonitor->isPCAPActive()) {
-        bleManager->sendError(CMD_PCAP_START, "PCAP already active");
+        respondError(CMD_PCAP_START, "PCAP already active");
+        return;
+    }
+    
+    // Frames only reach the capture while a monitor session is running
+    Job* monitor = jobs.findByType(JOB_MONITOR);
+    if (!monitor) {
+        respondError(CMD_PCAP_START, "Monitor not running");
+        return;
+    }
+    
+    const char* reason = nullptr;
+    Job* job = jobs.start(JOB_CAPTURE, JOB_RES_SD, JOB_RES_RADIO, &reason);
+    if (!job) {
+        respondError(CMD_PCAP_START, reason);
         return;
     }
+    job->parentId = monitor->id;
     
     String filename = params["filename"] | "capture.pcap";
     
     if (packetMonitor->startPCAP(filename.c_str())) {
+        updateMode();
+        
         DynamicJsonDocument response(256);
         response["message"] = "PCAP capture started";
         response["filename"] = filename;
-        bleManager->sendResponse(CMD_PCAP_START, STATUS_SUCCESS, response);
+        response[JSON_JOB_ID] = job->id;
+        respond(CMD_PCAP_START, STATUS_SUCCESS, response);
+        sendJobEvent(job);
     } else {
-        bleManager->sendError(CMD_PCAP_START, "Failed to start PCAP capture");
+        jobs.release(job);
+        respondError(CMD_PCAP_START, "Failed to start PCAP capture");
     }
 }
 
 void CommandProcessor::handlePCAPStop(JsonVariant params) {
-    if (!packetMonitor->isPCAPActive()) {
-        bleManager->sendError(CMD_PCAP_STOP, "PCAP not active");
+    Job* job = jobs.findByType(JOB_CAPTURE);
+    if (!job || !packetMonitor->isPCAPActive()) {
+        respondError(CMD_PCAP_STOP, "PCAP not active");
         return;
     }
     
     packetMonitor->stopPCAP();
+    endJob(job, JOB_STATE_DONE);
     
     DynamicJsonDocument response(256);
     response["message"] = "PCAP capture stopped";
-    bleManager->sendResponse(CMD_PCAP_STOP, STATUS_SUCCESS, response);
+    response[JSON_DROPPED] = packetMonitor->getPCAPDropped();
+    respond(CMD_PCAP_STOP, STATUS_SUCCESS, response);
+}
+
+void CommandProcessor::handleFlightArm(JsonVariant params) {
+    if (!isSDCardPresent()) {
+        respondError(CMD_FLIGHT_ARM, "SD card not present");
+        return;
+    }
+    
+    // The ring is fed from the monitor's promiscuous callback
+    Job* monitor = jobs.findByType(JOB_MONITOR);
+    if (!monitor) {
+        respondError(CMD_FLIGHT_ARM, "Monitor not running");
+        return;
+    }
+    
+    FlightConfig config = FlightRecorder::defaultConfig();
+    config.ringBytes = (params[JSON_SIZE_KB] | (FLIGHT_DEFAULT_BYTES / 1024)) * 1024;
+    config.preMs = params[JSON_PRE_MS] | FLIGHT_DEFAULT_PRE_MS;
+    config.postMs = params[JSON_POST_MS] | FLIGHT_DEFAULT_POST_MS;
+    config.rssiThreshold = params[JSON_RSSI] | -30;
+    config.deauthCount = params[JSON_DEAUTH_COUNT] | FLIGHT_DEAUTH_COUNT;
+    config.deauthWindowMs = params[JSON_DEAUTH_WINDOW] | FLIGHT_DEAUTH_WINDOW_MS;
+    if (config.deauthCount == 0) {
+        config.deauthCount = 1;
+    }
+    
+    // Manual triggering is always available
+    for (JsonVariant trigger : params[JSON_TRIGGERS].as<JsonArray>()) {
+        const char* name = trigger | "";
+        if (strcmp(name, "deauth") == 0) {
+            config.triggers |= FLIGHT_TRIGGER_DEAUTH;
+        } else if (strcmp(name, "mac") == 0) {
+            config.triggers |= FLIGHT_TRIGGER_MAC;
+        } else if (strcmp(name, "rssi") == 0) {
+            config.triggers |= FLIGHT_TRIGGER_RSSI;
+        } else if (strcmp(name, "manual") != 0) {
+            respondError(CMD_FLIGHT_ARM, "Unknown trigger");
+            return;
+        }
+    }
+    
+    if (config.triggers & FLIGHT_TRIGGER_MAC) {
+        if (!parseMac(params[JSON_MAC] | "", config.mac)) {
+            respondError(CMD_FLIGHT_ARM, "Invalid MAC");
+            return;
+        }
+    }
+    
+    const char* reason = nullptr;
+    Job* job = jobs.start(JOB_FLIGHT, 0, JOB_RES_RADIO | JOB_RES_SD, &reason);
+    if (!job) {
+        respondError(CMD_FLIGHT_ARM, reason);
+        return;
+    }
+    job->parentId = monitor->id;
+    
+    String filename = params[JSON_FILENAME] | "/flight.pcap";
+    
+    if (!packetMonitor->startFlightRecorder(config, filename.c_str())) {
+        jobs.release(job);
+        respondError(CMD_FLIGHT_ARM, "Failed to arm flight recorder");
+        return;
+    }
+    
+    DynamicJsonDocument response(512);
+    response["message"] = "Flight recorder armed";
+    response[JSON_FILENAME] = filename;
+    fillFlightStatus(response.createNestedObject(JSON_FLIGHT));
+    response[JSON_JOB_ID] = job->id;
+    respond(CMD_FLIGHT_ARM, STATUS_SUCCESS, response);
+    sendJobEvent(job);
+}
+
+void CommandProcessor::handleFlightTrigger(JsonVariant params) {
+    if (!jobs.findByType(JOB_FLIGHT)) {
+        respondError(CMD_FLIGHT_TRIGGER, "Flight recorder not armed");
+        return;
+    }
+    
+    if (!packetMonitor->getFlightRecorder().trigger()) {
+        respondError(CMD_FLIGHT_TRIGGER, "Already triggered");
+        return;
+    }
+    
+    DynamicJsonDocument response(256);
+    response["message"] = "Flight recorder triggered";
+    respond(CMD_FLIGHT_TRIGGER, STATUS_SUCCESS, response);
+}
+
+void CommandProcessor::handleFlightDisarm(JsonVariant params) {
+    Job* job = jobs.findByType(JOB_FLIGHT);
+    if (!job) {
+        respondError(CMD_FLIGHT_DISARM, "Flight recorder not armed");
+        return;
+    }
+    
+    DynamicJsonDocument response(512);
+    fillFlightStatus(response.createNestedObject(JSON_FLIGHT));
+    packetMonitor->stopFlightRecorder();
+    endJob(job, JOB_STATE_CANCELLED);
+    
+    response["message"] = "Flight recorder disarmed";
+    respond(CMD_FLIGHT_DISARM, STATUS_SUCCESS, response);
+}
+
+void CommandProcessor::fillFlightStatus(JsonObject flight) {
+    FlightRecorder& recorder = packetMonitor->getFlightRecorder();
+    flight[JSON_JOB_STATE] = FlightRecorder::stateName(recorder.getState());
+    if (recorder.getFiredBy()) {
+        flight[JSON_TRIGGER] = FlightRecorder::triggerName(recorder.getFiredBy());
+    }
+    flight[JSON_CAPACITY] = recorder.getCapacity();
+    flight[JSON_PSRAM] = recorder.isInPSRAM();
+    flight[JSON_BUFFERED] = recorder.getBufferedBytes();
+    flight[JSON_RECORDED] = recorder.getFramesRecorded();
+    flight[JSON_EVICTED] = recorder.getFramesEvicted();
+    flight[JSON_DROPPED] = recorder.getFramesDropped();
+    flight[JSON_BYTES] = recorder.getBytesDumped();
+}
+
+void CommandProcessor::handleStatsStream(JsonVariant params) {
+    Job* monitor = jobs.findByType(JOB_MONITOR);
+    if (!monitor) {
+        respondError(CMD_STATS_STREAM, "Monitor not running");
+        return;
+    }
+    
+    uint32_t interval = params["interval"] | 1000;
+    if (interval < STATS_STREAM_MIN_MS) {
+        interval = STATS_STREAM_MIN_MS;
+    }
+    
+    const char* reason = nullptr;
+    Job* job = jobs.start(JOB_STATS_STREAM, 0, JOB_RES_RADIO | JOB_RES_BLE_BW, &reason);
+    if (!job) {
+        respondError(CMD_STATS_STREAM, reason);
+        return;
+    }
+    job->parentId = monitor->id;
+    job->interval = interval;
+    
+    DynamicJsonDocument response(256);
+    response["message"] = "Stats stream started";
+    response["interval"] = interval;
+    response[JSON_JOB_ID] = job->id;
+    respond(CMD_STATS_STREAM, STATUS_SUCCESS, response);
+    sendJobEvent(job);
+}
+
+void CommandProcessor::handleJobList(JsonVariant params) {
+    DynamicJsonDocument response(1024);
+    JsonArray jobArray = response.createNestedArray(JSON_JOBS);
+    
+    for (size_t i = 0; i < MAX_JOBS; i++) {
+        const Job* job = jobs.getSlot(i);
+        if (job->state != JOB_STATE_RUNNING) {
+            continue;
+        }
+        
+        JsonObject jobObj = jobArray.createNestedObject();
+        jobObj[JSON_JOB_ID] = job->id;
+        jobObj[JSON_JOB_TYPE] = JobManager::typeName(job->type);
+        jobObj[JSON_JOB_STATE] = JobManager::stateName(job->state);
+        if (job->progress != JOB_PROGRESS_UNKNOWN) {
+            jobObj[JSON_JOB_PROGRESS] = job->progress;
+        }
+        jobObj[JSON_JOB_ELAPSED] = millis() - job->startTime;
+    }
+    
+    respond(CMD_JOB_LIST, STATUS_SUCCESS, response);
+}
+
+void CommandProcessor::handleJobCancel(JsonVariant params) {
+    uint16_t id = params[JSON_JOB_ID] | 0;
+    
+    Job* job = jobs.find(id);
+    if (!job) {
+        respondError(CMD_JOB_CANCEL, "No such job");
+        return;
+    }
+    
+    cancelJob(job);
+    
+    DynamicJsonDocument response(128);
+    response[JSON_JOB_ID] = id;
+    response["message"] = "Job cancelled";
+    respond(CMD_JOB_CANCEL, STATUS_SUCCESS, response);
+}
+
+void CommandProcessor::fillMonitorStats(JsonObject stats) {
+    stats[JSON_PACKETS_TOTAL] = packetMonitor->getPacketsTotal();
+    stats[JSON_PACKETS_SEC] = packetMonitor->getPacketsPerSec();
+    stats[JSON_BEACON_COUNT] = packetMonitor->getBeaconCount();
+    stats[JSON_PROBE_COUNT] = packetMonitor->getProbeCount();
+    stats[JSON_DATA_COUNT] = packetMonitor->getDataCount();
+    stats[JSON_MGMT_COUNT] = packetMonitor->getMgmtCount();
+    if (packetMonitor->getFilter().isActive()) {
+        stats[JSON_FILTERED] = packetMonitor->getFramesFiltered();
+    }
+    if (packetMonitor->isDedupEnabled()) {
+        const RetryDedup& dedup = packetMonitor->getDedup();
+        JsonObject dedupObj = stats.createNestedObject(JSON_DEDUP);
+        dedupObj[JSON_COUNT] = dedup.getDuplicates();
+        dedupObj[JSON_BYTES] = dedup.getBytesSaved();
+    }
+    
+    // Counters above are exact; analytics are scaled by sample_n while sampling
+    const OverloadController& overload = packetMonitor->getOverload();
+    JsonObject load = stats.createNestedObject(JSON_LOAD);
+    load[JSON_LEVEL] = OverloadController::levelName(overload.getLevel());
+    load[JSON_SAMPLE_N] = overload.getSampleN();
+    load[JSON_BUSY_PCT] = overload.getBusyPercent();
+    load[JSON_SHED] = overload.getFramesShed();
+    
+    fillLossStats(stats.createNestedObject(JSON_LOSS));
+    
+    // Utilization of the channel being monitored
+    AirtimeReport report;
+    packetMonitor->getAirtime().getChannel(packetMonitor->getChannel(), millis(), &report);
+    JsonObject airtime = stats.createNestedObject(JSON_AIRTIME);
+    airtime[JSON_CHANNEL] = packetMonitor->getChannel();
+    airtime[JSON_UTIL_SHORT] = report.shortPct;
+    airtime[JSON_UTIL_LONG] = report.longPct;
+}
+
+void CommandProcessor::fillLossStats(JsonObject loss) {
+    const SeqLossTracker& tracker = packetMonitor->getSeqLoss();
+    loss[JSON_RECEIVED] = tracker.getReceived();
+    loss[JSON_LOST] = tracker.getLost();
+    loss[JSON_LOSS_PERMILLE] = SeqLossTracker::lossPermille(tracker.getReceived(), tracker.getLost());
+    loss[JSON_RETRIES] = tracker.getRetries();
+    loss[JSON_REORDERED] = tracker.getReordered();
+    loss[JSON_RESYNCS] = tracker.getResyncs();
+    loss[JSON_TRACKED] = tracker.getTracked();
+    loss[JSON_EVICTED] = tracker.getEvictions();
+    
+    // Only channels heard this session, as {channel, received, lost, loss_permille}
+    JsonArray channels = loss.createNestedArray(JSON_CHANNELS);
+    for (uint8_t channel = 1; channel < SEQ_LOSS_CHANNELS; channel++) {
+        const SeqLossChannel& ch = tracker.getChannel(channel);
+        if (ch.received == 0) {
+            continue;
+        }
+        JsonObject chObj = channels.createNestedObject();
+        chObj[JSON_CHANNEL] = channel;
+        chObj[JSON_RECEIVED] = ch.received;
+        chObj[JSON_LOST] = ch.lost;
+        chObj[JSON_LOSS_PERMILLE] = SeqLossTracker::lossPermille(ch.received, ch.lost);
+    }
+    
+    SeqLossReport worst[SEQ_LOSS_WORST];
+    uint8_t count = tracker.getWorst(worst, SEQ_LOSS_WORST);
+    JsonArray worstArr = loss.createNestedArray(JSON_WORST);
+    for (uint8_t i = 0; i < count; i++) {
+        char mac[MAC_STRING_LEN];
+        macToString(worst[i].mac, mac);
+        JsonObject tx = worstArr.createNestedObject();
+        tx[JSON_MAC] = mac;
+        if (worst[i].tid >= 0) {
+            tx[JSON_TID] = worst[i].tid;
+        }
+        tx[JSON_RECEIVED] = worst[i].received;
+        tx[JSON_LOST] = worst[i].lost;
+    }
+}
+
+bool CommandProcessor::compileFilter(JsonObject spec, CaptureFilter& filter, const char** error) {
+    filter.clear();
+    if (spec.isNull()) {
+        return true;
+    }
+    
+    for (JsonVariant name : spec[JSON_FRAMES].as<JsonArray>()) {
+        if (!filter.addFrames(name | "")) {
+            *error = "Unknown frame type";
+            return false;
+        }
+    }
+    
+    for (JsonVariant channel : spec[JSON_CHANNELS].as<JsonArray>()) {
+        if (!filter.addChannel(channel | 0)) {
+            *error = "Invalid filter channel";
+            return false;
+        }
+    }
+    
+    if (spec.containsKey(JSON_RSSI_MIN) || spec.containsKey(JSON_RSSI_MAX)) {
+        int minimum = spec[JSON_RSSI_MIN] | -128;
+        int maximum = spec[JSON_RSSI_MAX] | 127;
+        if (minimum < -128 || maximum > 127 || minimum > maximum) {
+            *error = "Invalid RSSI range";
+            return false;
+        }
+        filter.setRssiRange(minimum, maximum);
+    }
+    
+    if (spec.containsKey(JSON_LEN_MIN) || spec.containsKey(JSON_LEN_MAX)) {
+        uint32_t minimum = spec[JSON_LEN_MIN] | 0;
+        uint32_t maximum = spec[JSON_LEN_MAX] | 0xFFFF;
+        if (maximum > 0xFFFF || minimum > maximum) {
+            *error = "Invalid length range";
+            return false;
+        }
+        filter.setLengthRange(minimum, maximum);
+    }
+    
+    for (JsonObject rule : spec[JSON_MACS].as<JsonArray>()) {
+        uint8_t fields = CaptureFilter::fieldsFromName(rule[JSON_FIELD] | "any");
+        if (!filter.addMac(rule[JSON_ADDR], rule[JSON_MASK], fields)) {
+            *error = "Invalid MAC rule";
+            return false;
+        }
+    }
+    
+    return true;
+}
+
+// Job engine
+void CommandProcessor::serviceJobs() {
+    uint32_t now = millis();
+    
+    for (size_t i = 0; i < MAX_JOBS; i++) {
+        Job* job = jobs.getSlot(i);
+        if (job->state != JOB_STATE_RUNNING) {
+            continue;
+        }
+        
+        switch (job->type) {
+            case JOB_SCAN:          stepScanJob(job); break;
+            case JOB_MONITOR:       stepMonitorJob(job); break;
+            case JOB_CAPTURE:       stepCaptureJob(job); break;
+            case JOB_STATS_STREAM:  stepStatsJob(job); break;
+            case JOB_EXPORT:        stepExportJob(job); break;
+            case JOB_FLIGHT:        stepFlightJob(job); break;
+        }
+        
+        // Steps may have finished the job
+        if (job->state == JOB_STATE_RUNNING &&
+            job->progress != job->reportedProgress &&
+            now - job->lastEventTime >= JOB_PROGRESS_INTERVAL) {
+            sendJobEvent(job);
+        }
+    }
+}
+
+void CommandProcessor::stepScanJob(Job* job) {
+    if (wifiScanner->isScanning()) {
+        uint32_t elapsed = millis() - job->startTime;
+        uint32_t percent = job->duration ? elapsed * 100 / job->duration : 0;
+        job->progress = percent > 99 ? 99 : percent;
+        return;
+    }
+    
+    if (!wifiScanner->hasResults()) {
+        Serial.println("WiFi scan failed or timed out!");
+        bleManager->sendError(CMD_SCAN_WIFI, "Scan timeout");
+        endJob(job, JOB_STATE_FAILED, "Scan timeout");
+        return;
+    }
+    
+    Serial.printf("Scan complete. Found %d networks\n", wifiScanner->getNetworkCount());
+    
+    // Hidden networks get names learned passively; unknown ones wait for one.
+    // Scan results also go through the same rogue AP checks as beacons.
+    RogueDetector& rogue = packetMonitor->getRogue();
+    HiddenResolver& hidden = packetMonitor->getHidden();
+    uint32_t now = millis();
+    for (NetworkInfo& net : wifiScanner->getResults()) {
+        uint8_t bssid[6];
+        if (!parseMac(net.bssid.c_str(), bssid)) {
+            continue;
+        }
+        if (net.hidden) {
+            char ssid[DOT11_SSID_MAX + 1];
+            if (hidden.lookup(bssid, ssid, sizeof(ssid))) {
+                net.ssid = ssid;
+            } else {
+                hidden.observeScan(bssid, net.channel, now);
+            }
+        }
+        rogue.observeScan(bssid, net.ssid.c_str(), net.channel, net.encryptionType, now);
+    }
+    
+    Serial.println("=== SENDING WIFI SCAN RESULTS ===");
+    sendScanResults();
+    surveyLog->logScan(wifiScanner->getResultsChannel());
+    
+    job->progress = 100;
+    endJob(job, JOB_STATE_DONE);
+}
+
+void CommandProcessor::stepMonitorJob(Job* job) {
+    if (job->duration == 0) {
+        return;
+    }
+    
+    uint32_t elapsed = millis() - job->startTime;
+    if (elapsed >= job->duration) {
+        stopMonitorJob(job, JOB_STATE_DONE);
+        return;
+    }
+    job->progress = elapsed * 100 / job->duration;
+}
+
+void CommandProcessor::stepCaptureJob(Job* job) {
+    // The capture can end underneath us, e.g. when the file fails
+    if (!packetMonitor->isPCAPActive()) {
+        endJob(job, JOB_STATE_FAILED, "Capture stopped");
+    }
+}
+
+void CommandProcessor::stepStatsJob(Job* job) {
+    uint32_t now = millis();
+    if (now - job->lastTick < job->interval) {
+        return;
+    }
+    job->lastTick = now;
+    
+    DynamicJsonDocument event(2048);
+    event[JSON_TYPE] = "stats";
+    event[JSON_JOB_ID] = job->id;
+    fillMonitorStats(event.createNestedObject(JSON_DATA));
+    
+    String output;
+    serializeJson(event, output);
+    bleManager->sendStatus(output);
+}
+
+void CommandProcessor::serviceApEvents() {
+    ApEvent event;
+    while (packetMonitor->getEvents().take(&event)) {
+        char mac[MAC_STRING_LEN];
+        macToString(event.bssid, mac);
+        
+        if (event.type == AP_EVENT_ALERT) {
+            char text[ALERT_TEXT_LEN];
+            RogueDetector::describe(event, text, sizeof(text));
+            
+            DynamicJsonDocument alert(512);
+            alert[JSON_TYPE] = "alert";
+            alert[JSON_KIND] = RogueDetector::kindName(event.kind);
+            alert[JSON_SEVERITY] = event.severity;
+            alert[JSON_BSSID] = mac;
+            alert[JSON_SSID] = (const char*)event.ssid;
+            alert[JSON_CHANNEL] = event.channel;
+            alert[JSON_BEFORE] = event.before;
+            alert[JSON_AFTER] = event.after;
+            alert[JSON_TEXT] = (const char*)text;
+            
+            String output;
+            serializeJson(alert, output);
+            bleManager->sendStatus(output);
+            surveyLog->logAlert(event.kind, event.severity, event.bssid, text);
+            
+            portENTER_CRITICAL(&alertLock);
+            memcpy(alertText, text, sizeof(alertText));
+            alertCount++;
+            portEXIT_CRITICAL(&alertLock);
+            
+            Serial.printf("AP alert [%s] %s %s\n", RogueDetector::kindName(event.kind), mac, text);
+        } else if (event.type == AP_EVENT_SSID_RESOLVED) {
+            // Name the network in the current scan results as well
+            for (NetworkInfo& net : wifiScanner->getResults()) {
+                uint8_t bssid[6];
+                if (net.hidden && parseMac(net.bssid.c_str(), bssid) &&
+                    memcmp(bssid, event.bssid, 6) == 0) {
+                    net.ssid = event.ssid;
+                }
+            }
+            
+            DynamicJsonDocument update(384);
+            update[JSON_TYPE] = "ssid_resolved";
+            update[JSON_BSSID] = mac;
+            update[JSON_SSID] = (const char*)event.ssid;
+            update[JSON_CHANNEL] = event.channel;
+            update[JSON_SOURCE] = HiddenResolver::sourceName(event.kind);
+            
+            String output;
+            serializeJson(update, output);
+            bleManager->sendStatus(output);
+            
+            Serial.printf("Hidden SSID %s is \"%s\" (%s)\n", mac, event.ssid, HiddenResolver::sourceName(event.kind));
+        }
+    }
+}
+
+uint32_t CommandProcessor::getLastAlert(char* text, size_t len) {
+    char copy[ALERT_TEXT_LEN];
+    portENTER_CRITICAL(&alertLock);
+    uint32_t count = alertCount;
+    memcpy(copy, alertText, sizeof(copy));
+    portEXIT_CRITICAL(&alertLock);
+    
+    snprintf(text, len, "%s", copy);
+    return count;
+}
+
+void CommandProcessor::stepExportJob(Job* job) {
+    if (exporter.step()) {
+        job->progress = exporter.getProgress();
+        return;
+    }
+    
+    if (exporter.hasFailed()) {
+        bleManager->sendError(CMD_EXPORT_DATA, "Export write failed");
+        endJob(job, JOB_STATE_FAILED, "Export write failed");
+        return;
+    }
+    
+    // Completion goes out as a second EXPORT_DATA response carrying the throughput
+    DynamicJsonDocument response(256);
+    response[JSON_FORMAT] = DataExporter::formatName(exporter.getFormat());
+    response[JSON_BYTES] = exporter.getBytesWritten();
+    response[JSON_ELAPSED_MS] = exporter.getElapsed();
+    response[JSON_BYTES_PER_SEC] = exporter.getThroughput();
+    if (exporter.getFormat() == EXPORT_FORMAT_BINARY) {
+        response[JSON_CRC32] = exporter.getChecksum();
+    }
+    response[JSON_JOB_ID] = job->id;
+    bleManager->sendResponse(CMD_EXPORT_DATA, STATUS_SUCCESS, response);
+    
+    job->progress = 100;
+    endJob(job, JOB_STATE_DONE);
+}
+
+void CommandProcessor::stepFlightJob(Job* job) {
+    FlightRecorder& recorder = packetMonitor->getFlightRecorder();
+    uint8_t state = recorder.getState();
+    if (state == FLIGHT_STATE_ARMED) {
+        return;
+    }
+    
+    // First step after the trigger fired
+    if (job->progress == JOB_PROGRESS_UNKNOWN) {
+        job->progress = 0;
+        char message[48];
+        snprintf(message, sizeof(message), "Triggered by %s", FlightRecorder::triggerName(recorder.getFiredBy()));
+        sendJobEvent(job, message);
+    }
+    
+    if (!recorder.service()) {
+        uint32_t dumped = recorder.getBytesDumped();
+        uint32_t total = dumped + recorder.getBufferedBytes();
+        uint32_t percent = total ? dumped * 100 / total : 0;
+        job->progress = percent > 99 ? 99 : percent;
+        return;
+    }
+    
+    // Completion goes out as a second FLIGHT_ARM response with the dump totals
+    DynamicJsonDocument response(512);
+    fillFlightStatus(response.createNestedObject(JSON_FLIGHT));
+    response[JSON_JOB_ID] = job->id;
+    bleManager->sendResponse(CMD_FLIGHT_ARM, STATUS_SUCCESS, response);
+    
+    job->progress = 100;
+    endJob(job, JOB_STATE_DONE);
+}
+
+void CommandProcessor::cancelJob(Job* job) {
+    switch (job->type) {
+        case JOB_SCAN:
+            wifiScanner->stopScan();
+            bleManager->sendError(CMD_SCAN_WIFI, "Scan cancelled");
+            endJob(job, JOB_STATE_CANCELLED);
+            break;
+        case JOB_MONITOR:
+            stopMonitorJob(job, JOB_STATE_CANCELLED);
+            break;
+        case JOB_CAPTURE:
+            packetMonitor->stopPCAP();
+            endJob(job, JOB_STATE_CANCELLED);
+            break;
+        case JOB_EXPORT:
+            exporter.abort();
+            endJob(job, JOB_STATE_CANCELLED);
+            break;
+        case JOB_FLIGHT:
+            packetMonitor->stopFlightRecorder();
+            endJob(job, JOB_STATE_CANCELLED);
+            break;
+        default:
+            endJob(job, JOB_STATE_CANCELLED);
+            break;
+    }
+}
+
+void CommandProcessor::stopMonitorJob(Job* job, uint8_t state) {
+    // Dependent jobs can't outlive the monitor session
+    for (size_t i = 0; i < MAX_JOBS; i++) {
+        Job* child = jobs.getSlot(i);
+        if (child->state == JOB_STATE_RUNNING && child->parentId == job->id) {
+            if (child->type == JOB_FLIGHT &&
+                packetMonitor->getFlightRecorder().getState() == FLIGHT_STATE_TRIGGERED) {
+                // Keep the dump; the post-trigger window just ends early
+                packetMonitor->getFlightRecorder().closeWindow();
+                child->parentId = 0;
+                continue;
+            }
+            if (child->type == JOB_CAPTURE) {
+                packetMonitor->stopPCAP();
+            } else if (child->type == JOB_FLIGHT) {
+                packetMonitor->stopFlightRecorder();
+            }
+            endJob(child, state, "Monitor stopped");
+        }
+    }
+    
+    packetMonitor->stopMonitor();
+    endJob(job, state);
+}
+
+void CommandProcessor::endJob(Job* job, uint8_t state, const char* message) {
+    job->state = state;
+    sendJobEvent(job, message);
+    jobs.release(job);
+    updateMode();
+}
+
+void CommandProcessor::sendJobEvent(Job* job, const char* message) {
+    DynamicJsonDocument event(256);
+    event[JSON_TYPE] = "job";
+    event[JSON_JOB_ID] = job->id;
+    event[JSON_JOB_TYPE] = JobManager::typeName(job->type);
+    event[JSON_JOB_STATE] = JobManager::stateName(job->state);
+    if (job->progress != JOB_PROGRESS_UNKNOWN) {
+        event[JSON_JOB_PROGRESS] = job->progress;
+    }
+    if (message) {
+        event["message"] = message;
+    }
+    
+    String output;
+    serializeJson(event, output);
+    bleManager->sendStatus(output);
+    
+    job->reportedProgress = job->progress;
+    job->lastEventTime = millis();
+}
+
+void CommandProcessor::updateMode() {
+    // Report the most significant running job for the display and status
+    if (jobs.findByType(JOB_SCAN)) {
+        currentMode = MODE_SCANNING;
+    } else if (jobs.findByType(JOB_CAPTURE)) {
+        currentMode = MODE_PCAP_CAPTURE;
+    } else if (jobs.findByType(JOB_EXPORT)) {
+        currentMode = MODE_EXPORTING;
+    } else if (jobs.findByType(JOB_MONITOR)) {
+        currentMode = MODE_MONITORING;
+    } else {
+        currentMode = MODE_IDLE;
+    }
+}
+
+void CommandProcessor::handleBatch(JsonVariant params) {
+    if (batchResults) {
+        respondError(CMD_BATCH, "Nested batch not allowed");
+        return;
+    }
+    
+    JsonArray commands = params[JSON_COMMANDS];
+    if (!commands || commands.size() == 0) {
+        respondError(CMD_BATCH, "No commands provided");
+        return;
+    }
+    
+    bool stopOnError = params["stop_on_error"] | false;
+    
+    DynamicJsonDocument response(MAX_RESPONSE_SIZE);
+    JsonArray results = response.createNestedArray(JSON_RESULTS);
+    batchDoc = &response;
+    batchResults = &results;
+    
+    size_t executed = 0;
+    for (JsonVariant command : commands) {
+        const char* cmd = command[JSON_CMD] | "";
+        
+        batchResponded = false;
+        batchFailed = false;
+        
+        // Every later command still gets its entry, and executed/total their slots
+        size_t remaining = commands.size() - executed - 1;
+        batchReserve = remaining * (JSON_ARRAY_SIZE(1) + JSON_OBJECT_SIZE(3)) + JSON_OBJECT_SIZE(2);
+        
+        if (cmd[0] == '\0') {
+            respondError("", "Missing command");
+        } else {
+            dispatch(cmd, command[JSON_PARAMS]);
+        }
+        executed++;
+        
+        // Async commands (e.g. scans) report through their job instead
+        if (!batchResponded) {
+            JsonObject result = results.createNestedObject();
+            result[JSON_CMD] = cmd;
+            result[JSON_STATUS] = STATUS_PENDING;
+        }
+        
+        if (batchFailed && stopOnError) {
+            break;
+        }
+    }
+    
+    batchResults = nullptr;
+    batchDoc = nullptr;
+    batchReserve = 0;
+    
+    response[JSON_EXECUTED] = executed;
+    response[JSON_TOTAL] = commands.size();
+    
+    // One chunk per result, then executed/total as the final response
+    bleManager->sendChunkedResponse(CMD_BATCH, STATUS_SUCCESS, response);
 }
\ No newline at end of file
@@ -0,0 +1,518 @@
+/**
+ * Data Exporter implementation
+ */
+
+#include "DataExporter.h"
+#include "Checksum.h"
+#include "MacTable.h"
+#include "protocol.h"
+#include <mbedtls/base64.h>
+
+// Column ids are stable across versions; new columns get new ids
+static const ExportColumn apColumns[] = {
+    {1, EXPORT_TYPE_MAC, "bssid"},
+    {2, EXPORT_TYPE_STR, "ssid"},
+    {3, EXPORT_TYPE_U8,  "channel"},
+    {4, EXPORT_TYPE_I8,  "rssi"},
+    {5, EXPORT_TYPE_U8,  "security"},
+    {6, EXPORT_TYPE_U8,  "hidden"}
+};
+
+static const ExportColumn statsColumns[] = {
+    {1, EXPORT_TYPE_U32, "packets_total"},
+    {2, EXPORT_TYPE_U32, "packets_sec"},
+    {3, EXPORT_TYPE_U32, "beacons"},
+    {4, EXPORT_TYPE_U32, "probes"},
+    {5, EXPORT_TYPE_U32, "deauths"},
+    {6, EXPORT_TYPE_U32, "data"},
+    {7, EXPORT_TYPE_U32, "mgmt"}
+};
+
+static const ExportColumn channelColumns[] = {
+    {1, EXPORT_TYPE_U8,  "channel"},
+    {2, EXPORT_TYPE_U16, "ap_count"},
+    {3, EXPORT_TYPE_I8,  "strongest_rssi"},
+    {4, EXPORT_TYPE_I8,  "interference"},
+    {5, EXPORT_TYPE_U32, "frames"},
+    {6, EXPORT_TYPE_U32, "frame_load"}
+};
+
+#define COLUMN_COUNT(columns) (sizeof(columns) / sizeof(columns[0]))
+
+const ExportSection DataExporter::sections[] = {
+    {EXPORT_SECTION_APS,      "aps",      apColumns,      COLUMN_COUNT(apColumns)},
+    {EXPORT_SECTION_STATS,    "stats",    statsColumns,   COLUMN_COUNT(statsColumns)},
+    {EXPORT_SECTION_CHANNELS, "channels", channelColumns, COLUMN_COUNT(channelColumns)}
+};
+
+const uint8_t DataExporter::sectionCount = sizeof(DataExporter::sections) / sizeof(DataExporter::sections[0]);
+
+// Sinks
+bool StorageExportSink::write(const uint8_t* data, size_t len) {
+    return stream->write(data, len, EXPORT_STORAGE_WAIT_MS);
+}
+
+bool StorageExportSink::close() {
+    stream->close();
+    return true;
+}
+
+bool BLEExportSink::sendChunk(const uint8_t* data, size_t len) {
+    char encoded[((EXPORT_BLE_CHUNK + 2) / 3) * 4 + 1];
+    size_t encodedLen = 0;
+    if (mbedtls_base64_encode((unsigned char*)encoded, sizeof(encoded), &encodedLen, data, len) != 0) {
+        return false;
+    }
+    encoded[encodedLen] = '\0';
+    
+    DynamicJsonDocument chunk(384);
+    chunk[JSON_TYPE] = "export";
+    chunk[JSON_SEQ] = sequence++;
+    chunk[JSON_DATA] = (const char*)encoded;
+    
+    String output;
+    serializeJson(chunk, output);
+    return bleManager->sendData(output);
+}
+
+bool BLEExportSink::write(const uint8_t* data, size_t len) {
+    while (len > 0) {
+        size_t n = len < EXPORT_BLE_CHUNK ? len : EXPORT_BLE_CHUNK;
+        if (!sendChunk(data, n)) {
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool BLEExportSink::close() {
+    return true;
+}
+
+// Exporter
+DataExporter::DataExporter(WiFiScanner* wifi, PacketMonitor* monitor, ChannelAnalyzer* analyzer) :
+    wifiScanner(wifi),
+    packetMonitor(monitor),
+    channelAnalyzer(analyzer),
+    sink(nullptr),
+    format(EXPORT_FORMAT_BINARY),
+    active(false),
+    failed(false),
+    bufferUsed(0),
+    bytesWritten(0),
+    crc(CRC32_INIT),
+    checksum(0),
+    startTime(0),
+    endTime(0),
+    headerWritten(false),
+    sectionIndex(0),
+    sectionStarted(false),
+    columnIndex(0),
+    rowIndex(0),
+    rowCount(0),
+    columnStarted(false) {
+}
+
+bool DataExporter::begin(ExportSink* exportSink, uint8_t exportFormat) {
+    // The sink is ours either way; a refused one still holds its stream open
+    if (active) {
+        exportSink->close();
+        delete exportSink;
+        return false;
+    }
+    
+    sink = exportSink;
+    format = exportFormat;
+    active = true;
+    failed = false;
+    bufferUsed = 0;
+    bytesWritten = 0;
+    crc = CRC32_INIT;
+    checksum = 0;
+    startTime = millis();
+    endTime = 0;
+    headerWritten = false;
+    sectionIndex = 0;
+    sectionStarted = false;
+    columnIndex = 0;
+    rowIndex = 0;
+    rowCount = 0;
+    columnStarted = false;
+    
+    Serial.printf("Export started (%s to %s)\n", formatName(format), sink->getName());
+    return true;
+}
+
+bool DataExporter::step() {
+    if (!active) {
+        return false;
+    }
+    
+    uint32_t stepEnd = bytesWritten + bufferUsed + sink->getStepBytes();
+    bool more = true;
+    while (more && !failed && bytesWritten + bufferUsed < stepEnd) {
+        more = advance();
+    }
+    
+    if (!more || failed) {
+        flush();
+        if (!sink->close()) {
+            failed = true;
+        }
+        delete sink;
+        sink = nullptr;
+        active = false;
+        endTime = millis();
+        
+        Serial.printf("Export %s: %lu bytes in %lu ms (%lu B/s)\n",
+                      failed ? "failed" : "complete",
+                      bytesWritten, getElapsed(), getThroughput());
+        return false;
+    }
+    return true;
+}
+
+void DataExporter::abort() {
+    if (!active) {
+        return;
+    }
+    
+    // Drop whatever is staged; the partial output has no trailer
+    bufferUsed = 0;
+    sink->close();
+    delete sink;
+    sink = nullptr;
+    active = false;
+    failed = true;
+    endTime = millis();
+}
+
+uint8_t DataExporter::getProgress() const {
+    if (!active) {
+        return 100;
+    }
+    if (sectionIndex >= sectionCount) {
+        return 99;
+    }
+    
+    // Whole sections done, plus the fraction of the current one
+    uint32_t done = 0;
+    uint32_t total = 1;
+    if (sectionStarted && rowCount > 0) {
+        if (format == EXPORT_FORMAT_BINARY) {
+            done = (uint32_t)columnIndex * rowCount + rowIndex;
+            total = (uint32_t)sections[sectionIndex].columnCount * rowCount;
+        } else {
+            done = rowIndex;
+            total = rowCount;
+        }
+    }
+    return (sectionIndex * 100 + done * 100 / total) / sectionCount;
+}
+
+uint32_t DataExporter::getElapsed() const {
+    return (active ? millis() : endTime) - startTime;
+}
+
+uint32_t DataExporter::getThroughput() const {
+    uint32_t elapsed = getElapsed();
+    if (elapsed == 0) {
+        return bytesWritten * 1000;
+    }
+    return (uint32_t)((uint64_t)bytesWritten * 1000 / elapsed);
+}
+
+const char* DataExporter::formatName(uint8_t format) {
+    return format == EXPORT_FORMAT_CSV ? "csv" : "binary";
+}
+
+uint32_t DataExporter::getRowCount(const ExportSection& section) const {
+    switch (section.id) {
+        case EXPORT_SECTION_APS:      return wifiScanner->getNetworkCount();
+        case EXPORT_SECTION_STATS:    return 1;
+        case EXPORT_SECTION_CHANNELS: return ANALYZER_MAX_CHANNEL;
+        default:                      return 0;
+    }
+}
+
+// Buffered output
+void DataExporter::writeBytes(const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    while (len > 0) {
+        if (bufferUsed == EXPORT_BUFFER_SIZE) {
+            flush();
+        }
+        size_t n = EXPORT_BUFFER_SIZE - bufferUsed;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(buffer + bufferUsed, p, n);
+        bufferUsed += n;
+        p += n;
+        len -= n;
+    }
+}
+
+void DataExporter::writeU16(uint16_t value) {
+    uint8_t bytes[2] = {(uint8_t)value, (uint8_t)(value >> 8)};
+    writeBytes(bytes, sizeof(bytes));
+}
+
+void DataExporter::writeU32(uint32_t value) {
+    uint8_t bytes[4] = {(uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24)};
+    writeBytes(bytes, sizeof(bytes));
+}
+
+void DataExporter::writeText(const char* text) {
+    writeBytes(text, strlen(text));
+}
+
+void DataExporter::writeCSVString(const char* text) {
+    // Quote only when needed, doubling embedded quotes
+    if (!strpbrk(text, ",\"\r\n")) {
+        writeText(text);
+        return;
+    }
+    writeU8('"');
+    for (const char* p = text; *p; p++) {
+        if (*p == '"') {
+            writeU8('"');
+        }
+        writeU8(*p);
+    }
+    writeU8('"');
+}
+
+void DataExporter::flush() {
+    if (bufferUsed == 0 || failed) {
+        bufferUsed = 0;
+        return;
+    }
+    
+    if (!sink->write(buffer, bufferUsed)) {
+        Serial.println("Export: sink write failed");
+        failed = true;
+    }
+    crc = crc32Update(crc, buffer, bufferUsed);
+    bytesWritten += bufferUsed;
+    bufferUsed = 0;
+}
+
+// Layout
+void DataExporter::writeHeader() {
+    if (format == EXPORT_FORMAT_BINARY) {
+        writeBytes(EXPORT_MAGIC, 4);
+        writeU8(EXPORT_VERSION);
+        writeU8(format);
+        writeU16(sectionCount);
+        writeU32(millis());
+    } else {
+        char line[48];
+        snprintf(line, sizeof(line), "# MCT2032 export v%d\n", EXPORT_VERSION);
+        writeText(line);
+    }
+}
+
+void DataExporter::writeSectionHeader(const ExportSection& section) {
+    if (format == EXPORT_FORMAT_BINARY) {
+        writeU8(section.id);
+        writeU8(section.columnCount);
+        writeU32(rowCount);
+        return;
+    }
+    
+    writeText("# ");
+    writeText(section.name);
+    writeText("\n");
+    for (uint8_t i = 0; i < section.columnCount; i++) {
+        if (i > 0) {
+            writeU8(',');
+        }
+        writeText(section.columns[i].name);
+    }
+    writeText("\n");
+}
+
+void DataExporter::writeColumnHeader(const ExportColumn& column) {
+    writeU8(column.id);
+    writeU8(column.type);
+}
+
+void DataExporter::writeValue(const ExportSection& section, const ExportColumn& column, uint32_t row) {
+    uint32_t value = 0;
+    uint8_t mac[6] = {0};
+    const char* str = "";
+    String text;
+    
+    switch (section.id) {
+        case EXPORT_SECTION_APS: {
+            // The list can be cleared mid-export; keep the layout and write blanks
+            std::vector<NetworkInfo>& networks = wifiScanner->getResults();
+            if (row >= networks.size()) {
+                break;
+            }
+            const NetworkInfo& net = networks[row];
+            switch (column.id) {
+                case 1: parseMac(net.bssid.c_str(), mac); break;
+                case 2: str = net.ssid.c_str(); break;
+                case 3: value = net.channel; break;
+                case 4: value = (uint32_t)net.rssi; break;
+                case 5:
+                    value = net.encryptionType;
+                    if (format == EXPORT_FORMAT_CSV) {
+                        // Names are friendlier than auth mode numbers in a spreadsheet
+                        text = net.getSecurityString();
+                        writeCSVString(text.c_str());
+                        return;
+                    }
+                    break;
+                case 6: value = net.hidden; break;
+            }
+            break;
+        }
+        
+        case EXPORT_SECTION_STATS:
+            switch (column.id) {
+                case 1: value = packetMonitor->getPacketsTotal(); break;
+                case 2: value = packetMonitor->getPacketsPerSec(); break;
+                case 3: value = packetMonitor->getBeaconCount(); break;
+                case 4: value = packetMonitor->getProbeCount(); break;
+                case 5: value = packetMonitor->getDeauthCount(); break;
+                case 6: value = packetMonitor->getDataCount(); break;
+                case 7: value = packetMonitor->getMgmtCount(); break;
+            }
+            break;
+        
+        case EXPORT_SECTION_CHANNELS: {
+            uint8_t channel = row + 1;
+            const ChannelStats& stats = channelAnalyzer->getChannel(channel);
+            switch (column.id) {
+                case 1: value = channel; break;
+                case 2: value = stats.apCount; break;
+                case 3: value = (uint32_t)(stats.apCount ? stats.strongestRssi : -100); break;
+                case 4: value = (uint32_t)(int32_t)roundf(ChannelAnalyzer::mwToDbm(stats.interferenceMw)); break;
+                case 5: value = stats.frameCount; break;
+                case 6: value = stats.frameLoad / 100; break;
+            }
+            break;
+        }
+    }
+    
+    if (format == EXPORT_FORMAT_BINARY) {
+        switch (column.type) {
+            case EXPORT_TYPE_U8:
+            case EXPORT_TYPE_I8:  writeU8((uint8_t)value); break;
+            case EXPORT_TYPE_U16: writeU16((uint16_t)value); break;
+            case EXPORT_TYPE_U32: writeU32(value); break;
+            case EXPORT_TYPE_MAC: writeBytes(mac, sizeof(mac)); break;
+            case EXPORT_TYPE_STR: {
+                size_t len = strlen(str);
+                if (len > 255) {
+                    len = 255;
+                }
+                writeU8((uint8_t)len);
+                writeBytes(str, len);
+                break;
+            }
+        }
+        return;
+    }
+    
+    char field[24];
+    switch (column.type) {
+        case EXPORT_TYPE_I8:
+            snprintf(field, sizeof(field), "%d", (int)(int8_t)value);
+            break;
+        case EXPORT_TYPE_MAC:
+            snprintf(field, sizeof(field), "%02X:%02X:%02X:%02X:%02X:%02X",
+                     mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+            break;
+        case EXPORT_TYPE_STR:
+            writeCSVString(str);
+            return;
+        default:
+            snprintf(field, sizeof(field), "%lu", (unsigned long)value);
+            break;
+    }
+    writeText(field);
+}
+
+void DataExporter::writeTrailer() {
+    if (format != EXPORT_FORMAT_BINARY) {
+        return;
+    }
+    
+    // The checksum covers everything before the trailer, so flush first
+    flush();
+    checksum = crc32Final(crc);
+    uint32_t length = bytesWritten;
+    writeU8(EXPORT_SECTION_END);
+    writeU8(0);
+    writeU32(length);
+    writeU32(checksum);
+}
+
+void DataExporter::nextSection() {
+    sectionIndex++;
+    sectionStarted = false;
+}
+
+bool DataExporter::advance() {
+    if (!headerWritten) {
+        writeHeader();
+        headerWritten = true;
+        return true;
+    }
+    
+    if (sectionIndex >= sectionCount) {
+        writeTrailer();
+        return false;
+    }
+    
+    const ExportSection& section = sections[sectionIndex];
+    if (!sectionStarted) {
+        rowCount = getRowCount(section);
+        writeSectionHeader(section);
+        sectionStarted = true;
+        columnIndex = 0;
+        rowIndex = 0;
+        columnStarted = false;
+        return true;
+    }
+    
+    if (format == EXPORT_FORMAT_BINARY) {
+        if (columnIndex >= section.columnCount) {
+            nextSection();
+            return true;
+        }
+        const ExportColumn& column = section.columns[columnIndex];
+        if (!columnStarted) {
+            writeColumnHeader(column);
+            columnStarted = true;
+        } else if (rowIndex < rowCount) {
+            writeValue(section, column, rowIndex++);
+        } else {
+            columnIndex++;
+            rowIndex = 0;
+            columnStarted = false;
+        }
+        return true;
+    }
+    
+    if (rowIndex >= rowCount) {
+        nextSection();
+        return true;
+    }
+    if (columnIndex > 0) {
+        writeU8(',');
+    }
+    writeValue(section, section.columns[columnIndex], rowIndex);
+    if (++columnIndex >= section.columnCount) {
+        writeU8('\n');
+        columnIndex = 0;
+        rowIndex++;
+    }
+    return true;
+}
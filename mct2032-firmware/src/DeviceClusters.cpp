@@ -0,0 +1,209 @@
+/**
+ * Device Clusters implementation
+ */
+
+#include "DeviceClusters.h"
+#include "Dot11.h"
+
+#define IE_DS_PARAMS    3
+#define IE_VENDOR       221
+
+static inline uint32_t fnvMix(uint32_t hash, uint8_t byte) {
+    return (hash ^ byte) * 16777619u;
+}
+
+DeviceClusters::DeviceClusters() {
+    portMUX_INITIALIZE(&lock);
+    reset();
+}
+
+void DeviceClusters::reset() {
+    portENTER_CRITICAL(&lock);
+    macs.clear();
+    memset(clusters, 0, sizeof(clusters));
+    macsSeen = 0;
+    randomizedSeen = 0;
+    devicesSeen = 0;
+    clusterEvictions = 0;
+    portEXIT_CRITICAL(&lock);
+}
+
+bool DeviceClusters::signature(const uint8_t* frame, uint16_t len, uint32_t* out) {
+    uint32_t hash = 2166136261u;
+    uint8_t hashed = 0;
+    dot11ForEachIE(frame, len, DOT11_MGMT_HEADER, [&](uint8_t id, const uint8_t* data, uint8_t n) {
+        // Element order is part of the fingerprint even for skipped contents
+        hash = fnvMix(hash, id);
+        switch (id) {
+            case DOT11_IE_SSID:
+            case IE_DS_PARAMS:
+                break;
+            case IE_VENDOR:
+                for (uint8_t i = 0; i < n && i < 4; i++) {
+                    hash = fnvMix(hash, data[i]);
+                }
+                hashed++;
+                break;
+            default:
+                hash = fnvMix(hash, n);
+                for (uint8_t i = 0; i < n; i++) {
+                    hash = fnvMix(hash, data[i]);
+                }
+                hashed++;
+                break;
+        }
+        return true;
+    });
+    *out = hash;
+    return hashed >= DEVICE_MIN_ELEMENTS;
+}
+
+uint8_t DeviceClusters::join(uint32_t signature, uint32_t now) {
+    // Same signature, gone quiet recently enough to be a rotation
+    uint8_t best = DEVICE_NO_CLUSTER;
+    uint8_t empty = DEVICE_NO_CLUSTER;
+    uint8_t stalest = 0;
+    for (uint8_t i = 0; i < DEVICE_CLUSTERS; i++) {
+        const DeviceCluster& c = clusters[i];
+        if (!c.used) {
+            if (empty == DEVICE_NO_CLUSTER) {
+                empty = i;
+            }
+            continue;
+        }
+        if ((int32_t)(c.lastSeen - clusters[stalest].lastSeen) < 0 || !clusters[stalest].used) {
+            stalest = i;
+        }
+        uint32_t quiet = now - c.lastSeen;
+        if (c.signature != signature || quiet < DEVICE_OVERLAP_MS || quiet >= DEVICE_ROTATION_MS) {
+            continue;
+        }
+        if (best == DEVICE_NO_CLUSTER || (int32_t)(c.lastSeen - clusters[best].lastSeen) > 0) {
+            best = i;
+        }
+    }
+    
+    if (best != DEVICE_NO_CLUSTER) {
+        clusters[best].macs++;
+        return best;
+    }
+    
+    uint8_t slot = empty;
+    if (slot == DEVICE_NO_CLUSTER) {
+        slot = stalest;
+        clusterEvictions++;
+    }
+    DeviceCluster& c = clusters[slot];
+    uint16_t generation = c.generation + 1;
+    memset(&c, 0, sizeof(c));
+    c.used = true;
+    c.generation = generation;
+    c.signature = signature;
+    c.firstSeen = now;
+    c.macs = 1;
+    devicesSeen++;
+    return slot;
+}
+
+void DeviceClusters::observe(const uint8_t* frame, uint16_t len, uint16_t weight, uint32_t now) {
+    const uint8_t* tx = dot11Transmitter(frame, len);
+    if (!tx || (tx[0] & 0x01)) {
+        return;
+    }
+    bool randomized = tx[0] & 0x02;
+    uint32_t sig = 0;
+    bool strong = randomized && signature(frame, len, &sig);
+    
+    portENTER_CRITICAL(&lock);
+    bool inserted;
+    DeviceMac* mac = macs.findOrInsert(macToKey(tx), &inserted);
+    mac->lastSeen = now;
+    
+    // An address whose cluster was since replaced starts over
+    bool stale = !inserted && mac->cluster != DEVICE_NO_CLUSTER &&
+                 clusters[mac->cluster].generation != mac->generation;
+    
+    if (inserted || stale) {
+        if (inserted) {
+            macsSeen++;
+            if (randomized) {
+                randomizedSeen++;
+            }
+        }
+        if (strong) {
+            mac->cluster = join(sig, now);
+            mac->generation = clusters[mac->cluster].generation;
+        } else {
+            mac->cluster = DEVICE_NO_CLUSTER;
+            if (inserted) {
+                devicesSeen++;
+            }
+        }
+    }
+    
+    if (mac->cluster != DEVICE_NO_CLUSTER) {
+        DeviceCluster& c = clusters[mac->cluster];
+        c.lastSeen = now;
+        c.probes += weight;
+    }
+    portEXIT_CRITICAL(&lock);
+}
+
+void DeviceClusters::getEstimate(uint32_t now, DeviceEstimate* out) {
+    uint16_t activeMacs = 0;
+    uint16_t activeUnclustered = 0;
+    uint16_t activeClusters = 0;
+    
+    portENTER_CRITICAL(&lock);
+    macs.forEach([&](uint64_t, const DeviceMac& mac) {
+        if (now - mac.lastSeen < DEVICE_ACTIVE_MS) {
+            activeMacs++;
+            if (mac.cluster == DEVICE_NO_CLUSTER) {
+                activeUnclustered++;
+            }
+        }
+    });
+    for (uint8_t i = 0; i < DEVICE_CLUSTERS; i++) {
+        if (clusters[i].used && now - clusters[i].lastSeen < DEVICE_ACTIVE_MS) {
+            activeClusters++;
+        }
+    }
+    out->macs = macsSeen;
+    out->randomized = randomizedSeen;
+    out->devices = devicesSeen;
+    portEXIT_CRITICAL(&lock);
+    
+    out->activeMacs = activeMacs;
+    out->activeDevices = activeUnclustered + activeClusters;
+}
+
+uint8_t DeviceClusters::getClusters(DeviceCluster* out, uint8_t k) {
+    if (k > DEVICE_REPORT_MAX) {
+        k = DEVICE_REPORT_MAX;
+    }
+    uint8_t count = 0;
+    
+    portENTER_CRITICAL(&lock);
+    for (uint8_t i = 0; i < DEVICE_CLUSTERS; i++) {
+        const DeviceCluster& c = clusters[i];
+        if (!c.used) {
+            continue;
+        }
+        uint8_t pos = count;
+        while (pos > 0 && out[pos - 1].macs < c.macs) {
+            pos--;
+        }
+        if (pos >= k) {
+            continue;
+        }
+        for (uint8_t n = count < k ? count : k - 1; n > pos; n--) {
+            out[n] = out[n - 1];
+        }
+        out[pos] = c;
+        if (count < k) {
+            count++;
+        }
+    }
+    portEXIT_CRITICAL(&lock);
+    return count;
+}
@@ -0,0 +1,126 @@
+/**
+ * Distinct Counters implementation
+ */
+
+#include "DistinctCounters.h"
+#include "MacTable.h"
+#include "Dot11.h"
+#include <esp_heap_caps.h>
+
+DistinctCounters::DistinctCounters() :
+    sketches(nullptr),
+    windowCount(0),
+    current(0),
+    inPSRAM(false) {
+}
+
+bool DistinctCounters::begin() {
+    if (sketches) {
+        return true;
+    }
+    
+    windowCount = DISTINCT_MAX_WINDOWS;
+    sketches = (uint8_t*)heap_caps_malloc(windowCount * DISTINCT_SLICE_BYTES, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    inPSRAM = sketches != nullptr;
+    if (!sketches) {
+        windowCount = DISTINCT_INTERNAL_MAX / DISTINCT_SLICE_BYTES;
+        sketches = (uint8_t*)heap_caps_malloc(windowCount * DISTINCT_SLICE_BYTES, MALLOC_CAP_8BIT);
+    }
+    if (!sketches) {
+        windowCount = 0;
+        Serial.println("Distinct counters: no memory for sketches");
+        return false;
+    }
+    
+    reset();
+    Serial.printf("Distinct counters: %u x %u min windows in %s\n",
+                  windowCount, DISTINCT_WINDOW_MS / 60000, inPSRAM ? "PSRAM" : "internal RAM");
+    return true;
+}
+
+void DistinctCounters::reset() {
+    if (!sketches) {
+        return;
+    }
+    memset(sketches, 0, windowCount * DISTINCT_SLICE_BYTES);
+    uint32_t now = millis();
+    for (uint8_t i = 0; i < windowCount; i++) {
+        windowStart[i] = now;
+    }
+    current = 0;
+}
+
+void DistinctCounters::rotate(uint32_t now) {
+    if (now - windowStart[current] < DISTINCT_WINDOW_MS) {
+        return;
+    }
+    current = (current + 1) % windowCount;
+    memset(sketch(current, 1, 0), 0, DISTINCT_SLICE_BYTES);
+    windowStart[current] = now;
+}
+
+void DistinctCounters::observe(const uint8_t* frame, uint16_t len, uint8_t channel, uint32_t now) {
+    if (!sketches || channel < 1 || channel > DISTINCT_CHANNELS) {
+        return;
+    }
+    rotate(now);
+    
+    const uint8_t* tx = dot11Transmitter(frame, len);
+    if (tx && !(tx[0] & 0x01)) {
+        uint64_t hashed = HyperLogLog::hash(macToKey(tx));
+        HyperLogLog::add(sketch(current, channel, DISTINCT_TX), hashed);
+        if (dot11Type(frame) == DOT11_TYPE_MGMT && dot11Subtype(frame) == 0x04) {
+            HyperLogLog::add(sketch(current, channel, DISTINCT_PROBERS), hashed);
+        }
+    }
+    
+    const uint8_t* bssid = dot11Bssid(frame, len);
+    if (bssid && !(bssid[0] & 0x01)) {
+        HyperLogLog::add(sketch(current, channel, DISTINCT_BSSIDS), HyperLogLog::hash(macToKey(bssid)));
+    }
+}
+
+uint32_t DistinctCounters::count(uint16_t channelMask, uint32_t spanMs, uint32_t now, uint32_t* counts) {
+    uint8_t merged[DISTINCT_KINDS][HLL_REGISTERS];
+    memset(merged, 0, sizeof(merged));
+    if (!sketches) {
+        memset(counts, 0, DISTINCT_KINDS * sizeof(uint32_t));
+        return 0;
+    }
+    
+    // Newest slice first, back until the span is covered or the ring runs out
+    uint32_t covered = 0;
+    for (uint8_t back = 0; back < windowCount; back++) {
+        uint8_t window = (current + windowCount - back) % windowCount;
+        uint32_t age = now - windowStart[window];
+        if (back > 0 && age > getMaxSpanMs()) {
+            break;
+        }
+        for (uint8_t channel = 1; channel <= DISTINCT_CHANNELS; channel++) {
+            if (!(channelMask & (1 << channel))) {
+                continue;
+            }
+            for (uint8_t kind = 0; kind < DISTINCT_KINDS; kind++) {
+                HyperLogLog::merge(merged[kind], sketch(window, channel, kind));
+            }
+        }
+        covered = age;
+        if (age >= spanMs) {
+            break;
+        }
+    }
+    
+    for (uint8_t kind = 0; kind < DISTINCT_KINDS; kind++) {
+        counts[kind] = HyperLogLog::estimate(merged[kind]);
+    }
+    return covered;
+}
+
+const char* DistinctCounters::kindName(uint8_t kind) {
+    switch (kind) {
+        case DISTINCT_TX:       return "transmitters";
+        case DISTINCT_PROBERS:  return "probers";
+        case DISTINCT_BSSIDS:   return "bssids";
+        default:                return "unknown";
+    }
+}
@@ -0,0 +1,377 @@
+/**
+ * Flight Recorder implementation
+ */
+
+#include "FlightRecorder.h"
+#include <esp_heap_caps.h>
+
+FlightRecorder::FlightRecorder() :
+    config(defaultConfig()),
+    ring(nullptr),
+    capacity(0),
+    inPSRAM(false),
+    head(0),
+    tail(0),
+    wrapEnd(0),
+    wrapped(false),
+    writing(false),
+    state(FLIGHT_STATE_IDLE),
+    firedBy(0),
+    triggerTime(0),
+    windowTrimmed(false),
+    stream(nullptr),
+    deauthWindowStart(0),
+    deauthSeen(0),
+    framesRecorded(0),
+    framesEvicted(0),
+    framesDropped(0),
+    bytesDumped(0) {
+    portMUX_INITIALIZE(&lock);
+}
+
+FlightRecorder::~FlightRecorder() {
+    disarm();
+}
+
+FlightConfig FlightRecorder::defaultConfig() {
+    FlightConfig cfg;
+    cfg.ringBytes = FLIGHT_DEFAULT_BYTES;
+    cfg.preMs = FLIGHT_DEFAULT_PRE_MS;
+    cfg.postMs = FLIGHT_DEFAULT_POST_MS;
+    cfg.triggers = FLIGHT_TRIGGER_MANUAL;
+    memset(cfg.mac, 0, sizeof(cfg.mac));
+    cfg.rssiThreshold = -30;
+    cfg.deauthCount = FLIGHT_DEAUTH_COUNT;
+    cfg.deauthWindowMs = FLIGHT_DEAUTH_WINDOW_MS;
+    return cfg;
+}
+
+bool FlightRecorder::arm(const FlightConfig& cfg, StorageStream* output) {
+    if (state != FLIGHT_STATE_IDLE || !output) {
+        return false;
+    }
+    
+    config = cfg;
+    uint32_t size = cfg.ringBytes < FLIGHT_MIN_BYTES ? FLIGHT_MIN_BYTES : cfg.ringBytes;
+    
+    ring = (uint8_t*)heap_caps_malloc(size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    inPSRAM = ring != nullptr;
+    if (!ring) {
+        if (size > FLIGHT_INTERNAL_MAX) {
+            size = FLIGHT_INTERNAL_MAX;
+        }
+        ring = (uint8_t*)heap_caps_malloc(size, MALLOC_CAP_8BIT);
+    }
+    if (!ring) {
+        Serial.println("Flight recorder: no memory for ring");
+        return false;
+    }
+    
+    capacity = size;
+    head = 0;
+    tail = 0;
+    wrapEnd = 0;
+    wrapped = false;
+    writing = false;
+    firedBy = 0;
+    triggerTime = 0;
+    windowTrimmed = false;
+    stream = output;
+    deauthWindowStart = 0;
+    deauthSeen = 0;
+    framesRecorded = 0;
+    framesEvicted = 0;
+    framesDropped = 0;
+    bytesDumped = 0;
+    
+    // Publish last; the WiFi task starts recording from here
+    portENTER_CRITICAL(&lock);
+    state = FLIGHT_STATE_ARMED;
+    portEXIT_CRITICAL(&lock);
+    
+    Serial.printf("Flight recorder armed: %lu KB ring in %s, %lu ms before, %lu ms after\n",
+                  capacity / 1024, inPSRAM ? "PSRAM" : "internal RAM", config.preMs, config.postMs);
+    return true;
+}
+
+void FlightRecorder::disarm() {
+    if (state == FLIGHT_STATE_IDLE) {
+        return;
+    }
+    
+    portENTER_CRITICAL(&lock);
+    state = FLIGHT_STATE_IDLE;
+    portEXIT_CRITICAL(&lock);
+    
+    release();
+}
+
+void FlightRecorder::release() {
+    // A frame copy already under way finishes before the ring goes away
+    while (writing) {
+        delay(1);
+    }
+    
+    if (stream) {
+        stream->close();
+        stream = nullptr;
+    }
+    if (ring) {
+        heap_caps_free(ring);
+        ring = nullptr;
+    }
+    capacity = 0;
+}
+
+void FlightRecorder::closeWindow() {
+    portENTER_CRITICAL(&lock);
+    if (state == FLIGHT_STATE_TRIGGERED) {
+        state = FLIGHT_STATE_DRAINING;
+    }
+    portEXIT_CRITICAL(&lock);
+}
+
+// WiFi task
+void FlightRecorder::record(const uint8_t* frame, uint16_t len, int8_t rssi, uint32_t timestamp) {
+    uint8_t current = state;
+    if (current != FLIGHT_STATE_ARMED && current != FLIGHT_STATE_TRIGGERED) {
+        return;
+    }
+    
+    uint32_t need = FLIGHT_RECORD_HEADER + len;
+    uint32_t pos;
+    bool wrap;
+    
+    portENTER_CRITICAL(&lock);
+    current = state;
+    bool ok = (current == FLIGHT_STATE_ARMED || current == FLIGHT_STATE_TRIGGERED) &&
+              need <= capacity && reserve(need, &pos, &wrap);
+    writing = ok;
+    portEXIT_CRITICAL(&lock);
+    
+    if (!ok) {
+        // Past the trigger the window is kept intact and new frames lose out
+        if (current == FLIGHT_STATE_TRIGGERED) {
+            framesDropped++;
+        }
+        return;
+    }
+    
+    // Stored as a finished PCAP record so the dump is a straight copy
+    uint32_t header[4] = {timestamp / 1000, (timestamp % 1000) * 1000, len, len};
+    memcpy(ring + pos, header, sizeof(header));
+    memcpy(ring + pos + FLIGHT_RECORD_HEADER, frame, len);
+    
+    portENTER_CRITICAL(&lock);
+    if (wrap && tail == head) {
+        tail = 0;               // The worker drained the upper part meanwhile
+    } else if (wrap) {
+        wrapEnd = head;
+        wrapped = true;
+    }
+    head = pos + need;
+    writing = false;
+    portEXIT_CRITICAL(&lock);
+    framesRecorded++;
+    
+    if (current == FLIGHT_STATE_ARMED && (config.triggers & ~FLIGHT_TRIGGER_MANUAL)) {
+        uint8_t fired = checkTriggers(frame, len, rssi, timestamp);
+        if (fired) {
+            fire(fired, timestamp);
+        }
+    }
+}
+
+// Called with the lock held. Finds room for a record, evicting the oldest
+// frames only while armed; the wrap is applied at commit
+bool FlightRecorder::reserve(uint32_t need, uint32_t* pos, bool* wrap) {
+    for (;;) {
+        if (!wrapped) {
+            if (head == tail) {
+                head = 0;
+                tail = 0;
+            }
+            if (capacity - head >= need) {
+                *pos = head;
+                *wrap = false;
+                return true;
+            }
+            if (tail >= need) {
+                *pos = 0;
+                *wrap = true;
+                return true;
+            }
+        } else if (tail - head >= need) {
+            *pos = head;
+            *wrap = false;
+            return true;
+        }
+        
+        if (state != FLIGHT_STATE_ARMED || !evictOldest()) {
+            return false;
+        }
+    }
+}
+
+bool FlightRecorder::evictOldest() {
+    if (!wrapped && tail == head) {
+        return false;
+    }
+    
+    uint32_t len;
+    memcpy(&len, ring + tail + 8, sizeof(len));
+    advanceTail(FLIGHT_RECORD_HEADER + len);
+    framesEvicted++;
+    return true;
+}
+
+void FlightRecorder::advanceTail(uint32_t bytes) {
+    tail += bytes;
+    if (wrapped && tail >= wrapEnd) {
+        tail = 0;
+        wrapped = false;
+    }
+}
+
+uint8_t FlightRecorder::checkTriggers(const uint8_t* frame, uint16_t len, int8_t rssi, uint32_t timestamp) {
+    uint8_t fired = 0;
+    
+    // Deauthentication (0xC0) or disassociation (0xA0) management frames
+    uint8_t fc = len > 0 ? frame[0] & 0xFC : 0;
+    if ((config.triggers & FLIGHT_TRIGGER_DEAUTH) && (fc == 0xC0 || fc == 0xA0)) {
+        if (deauthSeen == 0 || timestamp - deauthWindowStart > config.deauthWindowMs) {
+            deauthWindowStart = timestamp;
+            deauthSeen = 0;
+        }
+        if (++deauthSeen >= config.deauthCount) {
+            fired |= FLIGHT_TRIGGER_DEAUTH;
+        }
+    }
+    
+    if ((config.triggers & FLIGHT_TRIGGER_MAC) && len >= 24 &&
+        (memcmp(frame + 4, config.mac, 6) == 0 ||
+         memcmp(frame + 10, config.mac, 6) == 0 ||
+         memcmp(frame + 16, config.mac, 6) == 0)) {
+        fired |= FLIGHT_TRIGGER_MAC;
+    }
+    
+    if ((config.triggers & FLIGHT_TRIGGER_RSSI) && rssi >= config.rssiThreshold) {
+        fired |= FLIGHT_TRIGGER_RSSI;
+    }
+    
+    return fired;
+}
+
+bool FlightRecorder::fire(uint8_t source, uint32_t timestamp) {
+    bool fired = false;
+    
+    portENTER_CRITICAL(&lock);
+    if (state == FLIGHT_STATE_ARMED) {
+        state = FLIGHT_STATE_TRIGGERED;
+        firedBy = source;
+        triggerTime = timestamp;
+        fired = true;
+    }
+    portEXIT_CRITICAL(&lock);
+    
+    return fired;
+}
+
+// Worker
+bool FlightRecorder::service() {
+    uint8_t current = state;
+    if (current != FLIGHT_STATE_TRIGGERED && current != FLIGHT_STATE_DRAINING) {
+        return false;
+    }
+    
+    if (!windowTrimmed) {
+        trimPreWindow();
+        windowTrimmed = true;
+    }
+    
+    if (current == FLIGHT_STATE_TRIGGERED && millis() - triggerTime >= config.postMs) {
+        closeWindow();
+    }
+    
+    for (int i = 0; i < FLIGHT_DRAIN_CHUNKS; i++) {
+        portENTER_CRITICAL(&lock);
+        uint32_t start = tail;
+        uint32_t end = wrapped ? wrapEnd : head;
+        bool finished = !wrapped && start == end && !writing && state == FLIGHT_STATE_DRAINING;
+        portEXIT_CRITICAL(&lock);
+        
+        if (finished) {
+            Serial.printf("Flight recorder dump complete: %lu bytes, %lu frames dropped\n",
+                          bytesDumped, framesDropped);
+            portENTER_CRITICAL(&lock);
+            state = FLIGHT_STATE_IDLE;
+            portEXIT_CRITICAL(&lock);
+            release();
+            return true;
+        }
+        if (start == end) {
+            break;
+        }
+        
+        // Chunks may split records; the file only cares about byte order
+        uint32_t n = end - start < FLIGHT_DRAIN_CHUNK ? end - start : FLIGHT_DRAIN_CHUNK;
+        if (!stream->write(ring + start, n, FLIGHT_WRITE_WAIT_MS)) {
+            break;
+        }
+        bytesDumped += n;
+        
+        portENTER_CRITICAL(&lock);
+        advanceTail(n);
+        portEXIT_CRITICAL(&lock);
+    }
+    
+    return false;
+}
+
+void FlightRecorder::trimPreWindow() {
+    if (triggerTime <= config.preMs) {
+        return;
+    }
+    uint32_t cutoff = triggerTime - config.preMs;
+    
+    // Eviction has stopped, so the records from tail onward are whole
+    for (;;) {
+        portENTER_CRITICAL(&lock);
+        bool empty = !wrapped && tail == head;
+        uint32_t header[4];
+        if (!empty) {
+            memcpy(header, ring + tail, sizeof(header));
+        }
+        bool old = !empty && header[0] * 1000 + header[1] / 1000 < cutoff;
+        if (old) {
+            advanceTail(FLIGHT_RECORD_HEADER + header[2]);
+        }
+        portEXIT_CRITICAL(&lock);
+        
+        if (!old) {
+            break;
+        }
+    }
+}
+
+uint32_t FlightRecorder::bufferedBytes() const {
+    return wrapped ? (wrapEnd - tail) + head : head - tail;
+}
+
+const char* FlightRecorder::stateName(uint8_t state) {
+    switch (state) {
+        case FLIGHT_STATE_IDLE:         return "idle";
+        case FLIGHT_STATE_ARMED:        return "armed";
+        case FLIGHT_STATE_TRIGGERED:    return "triggered";
+        case FLIGHT_STATE_DRAINING:     return "draining";
+        default:                        return "unknown";
+    }
+}
+
+const char* FlightRecorder::triggerName(uint8_t trigger) {
+    if (trigger & FLIGHT_TRIGGER_MANUAL) return "manual";
+    if (trigger & FLIGHT_TRIGGER_DEAUTH) return "deauth";
+    if (trigger & FLIGHT_TRIGGER_MAC) return "mac";
+    if (trigger & FLIGHT_TRIGGER_RSSI) return "rssi";
+    return "none";
+}
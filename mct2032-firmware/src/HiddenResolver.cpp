@@ -0,0 +1,172 @@
+/**
+ * Hidden Resolver implementation
+ */
+
+#include "HiddenResolver.h"
+
+#define BEACON_IES          36      // Also probe responses
+#define ASSOC_REQ_IES       28
+#define REASSOC_REQ_IES     34
+
+#define IE_DS_PARAMS        3
+
+HiddenResolver::HiddenResolver() : events(nullptr), resolved(0) {
+    portMUX_INITIALIZE(&lock);
+}
+
+void HiddenResolver::begin(ApEventQueue* queue) {
+    events = queue;
+}
+
+bool HiddenResolver::isHidden(const uint8_t* ssid, uint8_t len) {
+    for (uint8_t i = 0; i < len; i++) {
+        if (ssid[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+const char* HiddenResolver::sourceName(uint8_t source) {
+    switch (source) {
+        case HIDDEN_SOURCE_PROBE_RESP:  return "probe_response";
+        case HIDDEN_SOURCE_ASSOC_REQ:   return "assoc_request";
+        case HIDDEN_SOURCE_REASSOC_REQ: return "reassoc_request";
+        default:                        return "unknown";
+    }
+}
+
+void HiddenResolver::track(const uint8_t* bssid, uint8_t channel, uint32_t now) {
+    bool inserted;
+    portENTER_CRITICAL(&lock);
+    HiddenAp* ap = aps.findOrInsert(macToKey(bssid), &inserted);
+    ap->lastSeen = now;
+    ap->channel = channel;
+    portEXIT_CRITICAL(&lock);
+}
+
+void HiddenResolver::observeBeacon(const uint8_t* frame, uint16_t len, uint8_t rxChannel, uint32_t now) {
+    // The SSID element always comes first, so visible networks cost two byte reads
+    if (len < BEACON_IES + 2 + DOT11_FCS_LEN || frame[BEACON_IES] != DOT11_IE_SSID) {
+        return;
+    }
+    uint8_t ssidLen = frame[BEACON_IES + 1];
+    if (ssidLen > DOT11_SSID_MAX || BEACON_IES + 2 + ssidLen > len - DOT11_FCS_LEN ||
+        !isHidden(frame + BEACON_IES + 2, ssidLen)) {
+        return;
+    }
+    
+    uint8_t channel = rxChannel;
+    dot11ForEachIE(frame, len, BEACON_IES, [&](uint8_t id, const uint8_t* data, uint8_t n) {
+        if (id == IE_DS_PARAMS && n == 1) {
+            channel = data[0];
+            return false;
+        }
+        return true;
+    });
+    track(frame + DOT11_ADDR_3, channel, now);
+}
+
+void HiddenResolver::observeProbeResponse(const uint8_t* frame, uint16_t len, uint32_t now) {
+    resolve(frame, len, BEACON_IES, HIDDEN_SOURCE_PROBE_RESP, now);
+}
+
+void HiddenResolver::observeAssocRequest(const uint8_t* frame, uint16_t len, bool reassoc, uint32_t now) {
+    if (reassoc) {
+        resolve(frame, len, REASSOC_REQ_IES, HIDDEN_SOURCE_REASSOC_REQ, now);
+    } else {
+        resolve(frame, len, ASSOC_REQ_IES, HIDDEN_SOURCE_ASSOC_REQ, now);
+    }
+}
+
+void HiddenResolver::observeScan(const uint8_t* bssid, uint8_t channel, uint32_t now) {
+    track(bssid, channel, now);
+}
+
+void HiddenResolver::resolve(const uint8_t* frame, uint16_t len, uint16_t offset, uint8_t source, uint32_t now) {
+    if (len < offset + 2 + DOT11_FCS_LEN) {
+        return;
+    }
+    uint64_t key = macToKey(frame + DOT11_ADDR_3);
+    
+    // Nearly every frame is for a BSSID nobody is waiting on
+    portENTER_CRITICAL(&lock);
+    HiddenAp* ap = aps.find(key);
+    bool waiting = ap && ap->ssidLen == 0 && now - ap->lastSeen <= HIDDEN_EXPIRY_MS;
+    portEXIT_CRITICAL(&lock);
+    if (!waiting) {
+        return;
+    }
+    
+    const uint8_t* ssid = nullptr;
+    uint8_t ssidLen = 0;
+    dot11ForEachIE(frame, len, offset, [&](uint8_t id, const uint8_t* data, uint8_t n) {
+        if (id == DOT11_IE_SSID) {
+            if (n <= DOT11_SSID_MAX) {
+                ssid = data;
+                ssidLen = n;
+            }
+            return false;
+        }
+        return true;
+    });
+    if (!ssid || isHidden(ssid, ssidLen)) {
+        return;
+    }
+    
+    ApEvent event;
+    bool post = false;
+    portENTER_CRITICAL(&lock);
+    ap = aps.find(key);
+    if (ap && ap->ssidLen == 0) {
+        memcpy(ap->ssid, ssid, ssidLen);
+        ap->ssid[ssidLen] = '\0';
+        ap->ssidLen = ssidLen;
+        ap->source = source;
+        ap->resolvedAt = now;
+        resolved++;
+        
+        memset(&event, 0, sizeof(event));
+        event.type = AP_EVENT_SSID_RESOLVED;
+        event.kind = source;
+        event.severity = AP_SEVERITY_INFO;
+        event.channel = ap->channel;
+        keyToMac(key, event.bssid);
+        memcpy(event.ssid, ap->ssid, ssidLen + 1);
+        post = true;
+    }
+    portEXIT_CRITICAL(&lock);
+    
+    if (post && events) {
+        events->post(event);
+    }
+}
+
+bool HiddenResolver::lookup(const uint8_t* bssid, char* ssid, size_t len) {
+    char copy[DOT11_SSID_MAX + 1];
+    bool found = false;
+    portENTER_CRITICAL(&lock);
+    HiddenAp* ap = aps.find(macToKey(bssid));
+    if (ap && ap->ssidLen) {
+        memcpy(copy, ap->ssid, sizeof(copy));
+        found = true;
+    }
+    portEXIT_CRITICAL(&lock);
+    
+    if (found) {
+        snprintf(ssid, len, "%s", copy);
+    }
+    return found;
+}
+
+uint16_t HiddenResolver::getPending(uint32_t now) {
+    uint16_t pending = 0;
+    portENTER_CRITICAL(&lock);
+    aps.forEach([&](uint64_t key, const HiddenAp& ap) {
+        if (ap.ssidLen == 0 && now - ap.lastSeen <= HIDDEN_EXPIRY_MS) {
+            pending++;
+        }
+    });
+    portEXIT_CRITICAL(&lock);
+    return pending;
+}
@@ -0,0 +1,35 @@
+/**
+ * HyperLogLog implementation
+ */
+
+#include "HyperLogLog.h"
+#include <math.h>
+
+void HyperLogLog::merge(uint8_t* into, const uint8_t* from) {
+    for (uint16_t i = 0; i < HLL_REGISTERS; i++) {
+        if (from[i] > into[i]) {
+            into[i] = from[i];
+        }
+    }
+}
+
+uint32_t HyperLogLog::estimate(const uint8_t* registers) {
+    float sum = 0.0f;
+    uint16_t zeros = 0;
+    for (uint16_t i = 0; i < HLL_REGISTERS; i++) {
+        sum += ldexpf(1.0f, -registers[i]);
+        if (registers[i] == 0) {
+            zeros++;
+        }
+    }
+    
+    const float m = HLL_REGISTERS;
+    const float alpha = 0.7213f / (1.0f + 1.079f / m);
+    float raw = alpha * m * m / sum;
+    
+    // Small cardinalities: linear counting over the empty registers is far more accurate
+    if (raw <= 2.5f * m && zeros > 0) {
+        return (uint32_t)lroundf(m * logf(m / zeros));
+    }
+    return (uint32_t)lroundf(raw);
+}
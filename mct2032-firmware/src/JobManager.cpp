@@ -0,0 +1,115 @@
+/**
+ * Job Manager implementation
+ */
+
+#include "JobManager.h"
+
+JobManager::JobManager() : nextId(1) {
+    memset(jobs, 0, sizeof(jobs));
+}
+
+bool JobManager::canClaim(uint8_t exclusiveClaims, uint8_t sharedClaims) const {
+    for (size_t i = 0; i < MAX_JOBS; i++) {
+        const Job& job = jobs[i];
+        if (job.state != JOB_STATE_RUNNING) {
+            continue;
+        }
+        
+        uint8_t held = job.exclusiveClaims | job.sharedClaims;
+        if ((exclusiveClaims & held) || (sharedClaims & job.exclusiveClaims)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+Job* JobManager::start(uint8_t type, uint8_t exclusiveClaims, uint8_t sharedClaims, const char** reason) {
+    if (findByType(type)) {
+        *reason = "Job already running";
+        return nullptr;
+    }
+    
+    if (!canClaim(exclusiveClaims, sharedClaims)) {
+        *reason = "Device busy";
+        return nullptr;
+    }
+    
+    for (size_t i = 0; i < MAX_JOBS; i++) {
+        Job& job = jobs[i];
+        if (job.state != JOB_STATE_FREE) {
+            continue;
+        }
+        
+        memset(&job, 0, sizeof(job));
+        job.id = nextId++;
+        if (nextId == 0) {
+            nextId = 1;
+        }
+        job.type = type;
+        job.state = JOB_STATE_RUNNING;
+        job.progress = JOB_PROGRESS_UNKNOWN;
+        job.reportedProgress = JOB_PROGRESS_UNKNOWN;
+        job.exclusiveClaims = exclusiveClaims;
+        job.sharedClaims = sharedClaims;
+        job.startTime = millis();
+        job.lastTick = job.startTime;
+        return &job;
+    }
+    
+    *reason = "Too many jobs";
+    return nullptr;
+}
+
+void JobManager::release(Job* job) {
+    job->state = JOB_STATE_FREE;
+}
+
+Job* JobManager::find(uint16_t id) {
+    for (size_t i = 0; i < MAX_JOBS; i++) {
+        if (jobs[i].state == JOB_STATE_RUNNING && jobs[i].id == id) {
+            return &jobs[i];
+        }
+    }
+    return nullptr;
+}
+
+Job* JobManager::findByType(uint8_t type) {
+    for (size_t i = 0; i < MAX_JOBS; i++) {
+        if (jobs[i].state == JOB_STATE_RUNNING && jobs[i].type == type) {
+            return &jobs[i];
+        }
+    }
+    return nullptr;
+}
+
+size_t JobManager::getActiveCount() const {
+    size_t count = 0;
+    for (size_t i = 0; i < MAX_JOBS; i++) {
+        if (jobs[i].state == JOB_STATE_RUNNING) {
+            count++;
+        }
+    }
+    return count;
+}
+
+const char* JobManager::typeName(uint8_t type) {
+    switch (type) {
+        case JOB_SCAN:          return "scan";
+        case JOB_MONITOR:       return "monitor";
+        case JOB_CAPTURE:       return "capture";
+        case JOB_EXPORT:        return "export";
+        case JOB_STATS_STREAM:  return "stats_stream";
+        case JOB_FLIGHT:        return "flight";
+        default:                return "unknown";
+    }
+}
+
+const char* JobManager::stateName(uint8_t state) {
+    switch (state) {
+        case JOB_STATE_RUNNING:     return "running";
+        case JOB_STATE_DONE:        return "done";
+        case JOB_STATE_CANCELLED:   return "cancelled";
+        case JOB_STATE_FAILED:      return "failed";
+        default:                    return "free";
+    }
+}
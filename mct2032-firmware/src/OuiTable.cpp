@@ -0,0 +1,87 @@
+/**
+ * OUI Table implementation
+ */
+
+#include "OuiTable.h"
+#include <string.h>
+
+#if __has_include("OuiData.h")
+#include "OuiData.h"
+#else
+// No generated table; every lookup misses
+#define OUI_DATA_COUNT      0
+#define OUI_DATA_VENDORS    0
+static const uint16_t OUI_DATA_INDEX[257] = {0};
+static const uint16_t OUI_DATA_LOW[1] = {0};
+static const uint16_t OUI_DATA_VENDOR[1] = {0};
+static const uint32_t OUI_DATA_BUCKETS[1] = {0};
+static const uint8_t OUI_DATA_NAMES[1] = {0};
+#endif
+
+uint16_t OuiTable::lookup(const uint8_t* mac) {
+    if (mac[0] & 0x02) {
+        return OUI_UNKNOWN;
+    }
+    return lookup(((uint32_t)mac[0] << 16) | (mac[1] << 8) | mac[2]);
+}
+
+uint16_t OuiTable::lookup(uint32_t oui) {
+    uint8_t first = (oui >> 16) & 0xFF;
+    uint16_t low = oui & 0xFFFF;
+    uint32_t lo = OUI_DATA_INDEX[first];
+    uint32_t end = OUI_DATA_INDEX[first + 1];
+    
+    // Lower bound of low within this first byte's range
+    uint32_t hi = end;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (OUI_DATA_LOW[mid] < low) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    
+    if (lo < end && OUI_DATA_LOW[lo] == low) {
+        return OUI_DATA_VENDOR[lo];
+    }
+    return OUI_UNKNOWN;
+}
+
+bool OuiTable::name(uint16_t vendor, char* out, size_t len) {
+    if (vendor >= OUI_DATA_VENDORS || len == 0) {
+        return false;
+    }
+    
+    // A bucket starts with a full name; each later one is (shared prefix, suffix length, suffix)
+    char text[OUI_NAME_MAX];
+    uint32_t pos = OUI_DATA_BUCKETS[vendor / OUI_NAME_BUCKET];
+    uint8_t textLen = OUI_DATA_NAMES[pos++];
+    memcpy(text, OUI_DATA_NAMES + pos, textLen);
+    pos += textLen;
+    for (uint16_t i = vendor % OUI_NAME_BUCKET; i > 0; i--) {
+        uint8_t prefix = OUI_DATA_NAMES[pos++];
+        uint8_t suffix = OUI_DATA_NAMES[pos++];
+        memcpy(text + prefix, OUI_DATA_NAMES + pos, suffix);
+        pos += suffix;
+        textLen = prefix + suffix;
+    }
+    
+    size_t n = textLen < len - 1 ? textLen : len - 1;
+    memcpy(out, text, n);
+    out[n] = '\0';
+    return true;
+}
+
+uint32_t OuiTable::getCount() {
+    return OUI_DATA_COUNT;
+}
+
+uint16_t OuiTable::getVendorCount() {
+    return OUI_DATA_VENDORS;
+}
+
+uint32_t OuiTable::getFlashBytes() {
+    return sizeof(OUI_DATA_INDEX) + sizeof(OUI_DATA_LOW) + sizeof(OUI_DATA_VENDOR) +
+           sizeof(OUI_DATA_BUCKETS) + sizeof(OUI_DATA_NAMES);
+}
@@ -0,0 +1,75 @@
+/**
+ * Overload Controller implementation
+ */
+
+#include "OverloadController.h"
+
+OverloadController::OverloadController() {
+    reset();
+}
+
+void OverloadController::reset() {
+    level = OVERLOAD_FULL;
+    sampleN = 1;
+    sampleTick = 0;
+    windowStart = millis();
+    busyUs = 0;
+    calmWindows = 0;
+    busyPct = 0;
+    framesShed = 0;
+    levelChanges = 0;
+}
+
+void OverloadController::evaluate(uint32_t now) {
+    uint32_t windowUs = (now - windowStart) * 1000;
+    uint32_t pct = busyUs / (windowUs / 100);
+    busyPct = pct > 100 ? 100 : pct;
+    windowStart = now;
+    busyUs = 0;
+    
+    if (busyPct > OVERLOAD_HIGH_PCT) {
+        calmWindows = 0;
+        if (level == OVERLOAD_FULL) {
+            setLevel(OVERLOAD_SAMPLED, 2);
+        } else if (level == OVERLOAD_SAMPLED && sampleN < OVERLOAD_MAX_SAMPLE) {
+            setLevel(OVERLOAD_SAMPLED, sampleN * 2);
+        } else if (level == OVERLOAD_SAMPLED) {
+            setLevel(OVERLOAD_COUNTERS_ONLY, 1);
+        }
+        return;
+    }
+    
+    if (busyPct >= OVERLOAD_LOW_PCT || level == OVERLOAD_FULL) {
+        calmWindows = 0;
+        return;
+    }
+    
+    // Step back up one level at a time, so a burst that returns is caught early
+    if (++calmWindows < OVERLOAD_CALM_WINDOWS) {
+        return;
+    }
+    calmWindows = 0;
+    if (level == OVERLOAD_COUNTERS_ONLY) {
+        setLevel(OVERLOAD_SAMPLED, OVERLOAD_MAX_SAMPLE);
+    } else if (sampleN > 2) {
+        setLevel(OVERLOAD_SAMPLED, sampleN / 2);
+    } else {
+        setLevel(OVERLOAD_FULL, 1);
+    }
+}
+
+void OverloadController::setLevel(uint8_t newLevel, uint16_t n) {
+    level = newLevel;
+    sampleN = n;
+    sampleTick = 0;
+    levelChanges++;
+}
+
+const char* OverloadController::levelName(uint8_t level) {
+    switch (level) {
+        case OVERLOAD_FULL:             return "full";
+        case OVERLOAD_SAMPLED:          return "sampled";
+        case OVERLOAD_COUNTERS_ONLY:    return "counters";
+        default:                        return "unknown";
+    }
+}
@@ -3,7 +3,7 @@
  */
 
 #include "PacketMonitor.h"
-#include <SD.h>
+#include "PipelineMetrics.h"
 
 // Static instance pointer
 PacketMonitor* PacketMonitor::instance = nullptr;
@@ -18,13 +18,24 @@ PacketMonitor::PacketMonitor() :
     dataCount(0),
     mgmtCount(0),
     ctrlCount(0),
+    framesFiltered(0),
+    dedupEnabled(false),
     startTime(0),
     lastPacketTime(0),
-    pcapActive(false) {
+    storage(nullptr),
+    pcapActive(false),
+    pcapWriting(false),
+    pcapStream(nullptr),
+    pcapDropped(0) {
+    portMUX_INITIALIZE(&pcapLock);
 }
 
 void PacketMonitor::init() {
     instance = this;
+    distinct.begin();
+    events.begin();
+    rogue.begin(&events);
+    hidden.begin(&events);
     Serial.println("Packet Monitor initialized");
 }
 
@@ -50,9 +61,18 @@ bool PacketMonitor::startMonitor(uint8_t channel) {
     resetStats();
     startTime = millis();
     
+    // Push the type and control subtype parts of the filter down to the driver
+    wifi_promiscuous_filter_t typeFilter = {filter.getHardwareMask()};
+    esp_wifi_set_promiscuous_filter(&typeFilter);
+    if (typeFilter.filter_mask & WIFI_PROMIS_FILTER_MASK_CTRL) {
+        wifi_promiscuous_filter_t ctrlFilter = {filter.getCtrlMask()};
+        esp_wifi_set_promiscuous_ctrl_filter(&ctrlFilter);
+    }
+    
     // Start promiscuous mode
     esp_wifi_set_promiscuous(true);
     esp_wifi_set_promiscuous_rx_cb(&promiscuousCallback);
+    airtime.setListening(currentChannel, millis());
     
     monitoring = true;
     Serial.printf("Packet monitoring started on channel %d\n", currentChannel);
@@ -67,6 +87,7 @@ void PacketMonitor::stopMonitor() {
     
     // Stop promiscuous mode
     esp_wifi_set_promiscuous(false);
+    airtime.setListening(0, millis());
     
     monitoring = false;
     
@@ -78,10 +99,34 @@ void PacketMonitor::stopMonitor() {
     Serial.println("Packet monitoring stopped");
 }
 
+bool PacketMonitor::setFilter(const CaptureFilter& f) {
+    if (monitoring) {
+        return false;
+    }
+    
+    filter = f;
+    return true;
+}
+
+bool PacketMonitor::setDedup(bool enabled) {
+    if (monitoring) {
+        return false;
+    }
+    
+    dedupEnabled = enabled;
+    return true;
+}
+
 void PacketMonitor::setChannel(uint8_t channel) {
     if (channel >= 1 && channel <= 14) {
         currentChannel = channel;
         esp_wifi_set_channel(currentChannel, WIFI_SECOND_CHAN_NONE);
+        
+        // Frames sent while we were away are not capture loss
+        seqLoss.newEpoch();
+        if (monitoring) {
+            airtime.setListening(channel, millis());
+        }
     }
 }
 
@@ -97,76 +142,164 @@ void PacketMonitor::hopChannel() {
 void PacketMonitor::promiscuousCallback(void* buf, wifi_promiscuous_pkt_type_t type) {
     if (!instance) return;
     
+    PIPE_START(rxStart);
     wifi_promiscuous_pkt_t* pkt = (wifi_promiscuous_pkt_t*)buf;
+    
+    // Rejected frames cost only the compares; nothing is counted, copied or written
+    PIPE_START(filterStart);
+    bool accepted = instance->filter.match(pkt->payload, pkt->rx_ctrl.sig_len, pkt->rx_ctrl.rssi, pkt->rx_ctrl.channel);
+    PIPE_STOP(PIPE_STAGE_FILTER, filterStart);
+    if (!accepted) {
+        instance->framesFiltered++;
+        PIPE_DROP(PIPE_STAGE_FILTER);
+        PIPE_STOP(PIPE_STAGE_RX, rxStart);
+        return;
+    }
+    
+    uint32_t startUs = micros();
     wifi_pkt_rx_ctrl_t ctrl = pkt->rx_ctrl;
+    uint32_t now = millis();
+    
+    // Exact retransmissions stop here, before they are counted or captured
+    if (instance->dedupEnabled) {
+        PIPE_START(dedupStart);
+        bool duplicate = instance->dedup.isDuplicate(pkt->payload, ctrl.sig_len, now);
+        PIPE_STOP(PIPE_STAGE_DEDUP, dedupStart);
+        if (duplicate) {
+            PIPE_DROP(PIPE_STAGE_DEDUP);
+            instance->overload.account(micros() - startUs, now);
+            PIPE_STOP(PIPE_STAGE_RX, rxStart);
+            return;
+        }
+    }
     
     // Update packet count
     instance->packetsTotal++;
-    instance->lastPacketTime = millis();
+    instance->lastPacketTime = now;
     
     // Get frame control field
     uint16_t frameControl = *((uint16_t*)pkt->payload);
     uint8_t frameType = (frameControl & 0x0C) >> 2;
     uint8_t frameSubType = (frameControl & 0xF0) >> 4;
     
-    // Create packet info
-    PacketInfo info;
-    info.type = frameType;
-    info.subtype = frameSubType;
-    info.channel = ctrl.channel;
-    info.rssi = ctrl.rssi;
-    info.timestamp = millis();
-    info.length = ctrl.sig_len;
+    // Capture and the every-frame trackers keep going while sampling; only
+    // counters-only mode sheds them
+    bool capture = instance->overload.getLevel() != OVERLOAD_COUNTERS_ONLY;
     
-    // Extract MAC addresses (if present)
-    if (ctrl.sig_len >= 24) {
-        memcpy(info.dstMAC, pkt->payload + 4, 6);
-        memcpy(info.srcMAC, pkt->payload + 10, 6);
-    }
+    // Analytics see every frame, or 1 in N carrying a weight of N under load
+    PIPE_START(analysisStart);
+    uint16_t weight = instance->overload.admit();
     
-    // Process based on frame type
+    // Process based on frame type; counters stay exact at every load level,
+    // the trackers behind them are shed with the rest of the analytics
     switch (frameType) {
         case FRAME_TYPE_MGMT:
             instance->mgmtCount++;
-            instance->processMgmtFrame(pkt->payload, ctrl.sig_len, ctrl.rssi);
+            instance->processMgmtFrame(pkt->payload, ctrl.sig_len, ctrl.rssi, weight, capture);
             break;
         case FRAME_TYPE_DATA:
             instance->dataCount++;
-            instance->processDataFrame(pkt->payload, ctrl.sig_len, ctrl.rssi);
+            instance->processDataFrame(pkt->payload, ctrl.sig_len, ctrl.rssi, weight);
             break;
         case FRAME_TYPE_CTRL:
             instance->ctrlCount++;
-            instance->processCtrlFrame(pkt->payload, ctrl.sig_len, ctrl.rssi);
+            instance->processCtrlFrame(pkt->payload, ctrl.sig_len, ctrl.rssi, weight);
             break;
     }
     
-    // Write to PCAP if active
-    if (instance->pcapActive && instance->pcapFile) {
-        uint32_t ts_sec = info.timestamp / 1000;
-        uint32_t ts_usec = (info.timestamp % 1000) * 1000;
-        instance->writePCAP_PacketHeader(ts_sec, ts_usec, ctrl.sig_len);
-        instance->writePCAP_PacketData(pkt->payload, ctrl.sig_len);
+    // Sequence gaps, distinct counts, airtime and PHY histograms need every
+    // frame rather than a sample, so they run until counters-only mode
+    if (capture) {
+        instance->seqLoss.observe(pkt->payload, ctrl.sig_len, ctrl.channel, now);
+        instance->distinct.observe(pkt->payload, ctrl.sig_len, ctrl.channel, now);
+        instance->airtime.observe(pkt->payload, ctrl, now);
+        instance->phy.observe(ctrl);
     }
     
-    // Call user callback if set
-    if (instance->packetCallback) {
+    if (weight) {
+        instance->talkers.observe(pkt->payload, ctrl.sig_len, weight, now);
+    }
+    if (weight && instance->packetCallback) {
+        PacketInfo info;
+        info.type = frameType;
+        info.subtype = frameSubType;
+        info.channel = ctrl.channel;
+        info.rssi = ctrl.rssi;
+        info.timestamp = now;
+        info.length = ctrl.sig_len;
+        info.weight = weight;
+        
+        // Extract MAC addresses (if present)
+        if (ctrl.sig_len >= 24) {
+            memcpy(info.dstMAC, pkt->payload + 4, 6);
+            memcpy(info.srcMAC, pkt->payload + 10, 6);
+        }
+        
         instance->packetCallback(info);
     }
+    PIPE_STOP(PIPE_STAGE_ANALYSIS, analysisStart);
+    if (!weight) {
+        PIPE_DROP(PIPE_STAGE_ANALYSIS);
+    }
+    
+    // Write to PCAP if active
+    if (instance->pcapActive) {
+        if (capture) {
+            uint32_t ts_sec = now / 1000;
+            uint32_t ts_usec = (now % 1000) * 1000;
+            PIPE_START(pcapStart);
+            instance->writePCAP_Packet(ts_sec, ts_usec, pkt->payload, ctrl.sig_len);
+            PIPE_STOP(PIPE_STAGE_PCAP, pcapStart);
+        } else {
+            instance->pcapDropped++;
+            PIPE_DROP(PIPE_STAGE_PCAP);
+        }
+    }
+    
+    // Pre-trigger ring; returns at once when not armed
+    if (capture) {
+        instance->flightRecorder.record(pkt->payload, ctrl.sig_len, ctrl.rssi, now);
+    }
+    
+    instance->overload.account(micros() - startUs, now);
+    PIPE_STOP(PIPE_STAGE_RX, rxStart);
 }
 
-void PacketMonitor::processMgmtFrame(const uint8_t* payload, uint16_t len, int8_t rssi) {
+void PacketMonitor::processMgmtFrame(const uint8_t* payload, uint16_t len, int8_t rssi, uint16_t weight, bool full) {
     if (len < 24) return;
     
     uint16_t frameControl = *((uint16_t*)payload);
     uint8_t frameSubType = (frameControl & 0xF0) >> 4;
     
+    // Rogue and hidden-SSID tracking aren't sampled: beacon timing checks need
+    // consecutive beacons and a name reveal may not come again. Like capture
+    // they run until counters-only mode, and cost little next to the beacons.
     switch (frameSubType) {
         case FRAME_SUBTYPE_BEACON:
             beaconCount++;
+            if (full) {
+                rogue.observeBeacon(payload, len, currentChannel, lastPacketTime);
+                hidden.observeBeacon(payload, len, currentChannel, lastPacketTime);
+            }
             break;
         case FRAME_SUBTYPE_PROBE_REQ:
+            probeCount++;
+            if (weight) {
+                probes.observe(payload, len, weight, lastPacketTime);
+                devices.observe(payload, len, weight, lastPacketTime);
+            }
+            break;
         case FRAME_SUBTYPE_PROBE_RESP:
             probeCount++;
+            if (full) {
+                hidden.observeProbeResponse(payload, len, lastPacketTime);
+            }
+            break;
+        case FRAME_SUBTYPE_ASSOC_REQ:
+        case FRAME_SUBTYPE_REASSOC_REQ:
+            if (full) {
+                hidden.observeAssocRequest(payload, len, frameSubType == FRAME_SUBTYPE_REASSOC_REQ, lastPacketTime);
+            }
             break;
         case FRAME_SUBTYPE_DEAUTH:
             deauthCount++;
@@ -175,12 +308,18 @@ void PacketMonitor::processMgmtFrame(const uint8_t* payload, uint16_t len, int8_
     }
 }
 
-void PacketMonitor::processDataFrame(const uint8_t* payload, uint16_t len, int8_t rssi) {
-    // Process data frames
+void PacketMonitor::processDataFrame(const uint8_t* payload, uint16_t len, int8_t rssi, uint16_t weight) {
+    if (weight) {
+        traffic.observeData(payload, len, weight, lastPacketTime);
+    }
 }
 
-void PacketMonitor::processCtrlFrame(const uint8_t* payload, uint16_t len, int8_t rssi) {
-    // Process control frames
+void PacketMonitor::processCtrlFrame(const uint8_t* payload, uint16_t len, int8_t rssi, uint16_t weight) {
+    // A PS-Poll ties a dozing station to its AP without any data traffic
+    uint8_t frameSubType = payload[0] >> 4;
+    if (weight && frameSubType == FRAME_SUBTYPE_PS_POLL) {
+        traffic.observePsPoll(payload, len, lastPacketTime);
+    }
 }
 
 uint32_t PacketMonitor::getPacketsPerSec() const {
@@ -202,6 +341,16 @@ void PacketMonitor::resetStats() {
     dataCount = 0;
     mgmtCount = 0;
     ctrlCount = 0;
+    framesFiltered = 0;
+    overload.reset();
+    seqLoss.reset();
+    dedup.reset();
+    talkers.reset();
+    traffic.reset();
+    airtime.reset();
+    phy.reset();
+    probes.reset();
+    devices.reset();
 }
 
 // Packet injection
@@ -326,16 +475,26 @@ bool PacketMonitor::startPCAP(const char* filename) {
         return false;
     }
     
+    if (!storage || !storage->isMounted()) {
+        Serial.println("PCAP: storage not mounted");
+        return false;
+    }
+    
     // Open file
-    pcapFile = SD.open(filename, FILE_WRITE);
-    if (!pcapFile) {
+    pcapStream = storage->openAppend(filename, true);
+    if (!pcapStream) {
         Serial.println("Failed to open PCAP file");
         return false;
     }
     
     // Write global header
-    writePCAP_GlobalHeader();
+    if (!writePCAP_GlobalHeader(pcapStream)) {
+        pcapStream->close();
+        pcapStream = nullptr;
+        return false;
+    }
     
+    pcapDropped = 0;
     pcapActive = true;
     Serial.printf("PCAP capture started: %s\n", filename);
     
@@ -347,74 +506,75 @@ void PacketMonitor::stopPCAP() {
         return;
     }
     
-    pcapFile.close();
+    portENTER_CRITICAL(&pcapLock);
     pcapActive = false;
+    portEXIT_CRITICAL(&pcapLock);
+    
+    // A frame write already under way finishes before the stream goes away
+    while (pcapWriting) {
+        delay(1);
+    }
+    pcapStream->close();
     
-    Serial.println("PCAP capture stopped");
+    Serial.printf("PCAP capture stopped (%lu bytes, %lu frames dropped)\n",
+                  pcapStream->getBytesQueued(), pcapDropped);
+    pcapStream = nullptr;
 }
 
-void PacketMonitor::writePCAP_GlobalHeader() {
-    if (!pcapFile) return;
-    
-    // PCAP global header
-    pcapFile.write((uint8_t)0xD4);  // Magic number
-    pcapFile.write((uint8_t)0xC3);
-    pcapFile.write((uint8_t)0xB2);
-    pcapFile.write((uint8_t)0xA1);
-    
-    pcapFile.write((uint8_t)0x02);  // Version major
-    pcapFile.write((uint8_t)0x00);
-    pcapFile.write((uint8_t)0x04);  // Version minor
-    pcapFile.write((uint8_t)0x00);
-    
-    // Timezone offset (0)
-    for (int i = 0; i < 8; i++) {
-        pcapFile.write((uint8_t)0x00);
-    }
-    
-    // Snaplen (65535)
-    pcapFile.write((uint8_t)0xFF);
-    pcapFile.write((uint8_t)0xFF);
-    pcapFile.write((uint8_t)0x00);
-    pcapFile.write((uint8_t)0x00);
-    
-    // Network type (IEEE 802.11)
-    pcapFile.write((uint8_t)0x7F);
-    pcapFile.write((uint8_t)0x00);
-    pcapFile.write((uint8_t)0x00);
-    pcapFile.write((uint8_t)0x00);
+// Flight recorder
+bool PacketMonitor::startFlightRecorder(const FlightConfig& config, const char* filename) {
+    if (flightRecorder.isActive()) {
+        return false;
+    }
+    
+    if (!storage || !storage->isMounted()) {
+        Serial.println("Flight recorder: storage not mounted");
+        return false;
+    }
+    
+    StorageStream* stream = storage->openAppend(filename, true);
+    if (!stream) {
+        Serial.println("Failed to open flight recorder file");
+        return false;
+    }
+    
+    if (!writePCAP_GlobalHeader(stream) || !flightRecorder.arm(config, stream)) {
+        stream->close();
+        return false;
+    }
+    
+    return true;
 }
 
-void PacketMonitor::writePCAP_PacketHeader(uint32_t ts_sec, uint32_t ts_usec, uint32_t len) {
-    if (!pcapFile) return;
-    
-    // Timestamp seconds
-    pcapFile.write((uint8_t)(ts_sec & 0xFF));
-    pcapFile.write((uint8_t)((ts_sec >> 8) & 0xFF));
-    pcapFile.write((uint8_t)((ts_sec >> 16) & 0xFF));
-    pcapFile.write((uint8_t)((ts_sec >> 24) & 0xFF));
-    
-    // Timestamp microseconds
-    pcapFile.write((uint8_t)(ts_usec & 0xFF));
-    pcapFile.write((uint8_t)((ts_usec >> 8) & 0xFF));
-    pcapFile.write((uint8_t)((ts_usec >> 16) & 0xFF));
-    pcapFile.write((uint8_t)((ts_usec >> 24) & 0xFF));
-    
-    // Captured length
-    pcapFile.write((uint8_t)(len & 0xFF));
-    pcapFile.write((uint8_t)((len >> 8) & 0xFF));
-    pcapFile.write((uint8_t)((len >> 16) & 0xFF));
-    pcapFile.write((uint8_t)((len >> 24) & 0xFF));
-    
-    // Original length
-    pcapFile.write((uint8_t)(len & 0xFF));
-    pcapFile.write((uint8_t)((len >> 8) & 0xFF));
-    pcapFile.write((uint8_t)((len >> 16) & 0xFF));
-    pcapFile.write((uint8_t)((len >> 24) & 0xFF));
+bool PacketMonitor::writePCAP_GlobalHeader(StorageStream* stream) {
+    const uint8_t header[24] = {
+        0xD4, 0xC3, 0xB2, 0xA1,     // Magic number
+        0x02, 0x00, 0x04, 0x00,     // Version 2.4
+        0x00, 0x00, 0x00, 0x00,     // Timezone offset (0)
+        0x00, 0x00, 0x00, 0x00,     // Timestamp accuracy
+        0xFF, 0xFF, 0x00, 0x00,     // Snaplen (65535)
+        0x69, 0x00, 0x00, 0x00      // Network type (IEEE 802.11)
+    };
+    return stream->write(header, sizeof(header), 100);
 }
 
-void PacketMonitor::writePCAP_PacketData(const uint8_t* data, uint32_t len) {
-    if (!pcapFile) return;
+void PacketMonitor::writePCAP_Packet(uint32_t ts_sec, uint32_t ts_usec, const uint8_t* data, uint32_t len) {
+    // Re-checked under the lock so stopPCAP can wait out this write
+    portENTER_CRITICAL(&pcapLock);
+    bool active = pcapActive;
+    pcapWriting = active;
+    portEXIT_CRITICAL(&pcapLock);
+    if (!active) {
+        return;
+    }
+    
+    // Timestamp, captured length and original length, little endian
+    uint32_t header[4] = {ts_sec, ts_usec, len, len};
     
-    pcapFile.write(data, len);
-}
\ No newline at end of file
+    // Runs in the WiFi task, so never wait for a buffer; drop whole frames instead
+    if (!pcapStream->writeRecord(header, sizeof(header), data, len)) {
+        pcapDropped++;
+        PIPE_DROP(PIPE_STAGE_PCAP);
+    }
+    pcapWriting = false;
+}
@@ -0,0 +1,115 @@
+/**
+ * PHY Statistics implementation
+ */
+
+#include "PhyStats.h"
+#include "Checksum.h"
+
+#define SNR_SHIFT       4           // Average moves 1/16 of the way per frame
+
+PhyStats::PhyStats() {
+    reset();
+}
+
+void PhyStats::reset() {
+    memset(channels, 0, sizeof(channels));
+}
+
+uint8_t PhyStats::bucket(int16_t value, int16_t base, uint8_t step, uint8_t count) {
+    if (value < base) {
+        return 0;
+    }
+    uint16_t index = (value - base) / step;
+    return index < count ? index : count - 1;
+}
+
+void PhyStats::observe(const wifi_pkt_rx_ctrl_t& ctrl) {
+    if (ctrl.channel == 0 || ctrl.channel > PHY_CHANNELS) {
+        return;
+    }
+    PhyChannel& ch = channels[ctrl.channel - 1];
+    
+    int8_t rssi = ctrl.rssi;
+    int8_t noise = ctrl.noise_floor;
+    ch.rssi[bucket(rssi, PHY_RSSI_BASE, PHY_RSSI_STEP, PHY_RSSI_BUCKETS)]++;
+    ch.noise[bucket(noise, PHY_NOISE_BASE, PHY_NOISE_STEP, PHY_NOISE_BUCKETS)]++;
+    
+    uint8_t rate = ctrl.sig_mode == 0 ? (ctrl.rate & 0x0F) : PHY_RATE_LEGACY + (ctrl.mcs & 0x0F);
+    ch.rate[rate]++;
+    ch.bandwidth[ctrl.cwb ? 1 : 0]++;
+    
+    // Seed the average with the first frame rather than creeping up from zero
+    int32_t snr = (int32_t)(rssi - noise) * (1 << SNR_SHIFT);
+    if (ch.frames == 0) {
+        ch.snrX16 = snr;
+    } else {
+        ch.snrX16 += (snr - ch.snrX16) >> SNR_SHIFT;
+    }
+    ch.frames++;
+}
+
+static uint8_t* putVarint(uint8_t* p, uint32_t value) {
+    while (value >= 0x80) {
+        *p++ = (uint8_t)value | 0x80;
+        value >>= 7;
+    }
+    *p++ = (uint8_t)value;
+    return p;
+}
+
+static uint8_t* putCounts(uint8_t* p, const uint32_t* counts, uint8_t n) {
+    for (uint8_t i = 0; i < n; i++) {
+        p = putVarint(p, counts[i]);
+    }
+    return p;
+}
+
+size_t PhyStats::serialize(uint8_t* out, size_t cap, uint16_t channelMask) const {
+    const size_t channelWorst = (PHY_BLOB_MAX - PHY_BLOB_HEADER - 4) / PHY_CHANNELS;
+    if (cap < PHY_BLOB_HEADER + 4) {
+        return 0;
+    }
+    
+    uint8_t* p = out;
+    memcpy(p, PHY_BLOB_MAGIC, 4);
+    p += 4;
+    *p++ = PHY_BLOB_VERSION;
+    uint8_t* countByte = p++;
+    *p++ = PHY_RSSI_BUCKETS;
+    *p++ = (uint8_t)(int8_t)PHY_RSSI_BASE;
+    *p++ = PHY_RSSI_STEP;
+    *p++ = PHY_NOISE_BUCKETS;
+    *p++ = (uint8_t)(int8_t)PHY_NOISE_BASE;
+    *p++ = PHY_NOISE_STEP;
+    *p++ = PHY_RATE_BUCKETS;
+    
+    // One pass, each channel's frame count read once: the callback keeps
+    // counting, so a second look could include a channel the count missed
+    uint8_t included = 0;
+    for (uint8_t n = 1; n <= PHY_CHANNELS; n++) {
+        const PhyChannel& ch = channels[n - 1];
+        uint32_t frames = ch.frames;
+        if (!(channelMask & (1 << n)) || frames == 0) {
+            continue;
+        }
+        if ((size_t)(p - out) + channelWorst + 4 > cap) {
+            return 0;
+        }
+        *p++ = n;
+        p = putVarint(p, frames);
+        int16_t snr = (int16_t)ch.snrX16;
+        *p++ = snr & 0xFF;
+        *p++ = (snr >> 8) & 0xFF;
+        p = putCounts(p, ch.rssi, PHY_RSSI_BUCKETS);
+        p = putCounts(p, ch.noise, PHY_NOISE_BUCKETS);
+        p = putCounts(p, ch.rate, PHY_RATE_BUCKETS);
+        p = putCounts(p, ch.bandwidth, PHY_BW_BUCKETS);
+        included++;
+    }
+    *countByte = included;
+    
+    uint32_t crc = crc32(out, p - out);
+    memcpy(p, &crc, 4);
+    p += 4;
+    return p - out;
+}
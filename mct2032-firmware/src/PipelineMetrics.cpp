@@ -0,0 +1,32 @@
+/**
+ * Pipeline Metrics implementation
+ */
+
+#include "PipelineMetrics.h"
+
+#if MCT_PIPELINE_METRICS
+
+PipelineMetrics pipelineMetrics;
+
+PipelineMetrics::PipelineMetrics() {
+    reset();
+}
+
+void PipelineMetrics::reset() {
+    memset(stages, 0, sizeof(stages));
+}
+
+const char* PipelineMetrics::stageName(uint8_t stage) {
+    switch (stage) {
+        case PIPE_STAGE_RX:         return "rx";
+        case PIPE_STAGE_FILTER:     return "filter";
+        case PIPE_STAGE_DEDUP:      return "dedup";
+        case PIPE_STAGE_ANALYSIS:   return "analysis";
+        case PIPE_STAGE_PCAP:       return "pcap";
+        case PIPE_STAGE_QUEUE:      return "queue";
+        case PIPE_STAGE_STREAM:     return "stream";
+        default:                    return "unknown";
+    }
+}
+
+#endif // MCT_PIPELINE_METRICS
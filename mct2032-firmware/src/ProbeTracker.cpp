@@ -0,0 +1,347 @@
+/**
+ * Probe Tracker implementation
+ */
+
+#include "ProbeTracker.h"
+
+ProbeTracker::ProbeTracker() {
+    portMUX_INITIALIZE(&lock);
+    reset();
+}
+
+void ProbeTracker::reset() {
+    portENTER_CRITICAL(&lock);
+    memset(ssids, 0, sizeof(ssids));
+    memset(index, 0, sizeof(index));
+    arenaUsed = 0;
+    ssidBytes = 0;
+    ssidCount = 0;
+    orderCount = 0;
+    clients.clear();
+    probeFrames = 0;
+    wildcardFrames = 0;
+    ssidEvictions = 0;
+    ssidDrops = 0;
+    portEXIT_CRITICAL(&lock);
+}
+
+uint32_t ProbeTracker::hashSsid(const uint8_t* ssid, uint8_t len) {
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (uint8_t i = 0; i < len; i++) {
+        hash = (hash ^ ssid[i]) * 16777619u;
+    }
+    return hash;
+}
+
+uint64_t ProbeTracker::bloomBits(uint32_t hash) {
+    // Double hashing from the two halves of the SSID hash
+    uint64_t bits = 0;
+    uint8_t a = hash & 0x3F;
+    uint8_t b = ((hash >> 16) & 0x3F) | 1;
+    for (uint8_t i = 0; i < PROBE_BLOOM_HASHES; i++) {
+        bits |= 1ULL << ((a + i * b) & 0x3F);
+    }
+    return bits;
+}
+
+uint8_t ProbeTracker::lookup(uint32_t hash, const uint8_t* ssid, uint8_t len) const {
+    uint16_t slot = hash & (PROBE_INDEX_SLOTS - 1);
+    for (uint16_t i = 0; i < PROBE_INDEX_SLOTS && index[slot]; i++) {
+        const ProbeSsid& entry = ssids[index[slot] - 1];
+        if (entry.hash == hash && entry.len == len && memcmp(arena + entry.offset, ssid, len) == 0) {
+            return index[slot] - 1;
+        }
+        slot = (slot + 1) & (PROBE_INDEX_SLOTS - 1);
+    }
+    return PROBE_NO_SSID;
+}
+
+void ProbeTracker::rebuildIndex() {
+    memset(index, 0, sizeof(index));
+    for (uint8_t id = 0; id < PROBE_SSIDS; id++) {
+        if (!ssids[id].used) {
+            continue;
+        }
+        uint16_t slot = ssids[id].hash & (PROBE_INDEX_SLOTS - 1);
+        while (index[slot]) {
+            slot = (slot + 1) & (PROBE_INDEX_SLOTS - 1);
+        }
+        index[slot] = id + 1;
+    }
+}
+
+uint8_t ProbeTracker::evictStalest() {
+    uint8_t victim = PROBE_NO_SSID;
+    for (uint8_t id = 0; id < PROBE_SSIDS; id++) {
+        if (ssids[id].used && (victim == PROBE_NO_SSID ||
+            (int32_t)(ssids[id].lastSeen - ssids[victim].lastSeen) < 0)) {
+            victim = id;
+        }
+    }
+    if (victim == PROBE_NO_SSID) {
+        return victim;
+    }
+    
+    ssidBytes -= ssids[victim].len;
+    ssids[victim].used = false;
+    ssidCount--;
+    ssidEvictions++;
+    return victim;
+}
+
+void ProbeTracker::compact() {
+    // Strings are appended, so arena order is the order they were added
+    // and one pass slides the live ones down
+    uint16_t cursor = 0;
+    uint8_t kept = 0;
+    for (uint8_t i = 0; i < orderCount; i++) {
+        ProbeSsid& entry = ssids[order[i]];
+        if (!entry.used) {
+            continue;
+        }
+        memmove(arena + cursor, arena + entry.offset, entry.len);
+        entry.offset = cursor;
+        cursor += entry.len;
+        order[kept++] = order[i];
+    }
+    orderCount = kept;
+    arenaUsed = cursor;
+}
+
+bool ProbeTracker::needsSpace() const {
+    return PROBE_SSIDS - ssidCount < PROBE_FREE_IDS || PROBE_ARENA_BYTES - ssidBytes < PROBE_FREE_BYTES;
+}
+
+void ProbeTracker::service() {
+    // Unlocked peek; a stale read only puts the work off to the next tick
+    if (!needsSpace()) {
+        return;
+    }
+    
+    portENTER_CRITICAL(&lock);
+    uint32_t victims[(PROBE_SSIDS + 31) / 32] = {0};
+    while (ssidCount > 0 && needsSpace()) {
+        uint8_t victim = evictStalest();
+        victims[victim >> 5] |= 1u << (victim & 31);
+    }
+    
+    // Ids are reused, so no client may keep pointing at an evicted one
+    clients.forEach([&victims](uint64_t, ProbeClient& client) {
+        uint8_t i = 0;
+        while (i < client.idCount) {
+            uint8_t id = client.ids[i];
+            if (victims[id >> 5] & (1u << (id & 31))) {
+                client.ids[i] = client.ids[--client.idCount];
+            } else {
+                i++;
+            }
+        }
+    });
+    compact();
+    rebuildIndex();
+    portEXIT_CRITICAL(&lock);
+}
+
+uint8_t ProbeTracker::intern(uint32_t hash, const uint8_t* ssid, uint8_t len, uint32_t now) {
+    // Making room is the worker's job; past the headroom the SSID goes untracked
+    if (ssidCount >= PROBE_SSIDS || arenaUsed + len > PROBE_ARENA_BYTES) {
+        ssidDrops++;
+        return PROBE_NO_SSID;
+    }
+    
+    uint8_t id = 0;
+    while (ssids[id].used) {
+        id++;
+    }
+    ProbeSsid& entry = ssids[id];
+    memset(&entry, 0, sizeof(entry));
+    entry.used = true;
+    entry.hash = hash;
+    entry.len = len;
+    entry.offset = arenaUsed;
+    entry.lastSeen = now;
+    memcpy(arena + arenaUsed, ssid, len);
+    arenaUsed += len;
+    ssidBytes += len;
+    ssidCount++;
+    order[orderCount++] = id;
+    
+    uint16_t slot = hash & (PROBE_INDEX_SLOTS - 1);
+    while (index[slot]) {
+        slot = (slot + 1) & (PROBE_INDEX_SLOTS - 1);
+    }
+    index[slot] = id + 1;
+    return id;
+}
+
+bool ProbeTracker::addToClient(ProbeClient* client, uint8_t id, uint32_t hash) {
+    for (uint8_t i = 0; i < client->idCount; i++) {
+        if (client->ids[i] == id) {
+            return false;
+        }
+    }
+    uint64_t bits = bloomBits(hash);
+    if ((client->bloom & bits) == bits) {
+        return false;
+    }
+    
+    if (client->idCount < PROBE_CLIENT_SET) {
+        client->ids[client->idCount++] = id;
+    } else {
+        client->bloom |= bits;
+        if (client->overflow < 0xFF) {
+            client->overflow++;
+        }
+    }
+    return true;
+}
+
+void ProbeTracker::observe(const uint8_t* frame, uint16_t len, uint16_t weight, uint32_t now) {
+    const uint8_t* tx = dot11Transmitter(frame, len);
+    if (!tx || (tx[0] & 0x01)) {
+        return;
+    }
+    
+    // The SSID element always comes first in a probe request
+    const uint8_t* ssid = nullptr;
+    uint8_t ssidLen = 0;
+    dot11ForEachIE(frame, len, DOT11_MGMT_HEADER, [&](uint8_t id, const uint8_t* data, uint8_t n) {
+        if (id == DOT11_IE_SSID && n <= DOT11_SSID_MAX) {
+            ssid = data;
+            ssidLen = n;
+        }
+        return false;
+    });
+    if (!ssid) {
+        return;
+    }
+    
+    bool wildcard = true;
+    for (uint8_t i = 0; i < ssidLen && wildcard; i++) {
+        wildcard = ssid[i] == 0;
+    }
+    uint32_t hash = hashSsid(ssid, ssidLen);
+    
+    portENTER_CRITICAL(&lock);
+    probeFrames += weight;
+    bool inserted;
+    ProbeClient* client = clients.findOrInsert(macToKey(tx), &inserted);
+    client->lastSeen = now;
+    client->probes += weight;
+    
+    if (wildcard) {
+        client->wildcard += weight;
+        wildcardFrames += weight;
+    } else {
+        uint8_t id = lookup(hash, ssid, ssidLen);
+        if (id == PROBE_NO_SSID) {
+            id = intern(hash, ssid, ssidLen, now);
+        }
+        if (id != PROBE_NO_SSID) {
+            ProbeSsid& entry = ssids[id];
+            entry.lastSeen = now;
+            entry.probes += weight;
+            if (addToClient(client, id, hash)) {
+                entry.clients++;
+            }
+        }
+    }
+    portEXIT_CRITICAL(&lock);
+}
+
+void ProbeTracker::copySsid(uint8_t id, char* out) const {
+    const ProbeSsid& entry = ssids[id];
+    memcpy(out, arena + entry.offset, entry.len);
+    out[entry.len] = '\0';
+}
+
+uint8_t ProbeTracker::getTopSsids(ProbeSsidReport* out, uint8_t k) {
+    // Rank ids first, then copy the winners' strings
+    uint8_t ranked[PROBE_REPORT_MAX];
+    uint8_t count = 0;
+    if (k > PROBE_REPORT_MAX) {
+        k = PROBE_REPORT_MAX;
+    }
+    
+    portENTER_CRITICAL(&lock);
+    for (uint8_t id = 0; id < PROBE_SSIDS; id++) {
+        if (!ssids[id].used) {
+            continue;
+        }
+        uint8_t pos = count;
+        while (pos > 0 && ssids[ranked[pos - 1]].clients < ssids[id].clients) {
+            pos--;
+        }
+        if (pos >= k) {
+            continue;
+        }
+        for (uint8_t n = count < k ? count : k - 1; n > pos; n--) {
+            ranked[n] = ranked[n - 1];
+        }
+        ranked[pos] = id;
+        if (count < k) {
+            count++;
+        }
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        const ProbeSsid& entry = ssids[ranked[i]];
+        copySsid(ranked[i], out[i].ssid);
+        out[i].clients = entry.clients;
+        out[i].probes = entry.probes;
+        out[i].lastSeen = entry.lastSeen;
+    }
+    portEXIT_CRITICAL(&lock);
+    return count;
+}
+
+uint8_t ProbeTracker::getClients(ProbeClientReport* out, uint8_t k, const uint8_t* only) {
+    struct Pick {
+        uint64_t key;
+        uint16_t ssids;
+        const ProbeClient* client;
+    };
+    Pick picks[PROBE_REPORT_MAX];
+    if (k > PROBE_REPORT_MAX) {
+        k = PROBE_REPORT_MAX;
+    }
+    uint64_t onlyKey = only ? macToKey(only) : 0;
+    uint8_t count = 0;
+    
+    portENTER_CRITICAL(&lock);
+    clients.forEach([&](uint64_t key, const ProbeClient& client) {
+        if (only && key != onlyKey) {
+            return;
+        }
+        uint16_t probed = client.idCount + client.overflow;
+        uint8_t pos = count;
+        while (pos > 0 && picks[pos - 1].ssids < probed) {
+            pos--;
+        }
+        if (pos >= k) {
+            return;
+        }
+        for (uint8_t n = count < k ? count : k - 1; n > pos; n--) {
+            picks[n] = picks[n - 1];
+        }
+        picks[pos] = {key, probed, &client};
+        if (count < k) {
+            count++;
+        }
+    });
+    for (uint8_t i = 0; i < count; i++) {
+        const ProbeClient& client = *picks[i].client;
+        ProbeClientReport& report = out[i];
+        keyToMac(picks[i].key, report.mac);
+        report.probes = client.probes;
+        report.wildcard = client.wildcard;
+        report.lastSeen = client.lastSeen;
+        report.overflow = client.overflow;
+        report.ssidCount = client.idCount;
+        for (uint8_t n = 0; n < client.idCount; n++) {
+            copySsid(client.ids[n], report.ssids[n]);
+        }
+    }
+    portEXIT_CRITICAL(&lock);
+    return count;
+}
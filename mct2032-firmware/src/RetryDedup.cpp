@@ -0,0 +1,49 @@
+/**
+ * Retry De-duplication implementation
+ */
+
+#include "RetryDedup.h"
+#include "SeqLossTracker.h"
+
+RetryDedup::RetryDedup() {
+    reset();
+}
+
+void RetryDedup::reset() {
+    table.clear();
+    duplicates = 0;
+    bytesSaved = 0;
+}
+
+bool RetryDedup::isDuplicate(const uint8_t* frame, uint16_t len, uint32_t now) {
+    uint64_t key;
+    if (!SeqLossTracker::spaceKey(frame, len, &key)) {
+        return false;
+    }
+    
+    uint16_t seqCtl = frame[22] | (frame[23] << 8);
+    bool retry = frame[1] & 0x08;
+    
+    bool inserted;
+    DedupEntry* entry = table.findOrInsert(key, &inserted);
+    entry->lastSeen = now;
+    
+    // Only a retry can be a copy; a first transmission reusing a number is new traffic
+    if (retry) {
+        for (uint8_t i = 0; i < entry->filled; i++) {
+            if (entry->recent[i] == seqCtl) {
+                duplicates++;
+                bytesSaved += len;
+                return true;
+            }
+        }
+    }
+    
+    // Passed on, so later retries of it are copies
+    entry->recent[entry->next] = seqCtl;
+    entry->next = (entry->next + 1) % DEDUP_RECENT;
+    if (entry->filled < DEDUP_RECENT) {
+        entry->filled++;
+    }
+    return false;
+}
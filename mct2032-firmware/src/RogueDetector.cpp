@@ -0,0 +1,478 @@
+/**
+ * Rogue Detector implementation
+ */
+
+#include "RogueDetector.h"
+#include "Dot11.h"
+
+#define BEACON_TSF          24
+#define BEACON_INTERVAL     32
+#define BEACON_CAPABILITY   34
+#define BEACON_IES          36
+#define CAP_PRIVACY         0x0010
+
+#define IE_DS_PARAMS        3
+#define IE_RSN              48
+#define IE_VENDOR           221
+
+#define AKM_SAE             8
+#define AKM_FT_SAE          9
+#define AKM_SAE_EXT         24
+
+// Most alerts one sighting can raise
+#define ROGUE_MAX_PENDING   6
+
+RogueDetector::RogueDetector() : events(nullptr), beacons(0), alerts(0) {
+    portMUX_INITIALIZE(&lock);
+    memset(groups, 0, sizeof(groups));
+    memset(index, 0, sizeof(index));
+    memset(allows, 0, sizeof(allows));
+}
+
+void RogueDetector::begin(ApEventQueue* queue) {
+    events = queue;
+}
+
+uint32_t RogueDetector::hashSsid(const uint8_t* ssid, uint8_t len) {
+    // FNV-1a; 0 is kept for hidden SSIDs
+    uint32_t hash = 2166136261u;
+    for (uint8_t i = 0; i < len; i++) {
+        hash = (hash ^ ssid[i]) * 16777619u;
+    }
+    return hash ? hash : 1;
+}
+
+uint32_t RogueDetector::ouiOf(uint64_t key) {
+    // Virtual BSSIDs often set the locally administered bit on the vendor's OUI
+    uint8_t mac[6];
+    keyToMac(key, mac);
+    return ((uint32_t)(mac[0] & ~0x02) << 16) | (mac[1] << 8) | mac[2];
+}
+
+uint8_t RogueDetector::securityFromAuth(wifi_auth_mode_t auth) {
+    switch (auth) {
+        case WIFI_AUTH_OPEN:            return ROGUE_SEC_OPEN;
+        case WIFI_AUTH_WEP:             return ROGUE_SEC_WEP;
+        case WIFI_AUTH_WPA_PSK:         return ROGUE_SEC_WPA;
+        case WIFI_AUTH_WPA3_PSK:
+        case WIFI_AUTH_WPA2_WPA3_PSK:   return ROGUE_SEC_WPA3;
+        default:                        return ROGUE_SEC_WPA2;
+    }
+}
+
+uint8_t RogueDetector::parseSecurity(const uint8_t* frame, uint16_t len, uint16_t offset, bool privacy) {
+    bool rsn = false;
+    bool sae = false;
+    bool wpa = false;
+    dot11ForEachIE(frame, len, offset, [&](uint8_t id, const uint8_t* data, uint8_t n) {
+        if (id == IE_RSN && n >= 8) {
+            rsn = true;
+            
+            // Version, group cipher, pairwise suites, then the AKM suites
+            uint16_t pos = 6;
+            uint16_t pairwise = data[pos] | (data[pos + 1] << 8);
+            pos += 2 + 4 * pairwise;
+            if (pos + 2 <= n) {
+                uint16_t akms = data[pos] | (data[pos + 1] << 8);
+                pos += 2;
+                for (uint16_t i = 0; i < akms && pos + 4 <= n; i++, pos += 4) {
+                    uint8_t akm = data[pos + 3];
+                    if (akm == AKM_SAE || akm == AKM_FT_SAE || akm == AKM_SAE_EXT) {
+                        sae = true;
+                    }
+                }
+            }
+        } else if (id == IE_VENDOR && n >= 4 && data[0] == 0x00 && data[1] == 0x50 &&
+                   data[2] == 0xF2 && data[3] == 0x01) {
+            wpa = true;
+        }
+        return true;
+    });
+    
+    if (sae) {
+        return ROGUE_SEC_WPA3;
+    }
+    if (rsn) {
+        return ROGUE_SEC_WPA2;
+    }
+    if (wpa) {
+        return ROGUE_SEC_WPA;
+    }
+    return privacy ? ROGUE_SEC_WEP : ROGUE_SEC_OPEN;
+}
+
+void RogueDetector::rebuildIndex() {
+    memset(index, 0, sizeof(index));
+    for (uint8_t g = 0; g < ROGUE_SSIDS; g++) {
+        if (!groups[g].used) {
+            continue;
+        }
+        uint16_t slot = groups[g].hash & (ROGUE_SSID_SLOTS - 1);
+        while (index[slot]) {
+            slot = (slot + 1) & (ROGUE_SSID_SLOTS - 1);
+        }
+        index[slot] = g + 1;
+    }
+}
+
+int8_t RogueDetector::findAllow(uint32_t hash) const {
+    for (uint8_t i = 0; i < ROGUE_ALLOW_SSIDS; i++) {
+        if (allows[i].used && allows[i].hash == hash) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+RogueGroup* RogueDetector::findGroup(uint32_t hash, bool create, uint32_t now) {
+    uint16_t slot = hash & (ROGUE_SSID_SLOTS - 1);
+    for (uint16_t i = 0; i < ROGUE_SSID_SLOTS && index[slot]; i++) {
+        if (groups[index[slot] - 1].hash == hash) {
+            return &groups[index[slot] - 1];
+        }
+        slot = (slot + 1) & (ROGUE_SSID_SLOTS - 1);
+    }
+    if (!create) {
+        return nullptr;
+    }
+    
+    // A free group, or the one heard from least recently
+    uint8_t victim = 0;
+    for (uint8_t g = 0; g < ROGUE_SSIDS; g++) {
+        if (!groups[g].used) {
+            victim = g;
+            break;
+        }
+        if ((int32_t)(groups[g].lastSeen - groups[victim].lastSeen) < 0) {
+            victim = g;
+        }
+    }
+    bool evicted = groups[victim].used;
+    
+    RogueGroup& group = groups[victim];
+    memset(&group, 0, sizeof(group));
+    group.used = true;
+    group.hash = hash;
+    group.lastSeen = now;
+    group.security = ROGUE_NONE;
+    int8_t allow = findAllow(hash);
+    group.allow = allow < 0 ? ROGUE_NONE : allow;
+    
+    if (evicted) {
+        rebuildIndex();
+    } else {
+        while (index[slot]) {
+            slot = (slot + 1) & (ROGUE_SSID_SLOTS - 1);
+        }
+        index[slot] = victim + 1;
+    }
+    return &group;
+}
+
+bool RogueDetector::raise(RogueAp* ap, uint8_t kind, uint32_t now) {
+    if (now - ap->lastAlert >= ROGUE_REALERT_MS) {
+        ap->alerted = 0;
+    }
+    uint8_t bit = 1 << kind;
+    if (ap->alerted & bit) {
+        return false;
+    }
+    if (ap->alerted == 0) {
+        ap->lastAlert = now;
+    }
+    ap->alerted |= bit;
+    return true;
+}
+
+void RogueDetector::checkGroup(RogueGroup* group, RogueAp* ap, uint64_t key, uint8_t security,
+                               ApEvent* out, uint8_t* count, uint32_t now) {
+    group->lastSeen = now;
+    
+    bool member = false;
+    for (uint8_t i = 0; i < group->bssidCount && !member; i++) {
+        member = group->bssids[i] == key;
+    }
+    uint32_t oui = ouiOf(key);
+    bool knownOui = false;
+    for (uint8_t i = 0; i < group->ouiCount && !knownOui; i++) {
+        knownOui = group->ouis[i] == oui;
+    }
+    
+    // The first BSSID sets what the SSID normally looks like
+    if (group->security == ROGUE_NONE) {
+        group->security = security;
+    }
+    
+    if (security != group->security && raise(ap, ROGUE_ALERT_SECURITY, now)) {
+        ApEvent& e = out[(*count)++];
+        e.kind = ROGUE_ALERT_SECURITY;
+        e.severity = security < group->security ? AP_SEVERITY_CRITICAL : AP_SEVERITY_WARNING;
+        e.before = group->security;
+        e.after = security;
+    }
+    
+    if (!knownOui && group->ouiCount > 0 && raise(ap, ROGUE_ALERT_VENDOR, now)) {
+        ApEvent& e = out[(*count)++];
+        e.kind = ROGUE_ALERT_VENDOR;
+        e.severity = AP_SEVERITY_WARNING;
+        e.before = group->ouis[0];
+        e.after = oui;
+    }
+    
+    if (group->allow != ROGUE_NONE) {
+        const RogueAllow& allow = allows[group->allow];
+        bool listed = false;
+        for (uint8_t i = 0; i < allow.count && !listed; i++) {
+            listed = allow.bssids[i] == key;
+        }
+        if (!listed && raise(ap, ROGUE_ALERT_UNLISTED, now)) {
+            ApEvent& e = out[(*count)++];
+            e.kind = ROGUE_ALERT_UNLISTED;
+            e.severity = AP_SEVERITY_CRITICAL;
+            e.before = allow.count;
+            e.after = 0;
+        }
+    }
+    
+    if (!member && group->bssidCount < ROGUE_GROUP_BSSIDS) {
+        group->bssids[group->bssidCount++] = key;
+    }
+    if (!knownOui && group->ouiCount < ROGUE_GROUP_OUIS) {
+        group->ouis[group->ouiCount++] = oui;
+    }
+}
+
+void RogueDetector::observe(const RogueSighting& s, uint32_t now) {
+    ApEvent pending[ROGUE_MAX_PENDING];
+    uint8_t count = 0;
+    uint64_t key = macToKey(s.bssid);
+    
+    bool hidden = true;
+    for (uint8_t i = 0; i < s.ssidLen && hidden; i++) {
+        hidden = s.ssid[i] == 0;
+    }
+    uint32_t hash = hidden ? 0 : hashSsid(s.ssid, s.ssidLen);
+    
+    portENTER_CRITICAL(&lock);
+    bool inserted;
+    RogueAp* ap = aps.findOrInsert(key, &inserted);
+    ap->lastSeen = now;
+    
+    // A BSSID that changes SSID starts over; hidden beacons and the name a
+    // scan resolves for them are the same AP
+    if (inserted || (hash && ap->ssidHash && ap->ssidHash != hash)) {
+        ap->channel = s.channel;
+        ap->interval = 0;
+        ap->lastBeacon = 0;
+    }
+    if (inserted || hash) {
+        ap->ssidHash = hash;
+    }
+    
+    if (s.channel && ap->channel && s.channel != ap->channel && raise(ap, ROGUE_ALERT_CHANNEL, now)) {
+        ApEvent& e = pending[count++];
+        e.kind = ROGUE_ALERT_CHANNEL;
+        e.severity = AP_SEVERITY_INFO;
+        e.before = ap->channel;
+        e.after = s.channel;
+    }
+    if (s.channel) {
+        ap->channel = s.channel;
+    }
+    
+    if (s.timing) {
+        if (ap->interval && s.interval != ap->interval && raise(ap, ROGUE_ALERT_INTERVAL, now)) {
+            ApEvent& e = pending[count++];
+            e.kind = ROGUE_ALERT_INTERVAL;
+            e.severity = AP_SEVERITY_WARNING;
+            e.before = ap->interval;
+            e.after = s.interval;
+        }
+        
+        // The AP's clock should have advanced as far as ours since its last beacon
+        if (ap->lastBeacon) {
+            uint32_t elapsed = now - ap->lastBeacon;
+            uint64_t expected = ap->lastTsf + (uint64_t)elapsed * 1000;
+            int64_t drift = (int64_t)(s.tsf - expected);
+            int64_t slack = ROGUE_TSF_SLACK_US + (int64_t)elapsed * ROGUE_TSF_DRIFT_PPM / 1000;
+            if ((drift > slack || drift < -slack) && raise(ap, ROGUE_ALERT_TSF, now)) {
+                ApEvent& e = pending[count++];
+                e.kind = ROGUE_ALERT_TSF;
+                e.severity = AP_SEVERITY_WARNING;
+                e.before = (int32_t)(expected / 1000);
+                e.after = (int32_t)(drift / 1000);
+            }
+        }
+        ap->interval = s.interval;
+        ap->lastTsf = s.tsf;
+        ap->lastBeacon = now ? now : 1;
+    }
+    
+    if (!hidden) {
+        checkGroup(findGroup(hash, true, now), ap, key, s.security, pending, &count, now);
+    }
+    alerts += count;
+    portEXIT_CRITICAL(&lock);
+    
+    for (uint8_t i = 0; i < count; i++) {
+        ApEvent& e = pending[i];
+        e.type = AP_EVENT_ALERT;
+        e.channel = s.channel;
+        memcpy(e.bssid, s.bssid, 6);
+        uint8_t n = s.ssidLen > DOT11_SSID_MAX ? DOT11_SSID_MAX : s.ssidLen;
+        memcpy(e.ssid, s.ssid, n);
+        e.ssid[n] = '\0';
+        if (events) {
+            events->post(e);
+        }
+    }
+}
+
+void RogueDetector::observeBeacon(const uint8_t* frame, uint16_t len, uint8_t rxChannel, uint32_t now) {
+    if (len < BEACON_IES + DOT11_FCS_LEN) {
+        return;
+    }
+    
+    RogueSighting s;
+    s.bssid = frame + DOT11_ADDR_3;
+    s.ssid = nullptr;
+    s.ssidLen = 0;
+    s.channel = rxChannel;
+    s.timing = true;
+    memcpy(&s.tsf, frame + BEACON_TSF, 8);
+    s.interval = frame[BEACON_INTERVAL] | (frame[BEACON_INTERVAL + 1] << 8);
+    uint16_t capability = frame[BEACON_CAPABILITY] | (frame[BEACON_CAPABILITY + 1] << 8);
+    
+    // Adjacent channels leak in, so the DS element is the AP's real channel
+    dot11ForEachIE(frame, len, BEACON_IES, [&](uint8_t id, const uint8_t* data, uint8_t n) {
+        if (id == DOT11_IE_SSID && n <= DOT11_SSID_MAX) {
+            s.ssid = data;
+            s.ssidLen = n;
+        } else if (id == IE_DS_PARAMS && n == 1) {
+            s.channel = data[0];
+        }
+        return true;
+    });
+    s.security = parseSecurity(frame, len, BEACON_IES, capability & CAP_PRIVACY);
+    
+    beacons++;
+    observe(s, now);
+}
+
+void RogueDetector::observeScan(const uint8_t* bssid, const char* ssid, uint8_t channel,
+                                wifi_auth_mode_t auth, uint32_t now) {
+    RogueSighting s;
+    s.bssid = bssid;
+    s.ssid = (const uint8_t*)ssid;
+    size_t len = strlen(ssid);
+    s.ssidLen = len > DOT11_SSID_MAX ? DOT11_SSID_MAX : len;
+    s.channel = channel;
+    s.security = securityFromAuth(auth);
+    s.timing = false;
+    s.tsf = 0;
+    s.interval = 0;
+    observe(s, now);
+}
+
+bool RogueDetector::setAllowList(const char* ssid, const uint8_t (*bssids)[6], uint8_t count) {
+    size_t len = strlen(ssid);
+    if (len == 0 || len > DOT11_SSID_MAX || count > ROGUE_ALLOW_BSSIDS) {
+        return false;
+    }
+    uint32_t hash = hashSsid((const uint8_t*)ssid, len);
+    bool ok = true;
+    
+    portENTER_CRITICAL(&lock);
+    int8_t slot = findAllow(hash);
+    if (count == 0) {
+        if (slot >= 0) {
+            allows[slot].used = false;
+        }
+    } else {
+        for (uint8_t i = 0; i < ROGUE_ALLOW_SSIDS && slot < 0; i++) {
+            if (!allows[i].used) {
+                slot = i;
+            }
+        }
+        if (slot < 0) {
+            ok = false;
+        } else {
+            RogueAllow& allow = allows[slot];
+            allow.used = true;
+            allow.hash = hash;
+            allow.count = count;
+            for (uint8_t i = 0; i < count; i++) {
+                allow.bssids[i] = macToKey(bssids[i]);
+            }
+        }
+    }
+    
+    // Point existing groups at the new lists
+    for (uint8_t g = 0; g < ROGUE_SSIDS; g++) {
+        if (groups[g].used) {
+            int8_t allow = findAllow(groups[g].hash);
+            groups[g].allow = allow < 0 ? ROGUE_NONE : allow;
+        }
+    }
+    portEXIT_CRITICAL(&lock);
+    return ok;
+}
+
+uint8_t RogueDetector::getAllowListCount() const {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < ROGUE_ALLOW_SSIDS; i++) {
+        count += allows[i].used;
+    }
+    return count;
+}
+
+const char* RogueDetector::kindName(uint8_t kind) {
+    switch (kind) {
+        case ROGUE_ALERT_SECURITY:  return "security_mismatch";
+        case ROGUE_ALERT_VENDOR:    return "vendor_mismatch";
+        case ROGUE_ALERT_UNLISTED:  return "unlisted_bssid";
+        case ROGUE_ALERT_CHANNEL:   return "channel_change";
+        case ROGUE_ALERT_INTERVAL:  return "interval_change";
+        case ROGUE_ALERT_TSF:       return "tsf_anomaly";
+        default:                    return "unknown";
+    }
+}
+
+const char* RogueDetector::securityName(uint8_t security) {
+    switch (security) {
+        case ROGUE_SEC_OPEN:    return "OPEN";
+        case ROGUE_SEC_WEP:     return "WEP";
+        case ROGUE_SEC_WPA:     return "WPA";
+        case ROGUE_SEC_WPA2:    return "WPA2";
+        case ROGUE_SEC_WPA3:    return "WPA3";
+        default:                return "?";
+    }
+}
+
+void RogueDetector::describe(const ApEvent& e, char* out, size_t len) {
+    switch (e.kind) {
+        case ROGUE_ALERT_SECURITY:
+            snprintf(out, len, "%s: %s, network uses %s", e.ssid,
+                     securityName(e.after), securityName(e.before));
+            break;
+        case ROGUE_ALERT_VENDOR:
+            snprintf(out, len, "%s: vendor %06lX, network uses %06lX", e.ssid,
+                     (unsigned long)e.after, (unsigned long)e.before);
+            break;
+        case ROGUE_ALERT_UNLISTED:
+            snprintf(out, len, "%s: BSSID not on allow-list", e.ssid);
+            break;
+        case ROGUE_ALERT_CHANNEL:
+            snprintf(out, len, "%s: channel %ld -> %ld", e.ssid, (long)e.before, (long)e.after);
+            break;
+        case ROGUE_ALERT_INTERVAL:
+            snprintf(out, len, "%s: beacon interval %ld -> %ld TU", e.ssid, (long)e.before, (long)e.after);
+            break;
+        case ROGUE_ALERT_TSF:
+            snprintf(out, len, "%s: TSF off by %ld ms", e.ssid, (long)e.after);
+            break;
+        default:
+            snprintf(out, len, "%s", e.ssid);
+            break;
+    }
+}
@@ -0,0 +1,162 @@
+/**
+ * Sequence Loss Tracker implementation
+ */
+
+#include "SeqLossTracker.h"
+
+#define SEQ_MODULO      4096
+#define SEQ_KEY_TID     48          // Key bits above the address: 0, or TID + 1
+
+SeqLossTracker::SeqLossTracker() {
+    reset();
+}
+
+void SeqLossTracker::reset() {
+    table.clear();
+    memset(channels, 0, sizeof(channels));
+    received = 0;
+    lost = 0;
+    retries = 0;
+    reordered = 0;
+    resyncs = 0;
+    epoch = 0;
+}
+
+bool SeqLossTracker::spaceKey(const uint8_t* frame, uint16_t len, uint64_t* key) {
+    if (len < 24) {
+        return false;
+    }
+    
+    // Control frames carry no sequence number
+    uint8_t type = (frame[0] >> 2) & 0x03;
+    uint8_t subtype = frame[0] >> 4;
+    if (type != 0 && type != 2) {
+        return false;
+    }
+    
+    // (QoS) Null frames may use any number
+    if (type == 2 && (subtype & 0x07) == 0x04) {
+        return false;
+    }
+    
+    // Group addresses never transmit
+    const uint8_t* transmitter = frame + 10;
+    if (transmitter[0] & 0x01) {
+        return false;
+    }
+    
+    *key = macToKey(transmitter);
+    if (type == 2 && (subtype & 0x08)) {
+        if (len < 26) {
+            return false;
+        }
+        *key |= (uint64_t)((frame[24] & 0x0F) + 1) << SEQ_KEY_TID;
+    }
+    return true;
+}
+
+void SeqLossTracker::observe(const uint8_t* frame, uint16_t len, uint8_t channel, uint32_t now) {
+    if (channel == 0 || channel >= SEQ_LOSS_CHANNELS) {
+        return;
+    }
+    
+    uint64_t key;
+    if (!spaceKey(frame, len, &key)) {
+        return;
+    }
+    
+    // Later fragments repeat the first's number
+    uint16_t seqCtl = frame[22] | (frame[23] << 8);
+    if ((seqCtl & 0x0F) != 0) {
+        return;
+    }
+    
+    uint16_t seq = seqCtl >> 4;
+    bool retry = frame[1] & 0x08;
+    
+    bool inserted;
+    SeqLossEntry* entry = table.findOrInsert(key, &inserted);
+    SeqLossChannel& ch = channels[channel];
+    
+    if (!inserted && entry->epoch == epoch && entry->channel == channel &&
+        now - entry->lastSeen < SEQ_LOSS_IDLE_MS) {
+        uint16_t step = (seq - entry->lastSeq) & (SEQ_MODULO - 1);
+        entry->lastSeen = now;
+        
+        // A repeat of the last number is a retransmission we already counted,
+        // with or without the retry bit
+        if (step == 0) {
+            entry->retries++;
+            retries++;
+            return;
+        }
+        
+        // Slightly behind: a late retry of an earlier frame, not new traffic
+        if (step > SEQ_MODULO - SEQ_LOSS_REORDER) {
+            if (retry) {
+                entry->retries++;
+                retries++;
+            } else {
+                reordered++;
+            }
+            return;
+        }
+        
+        if (step <= SEQ_LOSS_MAX_GAP) {
+            // A retry that arrives after a gap stands in for the original we missed
+            uint32_t missed = step - 1;
+            entry->lastSeq = seq;
+            entry->received++;
+            entry->lost += missed;
+            received++;
+            lost += missed;
+            ch.received++;
+            ch.lost += missed;
+            return;
+        }
+    }
+    
+    // Start following this space from here
+    if (!inserted) {
+        resyncs++;
+    }
+    entry->lastSeen = now;
+    entry->lastSeq = seq;
+    entry->channel = channel;
+    entry->epoch = epoch;
+    entry->received++;
+    received++;
+    ch.received++;
+}
+
+uint8_t SeqLossTracker::getWorst(SeqLossReport* out, uint8_t maxCount) const {
+    uint8_t count = 0;
+    table.forEach([&](uint64_t key, const SeqLossEntry& entry) {
+        if (entry.lost == 0) {
+            return;
+        }
+        
+        // Insertion into a short sorted list
+        uint8_t pos = count;
+        while (pos > 0 && out[pos - 1].lost < entry.lost) {
+            pos--;
+        }
+        if (pos >= maxCount) {
+            return;
+        }
+        uint8_t last = count < maxCount ? count : maxCount - 1;
+        for (uint8_t i = last; i > pos; i--) {
+            out[i] = out[i - 1];
+        }
+        
+        SeqLossReport& report = out[pos];
+        keyToMac(key, report.mac);
+        report.tid = (int8_t)((key >> SEQ_KEY_TID) & 0x1F) - 1;
+        report.received = entry.received;
+        report.lost = entry.lost;
+        if (count < maxCount) {
+            count++;
+        }
+    });
+    return count;
+}
@@ -0,0 +1,755 @@
+/**
+ * Storage implementation
+ */
+
+#include "Storage.h"
+#include "PipelineMetrics.h"
+#include <string.h>
+
+#ifdef ARDUINO
+#include <SD_MMC.h>
+#include <esp_heap_caps.h>
+#define STORAGE_LOG(...) Serial.printf(__VA_ARGS__)
+#else
+#include <stdlib.h>
+#include <chrono>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <unistd.h>
+#define STORAGE_LOG(...) printf(__VA_ARGS__)
+#endif
+
+// Streams
+StorageStream::StorageStream() :
+    owner(nullptr),
+    file(),
+    open(false),
+    closing(false),
+    current(-1),
+    bytesQueued(0),
+    bytesDropped(0) {
+    path[0] = '\0';
+}
+
+bool StorageStream::write(const void* data, size_t len, uint32_t waitMs) {
+    return writeRecord(data, len, nullptr, 0, waitMs);
+}
+
+bool StorageStream::writeRecord(const void* head, size_t headLen, const void* body, size_t bodyLen, uint32_t waitMs) {
+    if (!owner || !isOpen()) {
+        return false;
+    }
+    return owner->append(this, head, headLen, body, bodyLen, waitMs);
+}
+
+void StorageStream::flush() {
+    if (!owner || !isOpen()) {
+        return;
+    }
+    if (owner->lockStreams(STORAGE_WAIT_FOREVER)) {
+        if (current >= 0) {
+            owner->submitCurrent(this, false);
+        }
+        owner->unlockStreams();
+    }
+}
+
+void StorageStream::sync() {
+    if (!owner || !isOpen()) {
+        return;
+    }
+    if (owner->lockStreams(STORAGE_WAIT_FOREVER)) {
+        owner->submitCurrent(this, false, true);
+        owner->unlockStreams();
+    }
+}
+
+void StorageStream::close() {
+    if (!owner || !isOpen()) {
+        return;
+    }
+    if (owner->lockStreams(STORAGE_WAIT_FOREVER)) {
+        closing = true;
+        owner->submitCurrent(this, true);
+        owner->unlockStreams();
+    }
+}
+
+// Storage
+Storage::Storage() :
+    mounted(false),
+    totalBytes(0),
+    usedBytes(0),
+    writeSpeedKBps(0),
+    blockMemory(nullptr)
+#ifdef ARDUINO
+    ,
+    freeQueue(nullptr),
+    pendingQueue(nullptr),
+    streamLock(nullptr),
+    ioTask(nullptr)
+#else
+    ,
+    stopping(false)
+#endif
+    {
+    memset(blocks, 0, sizeof(blocks));
+    memset(blockUsed, 0, sizeof(blockUsed));
+    memset(blockStream, 0, sizeof(blockStream));
+    memset(blockClose, 0, sizeof(blockClose));
+    memset(blockSync, 0, sizeof(blockSync));
+    memset(&stats, 0, sizeof(stats));
+}
+
+Storage::~Storage() {
+    end();
+    
+    // Kept across remounts so the DMA-capable blocks are only carved out once
+    if (blockMemory) {
+#ifdef ARDUINO
+        heap_caps_free(blockMemory);
+#else
+        free(blockMemory);
+#endif
+        blockMemory = nullptr;
+    }
+}
+
+bool Storage::begin() {
+    if (mounted) {
+        return true;
+    }
+    
+    if (!backendMount()) {
+        STORAGE_LOG("Storage: no card mounted\n");
+        return false;
+    }
+    
+    if (!startIO()) {
+        STORAGE_LOG("Storage: failed to start I/O task\n");
+        backendUnmount();
+        return false;
+    }
+    
+    mounted = true;
+    backendRefreshUsage();
+    measureWriteSpeed();
+    
+    STORAGE_LOG("Storage mounted: %lu MB total, %lu MB used, write %lu KB/s\n",
+                (unsigned long)(totalBytes >> 20), (unsigned long)(usedBytes >> 20),
+                (unsigned long)writeSpeedKBps);
+    return true;
+}
+
+void Storage::end() {
+    if (!mounted) {
+        return;
+    }
+    
+    for (size_t i = 0; i < STORAGE_MAX_STREAMS; i++) {
+        streams[i].close();
+    }
+    stopIO();
+    backendUnmount();
+    mounted = false;
+}
+
+size_t Storage::getOpenStreamCount() const {
+    size_t count = 0;
+    for (size_t i = 0; i < STORAGE_MAX_STREAMS; i++) {
+        if (streams[i].open) {
+            count++;
+        }
+    }
+    return count;
+}
+
+StorageStream* Storage::openAppend(const char* path, bool truncate) {
+    // Paths are relative to the card root; accept them with or without the slash
+    char fullPath[STORAGE_PATH_MAX];
+    int len = snprintf(fullPath, sizeof(fullPath), "%s%s", path[0] == '/' ? "" : "/", path);
+    if (!mounted || len >= STORAGE_PATH_MAX) {
+        return nullptr;
+    }
+    
+    StorageStream* stream = nullptr;
+    for (size_t i = 0; i < STORAGE_MAX_STREAMS; i++) {
+        if (!streams[i].open) {
+            stream = &streams[i];
+            break;
+        }
+    }
+    if (!stream) {
+        STORAGE_LOG("Storage: no free stream for %s\n", fullPath);
+        return nullptr;
+    }
+    
+    StorageFile file = backendOpen(fullPath, truncate);
+    if (!file) {
+        STORAGE_LOG("Storage: failed to open %s\n", fullPath);
+        return nullptr;
+    }
+    
+    lockStreams(STORAGE_WAIT_FOREVER);
+    stream->owner = this;
+    stream->file = file;
+    stream->current = -1;
+    stream->bytesQueued = 0;
+    stream->bytesDropped = 0;
+    memcpy(stream->path, fullPath, len + 1);
+    stream->closing = false;
+    stream->open = true;
+    unlockStreams();
+    
+    return stream;
+}
+
+bool Storage::remove(const char* path) {
+    return mounted && backendRemove(path);
+}
+
+bool Storage::exists(const char* path) {
+    return mounted && backendExists(path);
+}
+
+bool Storage::append(StorageStream* stream, const void* head, size_t headLen,
+                     const void* body, size_t bodyLen, uint32_t waitMs) {
+    size_t total = headLen + bodyLen;
+    uint32_t start = nowMicros();
+    PIPE_START_ANY_CORE(queueStart);
+    
+    if (!lockStreams(waitMs)) {
+        stream->bytesDropped += total;
+        stats.bytesDropped += total;
+        PIPE_DROP(PIPE_STAGE_QUEUE);
+        return false;
+    }
+    
+    // Work out how many fresh blocks the record needs, and only start
+    // copying once they are all available so a record is never split by a drop
+    size_t room = stream->current >= 0 ? STORAGE_BLOCK_SIZE - blockUsed[stream->current] : 0;
+    size_t needed = total > room ? (total - room + STORAGE_BLOCK_SIZE - 1) / STORAGE_BLOCK_SIZE : 0;
+    
+    while (getFreeBlockCount() < needed) {
+        // Blocks held by open streams only come back when those streams write
+        // again, so a record needing more than the rest could wait forever;
+        // drop it at once instead
+        bool fits = needed <= STORAGE_BLOCK_COUNT - getHeldBlockCount();
+        if (!fits || waitMs == 0 || nowMicros() - start >= waitMs * 1000) {
+            unlockStreams();
+            stream->bytesDropped += total;
+            stats.bytesDropped += total;
+            PIPE_DROP(PIPE_STAGE_QUEUE);
+            return false;
+        }
+        unlockStreams();
+#ifdef ARDUINO
+        vTaskDelay(1);
+#else
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+#endif
+        lockStreams(STORAGE_WAIT_FOREVER);
+        room = stream->current >= 0 ? STORAGE_BLOCK_SIZE - blockUsed[stream->current] : 0;
+        needed = total > room ? (total - room + STORAGE_BLOCK_SIZE - 1) / STORAGE_BLOCK_SIZE : 0;
+    }
+    
+    const uint8_t* parts[2] = {(const uint8_t*)head, (const uint8_t*)body};
+    size_t lengths[2] = {headLen, bodyLen};
+    for (int p = 0; p < 2; p++) {
+        const uint8_t* src = parts[p];
+        size_t len = lengths[p];
+        while (len > 0) {
+            if (stream->current < 0) {
+                uint8_t index;
+                takeFreeBlock(&index, 0);   // Reserved above, can't fail
+                blockUsed[index] = 0;
+                blockStream[index] = stream - streams;
+                blockClose[index] = false;
+                blockSync[index] = false;
+                stream->current = index;
+            }
+            uint8_t index = stream->current;
+            size_t n = STORAGE_BLOCK_SIZE - blockUsed[index];
+            if (n > len) {
+                n = len;
+            }
+            memcpy(blocks[index] + blockUsed[index], src, n);
+            blockUsed[index] += n;
+            src += n;
+            len -= n;
+            if (blockUsed[index] == STORAGE_BLOCK_SIZE) {
+                submitCurrent(stream, false);
+            }
+        }
+    }
+    stream->bytesQueued += total;
+    
+    unlockStreams();
+    PIPE_STOP_ANY_CORE(PIPE_STAGE_QUEUE, queueStart);
+    return true;
+}
+
+size_t Storage::getHeldBlockCount() const {
+    // Called with the stream lock held
+    size_t count = 0;
+    for (size_t i = 0; i < STORAGE_MAX_STREAMS; i++) {
+        if (streams[i].current >= 0) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void Storage::submitCurrent(StorageStream* stream, bool close, bool sync) {
+    // Called with the stream lock held
+    int8_t index = stream->current;
+    if (index < 0) {
+        if (!close && !sync) {
+            return;
+        }
+        // Closing or syncing needs a block to carry the marker through the queue
+        uint8_t marker;
+        if (!takeFreeBlock(&marker, STORAGE_WAIT_FOREVER)) {
+            return;
+        }
+        index = marker;
+        blockUsed[index] = 0;
+        blockStream[index] = stream - streams;
+    }
+    blockClose[index] = close;
+    blockSync[index] = sync;
+    stream->current = -1;
+    queueBlock(index);
+}
+
+void Storage::ioLoop() {
+    uint8_t index;
+    while (nextPendingBlock(&index)) {
+        writeBlock(index);
+        returnBlock(index);
+    }
+}
+
+void Storage::writeBlock(uint8_t index) {
+    StorageStream* stream = &streams[blockStream[index]];
+    size_t len = blockUsed[index];
+    
+    uint32_t start = nowMicros();
+    if (len > 0) {
+        size_t written = backendWrite(stream->file, blocks[index], len);
+        stats.bytesWritten += written;
+        stats.blocksWritten++;
+        if (written != len) {
+            stats.writeErrors++;
+            STORAGE_LOG("Storage: short write on %s (%u of %u)\n",
+                        stream->path, (unsigned)written, (unsigned)len);
+        }
+    }
+    
+    // Blocks are written in queue order, so everything queued before a sync is on the card after it
+    if (blockSync[index] && !blockClose[index]) {
+        backendSync(stream->file);
+    }
+    
+    if (len > 0 || blockSync[index]) {
+        uint32_t elapsed = nowMicros() - start;
+        stats.writeTimeUs += elapsed;
+        if (elapsed > stats.writeMaxUs) {
+            stats.writeMaxUs = elapsed;
+        }
+    }
+    
+    // No writer touches a closing stream, so the slot can be released without the lock
+    if (blockClose[index]) {
+        backendClose(stream->file);
+        stream->closing = false;
+        stream->open = false;
+    }
+}
+
+void Storage::measureWriteSpeed() {
+    StorageFile file = backendOpen(STORAGE_SPEED_TEST_FILE, true);
+    if (!file) {
+        return;
+    }
+    
+    // Goes straight to the backend with the first block as scratch, before any stream exists
+    uint8_t* scratch = blocks[0];
+    memset(scratch, 0xA5, STORAGE_BLOCK_SIZE);
+    
+    uint32_t start = nowMicros();
+    size_t written = 0;
+    while (written < STORAGE_SPEED_TEST_BYTES) {
+        size_t n = backendWrite(file, scratch, STORAGE_BLOCK_SIZE);
+        if (n == 0) {
+            break;
+        }
+        written += n;
+    }
+    backendClose(file);
+    uint32_t elapsed = nowMicros() - start;
+    backendRemove(STORAGE_SPEED_TEST_FILE);
+    
+    writeSpeedKBps = elapsed ? (uint32_t)((uint64_t)written * 1000000 / elapsed / 1024) : 0;
+}
+
+#ifdef ARDUINO
+
+// SD_MMC backend
+bool Storage::backendMount() {
+    SD_MMC.setPins(SD_PIN_CLK, SD_PIN_CMD, SD_PIN_D0);
+    if (!SD_MMC.begin(STORAGE_MOUNT_POINT, true)) {
+        return false;
+    }
+    if (SD_MMC.cardType() == CARD_NONE) {
+        SD_MMC.end();
+        return false;
+    }
+    return true;
+}
+
+void Storage::backendUnmount() {
+    SD_MMC.end();
+}
+
+void Storage::backendRefreshUsage() {
+    totalBytes = SD_MMC.totalBytes();
+    usedBytes = SD_MMC.usedBytes();
+}
+
+StorageFile Storage::backendOpen(const char* path, bool truncate) {
+    return SD_MMC.open(path, truncate ? FILE_WRITE : FILE_APPEND);
+}
+
+size_t Storage::backendWrite(StorageFile& file, const uint8_t* data, size_t len) {
+    return file.write(data, len);
+}
+
+void Storage::backendSync(StorageFile& file) {
+    // The VFS flush is fflush plus fsync, which also writes the directory entry
+    file.flush();
+}
+
+void Storage::backendClose(StorageFile& file) {
+    file.close();
+}
+
+bool Storage::backendRemove(const char* path) {
+    return SD_MMC.remove(path);
+}
+
+bool Storage::backendExists(const char* path) {
+    return SD_MMC.exists(path);
+}
+
+size_t Storage::readFile(const char* path, uint32_t offset, uint8_t* data, size_t len) {
+    if (!mounted) {
+        return 0;
+    }
+    File file = SD_MMC.open(path, FILE_READ);
+    if (!file) {
+        return 0;
+    }
+    size_t n = 0;
+    if (file.seek(offset)) {
+        n = file.read(data, len);
+    }
+    file.close();
+    return n;
+}
+
+uint32_t Storage::fileSize(const char* path) {
+    if (!mounted) {
+        return 0;
+    }
+    File file = SD_MMC.open(path, FILE_READ);
+    if (!file) {
+        return 0;
+    }
+    uint32_t size = file.size();
+    file.close();
+    return size;
+}
+
+uint32_t Storage::nowMicros() const {
+    return micros();
+}
+
+// FreeRTOS queues of block indices; the I/O task blocks on the pending queue
+bool Storage::startIO() {
+    if (!blockMemory) {
+        blockMemory = (uint8_t*)heap_caps_aligned_alloc(STORAGE_BLOCK_ALIGN,
+            STORAGE_BLOCK_SIZE * STORAGE_BLOCK_COUNT, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+        if (!blockMemory) {
+            return false;
+        }
+    }
+    
+    // One extra pending slot for the stop marker
+    freeQueue = xQueueCreate(STORAGE_BLOCK_COUNT, sizeof(uint8_t));
+    pendingQueue = xQueueCreate(STORAGE_BLOCK_COUNT + 1, sizeof(uint8_t));
+    streamLock = xSemaphoreCreateMutex();
+    if (!freeQueue || !pendingQueue || !streamLock) {
+        return false;
+    }
+    
+    for (uint8_t i = 0; i < STORAGE_BLOCK_COUNT; i++) {
+        blocks[i] = blockMemory + i * STORAGE_BLOCK_SIZE;
+        xQueueSend(freeQueue, &i, 0);
+    }
+    
+    return xTaskCreatePinnedToCore(ioTaskEntry, "storage", STORAGE_TASK_STACK_SIZE,
+                                   this, STORAGE_TASK_PRIORITY, &ioTask, tskNO_AFFINITY) == pdPASS;
+}
+
+void Storage::stopIO() {
+    // The marker queues behind any pending blocks, so those still get written
+    uint8_t marker = STORAGE_STOP_MARKER;
+    xQueueSend(pendingQueue, &marker, portMAX_DELAY);
+    while (ioTask) {
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+    vQueueDelete(freeQueue);
+    vQueueDelete(pendingQueue);
+    vSemaphoreDelete(streamLock);
+    freeQueue = nullptr;
+    pendingQueue = nullptr;
+    streamLock = nullptr;
+}
+
+void Storage::ioTaskEntry(void* arg) {
+    Storage* storage = static_cast<Storage*>(arg);
+    storage->ioLoop();
+    storage->ioTask = nullptr;
+    vTaskDelete(nullptr);
+}
+
+bool Storage::lockStreams(uint32_t waitMs) {
+    TickType_t ticks = waitMs == STORAGE_WAIT_FOREVER ? portMAX_DELAY : pdMS_TO_TICKS(waitMs);
+    return xSemaphoreTake(streamLock, ticks) == pdTRUE;
+}
+
+void Storage::unlockStreams() {
+    xSemaphoreGive(streamLock);
+}
+
+bool Storage::takeFreeBlock(uint8_t* index, uint32_t waitMs) {
+    TickType_t ticks = waitMs == STORAGE_WAIT_FOREVER ? portMAX_DELAY : pdMS_TO_TICKS(waitMs);
+    return xQueueReceive(freeQueue, index, ticks) == pdTRUE;
+}
+
+size_t Storage::getFreeBlockCount() {
+    return uxQueueMessagesWaiting(freeQueue);
+}
+
+void Storage::queueBlock(uint8_t index) {
+    // Depth equals the block count, so this never waits
+    xQueueSend(pendingQueue, &index, portMAX_DELAY);
+    uint8_t pending = uxQueueMessagesWaiting(pendingQueue);
+    if (pending > stats.pendingHigh) {
+        stats.pendingHigh = pending;
+    }
+}
+
+bool Storage::nextPendingBlock(uint8_t* index) {
+    if (xQueueReceive(pendingQueue, index, portMAX_DELAY) != pdTRUE) {
+        return false;
+    }
+    return *index != STORAGE_STOP_MARKER;
+}
+
+void Storage::returnBlock(uint8_t index) {
+    xQueueSend(freeQueue, &index, 0);
+}
+
+#else
+
+// POSIX backend for host builds, rooted at MCT_STORAGE_ROOT
+static void hostPath(char* out, size_t size, const char* root, const char* path) {
+    snprintf(out, size, "%s%s%s", root, path[0] == '/' ? "" : "/", path);
+}
+
+bool Storage::backendMount() {
+    const char* root = getenv("MCT_STORAGE_ROOT");
+    snprintf(hostRoot, sizeof(hostRoot), "%s", root ? root : STORAGE_HOST_ROOT);
+    mkdir(hostRoot, 0755);
+    
+    struct stat st;
+    return stat(hostRoot, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+void Storage::backendUnmount() {
+}
+
+void Storage::backendRefreshUsage() {
+    struct statvfs fs;
+    if (statvfs(hostRoot, &fs) == 0) {
+        totalBytes = (uint64_t)fs.f_blocks * fs.f_frsize;
+        usedBytes = (uint64_t)(fs.f_blocks - fs.f_bfree) * fs.f_frsize;
+    }
+}
+
+StorageFile Storage::backendOpen(const char* path, bool truncate) {
+    char full[STORAGE_PATH_MAX * 2];
+    hostPath(full, sizeof(full), hostRoot, path);
+    return fopen(full, truncate ? "wb" : "ab");
+}
+
+size_t Storage::backendWrite(StorageFile& file, const uint8_t* data, size_t len) {
+    return fwrite(data, 1, len, file);
+}
+
+void Storage::backendSync(StorageFile& file) {
+    if (file) {
+        fflush(file);
+        fsync(fileno(file));
+    }
+}
+
+void Storage::backendClose(StorageFile& file) {
+    if (file) {
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+bool Storage::backendRemove(const char* path) {
+    char full[STORAGE_PATH_MAX * 2];
+    hostPath(full, sizeof(full), hostRoot, path);
+    return unlink(full) == 0;
+}
+
+bool Storage::backendExists(const char* path) {
+    char full[STORAGE_PATH_MAX * 2];
+    hostPath(full, sizeof(full), hostRoot, path);
+    return access(full, F_OK) == 0;
+}
+
+size_t Storage::readFile(const char* path, uint32_t offset, uint8_t* data, size_t len) {
+    if (!mounted) {
+        return 0;
+    }
+    char full[STORAGE_PATH_MAX * 2];
+    hostPath(full, sizeof(full), hostRoot, path);
+    FILE* file = fopen(full, "rb");
+    if (!file) {
+        return 0;
+    }
+    size_t n = 0;
+    if (fseek(file, offset, SEEK_SET) == 0) {
+        n = fread(data, 1, len, file);
+    }
+    fclose(file);
+    return n;
+}
+
+uint32_t Storage::fileSize(const char* path) {
+    if (!mounted) {
+        return 0;
+    }
+    char full[STORAGE_PATH_MAX * 2];
+    hostPath(full, sizeof(full), hostRoot, path);
+    struct stat st;
+    return stat(full, &st) == 0 ? (uint32_t)st.st_size : 0;
+}
+
+uint32_t Storage::nowMicros() const {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Mutex/condition variable queues with a std::thread as the I/O task
+bool Storage::startIO() {
+    if (!blockMemory) {
+        if (posix_memalign((void**)&blockMemory, STORAGE_BLOCK_ALIGN,
+                           STORAGE_BLOCK_SIZE * STORAGE_BLOCK_COUNT) != 0) {
+            blockMemory = nullptr;
+            return false;
+        }
+    }
+    
+    freeBlocks.clear();
+    pendingBlocks.clear();
+    for (uint8_t i = 0; i < STORAGE_BLOCK_COUNT; i++) {
+        blocks[i] = blockMemory + i * STORAGE_BLOCK_SIZE;
+        freeBlocks.push_back(i);
+    }
+    
+    stopping = false;
+    ioThread = std::thread(&Storage::ioLoop, this);
+    return true;
+}
+
+void Storage::stopIO() {
+    {
+        std::lock_guard<std::mutex> guard(queueLock);
+        stopping = true;
+    }
+    queueSignal.notify_all();
+    if (ioThread.joinable()) {
+        ioThread.join();
+    }
+}
+
+bool Storage::lockStreams(uint32_t waitMs) {
+    if (waitMs == STORAGE_WAIT_FOREVER) {
+        streamLock.lock();
+        return true;
+    }
+    return streamLock.try_lock_for(std::chrono::milliseconds(waitMs));
+}
+
+void Storage::unlockStreams() {
+    streamLock.unlock();
+}
+
+bool Storage::takeFreeBlock(uint8_t* index, uint32_t waitMs) {
+    std::unique_lock<std::mutex> guard(queueLock);
+    auto ready = [this] { return !freeBlocks.empty(); };
+    if (waitMs == STORAGE_WAIT_FOREVER) {
+        queueSignal.wait(guard, ready);
+    } else if (!queueSignal.wait_for(guard, std::chrono::milliseconds(waitMs), ready)) {
+        return false;
+    }
+    *index = freeBlocks.front();
+    freeBlocks.pop_front();
+    return true;
+}
+
+size_t Storage::getFreeBlockCount() {
+    std::lock_guard<std::mutex> guard(queueLock);
+    return freeBlocks.size();
+}
+
+void Storage::queueBlock(uint8_t index) {
+    {
+        std::lock_guard<std::mutex> guard(queueLock);
+        pendingBlocks.push_back(index);
+        if (pendingBlocks.size() > stats.pendingHigh) {
+            stats.pendingHigh = pendingBlocks.size();
+        }
+    }
+    queueSignal.notify_all();
+}
+
+bool Storage::nextPendingBlock(uint8_t* index) {
+    // Drains everything queued before a stop request
+    std::unique_lock<std::mutex> guard(queueLock);
+    queueSignal.wait(guard, [this] { return !pendingBlocks.empty() || stopping; });
+    if (pendingBlocks.empty()) {
+        return false;
+    }
+    *index = pendingBlocks.front();
+    pendingBlocks.pop_front();
+    return true;
+}
+
+void Storage::returnBlock(uint8_t index) {
+    {
+        std::lock_guard<std::mutex> guard(queueLock);
+        freeBlocks.push_back(index);
+    }
+    queueSignal.notify_all();
+}
+
+#endif
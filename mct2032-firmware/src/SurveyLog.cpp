@@ -0,0 +1,478 @@
+/**
+ * Survey Log implementation
+ */
+
+#include "SurveyLog.h"
+#include "Checksum.h"
+#include "MacTable.h"
+
+namespace {
+
+// Little-endian payload builder, bounded by SURVEY_MAX_PAYLOAD
+struct PayloadWriter {
+    uint8_t data[SURVEY_MAX_PAYLOAD];
+    size_t len = 0;
+    
+    void u8(uint8_t v) { if (len < sizeof(data)) data[len++] = v; }
+    void u16(uint16_t v) { u8(v); u8(v >> 8); }
+    void u32(uint32_t v) { u16(v); u16(v >> 16); }
+    void bytes(const void* p, size_t n) {
+        if (n > sizeof(data) - len) n = sizeof(data) - len;
+        memcpy(data + len, p, n);
+        len += n;
+    }
+};
+
+struct PayloadReader {
+    const uint8_t* data;
+    size_t len;
+    size_t pos = 0;
+    
+    PayloadReader(const uint8_t* d, size_t n) : data(d), len(n) {}
+    bool ok(size_t n) const { return pos + n <= len; }
+    uint8_t u8() { return ok(1) ? data[pos++] : 0; }
+    uint16_t u16() { uint16_t lo = u8(); return lo | ((uint16_t)u8() << 8); }
+    uint32_t u32() { uint32_t lo = u16(); return lo | ((uint32_t)u16() << 16); }
+};
+
+}
+
+SurveyLog::SurveyLog(Storage* store, WiFiScanner* wifi, PacketMonitor* monitor, ChannelAnalyzer* analyzer) :
+    storage(store),
+    wifiScanner(wifi),
+    packetMonitor(monitor),
+    channelAnalyzer(analyzer),
+    stream(nullptr),
+    indexStream(nullptr),
+    logOffset(0),
+    session(0),
+    recordsSinceCheckpoint(0),
+    bytesSinceCheckpoint(0),
+    recordsWritten(0),
+    checkpointsWritten(0),
+    writeFailures(0),
+    wasMonitoring(false),
+    lastStatsTime(0) {
+    memset(&totals, 0, sizeof(totals));
+    memset(&replay, 0, sizeof(replay));
+    memset(lastCounters, 0, sizeof(lastCounters));
+}
+
+bool SurveyLog::begin() {
+    if (!storage->isMounted() || stream) {
+        return false;
+    }
+    
+    // Replay from the newest good checkpoint; scanning forward past torn or
+    // corrupt bytes means a crash mid-record costs at most that record
+    uint32_t started = millis();
+    uint32_t size = storage->fileSize(SURVEY_LOG_FILE);
+    uint32_t offset = findReplayStart();
+    replay.startOffset = offset;
+    
+    static uint8_t chunk[SURVEY_READ_CHUNK];
+    while (offset < size) {
+        uint32_t want = size - offset < SURVEY_READ_CHUNK ? size - offset : SURVEY_READ_CHUNK;
+        size_t n = storage->readFile(SURVEY_LOG_FILE, offset, chunk, want);
+        if (n < SURVEY_HEADER_SIZE) {
+            replay.skippedBytes += size - offset;
+            break;
+        }
+        
+        size_t pos = 0;
+        while (pos + SURVEY_HEADER_SIZE <= n) {
+            uint8_t type;
+            uint16_t len;
+            uint32_t crc;
+            if (!parseHeader(chunk + pos, &type, &len, &crc)) {
+                pos++;
+                replay.skippedBytes++;
+                continue;
+            }
+            if (pos + SURVEY_HEADER_SIZE + len > n) {
+                break;      // Straddles the chunk; re-read from here
+            }
+            const uint8_t* payload = chunk + pos + SURVEY_HEADER_SIZE;
+            if (recordChecksum(chunk + pos, payload, len) != crc) {
+                pos++;
+                replay.skippedBytes++;
+                continue;
+            }
+            applyRecord(type, payload, len);
+            replay.records++;
+            pos += SURVEY_HEADER_SIZE + len;
+        }
+        
+        if (pos == 0) {
+            // A header promising more than the file holds: the torn tail
+            replay.skippedBytes += size - offset;
+            break;
+        }
+        offset += pos;
+    }
+    replay.durationMs = millis() - started;
+    
+    stream = storage->openAppend(SURVEY_LOG_FILE);
+    indexStream = storage->openAppend(SURVEY_INDEX_FILE);
+    if (!stream || !indexStream) {
+        end();
+        Serial.println("Survey log: failed to open log files");
+        return false;
+    }
+    logOffset = size;
+    
+    Serial.printf("Survey log: replayed %lu records from offset %lu in %lu ms (%lu bytes skipped), %d APs\n",
+                  replay.records, replay.startOffset, replay.durationMs, replay.skippedBytes,
+                  (int)wifiScanner->getNetworkCount());
+    
+    // New session, checkpointed right away so the next boot replays little
+    session++;
+    PayloadWriter p;
+    p.u32(session);
+    writeRecord(SURVEY_REC_SESSION, p.data, p.len);
+    readCounters(lastCounters);
+    checkpoint();
+    return true;
+}
+
+void SurveyLog::end() {
+    if (stream) {
+        stream->close();
+        stream = nullptr;
+    }
+    if (indexStream) {
+        indexStream->close();
+        indexStream = nullptr;
+    }
+}
+
+uint32_t SurveyLog::currentOffset() const {
+    return logOffset + (stream ? stream->getBytesQueued() : 0);
+}
+
+bool SurveyLog::writeRecord(uint8_t type, const uint8_t* payload, size_t len) {
+    if (!stream || len > SURVEY_MAX_PAYLOAD) {
+        return false;
+    }
+    
+    uint8_t header[SURVEY_HEADER_SIZE];
+    uint32_t now = millis();
+    header[0] = SURVEY_RECORD_MAGIC;
+    header[1] = type;
+    header[2] = (uint8_t)len;
+    header[3] = (uint8_t)(len >> 8);
+    header[4] = (uint8_t)now;
+    header[5] = (uint8_t)(now >> 8);
+    header[6] = (uint8_t)(now >> 16);
+    header[7] = (uint8_t)(now >> 24);
+    uint32_t crc = recordChecksum(header, payload, len);
+    header[8] = (uint8_t)crc;
+    header[9] = (uint8_t)(crc >> 8);
+    header[10] = (uint8_t)(crc >> 16);
+    header[11] = (uint8_t)(crc >> 24);
+    
+    if (!stream->writeRecord(header, sizeof(header), payload, len, SURVEY_WRITE_WAIT_MS)) {
+        writeFailures++;
+        return false;
+    }
+    
+    recordsWritten++;
+    recordsSinceCheckpoint++;
+    bytesSinceCheckpoint += sizeof(header) + len;
+    return true;
+}
+
+bool SurveyLog::writeNetwork(const NetworkInfo& net) {
+    PayloadWriter p;
+    uint8_t mac[6] = {0};
+    parseMac(net.bssid.c_str(), mac);
+    p.bytes(mac, sizeof(mac));
+    p.u8(net.channel);
+    p.u8((uint8_t)(int8_t)net.rssi);
+    p.u8((uint8_t)net.encryptionType);
+    p.u8(net.hidden ? 1 : 0);
+    size_t ssidLen = net.ssid.length() > 32 ? 32 : net.ssid.length();
+    p.u8(ssidLen);
+    p.bytes(net.ssid.c_str(), ssidLen);
+    return writeRecord(SURVEY_REC_AP, p.data, p.len);
+}
+
+void SurveyLog::writeNetworks(const std::vector<NetworkInfo>& networks) {
+    for (const auto& net : networks) {
+        writeNetwork(net);
+    }
+}
+
+void SurveyLog::logScan(uint8_t channel) {
+    if (!stream) {
+        return;
+    }
+    
+    const std::vector<NetworkInfo>& networks = wifiScanner->getResults();
+    PayloadWriter p;
+    p.u8(channel);
+    p.u16(networks.size());
+    writeRecord(SURVEY_REC_SCAN, p.data, p.len);
+    writeNetworks(networks);
+    stream->sync();
+    totals.scans++;
+}
+
+void SurveyLog::logAlert(uint8_t kind, uint8_t severity, const uint8_t* mac, const char* text) {
+    if (!stream) {
+        return;
+    }
+    
+    PayloadWriter p;
+    p.u8(kind);
+    p.u8(severity);
+    uint8_t zero[6] = {0};
+    p.bytes(mac ? mac : zero, 6);
+    size_t textLen = strlen(text);
+    if (textLen > SURVEY_MAX_PAYLOAD - 9) {
+        textLen = SURVEY_MAX_PAYLOAD - 9;
+    }
+    p.u8(textLen);
+    p.bytes(text, textLen);
+    writeRecord(SURVEY_REC_ALERT, p.data, p.len);
+    stream->sync();
+    totals.alerts++;
+}
+
+void SurveyLog::readCounters(uint32_t* counters) const {
+    counters[0] = packetMonitor->getPacketsTotal();
+    counters[1] = packetMonitor->getBeaconCount();
+    counters[2] = packetMonitor->getProbeCount();
+    counters[3] = packetMonitor->getDeauthCount();
+    counters[4] = packetMonitor->getDataCount();
+    counters[5] = packetMonitor->getMgmtCount();
+}
+
+void SurveyLog::logStats() {
+    uint32_t counters[6];
+    readCounters(counters);
+    
+    uint32_t delta[6];
+    bool changed = false;
+    for (int i = 0; i < 6; i++) {
+        delta[i] = counters[i] - lastCounters[i];
+        changed |= delta[i] != 0;
+    }
+    if (!changed) {
+        return;
+    }
+    
+    PayloadWriter p;
+    for (int i = 0; i < 6; i++) {
+        p.u32(delta[i]);
+    }
+    p.u32(millis() - lastStatsTime);
+    if (!writeRecord(SURVEY_REC_STATS, p.data, p.len)) {
+        return;     // Keep the baseline so the next record carries these counts
+    }
+    stream->sync();
+    
+    memcpy(lastCounters, counters, sizeof(lastCounters));
+    totals.packets += delta[0];
+    totals.beacons += delta[1];
+    totals.probes += delta[2];
+    totals.deauths += delta[3];
+    totals.data += delta[4];
+    totals.mgmt += delta[5];
+}
+
+void SurveyLog::checkpoint() {
+    if (!stream) {
+        return;
+    }
+    
+    uint32_t offset = currentOffset();
+    const std::vector<NetworkInfo>& networks = wifiScanner->getResults();
+    
+    PayloadWriter p;
+    p.u32(session);
+    p.u32(totals.packets);
+    p.u32(totals.beacons);
+    p.u32(totals.probes);
+    p.u32(totals.deauths);
+    p.u32(totals.data);
+    p.u32(totals.mgmt);
+    p.u32(totals.scans);
+    p.u32(totals.alerts);
+    p.u16(networks.size());
+    if (!writeRecord(SURVEY_REC_CHECKPOINT, p.data, p.len)) {
+        return;
+    }
+    writeNetworks(networks);
+    
+    // The I/O task works in queue order: the log reaches the card before the
+    // index entry is written, and the entry is synced behind it
+    stream->sync();
+    uint8_t entry[4] = {(uint8_t)offset, (uint8_t)(offset >> 8), (uint8_t)(offset >> 16), (uint8_t)(offset >> 24)};
+    indexStream->write(entry, sizeof(entry), SURVEY_WRITE_WAIT_MS);
+    indexStream->sync();
+    
+    recordsSinceCheckpoint = 0;
+    bytesSinceCheckpoint = 0;
+    checkpointsWritten++;
+}
+
+void SurveyLog::service() {
+    if (!stream) {
+        return;
+    }
+    
+    uint32_t now = millis();
+    bool monitoring = packetMonitor->isMonitoring();
+    if (monitoring && !wasMonitoring) {
+        // Counters restart with every monitor session
+        memset(lastCounters, 0, sizeof(lastCounters));
+        lastStatsTime = now;
+    } else if ((monitoring && now - lastStatsTime >= SURVEY_STATS_INTERVAL) ||
+               (!monitoring && wasMonitoring)) {
+        logStats();
+        lastStatsTime = now;
+    }
+    wasMonitoring = monitoring;
+    
+    if (recordsSinceCheckpoint >= SURVEY_CHECKPOINT_RECORDS ||
+        bytesSinceCheckpoint >= SURVEY_CHECKPOINT_BYTES) {
+        checkpoint();
+    }
+}
+
+// Replay
+uint32_t SurveyLog::findReplayStart() {
+    uint32_t logSize = storage->fileSize(SURVEY_LOG_FILE);
+    uint32_t entries = storage->fileSize(SURVEY_INDEX_FILE) / 4;
+    
+    // Newest entry first; fall back a few in case the last one is damaged
+    for (int tries = 0; entries > 0 && tries < 4; entries--, tries++) {
+        uint8_t entry[4];
+        if (storage->readFile(SURVEY_INDEX_FILE, (entries - 1) * 4, entry, sizeof(entry)) != sizeof(entry)) {
+            continue;
+        }
+        uint32_t offset = entry[0] | (entry[1] << 8) | (entry[2] << 16) | ((uint32_t)entry[3] << 24);
+        if (offset >= logSize) {
+            continue;
+        }
+        
+        uint8_t type;
+        uint8_t payload[SURVEY_MAX_PAYLOAD];
+        uint16_t len;
+        if (readRecordAt(offset, &type, payload, &len) && type == SURVEY_REC_CHECKPOINT) {
+            return offset;
+        }
+    }
+    return 0;
+}
+
+bool SurveyLog::readRecordAt(uint32_t offset, uint8_t* type, uint8_t* payload, uint16_t* len) {
+    uint8_t header[SURVEY_HEADER_SIZE];
+    uint32_t crc;
+    if (storage->readFile(SURVEY_LOG_FILE, offset, header, sizeof(header)) != sizeof(header) ||
+        !parseHeader(header, type, len, &crc)) {
+        return false;
+    }
+    if (storage->readFile(SURVEY_LOG_FILE, offset + sizeof(header), payload, *len) != *len) {
+        return false;
+    }
+    return recordChecksum(header, payload, *len) == crc;
+}
+
+void SurveyLog::clearNetworks() {
+    wifiScanner->clearResults();
+    channelAnalyzer->resetNetworks();
+}
+
+void SurveyLog::applyRecord(uint8_t type, const uint8_t* payload, uint16_t len) {
+    PayloadReader r(payload, len);
+    
+    switch (type) {
+        case SURVEY_REC_SESSION:
+            session = r.u32();
+            break;
+        
+        case SURVEY_REC_SCAN:
+            clearNetworks();
+            totals.scans++;
+            break;
+        
+        case SURVEY_REC_AP:
+            restoreNetwork(payload, len);
+            break;
+        
+        case SURVEY_REC_STATS:
+            totals.packets += r.u32();
+            totals.beacons += r.u32();
+            totals.probes += r.u32();
+            totals.deauths += r.u32();
+            totals.data += r.u32();
+            totals.mgmt += r.u32();
+            break;
+        
+        case SURVEY_REC_ALERT:
+            totals.alerts++;
+            break;
+        
+        case SURVEY_REC_CHECKPOINT:
+            session = r.u32();
+            totals.packets = r.u32();
+            totals.beacons = r.u32();
+            totals.probes = r.u32();
+            totals.deauths = r.u32();
+            totals.data = r.u32();
+            totals.mgmt = r.u32();
+            totals.scans = r.u32();
+            totals.alerts = r.u32();
+            clearNetworks();
+            break;
+    }
+}
+
+void SurveyLog::restoreNetwork(const uint8_t* payload, uint16_t len) {
+    PayloadReader r(payload, len);
+    if (!r.ok(11)) {
+        return;
+    }
+    
+    const uint8_t* mac = payload;
+    r.pos = 6;
+    NetworkInfo info;
+    char bssid[18];
+    snprintf(bssid, sizeof(bssid), "%02X:%02X:%02X:%02X:%02X:%02X",
+             mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
+    info.bssid = bssid;
+    info.channel = r.u8();
+    info.rssi = (int8_t)r.u8();
+    info.encryptionType = (wifi_auth_mode_t)r.u8();
+    info.hidden = r.u8() != 0;
+    info.vendor = OuiTable::lookup(mac);
+    
+    uint8_t ssidLen = r.u8();
+    char ssid[33];
+    if (ssidLen > 32 || !r.ok(ssidLen)) {
+        return;
+    }
+    memcpy(ssid, payload + r.pos, ssidLen);
+    ssid[ssidLen] = '\0';
+    info.ssid = ssid;
+    
+    wifiScanner->restoreNetwork(info);
+}
+
+bool SurveyLog::parseHeader(const uint8_t* header, uint8_t* type, uint16_t* len, uint32_t* crc) {
+    if (header[0] != SURVEY_RECORD_MAGIC) {
+        return false;
+    }
+    *type = header[1];
+    *len = header[2] | (header[3] << 8);
+    *crc = header[8] | (header[9] << 8) | (header[10] << 16) | ((uint32_t)header[11] << 24);
+    return *type >= SURVEY_REC_SESSION && *type <= SURVEY_REC_CHECKPOINT && *len <= SURVEY_MAX_PAYLOAD;
+}
+
+uint32_t SurveyLog::recordChecksum(const uint8_t* header, const uint8_t* payload, uint16_t len) {
+    // Covers type, length and time; the magic is implied and the CRC can't cover itself
+    uint32_t crc = crc32Update(CRC32_INIT, header + 1, 7);
+    return crc32Final(crc32Update(crc, payload, len));
+}
@@ -0,0 +1,188 @@
+/**
+ * Top Talkers implementation
+ */
+
+#include "TopTalkers.h"
+#include "MacTable.h"
+#include "Dot11.h"
+
+void TalkerSketch::add(uint64_t key, uint32_t amount) {
+    total += amount;
+    
+    uint8_t smallest = 0;
+    for (uint8_t i = 0; i < used; i++) {
+        if (counters[i].key == key) {
+            counters[i].count += amount;
+            return;
+        }
+        if (counters[i].count < counters[smallest].count) {
+            smallest = i;
+        }
+    }
+    
+    if (used < TALKER_CAPACITY) {
+        counters[used].key = key;
+        counters[used].count = amount;
+        counters[used].error = 0;
+        used++;
+        return;
+    }
+    
+    // Take over the smallest counter; what it held becomes the error bound
+    TalkerCounter& victim = counters[smallest];
+    victim.key = key;
+    victim.error = victim.count;
+    victim.count += amount;
+}
+
+const TalkerCounter* TalkerSketch::find(uint64_t key) const {
+    for (uint8_t i = 0; i < used; i++) {
+        if (counters[i].key == key) {
+            return &counters[i];
+        }
+    }
+    return nullptr;
+}
+
+uint32_t TalkerSketch::floor() const {
+    if (used < TALKER_CAPACITY) {
+        return 0;
+    }
+    uint32_t smallest = counters[0].count;
+    for (uint8_t i = 1; i < used; i++) {
+        if (counters[i].count < smallest) {
+            smallest = counters[i].count;
+        }
+    }
+    return smallest;
+}
+
+TopTalkers::TopTalkers() {
+    portMUX_INITIALIZE(&lock);
+    reset();
+}
+
+void TopTalkers::reset() {
+    uint32_t now = millis();
+    portENTER_CRITICAL(&lock);
+    for (uint8_t slot = 0; slot < TALKER_SLOTS; slot++) {
+        for (uint8_t r = 0; r < TALKER_RANKINGS; r++) {
+            sketches[slot][r].clear();
+        }
+        slotStart[slot] = now;
+    }
+    current = 0;
+    portEXIT_CRITICAL(&lock);
+}
+
+void TopTalkers::rotate(uint32_t now) {
+    // Called with the lock held
+    if (now - slotStart[current] < TALKER_SLOT_MS) {
+        return;
+    }
+    current = (current + 1) % TALKER_SLOTS;
+    for (uint8_t r = 0; r < TALKER_RANKINGS; r++) {
+        sketches[current][r].clear();
+    }
+    slotStart[current] = now;
+}
+
+void TopTalkers::observe(const uint8_t* frame, uint16_t len, uint16_t weight, uint32_t now) {
+    const uint8_t* tx = dot11Transmitter(frame, len);
+    const uint8_t* bssid = dot11Bssid(frame, len);
+    uint32_t bytes = (uint32_t)len * weight;
+    
+    portENTER_CRITICAL(&lock);
+    rotate(now);
+    TalkerSketch* slot = sketches[current];
+    if (tx && !(tx[0] & 0x01)) {
+        uint64_t key = macToKey(tx);
+        slot[TALKER_KIND_TX * 2 + TALKER_BY_FRAMES].add(key, weight);
+        slot[TALKER_KIND_TX * 2 + TALKER_BY_BYTES].add(key, bytes);
+    }
+    if (bssid && !(bssid[0] & 0x01)) {
+        uint64_t key = macToKey(bssid);
+        slot[TALKER_KIND_BSSID * 2 + TALKER_BY_FRAMES].add(key, weight);
+        slot[TALKER_KIND_BSSID * 2 + TALKER_BY_BYTES].add(key, bytes);
+    }
+    portEXIT_CRITICAL(&lock);
+}
+
+uint8_t TopTalkers::query(uint8_t kind, uint8_t by, TalkerResult* out, uint8_t k,
+                          uint32_t now, uint32_t* windowMs, uint32_t* total) {
+    uint8_t ranking = kind * 2 + by;
+    uint8_t live = 0;
+    uint32_t oldest = now;
+    
+    portENTER_CRITICAL(&lock);
+    rotate(now);
+    for (uint8_t slot = 0; slot < TALKER_SLOTS; slot++) {
+        if (now - slotStart[slot] >= TALKER_SLOTS * TALKER_SLOT_MS) {
+            continue;
+        }
+        if ((int32_t)(slotStart[slot] - oldest) < 0) {
+            oldest = slotStart[slot];
+        }
+        scratch[live++] = sketches[slot][ranking];
+    }
+    portEXIT_CRITICAL(&lock);
+    
+    *windowMs = now - oldest;
+    *total = 0;
+    uint32_t floors[TALKER_SLOTS];
+    for (uint8_t i = 0; i < live; i++) {
+        floors[i] = scratch[i].floor();
+        *total += scratch[i].total;
+    }
+    
+    if (k > TALKER_MAX_RESULTS) {
+        k = TALKER_MAX_RESULTS;
+    }
+    
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < live; i++) {
+        for (uint8_t c = 0; c < scratch[i].used; c++) {
+            uint64_t key = scratch[i].counters[c].key;
+            
+            // Each address once, from the first sub-window holding it
+            bool seen = false;
+            for (uint8_t j = 0; j < i && !seen; j++) {
+                seen = scratch[j].find(key) != nullptr;
+            }
+            if (seen) {
+                continue;
+            }
+            
+            // Bounds over the whole window
+            uint32_t upper = 0;
+            uint32_t lower = 0;
+            for (uint8_t j = 0; j < live; j++) {
+                const TalkerCounter* counter = j == i ? &scratch[i].counters[c] : scratch[j].find(key);
+                if (counter) {
+                    upper += counter->count;
+                    lower += counter->count - counter->error;
+                } else {
+                    upper += floors[j];
+                }
+            }
+            
+            uint8_t pos = count;
+            while (pos > 0 && out[pos - 1].count < upper) {
+                pos--;
+            }
+            if (pos >= k) {
+                continue;
+            }
+            for (uint8_t n = count < k ? count : k - 1; n > pos; n--) {
+                out[n] = out[n - 1];
+            }
+            keyToMac(key, out[pos].mac);
+            out[pos].count = upper;
+            out[pos].error = upper - lower;
+            if (count < k) {
+                count++;
+            }
+        }
+    }
+    return count;
+}
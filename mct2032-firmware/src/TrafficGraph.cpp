@@ -0,0 +1,202 @@
+/**
+ * Traffic Graph implementation
+ */
+
+#include "TrafficGraph.h"
+#include "Dot11.h"
+
+#define AC_BK   0
+#define AC_BE   1
+#define AC_VI   2
+#define AC_VO   3
+
+// 802.11 user priority -> access category
+const uint8_t TrafficGraph::tidToAc[8] = {AC_BE, AC_BK, AC_BK, AC_BE, AC_VI, AC_VI, AC_VO, AC_VO};
+
+TrafficGraph::TrafficGraph() {
+    portMUX_INITIALIZE(&lock);
+    reset();
+}
+
+void TrafficGraph::reset() {
+    portENTER_CRITICAL(&lock);
+    stations.clear();
+    bsses.clear();
+    dataFrames = 0;
+    wdsFrames = 0;
+    portEXIT_CRITICAL(&lock);
+}
+
+void TrafficGraph::link(StationTraffic* station, uint64_t bssid) {
+    if (station->bssid != bssid) {
+        if (station->bssid != 0) {
+            station->roams++;
+        }
+        station->bssid = bssid;
+    }
+}
+
+void TrafficGraph::observeData(const uint8_t* frame, uint16_t len, uint16_t weight, uint32_t now) {
+    Dot11Data data;
+    if (!dot11ParseData(frame, len, &data)) {
+        return;
+    }
+    
+    // Only To/From DS frames say which side is the AP
+    bool infra = data.bssid && (frame[1] & (DOT11_FC_TO_DS | DOT11_FC_FROM_DS)) && !(data.bssid[0] & 0x01);
+    bool inserted;
+    uint64_t bssidKey = infra ? macToKey(data.bssid) : 0;
+    uint8_t tid = data.tid >= 0 ? (data.tid & 0x07) : 0;
+    
+    portENTER_CRITICAL(&lock);
+    dataFrames += weight;
+    if (!data.bssid) {
+        wdsFrames += weight;
+    }
+    if (!infra) {
+        portEXIT_CRITICAL(&lock);
+        return;
+    }
+    
+    BssTraffic* bss = bsses.findOrInsert(bssidKey, &inserted);
+    bss->lastSeen = now;
+    bss->acFrames[data.tid >= 0 ? tidToAc[tid] : AC_BE] += weight;
+    if (data.uplink) {
+        bss->framesUp += weight;
+        bss->bytesUp += data.payload * weight;
+    } else {
+        bss->framesDown += weight;
+        bss->bytesDown += data.payload * weight;
+    }
+    
+    // Group-addressed downlink belongs to the BSS alone
+    if (!data.station) {
+        portEXIT_CRITICAL(&lock);
+        return;
+    }
+    StationTraffic* station = stations.findOrInsert(macToKey(data.station), &inserted);
+    station->lastSeen = now;
+    link(station, bssidKey);
+    if (data.tid >= 0) {
+        station->tidMask |= 1 << tid;
+    }
+    if (data.uplink) {
+        station->framesUp += weight;
+        station->bytesUp += data.payload * weight;
+    } else {
+        station->framesDown += weight;
+        station->bytesDown += data.payload * weight;
+    }
+    portEXIT_CRITICAL(&lock);
+}
+
+void TrafficGraph::observePsPoll(const uint8_t* frame, uint16_t len, uint32_t now) {
+    // PS-Poll: address 1 is the BSSID, address 2 the polling station
+    if (len < 16 || (frame[DOT11_ADDR_2] & 0x01) || (frame[DOT11_ADDR_1] & 0x01)) {
+        return;
+    }
+    bool inserted;
+    uint64_t stationKey = macToKey(frame + DOT11_ADDR_2);
+    uint64_t bssidKey = macToKey(frame + DOT11_ADDR_1);
+    
+    portENTER_CRITICAL(&lock);
+    StationTraffic* station = stations.findOrInsert(stationKey, &inserted);
+    station->lastSeen = now;
+    link(station, bssidKey);
+    portEXIT_CRITICAL(&lock);
+}
+
+void TrafficGraph::getGraph(TrafficGraphReport* out, uint8_t k, const uint8_t* only) {
+    struct Pick {
+        uint64_t key;
+        uint32_t bytes;
+        const void* entry;
+    };
+    Pick aps[TRAFFIC_REPORT_MAX];
+    Pick edges[TRAFFIC_REPORT_MAX];
+    if (k > TRAFFIC_REPORT_MAX) {
+        k = TRAFFIC_REPORT_MAX;
+    }
+    uint64_t onlyKey = only ? macToKey(only) : 0;
+    uint8_t apCount = 0;
+    uint8_t edgeCount = 0;
+    auto insert = [k](Pick* picks, uint8_t& count, const Pick& pick) {
+        uint8_t pos = count;
+        while (pos > 0 && picks[pos - 1].bytes < pick.bytes) {
+            pos--;
+        }
+        if (pos >= k) {
+            return;
+        }
+        for (uint8_t n = count < k ? count : k - 1; n > pos; n--) {
+            picks[n] = picks[n - 1];
+        }
+        picks[pos] = pick;
+        if (count < k) {
+            count++;
+        }
+    };
+    
+    portENTER_CRITICAL(&lock);
+    bsses.forEach([&](uint64_t key, const BssTraffic& bss) {
+        if (!only || key == onlyKey) {
+            insert(aps, apCount, {key, bss.bytesUp + bss.bytesDown, &bss});
+        }
+    });
+    for (uint8_t i = 0; i < apCount; i++) {
+        out->aps[i].stations = 0;
+    }
+    
+    // One station pass picks the edges and counts each picked AP's stations
+    stations.forEach([&](uint64_t key, const StationTraffic& station) {
+        for (uint8_t i = 0; i < apCount; i++) {
+            if (aps[i].key == station.bssid) {
+                out->aps[i].stations++;
+                break;
+            }
+        }
+        if (!only || station.bssid == onlyKey) {
+            insert(edges, edgeCount, {key, station.bytesUp + station.bytesDown, &station});
+        }
+    });
+    
+    for (uint8_t i = 0; i < apCount; i++) {
+        const BssTraffic& bss = *(const BssTraffic*)aps[i].entry;
+        BssTrafficReport& report = out->aps[i];
+        keyToMac(aps[i].key, report.bssid);
+        report.framesUp = bss.framesUp;
+        report.framesDown = bss.framesDown;
+        report.bytesUp = bss.bytesUp;
+        report.bytesDown = bss.bytesDown;
+        memcpy(report.acFrames, bss.acFrames, sizeof(report.acFrames));
+    }
+    for (uint8_t i = 0; i < edgeCount; i++) {
+        const StationTraffic& station = *(const StationTraffic*)edges[i].entry;
+        EdgeTrafficReport& report = out->edges[i];
+        keyToMac(edges[i].key, report.station);
+        keyToMac(station.bssid, report.bssid);
+        report.lastSeen = station.lastSeen;
+        report.framesUp = station.framesUp;
+        report.framesDown = station.framesDown;
+        report.bytesUp = station.bytesUp;
+        report.bytesDown = station.bytesDown;
+        report.roams = station.roams;
+        report.tidMask = station.tidMask;
+    }
+    out->stationCount = stations.getUsed();
+    out->bssCount = bsses.getUsed();
+    out->dataFrames = dataFrames;
+    out->apCount = apCount;
+    out->edgeCount = edgeCount;
+    portEXIT_CRITICAL(&lock);
+}
+
+const char* TrafficGraph::acName(uint8_t ac) {
+    switch (ac) {
+        case AC_BK: return "bk";
+        case AC_BE: return "be";
+        case AC_VI: return "vi";
+        case AC_VO: return "vo";
+        default:    return "unknown";
+    }
+}
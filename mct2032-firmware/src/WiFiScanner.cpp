@@ -10,7 +10,13 @@ String NetworkInfo::getSecurityString() const {
     return WiFiScanner::encryptionTypeToString(encryptionType);
 }
 
-WiFiScanner::WiFiScanner() : scanning(false), scanStartTime(0) {
+WiFiScanner::WiFiScanner() :
+    scanning(false),
+    scanStartTime(0),
+    resultsValid(false),
+    resultsTime(0),
+    scanChannel(0),
+    resultsChannel(0) {
 }
 
 void WiFiScanner::init() {
@@ -34,8 +40,10 @@ bool WiFiScanner::startScan(uint8_t channel) {
     
     // Clear previous results
     networks.clear();
+    resultsValid = false;
     scanning = true;
     scanStartTime = millis();
+    scanChannel = channel;
     
     // Make sure we're not in promiscuous mode
     esp_wifi_set_promiscuous(false);
@@ -49,7 +57,7 @@ bool WiFiScanner::startScan(uint8_t channel) {
     
     // Start async scan with parameters similar to Marauder
     // true = async, true = show hidden, false = passive scan, 300ms = dwell time per channel
-    int result = WiFi.scanNetworks(true, true, false, 300, channel);
+    int result = WiFi.scanNetworks(true, true, false, SCAN_DWELL_MS, channel);
     
     if (result == WIFI_SCAN_RUNNING) {
         Serial.printf("WiFi scan started successfully (channel: %d)\n", channel);
@@ -62,8 +70,8 @@ bool WiFiScanner::startScan(uint8_t channel) {
 }
 
 bool WiFiScanner::isScanning() {
-    // Add timeout check (10 seconds)
-    if (scanning && (millis() - scanStartTime > 10000)) {
+    // Add timeout check
+    if (scanning && (millis() - scanStartTime > SCAN_TIMEOUT_MS)) {
         Serial.println("WiFi scan timeout - forcing completion");
         WiFi.scanDelete();
         scanning = false;
@@ -79,6 +87,9 @@ bool WiFiScanner::isScanning() {
         Serial.printf("WiFi scan complete with result: %d\n", result);
         processScanResults();
         scanning = false;
+        resultsValid = true;
+        resultsTime = millis();
+        resultsChannel = scanChannel;
         return false;
     } else {
         // Scan failed
@@ -96,6 +107,30 @@ void WiFiScanner::stopScan() {
     }
 }
 
+bool WiFiScanner::hasCachedResults(uint8_t channel, uint32_t maxAge) const {
+    if (!resultsValid || scanning) {
+        return false;
+    }
+    return resultsChannel == channel && getResultAge() <= maxAge;
+}
+
+uint32_t WiFiScanner::getResultAge() const {
+    return millis() - resultsTime;
+}
+
+void WiFiScanner::clearResults() {
+    networks.clear();
+    resultsValid = false;
+}
+
+void WiFiScanner::restoreNetwork(const NetworkInfo& info) {
+    networks.push_back(info);
+    
+    if (networkCallback) {
+        networkCallback(info);
+    }
+}
+
 void WiFiScanner::processScanResults() {
     int16_t count = WiFi.scanComplete();
     
@@ -122,12 +157,17 @@ void WiFiScanner::processScanResults() {
         info.channel = WiFi.channel(i);
         info.encryptionType = WiFi.encryptionType(i);
         info.hidden = (info.ssid.length() == 0);
+        info.vendor = OuiTable::lookup(WiFi.BSSID(i));
         
         // Debug output for each network
         Serial.printf("  [%d] SSID: %s, RSSI: %d, CH: %d\n", 
                       i, info.ssid.c_str(), info.rssi, info.channel);
         
         networks.push_back(info);
+        
+        if (networkCallback) {
+            networkCallback(info);
+        }
     }
     
     Serial.printf("Scan processing complete. Total networks: %d\n", networks.size());
@@ -147,6 +187,11 @@ void WiFiScanner::toJSON(DynamicJsonDocument& doc) {
         netObj[JSON_CHANNEL] = net.channel;
         netObj[JSON_SECURITY] = net.getSecurityString();
         netObj[JSON_HIDDEN] = net.hidden;
+        
+        char vendor[OUI_NAME_MAX];
+        if (OuiTable::name(net.vendor, vendor, sizeof(vendor))) {
+            netObj[JSON_VENDOR] = vendor;
+        }
     }
 }
 
@@ -15,6 +15,9 @@
 #include "WiFiScanner.h"
 #include "CommandProcessor.h"
 #include "PacketMonitor.h"
+#include "ChannelAnalyzer.h"
+#include "Storage.h"
+#include "SurveyLog.h"
 
 // Declare fonts - commented out as they're not properly linked
 // LV_FONT_DECLARE(lv_font_montserrat_12)
@@ -50,6 +53,9 @@ Arduino_GFX *gfx = nullptr;
 BLEManager bleManager;
 WiFiScanner wifiScanner;
 PacketMonitor packetMonitor;
+ChannelAnalyzer channelAnalyzer;
+Storage storage;
+SurveyLog surveyLog(&storage, &wifiScanner, &packetMonitor, &channelAnalyzer);
 CommandProcessor* commandProcessor = nullptr;
 
 // RGB LED instance
@@ -242,19 +248,36 @@ void setup() {
     create_ui();
 
     // Initialize components
+    if (!storage.begin()) {
+        Serial.println("No SD card, captures and SD exports disabled");
+    }
     bleManager.init();
     wifiScanner.init();
     // Note: packetMonitor.init() only sets up the instance, doesn't enable promiscuous mode
     packetMonitor.init();
+    packetMonitor.setStorage(&storage);
+    
+    // Feed channel analytics from scan results and live frames
+    wifiScanner.setNetworkCallback([](const NetworkInfo& info) {
+        channelAnalyzer.addNetwork(info.channel, info.rssi);
+    });
+    packetMonitor.setPacketCallback([](const PacketInfo& info) {
+        channelAnalyzer.recordFrame(info.channel, info.rssi, info.weight);
+    });
+    
+    // Replay the survey log so the last known APs and totals survive a reboot
+    if (storage.isMounted() && !surveyLog.begin()) {
+        Serial.println("Survey log unavailable");
+    }
     
     // Create command processor
-    commandProcessor = new CommandProcessor(&bleManager, &wifiScanner, &packetMonitor);
+    commandProcessor = new CommandProcessor(&bleManager, &wifiScanner, &packetMonitor, &channelAnalyzer, &storage, &surveyLog);
     commandProcessor->init();
     
-    // Set BLE command callback
-    bleManager.setCommandCallback([](String cmd) {
+    // Set BLE command callback - commands are queued for the worker task
+    bleManager.setCommandCallback([](const char* data, size_t length) {
         if (commandProcessor) {
-            commandProcessor->processCommand(cmd);
+            commandProcessor->enqueueCommand(data, length);
         }
     });
     
@@ -273,7 +296,9 @@ void loop() {
     // Handle LVGL
     lv_timer_handler();
     
-    // Note: Command processor mode management would go here if we had getter/setter methods
+    // Long-running work (scans, monitor sessions, captures) runs as jobs on the
+    // command worker task; the loop only mirrors the current mode on screen
+    uint8_t mode = commandProcessor ? commandProcessor->getCurrentMode() : MODE_IDLE;
     
     // Update RGB LED based on status
     static unsigned long lastLedUpdate = 0;
@@ -293,7 +318,7 @@ void loop() {
         }
         
         // Set color based on state
-        if (wifiScanner.isScanning()) {
+        if (mode == MODE_SCANNING) {
             // Blue = scanning
             rgbLED.setPixelColor(0, rgbLED.Color(0, 0, breathValue));
         } else if (bleManager.isConnected()) {
@@ -326,8 +351,11 @@ void loop() {
     
     // Update mode display
     static uint8_t lastMode = MODE_IDLE;
-    if (commandProcessor && commandProcessor->getCurrentMode() != lastMode) {
-        lastMode = commandProcessor->getCurrentMode();
+    static unsigned long scanStartTime = 0;
+    static unsigned long statusResetTime = 0;
+    if (mode != lastMode) {
+        uint8_t previousMode = lastMode;
+        lastMode = mode;
         switch (lastMode) {
             case MODE_SCANNING:
                 lv_label_set_text(mode_label, "[ SCANNING ]");
@@ -349,28 +377,46 @@ void loop() {
                 lv_label_set_text(mode_label, "[ CAPTURE ]");
                 lv_obj_set_style_text_color(mode_label, lv_color_hex(0x9370db), 0);  // Purple
                 break;
+            case MODE_EXPORTING:
+                lv_label_set_text(mode_label, "[ EXPORT ]");
+                lv_obj_set_style_text_color(mode_label, lv_color_hex(0xffd700), 0);  // Gold
+                break;
             default:
                 lv_label_set_text(mode_label, "[ IDLE ]");
                 lv_obj_set_style_text_color(mode_label, lv_color_hex(0x00ff00), 0);  // Green
                 break;
         }
+        
+        if (lastMode == MODE_SCANNING) {
+            scanStartTime = millis();
+        }
+        
+        // Show scan results once the scan job has finished
+        if (previousMode == MODE_SCANNING) {
+            size_t networkCount = wifiScanner.getNetworkCount();
+            if (networkCount > 0) {
+                char statusBuf[32];
+                snprintf(statusBuf, sizeof(statusBuf), "> FOUND: %d", (int)networkCount);
+                lv_label_set_text(status_label, statusBuf);
+                
+                char statsBuf[32];
+                snprintf(statsBuf, sizeof(statsBuf), "%d APs", (int)networkCount);
+                lv_label_set_text(stats_label, statsBuf);
+                
+                // Show network count
+                char countBuf[64];
+                snprintf(countBuf, sizeof(countBuf), "%d networks detected", (int)networkCount);
+                lv_label_set_text(network_count_label, countBuf);
+            } else {
+                lv_label_set_text(status_label, "> NO NETS");
+                lv_label_set_text(stats_label, "0 APs");
+                lv_label_set_text(network_count_label, "No networks found");
+            }
+            statusResetTime = millis() + 5000;  // Show status for 5 seconds
+        }
     }
     
-    // Check WiFi scan status - improved based on Marauder pattern
-    static bool scanRequested = false;
-    static bool scanInProgress = false;
-    static unsigned long scanStartTime = 0;
-    
-    // Check if we have a pending scan request
-    if (commandProcessor && commandProcessor->getCurrentMode() == MODE_SCANNING && !scanInProgress) {
-        scanRequested = true;
-        scanInProgress = true;
-        scanStartTime = millis();
-        Serial.println("=== WiFi SCAN STARTED ===");
-        Serial.printf("Mode: %d, Time: %lu\n", commandProcessor->getCurrentMode(), millis());
-    }
-    
-    if (scanInProgress) {
+    if (mode == MODE_SCANNING) {
         // Update display during scan
         static unsigned long lastUpdate = 0;
         static int animFrame = 0;
@@ -392,85 +438,19 @@ void loop() {
             snprintf(buf, sizeof(buf), "%d ms", (int)(millis() - scanStartTime));
             lv_label_set_text(stats_label, buf);
         }
-        
-        // Check if scan is complete
-        if (!wifiScanner.isScanning()) {
-            Serial.printf("Scan complete. Found %d networks\n", wifiScanner.getNetworkCount());
-            
-            // Send results
-            Serial.println("=== SENDING WIFI SCAN RESULTS ===");
-            
-            // Use larger document size for WiFi results
-            DynamicJsonDocument doc(8192);
-            if (wifiScanner.getNetworkCount() > 0) {
-                wifiScanner.toJSON(doc);
-                
-                // Update display with results
-                char statusBuf[32];
-                snprintf(statusBuf, sizeof(statusBuf), "> FOUND: %d", wifiScanner.getNetworkCount());
-                lv_label_set_text(status_label, statusBuf);
-                
-                char statsBuf[32];
-                snprintf(statsBuf, sizeof(statsBuf), "%d APs", wifiScanner.getNetworkCount());
-                lv_label_set_text(stats_label, statsBuf);
-                
-                // Show network count
-                char countBuf[64];
-                snprintf(countBuf, sizeof(countBuf), "%d networks detected", wifiScanner.getNetworkCount());
-                lv_label_set_text(network_count_label, countBuf);
-                
-                // Check JSON size
-                size_t jsonSize = measureJson(doc);
-                Serial.printf("Sending %d networks, JSON size: %d bytes\n", 
-                              wifiScanner.getNetworkCount(), jsonSize);
-                
-                if (jsonSize > 2000) {
-                    Serial.println("WARNING: Response may be too large for BLE!");
-                }
-            } else {
-                JsonArray emptyArray = doc.createNestedArray("networks");
-                lv_label_set_text(status_label, "> NO NETS");
-                lv_label_set_text(stats_label, "0 APs");
-                lv_label_set_text(network_count_label, "No networks found");
-                Serial.println("Sending empty network list");
-            }
-            
-            // Send the scan results using chunked method for large data
-            if (!bleManager.sendChunkedResponse(CMD_SCAN_WIFI, STATUS_SUCCESS, doc)) {
-                Serial.println("ERROR: Failed to send WiFi scan results!");
-            } else {
-                Serial.println("WiFi scan results sent successfully");
-            }
-            
-            // Reset state
-            scanInProgress = false;
-            scanRequested = false;
-            if (commandProcessor) {
-                commandProcessor->setMode(MODE_IDLE);
-            }
-        }
-        
-        // Timeout check (10 seconds)
-        if (millis() - scanStartTime > 10000) {
-            Serial.println("WiFi scan timeout!");
-            bleManager.sendError(CMD_SCAN_WIFI, "Scan timeout");
-            scanInProgress = false;
-            scanRequested = false;
-            if (commandProcessor) {
-                commandProcessor->setMode(MODE_IDLE);
-            }
-            lv_label_set_text(status_label, "Scan timeout");
-        }
     }
     
-    // Reset status after displaying results
-    static unsigned long statusResetTime = 0;
-    static bool statusDisplayed = false;
-    
-    // Set timer when scan completes
-    if (!scanInProgress && scanRequested && !statusDisplayed) {
-        statusResetTime = millis() + 5000;  // Show status for 5 seconds
-        statusDisplayed = true;
+    // Latest rogue AP alert takes over the status lines for a while
+    static uint32_t lastAlertCount = 0;
+    if (commandProcessor) {
+        char alertText[ALERT_TEXT_LEN];
+        uint32_t alertCount = commandProcessor->getLastAlert(alertText, sizeof(alertText));
+        if (alertCount != lastAlertCount) {
+            lastAlertCount = alertCount;
+            lv_label_set_text(status_label, "> ALERT");
+            lv_label_set_text(network_count_label, alertText);
+            statusResetTime = millis() + 5000;
+        }
     }
     
     // Reset display after timeout
@@ -488,12 +468,10 @@ void loop() {
         }
         
         statusResetTime = 0;
-        statusDisplayed = false;
-        scanRequested = false;
     }
     
     // Update packet monitor stats if monitoring
-    if (commandProcessor && commandProcessor->getCurrentMode() == MODE_MONITORING) {
+    if (mode == MODE_MONITORING || mode == MODE_PCAP_CAPTURE) {
         static unsigned long lastMonitorUpdate = 0;
         if (millis() - lastMonitorUpdate > 500) {  // Update every 500ms
             lastMonitorUpdate = millis();
@@ -502,8 +480,11 @@ void loop() {
             snprintf(buf, sizeof(buf), "PKT: %lu", packetMonitor.getPacketsTotal());
             lv_label_set_text(stats_label, buf);
             
-            snprintf(buf, sizeof(buf), "%lu pkt/s", packetMonitor.getPacketsPerSec());
-            lv_label_set_text(network_count_label, buf);
+            // Leave a pending alert readable
+            if (statusResetTime == 0) {
+                snprintf(buf, sizeof(buf), "%lu pkt/s", packetMonitor.getPacketsPerSec());
+                lv_label_set_text(network_count_label, buf);
+            }
         }
     }
     
@@ -0,0 +1,154 @@
+/**
+ * Command dispatch host benchmark
+ * Perfect-hash table against the std::map of std::function it replaced
+ *
+ * Both dispatchers route the same CMD_* names to member handlers. The map
+ * side builds a string key per command, as the old String lookup did.
+ * Usage: bench_dispatch [rounds] (default 200000 passes over the names).
+ */
+
+#include "protocol.h"
+#include "CommandHash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <string>
+
+class Dispatcher {
+public:
+    typedef void (Dispatcher::*Handler)(int);
+    
+    struct Entry {
+        const char* name;
+        Handler handler;
+    };
+    
+    static const Entry table[];
+    static const CommandSlots slots;
+    
+    std::map<std::string, std::function<void(int)>> handlers;
+    uint32_t calls[MAX_COMMANDS] = {0};
+    
+    Dispatcher();
+    bool dispatchTable(const char* name, int arg);
+    bool dispatchMap(const char* name, int arg);
+    
+    template <int N>
+    void handle(int arg) { calls[N] += arg; }
+};
+
+// Same names as CommandProcessor::commandTable
+constexpr Dispatcher::Entry Dispatcher::table[] = {
+    {CMD_SCAN_WIFI,        &Dispatcher::handle<0>},
+    {CMD_SCAN_BLE,         &Dispatcher::handle<1>},
+    {CMD_GET_STATUS,       &Dispatcher::handle<2>},
+    {CMD_SET_CHANNEL,      &Dispatcher::handle<3>},
+    {CMD_MONITOR_START,    &Dispatcher::handle<4>},
+    {CMD_MONITOR_STOP,     &Dispatcher::handle<5>},
+    {CMD_EXPORT_DATA,      &Dispatcher::handle<6>},
+    {CMD_CLEAR_DATA,       &Dispatcher::handle<7>},
+    {CMD_CHANNEL_REPORT,   &Dispatcher::handle<8>},
+    {CMD_GET_METRICS,      &Dispatcher::handle<9>},
+    {CMD_JOB_LIST,         &Dispatcher::handle<10>},
+    {CMD_JOB_CANCEL,       &Dispatcher::handle<11>},
+    {CMD_STATS_STREAM,     &Dispatcher::handle<12>},
+    {CMD_BATCH,            &Dispatcher::handle<13>},
+    {CMD_TOP_TALKERS,      &Dispatcher::handle<14>},
+    {CMD_DISTINCT_COUNT,   &Dispatcher::handle<15>},
+    {CMD_ASSOC_GRAPH,      &Dispatcher::handle<16>},
+    {CMD_AIRTIME,          &Dispatcher::handle<17>},
+    {CMD_PHY_STATS,        &Dispatcher::handle<18>},
+    {CMD_PROBE_REPORT,     &Dispatcher::handle<19>},
+    {CMD_ROGUE_ALLOW,      &Dispatcher::handle<20>},
+    {CMD_DEAUTH_ATTACK,    &Dispatcher::handle<21>},
+    {CMD_BEACON_SPAM,      &Dispatcher::handle<22>},
+    {CMD_RICKROLL,         &Dispatcher::handle<23>},
+    {CMD_PCAP_START,       &Dispatcher::handle<24>},
+    {CMD_PCAP_STOP,        &Dispatcher::handle<25>},
+    {CMD_FLIGHT_ARM,       &Dispatcher::handle<26>},
+    {CMD_FLIGHT_TRIGGER,   &Dispatcher::handle<27>},
+    {CMD_FLIGHT_DISARM,    &Dispatcher::handle<28>},
+};
+
+constexpr CommandSlots Dispatcher::slots = buildCommandSlots(Dispatcher::table);
+static_assert(Dispatcher::slots.valid, "No collision-free seed for command table");
+
+static const size_t TABLE_SIZE = sizeof(Dispatcher::table) / sizeof(Dispatcher::table[0]);
+
+Dispatcher::Dispatcher() {
+    // One heap closure per command, like the old registration
+    for (size_t i = 0; i < TABLE_SIZE; i++) {
+        Handler handler = table[i].handler;
+        handlers[table[i].name] = [this, handler](int arg) { (this->*handler)(arg); };
+    }
+}
+
+bool Dispatcher::dispatchTable(const char* name, int arg) {
+    const Entry* entry = findCommandEntry(slots, table, name);
+    if (!entry) {
+        return false;
+    }
+    (this->*entry->handler)(arg);
+    return true;
+}
+
+bool Dispatcher::dispatchMap(const char* name, int arg) {
+    auto it = handlers.find(name);
+    if (it == handlers.end()) {
+        return false;
+    }
+    it->second(arg);
+    return true;
+}
+
+template <typename Fn>
+static double timeRounds(size_t rounds, const char* const* names, size_t count, Fn dispatch, size_t* misses) {
+    auto start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r < rounds; r++) {
+        for (size_t i = 0; i < count; i++) {
+            if (!dispatch(names[i])) {
+                (*misses)++;
+            }
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return seconds * 1e9 / (rounds * count);
+}
+
+int main(int argc, char** argv) {
+    size_t rounds = argc > 1 ? atoi(argv[1]) : 200000;
+    
+    // Every command plus a few unknown names, which both must reject
+    const char* names[TABLE_SIZE + 3];
+    for (size_t i = 0; i < TABLE_SIZE; i++) {
+        names[i] = Dispatcher::table[i].name;
+    }
+    names[TABLE_SIZE] = "SCAN_WIFIX";
+    names[TABLE_SIZE + 1] = "scan_wifi";
+    names[TABLE_SIZE + 2] = "";
+    size_t count = TABLE_SIZE + 3;
+    
+    Dispatcher tableSide;
+    Dispatcher mapSide;
+    size_t tableMisses = 0;
+    size_t mapMisses = 0;
+    double tableNs = timeRounds(rounds, names, count,
+        [&](const char* name) { return tableSide.dispatchTable(name, 1); }, &tableMisses);
+    double mapNs = timeRounds(rounds, names, count,
+        [&](const char* name) { return mapSide.dispatchMap(name, 1); }, &mapMisses);
+    
+    // Same handlers hit the same number of times, and only the unknown names missed
+    bool ok = tableMisses == mapMisses && tableMisses == rounds * 3;
+    for (size_t i = 0; i < TABLE_SIZE; i++) {
+        ok &= tableSide.calls[i] == rounds && mapSide.calls[i] == rounds;
+    }
+    
+    printf("%lu commands, hash seed %u, %lu slots\n",
+           (unsigned long)TABLE_SIZE, Dispatcher::slots.seed, (unsigned long)COMMAND_SLOTS);
+    printf("perfect hash  %7.1f ns/dispatch\n", tableNs);
+    printf("std::map      %7.1f ns/dispatch (%.1fx)\n", mapNs, tableNs > 0 ? mapNs / tableNs : 0);
+    printf(ok ? "dispatch matches\n" : "dispatch MISMATCH\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,70 @@
+/**
+ * Storage host benchmark
+ * Write-behind throughput and drop rate against the POSIX backend
+ *
+ * Each row streams the same volume as records of one size, once waiting
+ * for blocks like the worker does and once with no wait like the WiFi task.
+ * Usage: bench_storage [megabytes] (default 64), rooted at MCT_STORAGE_ROOT.
+ */
+
+#include "Storage.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+static double run(Storage& storage, size_t recordSize, size_t total, uint32_t waitMs, uint32_t* dropped) {
+    StorageStream* stream = storage.openAppend("bench.bin", true);
+    if (!stream) {
+        return 0;
+    }
+    
+    std::vector<uint8_t> body(recordSize, 0xA5);
+    uint32_t head[4] = {0};
+    size_t records = total / (recordSize + sizeof(head));
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < records; i++) {
+        head[0] = i;
+        stream->writeRecord(head, sizeof(head), body.data(), body.size(), waitMs);
+    }
+    *dropped = stream->getBytesDropped();
+    stream->close();
+    
+    // Timed until the last block is on disk, not just queued
+    storage.end();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    storage.begin();
+    return seconds > 0 ? (total - *dropped) / seconds / (1024 * 1024) : 0;
+}
+
+int main(int argc, char** argv) {
+    size_t megabytes = argc > 1 ? atoi(argv[1]) : 64;
+    size_t total = megabytes * 1024 * 1024;
+    
+    Storage storage;
+    if (!storage.begin()) {
+        printf("mount failed\n");
+        return 1;
+    }
+    
+    printf("%8s %14s %14s %10s\n", "record", "wait MB/s", "no-wait MB/s", "dropped");
+    const size_t sizes[] = {64, 256, 1500, 4096, 16384};
+    for (size_t size : sizes) {
+        uint32_t waitDropped;
+        uint32_t noWaitDropped;
+        double waitRate = run(storage, size, total, STORAGE_WAIT_FOREVER, &waitDropped);
+        double noWaitRate = run(storage, size, total, 0, &noWaitDropped);
+        printf("%8lu %14.1f %14.1f %9.1f%%\n", (unsigned long)size, waitRate, noWaitRate,
+               100.0 * noWaitDropped / total);
+        if (waitDropped) {
+            printf("  %lu bytes dropped while waiting\n", (unsigned long)waitDropped);
+        }
+    }
+    
+    const StorageStats& stats = storage.getStats();
+    printf("blocks %lu, write errors %lu, slowest block %lu us, pending high %u\n",
+           (unsigned long)stats.blocksWritten, (unsigned long)stats.writeErrors,
+           (unsigned long)stats.writeMaxUs, stats.pendingHigh);
+    storage.remove("bench.bin");
+    return 0;
+}
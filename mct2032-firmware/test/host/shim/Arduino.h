@@ -0,0 +1,55 @@
+/**
+ * Arduino shim for host tests
+ * Just what the analytics modules use: fixed-width types, the C string
+ * and math headers, millis/micros/delay on the host clock and a Serial
+ * that prints to stdout
+ *
+ * Storage.h keys its POSIX backend off ARDUINO, so this header leaves it
+ * undefined.
+ */
+
+#ifndef HOST_SHIM_ARDUINO_H
+#define HOST_SHIM_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <stdarg.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+using std::min;
+using std::max;
+
+inline uint32_t micros() {
+    static const auto start = std::chrono::steady_clock::now();
+    return (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+inline uint32_t millis() {
+    return micros() / 1000;
+}
+
+inline void delay(uint32_t ms) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+struct HostSerial {
+    int printf(const char* format, ...) {
+        va_list args;
+        va_start(args, format);
+        int n = vprintf(format, args);
+        va_end(args);
+        return n;
+    }
+    void println(const char* text) { puts(text); }
+};
+
+inline HostSerial Serial;
+
+#endif // HOST_SHIM_ARDUINO_H
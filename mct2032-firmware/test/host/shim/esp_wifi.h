@@ -0,0 +1,58 @@
+/**
+ * WiFi driver shim for host tests
+ * rx_ctrl with the ESP-IDF 4.4 layout and the promiscuous filter masks
+ */
+
+#ifndef HOST_SHIM_ESP_WIFI_H
+#define HOST_SHIM_ESP_WIFI_H
+
+#include <stdint.h>
+
+typedef struct {
+    signed rssi:8;
+    unsigned rate:5;
+    unsigned :1;
+    unsigned sig_mode:2;
+    unsigned :16;
+    unsigned mcs:7;
+    unsigned cwb:1;
+    unsigned :16;
+    unsigned smoothing:1;
+    unsigned not_sounding:1;
+    unsigned :1;
+    unsigned aggregation:1;
+    unsigned stbc:2;
+    unsigned fec_coding:1;
+    unsigned sgi:1;
+    signed noise_floor:8;
+    unsigned ampdu_cnt:8;
+    unsigned channel:4;
+    unsigned secondary_channel:4;
+    unsigned :8;
+    unsigned timestamp:32;
+    unsigned :32;
+    unsigned :31;
+    unsigned ant:1;
+    unsigned sig_len:12;
+    unsigned :12;
+    unsigned rx_state:8;
+} wifi_pkt_rx_ctrl_t;
+
+#define WIFI_PROMIS_FILTER_MASK_ALL             0xFFFFFFFF
+#define WIFI_PROMIS_FILTER_MASK_MGMT            (1)
+#define WIFI_PROMIS_FILTER_MASK_CTRL            (1 << 1)
+#define WIFI_PROMIS_FILTER_MASK_DATA            (1 << 2)
+#define WIFI_PROMIS_FILTER_MASK_MISC            (1 << 3)
+
+#define WIFI_PROMIS_CTRL_FILTER_MASK_ALL        0xFF800000
+#define WIFI_PROMIS_CTRL_FILTER_MASK_WRAPPER    (1 << 23)
+#define WIFI_PROMIS_CTRL_FILTER_MASK_BAR        (1 << 24)
+#define WIFI_PROMIS_CTRL_FILTER_MASK_BA         (1 << 25)
+#define WIFI_PROMIS_CTRL_FILTER_MASK_PSPOLL     (1 << 26)
+#define WIFI_PROMIS_CTRL_FILTER_MASK_RTS        (1 << 27)
+#define WIFI_PROMIS_CTRL_FILTER_MASK_CTS        (1 << 28)
+#define WIFI_PROMIS_CTRL_FILTER_MASK_ACK        (1 << 29)
+#define WIFI_PROMIS_CTRL_FILTER_MASK_CFEND      (1 << 30)
+#define WIFI_PROMIS_CTRL_FILTER_MASK_CFENDACK   (1u << 31)
+
+#endif // HOST_SHIM_ESP_WIFI_H
@@ -0,0 +1,20 @@
+/**
+ * FreeRTOS shim for host tests
+ * portMUX critical sections as a spinlock, so tests that feed a module
+ * from a second thread still get the locking the device has
+ */
+
+#ifndef HOST_SHIM_FREERTOS_H
+#define HOST_SHIM_FREERTOS_H
+
+#include <atomic>
+
+struct portMUX_TYPE {
+    std::atomic_flag held = ATOMIC_FLAG_INIT;
+};
+
+#define portMUX_INITIALIZE(mux)     ((mux)->held.clear())
+#define portENTER_CRITICAL(mux)     while ((mux)->held.test_and_set(std::memory_order_acquire)) {}
+#define portEXIT_CRITICAL(mux)      ((mux)->held.clear(std::memory_order_release))
+
+#endif // HOST_SHIM_FREERTOS_H
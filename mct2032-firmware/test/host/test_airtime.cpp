@@ -0,0 +1,160 @@
+/**
+ * Airtime meter host tests
+ * Per-frame airtime against worked 802.11 figures, A-MPDU preamble sharing,
+ * utilization and the per-BSSID ranking
+ */
+
+#include "AirtimeMeter.h"
+#include <stdio.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    } \
+} while (0)
+
+static wifi_pkt_rx_ctrl_t legacy(uint8_t rate, uint16_t len) {
+    wifi_pkt_rx_ctrl_t ctrl;
+    memset(&ctrl, 0, sizeof(ctrl));
+    ctrl.sig_mode = 0;
+    ctrl.rate = rate;
+    ctrl.sig_len = len;
+    ctrl.channel = 6;
+    return ctrl;
+}
+
+static wifi_pkt_rx_ctrl_t ht(uint8_t mcs, uint16_t len, bool wide = false, bool sgi = false) {
+    wifi_pkt_rx_ctrl_t ctrl;
+    memset(&ctrl, 0, sizeof(ctrl));
+    ctrl.sig_mode = 1;
+    ctrl.mcs = mcs;
+    ctrl.cwb = wide;
+    ctrl.sgi = sgi;
+    ctrl.sig_len = len;
+    ctrl.channel = 6;
+    return ctrl;
+}
+
+// DSSS/CCK with both preambles, and ERP-OFDM with its signal extension
+static void testLegacy() {
+    printf("legacy\n");
+    CHECK(AirtimeMeter::frameAirtimeUs(legacy(0, 100), false) == 192 + 800);        // 1 Mbps
+    CHECK(AirtimeMeter::frameAirtimeUs(legacy(3, 14), false) == 192 + 11);          // 11 Mbps ACK
+    CHECK(AirtimeMeter::frameAirtimeUs(legacy(7, 14), false) == 96 + 11);           // Short preamble
+    CHECK(AirtimeMeter::frameAirtimeUs(legacy(11, 14), false) == 20 + 6 * 4 + 6);   // 6 Mbps ACK
+    CHECK(AirtimeMeter::frameAirtimeUs(legacy(12, 1500), false) == 20 + 56 * 4 + 6); // 54 Mbps
+    CHECK(AirtimeMeter::frameAirtimeUs(legacy(4, 100), false) == 0);                // No such rate
+}
+
+// HT and VHT: width, guard interval, streams, and A-MPDU delimiters
+static void testHt() {
+    printf("ht\n");
+    // MCS 7, 20 MHz: 260 bits a symbol, (22 + 12000) / 260 -> 47 symbols
+    CHECK(AirtimeMeter::frameAirtimeUs(ht(7, 1500), false) == 42 + 47 * 4);
+    CHECK(AirtimeMeter::frameAirtimeUs(ht(7, 1500, false, true), false) == 42 + 170);
+    
+    // MCS 15, 40 MHz: two streams of 540 bits, and a second HT-LTF
+    CHECK(AirtimeMeter::frameAirtimeUs(ht(15, 1500, true), false) == 46 + 12 * 4);
+    
+    // A subframe sharing the preamble is charged its symbols only
+    wifi_pkt_rx_ctrl_t sub = ht(7, 1500);
+    sub.aggregation = 1;
+    CHECK(AirtimeMeter::frameAirtimeUs(sub, false) == 42 + 47 * 4);
+    CHECK(AirtimeMeter::frameAirtimeUs(sub, true) == 47 * 4);
+    
+    wifi_pkt_rx_ctrl_t vht = ht(8, 1500);
+    vht.sig_mode = 3;
+    CHECK(AirtimeMeter::frameAirtimeUs(vht, false) == 42 + 39 * 4);
+    vht.mcs = 10;
+    CHECK(AirtimeMeter::frameAirtimeUs(vht, false) == 0);
+}
+
+// Data frame from the AP with the given last BSSID byte
+static void makeFrame(uint8_t* frame, uint8_t ap) {
+    memset(frame, 0, 32);
+    frame[0] = 0x08;
+    frame[1] = 0x02;
+    frame[4] = 0x02;
+    frame[15] = ap;
+}
+
+// Only a subframe following close behind another shares its preamble
+static void testAmpdu() {
+    printf("ampdu\n");
+    AirtimeMeter meter;
+    uint32_t now = millis();
+    uint8_t frame[32];
+    makeFrame(frame, 1);
+    
+    wifi_pkt_rx_ctrl_t ctrl = ht(7, 1500);
+    ctrl.aggregation = 1;
+    uint32_t full = 42 + 47 * 4;
+    uint32_t shared = 47 * 4;
+    ctrl.timestamp = 1000;
+    meter.observe(frame, ctrl, now);
+    ctrl.timestamp = 1000 + full + 10;
+    meter.observe(frame, ctrl, now);
+    ctrl.timestamp = 1000 + full + 10 + shared + 100;
+    meter.observe(frame, ctrl, now);
+    
+    BssAirtimeReport top[4];
+    uint64_t total;
+    CHECK(meter.getTopBss(top, 4, &total) == 1);
+    CHECK(total == full + shared + full);
+    CHECK(top[0].frames == 3 && top[0].airtimeUs == total);
+}
+
+// Utilization over the time listened, per class totals, and BSSIDs by airtime
+static void testUtilization() {
+    printf("utilization\n");
+    AirtimeMeter meter;
+    uint32_t now = millis();
+    meter.setListening(6, now);
+    
+    uint8_t beacon[32];
+    memset(beacon, 0, sizeof(beacon));
+    beacon[0] = 0x80;
+    memset(beacon + 4, 0xFF, 6);
+    beacon[16] = 0x02;
+    for (uint32_t i = 0; i < 500; i++) {
+        beacon[21] = i % 3 == 0 ? 1 : 2;
+        meter.observe(beacon, legacy(0, 100), now);
+    }
+    
+    AirtimeReport report;
+    meter.getChannel(6, now + 1000, &report);
+    CHECK(report.longListenMs == 1000);
+    CHECK(report.shortPct == 49 && report.longPct == 49);
+    CHECK(report.classUs[AIRTIME_BEACON] == 500 * 992);
+    CHECK(report.classUs[AIRTIME_DATA] == 0);
+    
+    meter.getChannel(1, now + 1000, &report);
+    CHECK(report.longListenMs == 0 && report.longPct == 0);
+    
+    BssAirtimeReport top[4];
+    uint64_t total;
+    CHECK(meter.getTopBss(top, 4, &total) == 2);
+    CHECK(total == 500 * 992);
+    CHECK(top[0].bssid[5] == 2 && top[0].frames == 333);
+    CHECK(top[1].bssid[5] == 1 && top[1].frames == 167);
+    CHECK(meter.getTopBss(top, 1, &total) == 1 && top[0].bssid[5] == 2);
+    
+    // Busy time leaves the short window after ten idle seconds
+    meter.getChannel(6, now + 1000 + AIRTIME_SHORT_BUCKETS * AIRTIME_BUCKET_MS, &report);
+    CHECK(report.shortPct == 0);
+    CHECK(report.longPct == 4);
+}
+
+int main() {
+    testLegacy();
+    testHt();
+    testAmpdu();
+    testUtilization();
+    
+    printf(failures ? "%d failures\n" : "all passed\n", failures);
+    return failures ? 1 : 0;
+}
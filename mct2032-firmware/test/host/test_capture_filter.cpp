@@ -0,0 +1,162 @@
+/**
+ * Capture filter host tests
+ * Compiled predicates against hand-built frames, and the driver pushdown
+ */
+
+#include "CaptureFilter.h"
+#include "Dot11.h"
+#include <stdio.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    } \
+} while (0)
+
+static const uint8_t AP[6] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55};
+static const uint8_t STA[6] = {0x02, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE};
+static const uint8_t BROADCAST[6] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF};
+
+// 24 byte header with the given frame control and addresses, zero body
+static void makeFrame(uint8_t* frame, uint8_t fc0, uint8_t fc1,
+                      const uint8_t* a1, const uint8_t* a2, const uint8_t* a3) {
+    memset(frame, 0, 64);
+    frame[0] = fc0;
+    frame[1] = fc1;
+    memcpy(frame + 4, a1, 6);
+    memcpy(frame + 10, a2, 6);
+    memcpy(frame + 16, a3, 6);
+}
+
+// An empty filter passes everything and leaves the driver at its default
+static void testEmpty() {
+    printf("empty\n");
+    CaptureFilter filter;
+    uint8_t frame[64];
+    makeFrame(frame, 0x80, 0, BROADCAST, AP, AP);
+    CHECK(!filter.isActive());
+    CHECK(filter.match(frame, 64, -90, 6));
+    CHECK(filter.match(frame, 0, 0, 0));
+    CHECK(filter.getHardwareMask() == CAPTURE_HW_DEFAULT_MASK);
+    CHECK(!(filter.getHardwareMask() & WIFI_PROMIS_FILTER_MASK_CTRL));
+}
+
+// Channel, RSSI and length bounds are inclusive
+static void testRanges() {
+    printf("ranges\n");
+    CaptureFilter filter;
+    CHECK(filter.addChannel(1));
+    CHECK(filter.addChannel(11));
+    CHECK(!filter.addChannel(0));
+    CHECK(!filter.addChannel(15));
+    filter.setRssiRange(-70, -40);
+    filter.setLengthRange(24, 100);
+    
+    uint8_t frame[64];
+    makeFrame(frame, 0x80, 0, BROADCAST, AP, AP);
+    CHECK(filter.match(frame, 64, -50, 1));
+    CHECK(filter.match(frame, 64, -50, 11));
+    CHECK(!filter.match(frame, 64, -50, 6));
+    CHECK(filter.match(frame, 64, -70, 1));
+    CHECK(filter.match(frame, 64, -40, 1));
+    CHECK(!filter.match(frame, 64, -71, 1));
+    CHECK(!filter.match(frame, 64, -39, 1));
+    CHECK(filter.match(frame, 24, -50, 1));
+    CHECK(filter.match(frame, 100, -50, 1));
+    CHECK(!filter.match(frame, 23, -50, 1));
+    CHECK(!filter.match(frame, 101, -50, 1));
+}
+
+// Type and subtype names, and the type-level mask handed to the driver
+static void testFrames() {
+    printf("frames\n");
+    CaptureFilter filter;
+    CHECK(filter.addFrames("beacon"));
+    CHECK(filter.addFrames("qos_data"));
+    CHECK(!filter.addFrames("bogus"));
+    
+    uint8_t frame[64];
+    makeFrame(frame, 0x80, 0, BROADCAST, AP, AP);
+    CHECK(filter.match(frame, 64, -50, 1));
+    makeFrame(frame, 0x40, 0, BROADCAST, STA, BROADCAST);      // Probe request
+    CHECK(!filter.match(frame, 64, -50, 1));
+    makeFrame(frame, 0x88, DOT11_FC_TO_DS, AP, STA, AP);       // QoS data
+    CHECK(filter.match(frame, 64, -50, 1));
+    makeFrame(frame, 0x08, DOT11_FC_TO_DS, AP, STA, AP);       // Plain data
+    CHECK(!filter.match(frame, 64, -50, 1));
+    CHECK(!filter.match(frame, 1, -50, 1));
+    
+    CHECK(filter.getHardwareMask() == (WIFI_PROMIS_FILTER_MASK_MGMT | WIFI_PROMIS_FILTER_MASK_DATA));
+    
+    // Control frames reach the callback only when asked for, and only the named subtypes
+    CaptureFilter ctrl;
+    CHECK(ctrl.addFrames("rts"));
+    CHECK(ctrl.addFrames("ack"));
+    CHECK(ctrl.getHardwareMask() == WIFI_PROMIS_FILTER_MASK_CTRL);
+    CHECK(ctrl.getCtrlMask() == (WIFI_PROMIS_CTRL_FILTER_MASK_RTS | WIFI_PROMIS_CTRL_FILTER_MASK_ACK));
+    
+    uint8_t ack[16];
+    memset(ack, 0, sizeof(ack));
+    ack[0] = 0xD4;
+    memcpy(ack + 4, STA, 6);
+    CHECK(ctrl.match(ack, 10, -50, 1));
+    ack[0] = 0xC4;                                              // CTS
+    CHECK(!ctrl.match(ack, 10, -50, 1));
+}
+
+// Masked MAC rules on chosen address fields; the BSSID field follows the DS bits
+static void testMacs() {
+    printf("macs\n");
+    CaptureFilter filter;
+    CHECK(!filter.addMac("not a mac", nullptr, CAPTURE_ADDR_ANY));
+    CHECK(!filter.addMac("00:11:22:33:44:55", nullptr, 0));
+    CHECK(filter.addMac("02:aa:bb:00:00:00", "ff:ff:ff:00:00:00", CAPTURE_ADDR_2));
+    
+    uint8_t frame[64];
+    makeFrame(frame, 0x08, DOT11_FC_TO_DS, AP, STA, AP);
+    CHECK(filter.match(frame, 64, -50, 1));
+    makeFrame(frame, 0x08, DOT11_FC_FROM_DS, STA, AP, AP);
+    CHECK(!filter.match(frame, 64, -50, 1));
+    
+    // Address 2 is past the end of a 10 byte ACK
+    uint8_t ack[16];
+    memset(ack, 0, sizeof(ack));
+    ack[0] = 0xD4;
+    memcpy(ack + 4, STA, 6);
+    memcpy(ack + 10, STA, 6);
+    CHECK(!filter.match(ack, 10, -50, 1));
+    
+    CaptureFilter bssid;
+    CHECK(bssid.addMac("00:11:22:33:44:55", nullptr, CAPTURE_ADDR_BSSID));
+    makeFrame(frame, 0x08, DOT11_FC_TO_DS, AP, STA, BROADCAST);
+    CHECK(bssid.match(frame, 64, -50, 1));
+    makeFrame(frame, 0x08, DOT11_FC_FROM_DS, STA, AP, BROADCAST);
+    CHECK(bssid.match(frame, 64, -50, 1));
+    makeFrame(frame, 0x80, 0, BROADCAST, STA, AP);
+    CHECK(bssid.match(frame, 64, -50, 1));
+    
+    // Address 1 of a frame from the DS is the station, not the BSSID
+    makeFrame(frame, 0x08, DOT11_FC_FROM_DS, AP, STA, STA);
+    CHECK(!bssid.match(frame, 64, -50, 1));
+    
+    // Rules are alternatives; every one is tried
+    CHECK(bssid.addMac("02:aa:bb:cc:dd:ee", nullptr, CAPTURE_ADDR_ANY));
+    CHECK(bssid.match(frame, 64, -50, 1));
+    CHECK(bssid.addMac("00:00:00:00:00:01", nullptr, CAPTURE_ADDR_1));
+    CHECK(bssid.addMac("00:00:00:00:00:02", nullptr, CAPTURE_ADDR_1));
+    CHECK(!bssid.addMac("00:00:00:00:00:03", nullptr, CAPTURE_ADDR_1));
+}
+
+int main() {
+    testEmpty();
+    testRanges();
+    testFrames();
+    testMacs();
+    
+    printf(failures ? "%d failures\n" : "all passed\n", failures);
+    return failures ? 1 : 0;
+}
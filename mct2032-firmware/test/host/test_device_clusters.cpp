@@ -0,0 +1,200 @@
+/**
+ * Device cluster host tests
+ * Element signatures, rotation joins against overlap, and cluster eviction
+ */
+
+#include "DeviceClusters.h"
+#include "Dot11.h"
+#include <stdio.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    } \
+} while (0)
+
+#define FRAME_MAX       128
+
+// One probe request's contents; model picks the capability bytes
+struct Probe {
+    uint8_t model;
+    const char* ssid;
+    uint8_t channel;
+    uint8_t vendorExtra;        // Byte after the vendor OUI and type
+    bool swapOrder;             // HT capabilities before the rates
+    bool weak;                  // Rates only
+};
+
+static void addIE(uint8_t* frame, uint16_t* len, uint8_t id, const uint8_t* data, uint8_t n) {
+    frame[(*len)++] = id;
+    frame[(*len)++] = n;
+    memcpy(frame + *len, data, n);
+    *len += n;
+}
+
+// Probe request from the given address with room for the FCS; returns the length
+static uint16_t makeProbe(uint8_t* frame, const uint8_t* mac, const Probe& probe) {
+    memset(frame, 0, FRAME_MAX);
+    frame[0] = 0x40;
+    memset(frame + DOT11_ADDR_1, 0xFF, 6);
+    memcpy(frame + DOT11_ADDR_2, mac, 6);
+    memset(frame + DOT11_ADDR_3, 0xFF, 6);
+    
+    uint16_t len = DOT11_MGMT_HEADER;
+    const uint8_t rates[] = {0x02, 0x04, 0x0B, 0x16, probe.model};
+    const uint8_t ht[] = {0x2D, 0x01, probe.model, 0x00};
+    const uint8_t vendor[] = {0x00, 0x50, 0xF2, 0x08, probe.vendorExtra};
+    addIE(frame, &len, DOT11_IE_SSID, (const uint8_t*)probe.ssid, strlen(probe.ssid));
+    if (probe.swapOrder) {
+        addIE(frame, &len, 45, ht, sizeof(ht));
+        addIE(frame, &len, 1, rates, sizeof(rates));
+    } else {
+        addIE(frame, &len, 1, rates, sizeof(rates));
+        addIE(frame, &len, 45, ht, sizeof(ht));
+    }
+    if (!probe.weak) {
+        addIE(frame, &len, 3, &probe.channel, 1);
+        addIE(frame, &len, 221, vendor, sizeof(vendor));
+    } else {
+        len -= 2 + sizeof(ht);
+    }
+    return len + DOT11_FCS_LEN;
+}
+
+static uint32_t signatureOf(const Probe& probe, bool* strong = nullptr) {
+    uint8_t frame[FRAME_MAX];
+    const uint8_t mac[6] = {0x02, 0, 0, 0, 0, 1};
+    uint16_t len = makeProbe(frame, mac, probe);
+    uint32_t sig = 0;
+    bool ok = DeviceClusters::signature(frame, len, &sig);
+    if (strong) {
+        *strong = ok;
+    }
+    return sig;
+}
+
+static void randomMac(uint8_t* mac, uint16_t id) {
+    const uint8_t base[6] = {0x02, 0x77, 0x00, 0x00, 0x00, 0x00};
+    memcpy(mac, base, 6);
+    mac[4] = id >> 8;
+    mac[5] = id & 0xFF;
+}
+
+static void observe(DeviceClusters& devices, uint16_t id, uint8_t model, uint32_t now, uint16_t weight = 1) {
+    uint8_t frame[FRAME_MAX];
+    uint8_t mac[6];
+    randomMac(mac, id);
+    Probe probe = {model, "", 6, 0, false, false};
+    uint16_t len = makeProbe(frame, mac, probe);
+    devices.observe(frame, len, weight, now);
+}
+
+// SSID, channel and vendor payload are left out; element order and capabilities are not
+static void testSignature() {
+    printf("signature\n");
+    Probe base = {1, "home", 6, 0, false, false};
+    bool strong;
+    uint32_t sig = signatureOf(base, &strong);
+    CHECK(strong);
+    
+    Probe other = base;
+    other.ssid = "office";
+    other.channel = 11;
+    other.vendorExtra = 0x55;
+    CHECK(signatureOf(other) == sig);
+    
+    other = base;
+    other.model = 2;
+    CHECK(signatureOf(other) != sig);
+    other = base;
+    other.swapOrder = true;
+    CHECK(signatureOf(other) != sig);
+    
+    other = base;
+    other.weak = true;
+    signatureOf(other, &strong);
+    CHECK(!strong);
+}
+
+// A new address joins a quiet cluster of its model; overlapping or long-gone ones start another
+static void testRotation() {
+    printf("rotation\n");
+    DeviceClusters devices;
+    observe(devices, 1, 1, 0, 2);
+    observe(devices, 2, 1, 60000, 3);
+    observe(devices, 2, 1, 60100);
+    observe(devices, 3, 1, 60500);
+    observe(devices, 4, 2, 60600);
+    observe(devices, 5, 1, 60500 + DEVICE_ROTATION_MS);
+    
+    // A global address is one device, as is a randomized one with a weak signature
+    uint8_t frame[FRAME_MAX];
+    const uint8_t global[6] = {0x00, 0x11, 0x22, 0x33, 0x44, 0x55};
+    Probe probe = {1, "", 6, 0, false, false};
+    devices.observe(frame, makeProbe(frame, global, probe), 1, 60700);
+    uint8_t weakMac[6];
+    randomMac(weakMac, 6);
+    probe.weak = true;
+    devices.observe(frame, makeProbe(frame, weakMac, probe), 1, 60800);
+    
+    DeviceEstimate estimate;
+    devices.getEstimate(60500 + DEVICE_ROTATION_MS, &estimate);
+    CHECK(estimate.macs == 7);
+    CHECK(estimate.randomized == 6);
+    CHECK(estimate.devices == 6);
+    CHECK(estimate.activeMacs == 1);
+    CHECK(estimate.activeDevices == 1);
+    
+    devices.getEstimate(61000, &estimate);
+    CHECK(estimate.activeMacs == 6);
+    CHECK(estimate.activeDevices == 5);
+    
+    DeviceCluster clusters[DEVICE_REPORT_MAX];
+    uint8_t n = devices.getClusters(clusters, DEVICE_REPORT_MAX);
+    CHECK(n == 4);
+    CHECK(clusters[0].macs == 2 && clusters[0].probes == 2 + 3 + 1);
+    CHECK(clusters[0].firstSeen == 0 && clusters[0].lastSeen == 60100);
+    for (uint8_t i = 1; i < n; i++) {
+        CHECK(clusters[i].macs == 1);
+    }
+    CHECK(devices.getClusters(clusters, 1) == 1 && clusters[0].macs == 2);
+}
+
+// A full table replaces the stalest cluster, and its addresses start over
+static void testEviction() {
+    printf("eviction\n");
+    DeviceClusters devices;
+    for (uint16_t i = 0; i < DEVICE_CLUSTERS; i++) {
+        observe(devices, i, i, i * 10);
+    }
+    CHECK(devices.getClusterEvictions() == 0);
+    
+    observe(devices, 1000, 200, 5000);
+    CHECK(devices.getClusterEvictions() == 1);
+    
+    // Address 0's cluster went to model 200; heard again it counts as a new device
+    observe(devices, 0, 0, 6000);
+    DeviceEstimate estimate;
+    devices.getEstimate(6000, &estimate);
+    CHECK(estimate.macs == DEVICE_CLUSTERS + 1);
+    CHECK(estimate.devices == DEVICE_CLUSTERS + 2);
+    CHECK(devices.getClusterEvictions() == 2);
+    
+    devices.reset();
+    devices.getEstimate(6000, &estimate);
+    CHECK(estimate.macs == 0 && estimate.devices == 0 && estimate.activeMacs == 0);
+    CHECK(devices.getClusters(nullptr, 0) == 0);
+}
+
+int main() {
+    testSignature();
+    testRotation();
+    testEviction();
+    
+    printf(failures ? "%d failures\n" : "all passed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,148 @@
+/**
+ * Distinct counter host tests
+ * HyperLogLog estimates and merges, and the per-channel window ring
+ */
+
+#include "DistinctCounters.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    } \
+} while (0)
+
+// Within fraction of the true count, plus one for the smallest sets
+static bool near(uint32_t estimate, uint32_t truth, float fraction) {
+    float slack = truth * fraction + 1.0f;
+    return fabsf((float)estimate - (float)truth) <= slack;
+}
+
+static void addRange(uint8_t* registers, uint64_t from, uint64_t to) {
+    for (uint64_t key = from; key < to; key++) {
+        HyperLogLog::add(registers, HyperLogLog::hash(key));
+    }
+}
+
+// Three standard errors across small and large sets; repeats change nothing
+static void testEstimates() {
+    printf("estimates\n");
+    const uint32_t sizes[] = {1, 10, 100, 1000, 10000, 100000};
+    for (uint32_t n : sizes) {
+        uint8_t registers[HLL_REGISTERS];
+        memset(registers, 0, sizeof(registers));
+        addRange(registers, 0x020000000000ULL, 0x020000000000ULL + n);
+        uint32_t estimate = HyperLogLog::estimate(registers);
+        CHECK(near(estimate, n, n < 100 ? 0.05f : 0.2f));
+        
+        addRange(registers, 0x020000000000ULL, 0x020000000000ULL + n);
+        CHECK(HyperLogLog::estimate(registers) == estimate);
+    }
+    
+    uint8_t empty[HLL_REGISTERS];
+    memset(empty, 0, sizeof(empty));
+    CHECK(HyperLogLog::estimate(empty) == 0);
+}
+
+// A merged sketch estimates the union, overlap counted once
+static void testMerge() {
+    printf("merge\n");
+    uint8_t a[HLL_REGISTERS];
+    uint8_t b[HLL_REGISTERS];
+    uint8_t both[HLL_REGISTERS];
+    memset(a, 0, sizeof(a));
+    memset(b, 0, sizeof(b));
+    memset(both, 0, sizeof(both));
+    addRange(a, 0, 3000);
+    addRange(b, 2000, 5000);
+    addRange(both, 0, 5000);
+    
+    HyperLogLog::merge(a, b);
+    CHECK(memcmp(a, both, HLL_REGISTERS) == 0);
+    CHECK(near(HyperLogLog::estimate(a), 5000, 0.2f));
+}
+
+// Beacon (or probe request) from transmitter id in BSS bss
+static void makeFrame(uint8_t* frame, uint32_t id, uint32_t bss, bool probe = false) {
+    memset(frame, 0, 24);
+    frame[0] = probe ? 0x40 : 0x80;
+    memset(frame + 4, 0xFF, 6);
+    frame[10] = 0x02;
+    memcpy(frame + 12, &id, sizeof(id));
+    frame[16] = 0x02;
+    memcpy(frame + 18, &bss, sizeof(bss));
+    if (probe) {
+        memset(frame + 16, 0xFF, 6);
+    }
+}
+
+// Kinds, channel masks and the slices a span reaches back over
+static void testCounters() {
+    printf("counters\n");
+    // Static, so the sketches the counters never free stay reachable
+    static DistinctCounters counters;
+    CHECK(counters.begin());
+    CHECK(counters.getMaxSpanMs() == DISTINCT_MAX_WINDOWS * DISTINCT_WINDOW_MS);
+    
+    uint32_t start = millis();
+    uint8_t frame[24];
+    for (uint32_t id = 0; id < 500; id++) {
+        makeFrame(frame, id, id / 10);
+        counters.observe(frame, sizeof(frame), 1, start);
+    }
+    for (uint32_t id = 1000; id < 1040; id++) {
+        makeFrame(frame, id, 0, true);
+        counters.observe(frame, sizeof(frame), 1, start);
+    }
+    
+    // Out of range channels are ignored
+    makeFrame(frame, 9999, 9999);
+    counters.observe(frame, sizeof(frame), 0, start);
+    counters.observe(frame, sizeof(frame), DISTINCT_CHANNELS + 1, start);
+    
+    uint32_t later = start + DISTINCT_WINDOW_MS;
+    for (uint32_t id = 0; id < 300; id++) {
+        makeFrame(frame, id + 250, 0);
+        counters.observe(frame, sizeof(frame), 6, later);
+    }
+    
+    uint32_t counts[DISTINCT_KINDS];
+    uint16_t both = (1 << 1) | (1 << 6);
+    counters.count(both, counters.getMaxSpanMs(), later + 10, counts);
+    CHECK(near(counts[DISTINCT_TX], 590, 0.2f));
+    CHECK(near(counts[DISTINCT_PROBERS], 40, 0.05f));
+    CHECK(near(counts[DISTINCT_BSSIDS], 50, 0.05f));
+    
+    counters.count(1 << 6, counters.getMaxSpanMs(), later + 10, counts);
+    CHECK(near(counts[DISTINCT_TX], 300, 0.2f));
+    CHECK(counts[DISTINCT_PROBERS] == 0);
+    CHECK(near(counts[DISTINCT_BSSIDS], 1, 0.0f));
+    
+    // A span inside the newest slice leaves the older one out
+    uint32_t covered = counters.count(both, 1000, later + 2000, counts);
+    CHECK(covered == 2000);
+    CHECK(near(counts[DISTINCT_TX], 300, 0.2f));
+    CHECK(counts[DISTINCT_PROBERS] == 0);
+    
+    covered = counters.count(both, 3000, later + 2000, counts);
+    CHECK(covered >= DISTINCT_WINDOW_MS + 2000);
+    CHECK(near(counts[DISTINCT_TX], 590, 0.2f));
+    
+    counters.reset();
+    counters.count(both, counters.getMaxSpanMs(), later, counts);
+    CHECK(counts[DISTINCT_TX] == 0 && counts[DISTINCT_BSSIDS] == 0);
+}
+
+int main() {
+    testEstimates();
+    testMerge();
+    testCounters();
+    
+    printf(failures ? "%d failures\n" : "all passed\n", failures);
+    return failures ? 1 : 0;
+}
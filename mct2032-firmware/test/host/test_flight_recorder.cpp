@@ -0,0 +1,222 @@
+/**
+ * Flight recorder host tests
+ * Ring eviction, the pre-trigger trim and the drain to a capture file
+ *
+ * Built against the host shim headers and the POSIX Storage backend by
+ * scripts/run-host-tests.sh, with AddressSanitizer watching the ring copies.
+ */
+
+#include "FlightRecorder.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    } \
+} while (0)
+
+#define FRAME_LEN       100
+
+// A beacon-sized management frame carrying its index after the header
+static void makeFrame(uint8_t* frame, uint8_t fc, uint32_t index) {
+    memset(frame, 0, FRAME_LEN);
+    frame[0] = fc;
+    memset(frame + 4, 0xFF, 6);
+    const uint8_t source[6] = {0x02, 0x11, 0x22, 0x33, 0x44, 0x55};
+    memcpy(frame + 10, source, 6);
+    memcpy(frame + 16, source, 6);
+    memcpy(frame + 24, &index, sizeof(index));
+}
+
+static FlightConfig smallRing(uint8_t triggers, uint32_t preMs) {
+    FlightConfig cfg = FlightRecorder::defaultConfig();
+    cfg.ringBytes = FLIGHT_MIN_BYTES;
+    cfg.preMs = preMs;
+    cfg.postMs = 0;
+    cfg.triggers = triggers;
+    return cfg;
+}
+
+// Drains until the dump completes, or gives up after plenty of passes
+static bool drain(FlightRecorder& recorder) {
+    for (int i = 0; i < 1000; i++) {
+        if (recorder.service()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Armed, the ring keeps the newest frames and never holds more than it has room for
+static void testEviction(Storage& storage) {
+    printf("eviction\n");
+    FlightRecorder recorder;
+    CHECK(recorder.arm(smallRing(FLIGHT_TRIGGER_MANUAL, 1000), storage.openAppend("evict.pcap", true)));
+    
+    uint8_t frame[FRAME_LEN];
+    for (uint32_t i = 0; i < 1000; i++) {
+        makeFrame(frame, 0x80, i);
+        recorder.record(frame, FRAME_LEN, -60, 1000 + i * 10);
+        CHECK(recorder.getBufferedBytes() <= recorder.getCapacity());
+    }
+    
+    uint32_t perRecord = FLIGHT_RECORD_HEADER + FRAME_LEN;
+    CHECK(recorder.getState() == FLIGHT_STATE_ARMED);
+    CHECK(recorder.getFramesRecorded() == 1000);
+    CHECK(recorder.getFramesEvicted() > 0);
+    CHECK(recorder.getFramesDropped() == 0);
+    CHECK(recorder.getBufferedBytes() == (1000 - recorder.getFramesEvicted()) * perRecord);
+    CHECK(recorder.getCapacity() - recorder.getBufferedBytes() < 2 * perRecord);
+    
+    recorder.disarm();
+    CHECK(!recorder.isActive());
+}
+
+// The dump holds the pre-trigger window and the frames up to the window closing, in order
+static void testDump(Storage& storage) {
+    printf("dump\n");
+    // The timestamps are made up, so the post window is closed by hand
+    FlightRecorder recorder;
+    FlightConfig cfg = smallRing(FLIGHT_TRIGGER_RSSI, 500);
+    cfg.postMs = 0xFFFFFFFF;
+    CHECK(recorder.arm(cfg, storage.openAppend("dump.pcap", true)));
+    
+    uint8_t frame[FRAME_LEN];
+    const uint32_t fireAt = 600;
+    for (uint32_t i = 0; i <= fireAt + 3; i++) {
+        makeFrame(frame, 0x80, i);
+        recorder.record(frame, FRAME_LEN, i == fireAt ? -20 : -60, i * 10);
+        if (i == fireAt) {
+            CHECK(recorder.getState() == FLIGHT_STATE_TRIGGERED);
+            CHECK(recorder.getFiredBy() == FLIGHT_TRIGGER_RSSI);
+            CHECK(recorder.getTriggerTime() == fireAt * 10);
+            
+            // The full ring makes room for the post window once the worker trims it
+            CHECK(!recorder.service());
+        }
+    }
+    CHECK(recorder.getFramesDropped() == 0);
+    recorder.closeWindow();
+    
+    // Frames after the window closes stay out of the dump
+    makeFrame(frame, 0x80, 9999);
+    recorder.record(frame, FRAME_LEN, -60, 99990);
+    
+    CHECK(drain(recorder));
+    CHECK(recorder.getState() == FLIGHT_STATE_IDLE);
+    
+    storage.end();
+    storage.begin();
+    std::vector<uint8_t> dump(storage.fileSize("dump.pcap"));
+    CHECK(storage.readFile("dump.pcap", 0, dump.data(), dump.size()) == dump.size());
+    CHECK(dump.size() == recorder.getBytesDumped());
+    
+    // Records from fireAt * 10 - 500 ms onward: 50 before the trigger, it, and 3 after
+    uint32_t expected = fireAt - 50;
+    size_t offset = 0;
+    while (offset + FLIGHT_RECORD_HEADER <= dump.size()) {
+        uint32_t header[4];
+        memcpy(header, dump.data() + offset, sizeof(header));
+        CHECK(header[2] == FRAME_LEN && header[3] == FRAME_LEN);
+        CHECK(header[0] * 1000 + header[1] / 1000 == expected * 10);
+        
+        uint32_t index;
+        memcpy(&index, dump.data() + offset + FLIGHT_RECORD_HEADER + 24, sizeof(index));
+        CHECK(index == expected);
+        expected++;
+        offset += FLIGHT_RECORD_HEADER + header[2];
+    }
+    CHECK(offset == dump.size());
+    CHECK(expected == fireAt + 4);
+}
+
+// Once triggered nothing is evicted: new frames are dropped instead
+static void testFrozenAfterTrigger(Storage& storage) {
+    printf("frozen after trigger\n");
+    FlightRecorder recorder;
+    CHECK(recorder.arm(smallRing(FLIGHT_TRIGGER_MANUAL, 100000), storage.openAppend("frozen.pcap", true)));
+    
+    uint8_t frame[FRAME_LEN];
+    for (uint32_t i = 0; i < 50; i++) {
+        makeFrame(frame, 0x80, i);
+        recorder.record(frame, FRAME_LEN, -60, 200000 + i);
+    }
+    CHECK(recorder.trigger());
+    CHECK(!recorder.trigger());
+    
+    uint32_t evicted = recorder.getFramesEvicted();
+    for (uint32_t i = 50; i < 1000; i++) {
+        makeFrame(frame, 0x80, i);
+        recorder.record(frame, FRAME_LEN, -60, 200000 + i);
+    }
+    CHECK(recorder.getFramesEvicted() == evicted);
+    CHECK(recorder.getFramesDropped() > 0);
+    CHECK(recorder.getFramesRecorded() + recorder.getFramesDropped() == 1000);
+    
+    recorder.closeWindow();
+    CHECK(drain(recorder));
+}
+
+// A deauth burst fires only when enough arrive within the window
+static void testDeauthBurst(Storage& storage) {
+    printf("deauth burst\n");
+    FlightRecorder recorder;
+    FlightConfig cfg = smallRing(FLIGHT_TRIGGER_DEAUTH, 1000);
+    cfg.deauthCount = 10;
+    cfg.deauthWindowMs = 1000;
+    CHECK(recorder.arm(cfg, storage.openAppend("deauth.pcap", true)));
+    
+    // Spread out, the count starts over every window
+    uint8_t frame[FRAME_LEN];
+    for (uint32_t i = 0; i < 30; i++) {
+        makeFrame(frame, 0xC0, i);
+        recorder.record(frame, FRAME_LEN, -60, 10000 + i * 200);
+    }
+    CHECK(recorder.getState() == FLIGHT_STATE_ARMED);
+    
+    // Nine disassociations in quick succession aren't enough; the tenth is
+    for (uint32_t i = 0; i < 10; i++) {
+        makeFrame(frame, 0xA0, 100 + i);
+        recorder.record(frame, FRAME_LEN, -60, 30000 + i * 10);
+        CHECK(recorder.getState() == (i < 9 ? FLIGHT_STATE_ARMED : FLIGHT_STATE_TRIGGERED));
+    }
+    CHECK(recorder.getFiredBy() == FLIGHT_TRIGGER_DEAUTH);
+    
+    recorder.disarm();
+}
+
+int main() {
+    char root[] = "/tmp/mct2032-test-XXXXXX";
+    if (!mkdtemp(root)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    setenv("MCT_STORAGE_ROOT", root, 1);
+    
+    {
+        Storage storage;
+        if (!storage.begin()) {
+            printf("mount failed\n");
+            return 1;
+        }
+        testEviction(storage);
+        testDump(storage);
+        testFrozenAfterTrigger(storage);
+        testDeauthBurst(storage);
+    }
+    
+    char command[64];
+    snprintf(command, sizeof(command), "rm -rf %s", root);
+    if (system(command) != 0) {
+        printf("could not remove %s\n", root);
+    }
+    
+    printf(failures ? "%d failures\n" : "all passed\n", failures);
+    return failures ? 1 : 0;
+}
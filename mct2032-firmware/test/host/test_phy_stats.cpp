@@ -0,0 +1,201 @@
+/**
+ * PHY statistics host tests
+ * Bucketing from rx_ctrl, and the binary blob parsed back and CRC-checked
+ */
+
+#include "PhyStats.h"
+#include "Checksum.h"
+#include <stdio.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    } \
+} while (0)
+
+static wifi_pkt_rx_ctrl_t makeCtrl(uint8_t channel, int8_t rssi, int8_t noise, bool ht, uint8_t rate, bool wide = false) {
+    wifi_pkt_rx_ctrl_t ctrl;
+    memset(&ctrl, 0, sizeof(ctrl));
+    ctrl.channel = channel;
+    ctrl.rssi = rssi;
+    ctrl.noise_floor = noise;
+    ctrl.sig_mode = ht ? 1 : 0;
+    if (ht) {
+        ctrl.mcs = rate;
+    } else {
+        ctrl.rate = rate;
+    }
+    ctrl.cwb = wide;
+    return ctrl;
+}
+
+// Reads the blob the way the admin client does; false on any mismatch
+struct BlobReader {
+    const uint8_t* p;
+    const uint8_t* end;
+    
+    bool varint(uint32_t* value) {
+        *value = 0;
+        for (uint8_t shift = 0; shift < 35 && p < end; shift += 7) {
+            uint8_t byte = *p++;
+            *value |= (uint32_t)(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    bool counts(const uint32_t* expected, uint8_t n) {
+        for (uint8_t i = 0; i < n; i++) {
+            uint32_t value;
+            if (!varint(&value) || value != expected[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+};
+
+// Parses a blob and checks every channel in it against the live counters
+static bool roundTrip(const PhyStats& stats, const uint8_t* blob, size_t len, uint8_t* channelsOut) {
+    if (len < PHY_BLOB_HEADER + 4 || memcmp(blob, PHY_BLOB_MAGIC, 4) != 0) {
+        return false;
+    }
+    uint32_t crc;
+    memcpy(&crc, blob + len - 4, 4);
+    if (crc != crc32(blob, len - 4)) {
+        return false;
+    }
+    const uint8_t header[] = {PHY_BLOB_VERSION, 0, PHY_RSSI_BUCKETS, (uint8_t)(int8_t)PHY_RSSI_BASE, PHY_RSSI_STEP,
+                              PHY_NOISE_BUCKETS, (uint8_t)(int8_t)PHY_NOISE_BASE, PHY_NOISE_STEP, PHY_RATE_BUCKETS};
+    for (uint8_t i = 0; i < sizeof(header); i++) {
+        if (i != 1 && blob[4 + i] != header[i]) {
+            return false;
+        }
+    }
+    
+    BlobReader reader = {blob + PHY_BLOB_HEADER, blob + len - 4};
+    uint8_t count = blob[5];
+    for (uint8_t i = 0; i < count; i++) {
+        if (reader.p + 1 > reader.end) {
+            return false;
+        }
+        uint8_t n = *reader.p++;
+        channelsOut[i] = n;
+        const PhyChannel& ch = stats.getChannel(n);
+        uint32_t frames;
+        if (!reader.varint(&frames) || frames != ch.frames || reader.p + 2 > reader.end) {
+            return false;
+        }
+        int16_t snr = reader.p[0] | (reader.p[1] << 8);
+        reader.p += 2;
+        if (snr != (int16_t)ch.snrX16) {
+            return false;
+        }
+        if (!reader.counts(ch.rssi, PHY_RSSI_BUCKETS) || !reader.counts(ch.noise, PHY_NOISE_BUCKETS) ||
+            !reader.counts(ch.rate, PHY_RATE_BUCKETS) || !reader.counts(ch.bandwidth, PHY_BW_BUCKETS)) {
+            return false;
+        }
+    }
+    return reader.p == reader.end;
+}
+
+// Buckets clamp at both ends; rates and widths land in their slots
+static void testObserve() {
+    printf("observe\n");
+    PhyStats stats;
+    stats.observe(makeCtrl(6, -50, -95, false, 11));
+    stats.observe(makeCtrl(6, -120, -95, true, 7, true));
+    stats.observe(makeCtrl(6, 10, -95, true, 15));
+    stats.observe(makeCtrl(0, -50, -95, false, 0));
+    stats.observe(makeCtrl(15, -50, -95, false, 0));
+    
+    const PhyChannel& ch = stats.getChannel(6);
+    CHECK(ch.frames == 3);
+    CHECK(ch.rssi[10] == 1);
+    CHECK(ch.rssi[0] == 1);
+    CHECK(ch.rssi[PHY_RSSI_BUCKETS - 1] == 1);
+    CHECK(ch.noise[1] == 3);
+    CHECK(ch.rate[11] == 1);
+    CHECK(ch.rate[PHY_RATE_LEGACY + 7] == 1);
+    CHECK(ch.rate[PHY_RATE_LEGACY + 15] == 1);
+    CHECK(ch.bandwidth[0] == 2 && ch.bandwidth[1] == 1);
+    
+    // Seeded by the first frame at 45 dB
+    PhyStats one;
+    one.observe(makeCtrl(1, -50, -95, false, 0));
+    CHECK(one.getChannel(1).snrX16 == 45 * 16);
+}
+
+// Every counter and the CRC survive the trip; the mask picks channels
+static void testRoundTrip() {
+    printf("round trip\n");
+    CHECK(crc32("123456789", 9) == 0xCBF43926);
+    
+    PhyStats stats;
+    for (uint32_t i = 0; i < 5000; i++) {
+        uint8_t channel = i % 3 == 0 ? 1 : (i % 3 == 1 ? 6 : 11);
+        stats.observe(makeCtrl(channel, -100 + i % 90, -98 + i % 10, i % 2, i % 16, i % 7 == 0));
+    }
+    
+    uint8_t blob[PHY_BLOB_MAX];
+    uint8_t seen[PHY_CHANNELS];
+    size_t len = stats.serialize(blob, sizeof(blob), 0xFFFF);
+    CHECK(len > 0);
+    CHECK(blob[5] == 3);
+    CHECK(roundTrip(stats, blob, len, seen));
+    CHECK(seen[0] == 1 && seen[1] == 6 && seen[2] == 11);
+    
+    len = stats.serialize(blob, sizeof(blob), (1 << 6) | (1 << 2));
+    CHECK(blob[5] == 1);
+    CHECK(roundTrip(stats, blob, len, seen));
+    CHECK(seen[0] == 6);
+    
+    // A corrupted byte fails the CRC
+    blob[PHY_BLOB_HEADER + 3] ^= 0x01;
+    CHECK(!roundTrip(stats, blob, len, seen));
+    
+    len = stats.serialize(blob, sizeof(blob), 0);
+    CHECK(len == PHY_BLOB_HEADER + 4 && blob[5] == 0);
+    CHECK(roundTrip(stats, blob, len, seen));
+    
+    CHECK(stats.serialize(blob, PHY_BLOB_HEADER + 3, 0xFFFF) == 0);
+    CHECK(stats.serialize(blob, PHY_BLOB_HEADER + 20, 0xFFFF) == 0);
+}
+
+// Every channel with full-width counts still fits PHY_BLOB_MAX
+static void testWorstCase() {
+    printf("worst case\n");
+    static PhyStats stats;
+    for (uint8_t n = 1; n <= PHY_CHANNELS; n++) {
+        PhyChannel& ch = const_cast<PhyChannel&>(stats.getChannel(n));
+        ch.frames = 0xFFFFFFFF;
+        ch.snrX16 = -1;
+        memset(ch.rssi, 0xFF, sizeof(ch.rssi));
+        memset(ch.noise, 0xFF, sizeof(ch.noise));
+        memset(ch.rate, 0xFF, sizeof(ch.rate));
+        memset(ch.bandwidth, 0xFF, sizeof(ch.bandwidth));
+    }
+    
+    uint8_t blob[PHY_BLOB_MAX];
+    uint8_t seen[PHY_CHANNELS];
+    size_t len = stats.serialize(blob, sizeof(blob), 0xFFFF);
+    CHECK(len == PHY_BLOB_MAX);
+    CHECK(blob[5] == PHY_CHANNELS);
+    CHECK(roundTrip(stats, blob, len, seen));
+    CHECK(stats.serialize(blob, PHY_BLOB_MAX - 1, 0xFFFF) == 0);
+}
+
+int main() {
+    testObserve();
+    testRoundTrip();
+    testWorstCase();
+    
+    printf(failures ? "%d failures\n" : "all passed\n", failures);
+    return failures ? 1 : 0;
+}
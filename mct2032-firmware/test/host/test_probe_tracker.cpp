@@ -0,0 +1,174 @@
+/**
+ * Probe tracker host tests
+ * Interning, per-client sets and Bloom overflow, weights, and the worker's
+ * eviction and arena compaction
+ */
+
+#include "ProbeTracker.h"
+#include <stdio.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    } \
+} while (0)
+
+// Probe request from client id for ssid, with room for the FCS; returns the length
+static uint16_t makeProbe(uint8_t* frame, uint8_t client, const char* ssid) {
+    uint8_t ssidLen = strlen(ssid);
+    uint16_t len = DOT11_MGMT_HEADER + 2 + ssidLen + DOT11_FCS_LEN;
+    memset(frame, 0, len);
+    frame[0] = 0x40;
+    memset(frame + DOT11_ADDR_1, 0xFF, 6);
+    frame[DOT11_ADDR_2] = 0x02;
+    frame[DOT11_ADDR_2 + 5] = client;
+    memset(frame + DOT11_ADDR_3, 0xFF, 6);
+    frame[DOT11_MGMT_HEADER] = DOT11_IE_SSID;
+    frame[DOT11_MGMT_HEADER + 1] = ssidLen;
+    memcpy(frame + DOT11_MGMT_HEADER + 2, ssid, ssidLen);
+    return len;
+}
+
+static void probe(ProbeTracker& tracker, uint8_t client, const char* ssid, uint32_t now, uint16_t weight = 1) {
+    uint8_t frame[DOT11_MGMT_HEADER + 2 + DOT11_SSID_MAX + DOT11_FCS_LEN];
+    uint16_t len = makeProbe(frame, client, ssid);
+    tracker.observe(frame, len, weight, now);
+}
+
+// Distinct client pairs, weighted probe counts and wildcard probes
+static void testCounts() {
+    printf("counts\n");
+    ProbeTracker tracker;
+    probe(tracker, 1, "home", 100);
+    probe(tracker, 1, "home", 110, 4);
+    probe(tracker, 2, "home", 120);
+    probe(tracker, 1, "cafe", 130);
+    probe(tracker, 1, "", 140, 2);
+    
+    // A hidden SSID sent as zero bytes is a wildcard too, and group senders are ignored
+    uint8_t frame[64];
+    uint16_t len = makeProbe(frame, 3, "\x01\x01\x01");
+    memset(frame + DOT11_MGMT_HEADER + 2, 0, 3);
+    tracker.observe(frame, len, 1, 150);
+    len = makeProbe(frame, 4, "home");
+    frame[DOT11_ADDR_2] = 0x01;
+    tracker.observe(frame, len, 1, 160);
+    
+    CHECK(tracker.getProbeFrames() == 1 + 4 + 1 + 1 + 2 + 1);
+    CHECK(tracker.getWildcardFrames() == 3);
+    CHECK(tracker.getSsidCount() == 2);
+    CHECK(tracker.getClientCount() == 3);
+    
+    ProbeSsidReport ssids[PROBE_REPORT_MAX];
+    CHECK(tracker.getTopSsids(ssids, PROBE_REPORT_MAX) == 2);
+    CHECK(strcmp(ssids[0].ssid, "home") == 0);
+    CHECK(ssids[0].clients == 2 && ssids[0].probes == 6 && ssids[0].lastSeen == 120);
+    CHECK(strcmp(ssids[1].ssid, "cafe") == 0 && ssids[1].clients == 1);
+    CHECK(tracker.getTopSsids(ssids, 1) == 1);
+    
+    ProbeClientReport clients[PROBE_REPORT_MAX];
+    uint8_t n = tracker.getClients(clients, PROBE_REPORT_MAX, nullptr);
+    CHECK(n == 3);
+    CHECK(clients[0].mac[5] == 1);
+    CHECK(clients[0].probes == 8 && clients[0].wildcard == 2 && clients[0].ssidCount == 2);
+    CHECK(strcmp(clients[0].ssids[0], "home") == 0 && strcmp(clients[0].ssids[1], "cafe") == 0);
+    
+    uint8_t only[6] = {0x02, 0, 0, 0, 0, 2};
+    CHECK(tracker.getClients(clients, PROBE_REPORT_MAX, only) == 1);
+    CHECK(clients[0].mac[5] == 2 && clients[0].ssidCount == 1);
+    
+    tracker.reset();
+    CHECK(tracker.getSsidCount() == 0 && tracker.getClientCount() == 0 && tracker.getProbeFrames() == 0);
+}
+
+// Past the set, SSIDs go to the Bloom filter and are still counted once
+static void testOverflow() {
+    printf("overflow\n");
+    ProbeTracker tracker;
+    char name[16];
+    for (uint8_t i = 0; i < PROBE_CLIENT_SET + 3; i++) {
+        snprintf(name, sizeof(name), "net-%u", i);
+        probe(tracker, 1, name, i);
+        probe(tracker, 1, name, i);
+    }
+    
+    ProbeClientReport clients[1];
+    CHECK(tracker.getClients(clients, 1, nullptr) == 1);
+    CHECK(clients[0].ssidCount == PROBE_CLIENT_SET);
+    CHECK(clients[0].overflow == 3);
+    
+    ProbeSsidReport ssids[PROBE_REPORT_MAX];
+    uint8_t n = tracker.getTopSsids(ssids, PROBE_REPORT_MAX);
+    CHECK(n == PROBE_CLIENT_SET + 3);
+    for (uint8_t i = 0; i < n; i++) {
+        CHECK(ssids[i].clients == 1 && ssids[i].probes == 2);
+    }
+}
+
+// New SSIDs past the headroom are dropped until the worker evicts the stalest,
+// and every surviving name reads back intact after compaction
+static void testEviction() {
+    printf("eviction\n");
+    ProbeTracker tracker;
+    char name[DOT11_SSID_MAX + 1];
+    
+    // 30-byte names run the arena out before the ids
+    uint16_t fit = PROBE_ARENA_BYTES / 30;
+    for (uint16_t i = 0; i < fit + 5; i++) {
+        snprintf(name, sizeof(name), "%04u-padded-out-to-thirty-byte", i);
+        probe(tracker, i % 20, name, 1000 + i);
+    }
+    CHECK(tracker.getSsidCount() == fit);
+    CHECK(tracker.getSsidDrops() == 5);
+    
+    tracker.service();
+    CHECK(tracker.getSsidEvictions() > 0);
+    CHECK(tracker.getSsidCount() == fit - tracker.getSsidEvictions());
+    CHECK(PROBE_ARENA_BYTES - tracker.getSsidCount() * 30 >= PROBE_FREE_BYTES);
+    
+    // The stalest went first; the names left are the newest, intact
+    ProbeSsidReport ssids[PROBE_REPORT_MAX];
+    uint8_t n = tracker.getTopSsids(ssids, PROBE_REPORT_MAX);
+    for (uint8_t i = 0; i < n; i++) {
+        unsigned index;
+        CHECK(sscanf(ssids[i].ssid, "%04u-", &index) == 1);
+        CHECK(index >= tracker.getSsidEvictions() && index < fit);
+        CHECK(strlen(ssids[i].ssid) == 30);
+    }
+    
+    // No client still names an evicted SSID
+    ProbeClientReport clients[PROBE_REPORT_MAX];
+    n = tracker.getClients(clients, PROBE_REPORT_MAX, nullptr);
+    for (uint8_t i = 0; i < n; i++) {
+        for (uint8_t s = 0; s < clients[i].ssidCount; s++) {
+            unsigned index;
+            CHECK(sscanf(clients[i].ssids[s], "%04u-", &index) == 1);
+            CHECK(index >= tracker.getSsidEvictions());
+        }
+    }
+    
+    // The freed room takes new names, and a survivor is still found, not added again
+    uint8_t before = tracker.getSsidCount();
+    probe(tracker, 50, "fresh", 5000);
+    snprintf(name, sizeof(name), "%04u-padded-out-to-thirty-byte", fit - 1);
+    probe(tracker, 51, name, 5001);
+    CHECK(tracker.getSsidCount() == before + 1);
+    CHECK(tracker.getSsidDrops() == 5);
+    
+    uint8_t fresh[6] = {0x02, 0, 0, 0, 0, 50};
+    CHECK(tracker.getClients(clients, 1, fresh) == 1);
+    CHECK(clients[0].ssidCount == 1 && strcmp(clients[0].ssids[0], "fresh") == 0);
+}
+
+int main() {
+    testCounts();
+    testOverflow();
+    testEviction();
+    
+    printf(failures ? "%d failures\n" : "all passed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,99 @@
+/**
+ * Retry de-duplication host tests
+ * Retransmissions against the recent ring of each sequence space
+ */
+
+#include "RetryDedup.h"
+#include <stdio.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    } \
+} while (0)
+
+// 26 byte frame from transmitter tx; tid >= 0 makes it QoS data
+static void makeFrame(uint8_t* frame, uint8_t tx, uint16_t seq, bool retry, int tid = -1, uint8_t frag = 0) {
+    memset(frame, 0, 26);
+    frame[0] = tid >= 0 ? 0x88 : 0x80;
+    frame[1] = retry ? 0x08 : 0x00;
+    frame[10] = 0x02;
+    frame[15] = tx;
+    uint16_t seqCtl = ((seq & 0x0FFF) << 4) | (frag & 0x0F);
+    frame[22] = seqCtl & 0xFF;
+    frame[23] = seqCtl >> 8;
+    if (tid >= 0) {
+        frame[24] = tid;
+    }
+}
+
+static bool dup(RetryDedup& dedup, uint8_t tx, uint16_t seq, bool retry, int tid = -1, uint8_t frag = 0) {
+    uint8_t frame[26];
+    makeFrame(frame, tx, seq, retry, tid, frag);
+    return dedup.isDuplicate(frame, sizeof(frame), 0);
+}
+
+// Only a retry of a value already passed on is dropped
+static void testRetries() {
+    printf("retries\n");
+    RetryDedup dedup;
+    CHECK(!dup(dedup, 1, 100, false));
+    CHECK(dup(dedup, 1, 100, true));
+    CHECK(dup(dedup, 1, 100, true));
+    CHECK(!dup(dedup, 1, 100, false));
+    CHECK(!dup(dedup, 1, 101, true));
+    CHECK(dup(dedup, 1, 101, true));
+    CHECK(!dup(dedup, 1, 102, false, -1, 1));
+    CHECK(!dup(dedup, 1, 102, true, -1, 2));
+    CHECK(dedup.getDuplicates() == 3);
+    CHECK(dedup.getBytesSaved() == 3 * 26);
+    
+    dedup.reset();
+    CHECK(dedup.getDuplicates() == 0);
+    CHECK(!dup(dedup, 1, 100, true));
+}
+
+// The ring remembers the last few values; older ones pass as new
+static void testRing() {
+    printf("ring\n");
+    RetryDedup dedup;
+    for (uint16_t seq = 0; seq < DEDUP_RECENT + 1; seq++) {
+        CHECK(!dup(dedup, 1, seq, false));
+    }
+    CHECK(!dup(dedup, 1, 0, true));
+    CHECK(dup(dedup, 1, DEDUP_RECENT, true));
+    CHECK(dup(dedup, 1, 2, true));
+}
+
+// Transmitters and QoS TIDs keep separate rings; frames without a space pass
+static void testSpaces() {
+    printf("spaces\n");
+    RetryDedup dedup;
+    CHECK(!dup(dedup, 1, 50, false));
+    CHECK(!dup(dedup, 2, 50, true));
+    CHECK(!dup(dedup, 1, 60, false, 0));
+    CHECK(!dup(dedup, 1, 60, true, 5));
+    CHECK(dup(dedup, 1, 60, true, 0));
+    
+    uint8_t frame[26];
+    makeFrame(frame, 3, 0, true);
+    frame[10] = 0x01;
+    CHECK(!dedup.isDuplicate(frame, sizeof(frame), 0));
+    CHECK(!dedup.isDuplicate(frame, sizeof(frame), 0));
+    makeFrame(frame, 3, 0, true);
+    CHECK(!dedup.isDuplicate(frame, 23, 0));
+    CHECK(dedup.getDuplicates() == 1);
+}
+
+int main() {
+    testRetries();
+    testRing();
+    testSpaces();
+    
+    printf(failures ? "%d failures\n" : "all passed\n", failures);
+    return failures ? 1 : 0;
+}
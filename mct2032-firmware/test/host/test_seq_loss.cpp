@@ -0,0 +1,146 @@
+/**
+ * Sequence loss host tests
+ * Gap counting, retransmissions, reordering and resyncs on built frames
+ */
+
+#include "SeqLossTracker.h"
+#include <stdio.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    } \
+} while (0)
+
+// 26 byte frame from transmitter tx; tid >= 0 makes it QoS data
+static void makeFrame(uint8_t* frame, uint8_t tx, uint16_t seq, bool retry, int tid = -1) {
+    memset(frame, 0, 26);
+    frame[0] = tid >= 0 ? 0x88 : 0x80;
+    frame[1] = retry ? 0x08 : 0x00;
+    frame[10] = 0x02;
+    frame[15] = tx;
+    uint16_t seqCtl = (seq & 0x0FFF) << 4;
+    frame[22] = seqCtl & 0xFF;
+    frame[23] = seqCtl >> 8;
+    if (tid >= 0) {
+        frame[24] = tid;
+    }
+}
+
+static void feed(SeqLossTracker& tracker, uint8_t tx, uint16_t seq, uint32_t now,
+                 bool retry = false, int tid = -1, uint8_t channel = 6) {
+    uint8_t frame[26];
+    makeFrame(frame, tx, seq, retry, tid);
+    tracker.observe(frame, sizeof(frame), channel, now);
+}
+
+// A step of k counts k-1 lost, across the modulo wrap too
+static void testGaps() {
+    printf("gaps\n");
+    SeqLossTracker tracker;
+    feed(tracker, 1, 4090, 0);
+    feed(tracker, 1, 4091, 1);
+    feed(tracker, 1, 4094, 2);
+    feed(tracker, 1, 2, 3);
+    CHECK(tracker.getReceived() == 4);
+    CHECK(tracker.getLost() == 2 + 3);
+    CHECK(tracker.getChannel(6).lost == 5);
+    CHECK(tracker.getResyncs() == 0);
+    CHECK(SeqLossTracker::lossPermille(tracker.getReceived(), tracker.getLost()) == 555);
+}
+
+// Repeats and late frames never count as loss or as new frames
+static void testRetries() {
+    printf("retries\n");
+    SeqLossTracker tracker;
+    feed(tracker, 1, 100, 0);
+    feed(tracker, 1, 100, 1, true);
+    feed(tracker, 1, 100, 2);
+    feed(tracker, 1, 101, 3);
+    feed(tracker, 1, 99, 4, true);
+    feed(tracker, 1, 98, 5);
+    CHECK(tracker.getReceived() == 2);
+    CHECK(tracker.getLost() == 0);
+    CHECK(tracker.getRetries() == 3);
+    CHECK(tracker.getReordered() == 1);
+    
+    // A fragment after the first repeats its number and is skipped
+    uint8_t frame[26];
+    makeFrame(frame, 1, 102, false);
+    frame[22] |= 0x01;
+    tracker.observe(frame, sizeof(frame), 6, 6);
+    CHECK(tracker.getReceived() == 2);
+}
+
+// Large jumps, channel changes, epochs and silence start over rather than count
+static void testResync() {
+    printf("resync\n");
+    SeqLossTracker tracker;
+    feed(tracker, 1, 0, 0);
+    feed(tracker, 1, 1000, 1);
+    CHECK(tracker.getLost() == 0);
+    CHECK(tracker.getResyncs() == 1);
+    
+    feed(tracker, 1, 1010, 2, false, -1, 11);
+    CHECK(tracker.getLost() == 0);
+    CHECK(tracker.getResyncs() == 2);
+    
+    tracker.newEpoch();
+    feed(tracker, 1, 1020, 3, false, -1, 11);
+    CHECK(tracker.getLost() == 0);
+    CHECK(tracker.getResyncs() == 3);
+    
+    feed(tracker, 1, 1030, 3 + SEQ_LOSS_IDLE_MS);
+    CHECK(tracker.getLost() == 0);
+    CHECK(tracker.getResyncs() == 4);
+    CHECK(tracker.getReceived() == 5);
+}
+
+// QoS TIDs number separately; control frames, nulls and group senders have no space
+static void testSpaces() {
+    printf("spaces\n");
+    SeqLossTracker tracker;
+    feed(tracker, 1, 10, 0, false, 0);
+    feed(tracker, 1, 500, 1, false, 5);
+    feed(tracker, 1, 12, 2, false, 0);
+    feed(tracker, 1, 510, 3, false, 5);
+    CHECK(tracker.getTracked() == 2);
+    CHECK(tracker.getLost() == 1 + 9);
+    
+    SeqLossReport worst[SEQ_LOSS_WORST];
+    feed(tracker, 2, 0, 4);
+    feed(tracker, 2, 4, 5);
+    uint8_t n = tracker.getWorst(worst, SEQ_LOSS_WORST);
+    CHECK(n == 3);
+    CHECK(worst[0].tid == 5 && worst[0].lost == 9);
+    CHECK(worst[1].tid == -1 && worst[1].lost == 3 && worst[1].mac[5] == 2);
+    CHECK(worst[2].tid == 0 && worst[2].lost == 1);
+    CHECK(tracker.getWorst(worst, 1) == 1 && worst[0].lost == 9);
+    
+    uint8_t frame[26];
+    uint64_t key;
+    makeFrame(frame, 3, 0, false);
+    frame[0] = 0xD4;
+    CHECK(!SeqLossTracker::spaceKey(frame, sizeof(frame), &key));
+    makeFrame(frame, 3, 0, false);
+    frame[0] = 0xC8;
+    CHECK(!SeqLossTracker::spaceKey(frame, sizeof(frame), &key));
+    makeFrame(frame, 3, 0, false);
+    frame[10] = 0x01;
+    CHECK(!SeqLossTracker::spaceKey(frame, sizeof(frame), &key));
+    CHECK(!SeqLossTracker::spaceKey(frame, 23, &key));
+}
+
+int main() {
+    testGaps();
+    testRetries();
+    testResync();
+    testSpaces();
+    
+    printf(failures ? "%d failures\n" : "all passed\n", failures);
+    return failures ? 1 : 0;
+}
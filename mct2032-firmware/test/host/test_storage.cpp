@@ -0,0 +1,240 @@
+/**
+ * Storage host tests
+ * Write-behind streams against the POSIX backend in a scratch directory
+ *
+ * Built and run by scripts/run-host-tests.sh with AddressSanitizer, so a
+ * leaked block pool or a use after close fails the run as well.
+ */
+
+#include "Storage.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    } \
+} while (0)
+
+static void fill(std::vector<uint8_t>& data, uint32_t seed) {
+    for (size_t i = 0; i < data.size(); i++) {
+        seed = seed * 1103515245 + 12345;
+        data[i] = seed >> 16;
+    }
+}
+
+static std::vector<uint8_t> readAll(Storage& storage, const char* path) {
+    std::vector<uint8_t> data(storage.fileSize(path));
+    size_t n = storage.readFile(path, 0, data.data(), data.size());
+    data.resize(n);
+    return data;
+}
+
+// Records of every size around the block boundary come back in order and intact
+static void testRoundTrip(Storage& storage) {
+    printf("round trip\n");
+    StorageStream* stream = storage.openAppend("roundtrip.bin", true);
+    CHECK(stream != nullptr);
+    if (!stream) {
+        return;
+    }
+    
+    std::vector<uint8_t> expected;
+    const size_t sizes[] = {1, 17, 511, 512, 4095, 4096, 4097, 9000, 12};
+    for (int round = 0; round < 20; round++) {
+        for (size_t size : sizes) {
+            std::vector<uint8_t> body(size);
+            fill(body, round * 31 + size);
+            uint32_t head = size;
+            CHECK(stream->writeRecord(&head, sizeof(head), body.data(), body.size(), STORAGE_WAIT_FOREVER));
+            expected.insert(expected.end(), (uint8_t*)&head, (uint8_t*)&head + sizeof(head));
+            expected.insert(expected.end(), body.begin(), body.end());
+        }
+    }
+    CHECK(stream->getBytesQueued() == expected.size());
+    CHECK(stream->getBytesDropped() == 0);
+    stream->close();
+    
+    // Close queues behind the data, so the file is complete once the task drains
+    storage.end();
+    storage.begin();
+    std::vector<uint8_t> actual = readAll(storage, "roundtrip.bin");
+    CHECK(actual.size() == expected.size());
+    CHECK(actual == expected);
+    
+    uint8_t middle[8];
+    CHECK(storage.readFile("roundtrip.bin", 5000, middle, sizeof(middle)) == sizeof(middle));
+    CHECK(memcmp(middle, expected.data() + 5000, sizeof(middle)) == 0);
+}
+
+// A record larger than the whole block pool is refused at once, even with no deadline
+static void testOversized(Storage& storage) {
+    printf("oversized record\n");
+    StorageStream* stream = storage.openAppend("oversized.bin", true);
+    CHECK(stream != nullptr);
+    if (!stream) {
+        return;
+    }
+    
+    std::vector<uint8_t> big(STORAGE_BLOCK_SIZE * STORAGE_BLOCK_COUNT + 1);
+    CHECK(!stream->write(big.data(), big.size(), STORAGE_WAIT_FOREVER));
+    CHECK(stream->getBytesDropped() == big.size());
+    
+    // The stream is still usable afterwards
+    uint8_t small[100] = {1, 2, 3};
+    CHECK(stream->write(small, sizeof(small), STORAGE_WAIT_FOREVER));
+    stream->close();
+    
+    storage.end();
+    storage.begin();
+    CHECK(storage.fileSize("oversized.bin") == sizeof(small));
+}
+
+// Blocks held by other open streams can't come free, so the wait is skipped
+static void testHeldBlocks(Storage& storage) {
+    printf("held blocks\n");
+    StorageStream* streams[STORAGE_MAX_STREAMS];
+    char path[32];
+    for (int i = 0; i < STORAGE_MAX_STREAMS; i++) {
+        snprintf(path, sizeof(path), "held%d.bin", i);
+        streams[i] = storage.openAppend(path, true);
+        CHECK(streams[i] != nullptr);
+        if (!streams[i]) {
+            return;
+        }
+        uint8_t byte = i;
+        CHECK(streams[i]->write(&byte, 1));
+    }
+    
+    // Every stream holds a part-filled block, leaving two for the rest
+    std::vector<uint8_t> record(STORAGE_BLOCK_SIZE * 3);
+    CHECK(!streams[0]->write(record.data(), record.size(), STORAGE_WAIT_FOREVER));
+    
+    // Two fresh blocks plus the rest of the current one do fit
+    record.resize(STORAGE_BLOCK_SIZE * 2);
+    CHECK(streams[0]->write(record.data(), record.size(), STORAGE_WAIT_FOREVER));
+    
+    for (int i = 0; i < STORAGE_MAX_STREAMS; i++) {
+        streams[i]->close();
+    }
+    
+    storage.end();
+    storage.begin();
+    CHECK(storage.getOpenStreamCount() == 0);
+    CHECK(storage.fileSize("held0.bin") == 1 + STORAGE_BLOCK_SIZE * 2);
+    CHECK(storage.fileSize("held1.bin") == 1);
+}
+
+// The I/O task syncs behind the data, so poll for it rather than closing
+static bool waitForSize(Storage& storage, const char* path, uint32_t size) {
+    for (int i = 0; i < 1000; i++) {
+        if (storage.fileSize(path) == size) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+}
+
+// Synced data is in the file while the stream stays open
+static void testSync(Storage& storage) {
+    printf("sync\n");
+    StorageStream* log = storage.openAppend("sync.log", true);
+    StorageStream* index = storage.openAppend("sync.idx", true);
+    CHECK(log != nullptr && index != nullptr);
+    if (!log || !index) {
+        return;
+    }
+    
+    uint8_t record[100] = {0};
+    CHECK(log->write(record, sizeof(record)));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    CHECK(storage.fileSize("sync.log") == 0);      // Still in a RAM block
+    
+    log->sync();
+    CHECK(waitForSize(storage, "sync.log", sizeof(record)));
+    
+    // With nothing buffered the sync travels as an empty marker block
+    log->sync();
+    CHECK(log->write(record, sizeof(record)));
+    log->sync();
+    CHECK(waitForSize(storage, "sync.log", sizeof(record) * 2));
+    
+    // Log sync, index write, index sync: the index never gets ahead of the log
+    CHECK(log->write(record, sizeof(record)));
+    log->sync();
+    uint32_t offset = sizeof(record) * 3;
+    CHECK(index->write(&offset, sizeof(offset)));
+    index->sync();
+    CHECK(waitForSize(storage, "sync.idx", sizeof(offset)));
+    CHECK(storage.fileSize("sync.log") >= offset);
+    
+    log->close();
+    index->close();
+}
+
+// Without a wait, a full pool drops whole records and never splits one
+static void testNoWaitDrops(Storage& storage) {
+    printf("no-wait drops\n");
+    StorageStream* stream = storage.openAppend("drops.bin", true);
+    CHECK(stream != nullptr);
+    if (!stream) {
+        return;
+    }
+    
+    std::vector<uint8_t> body(1500);
+    fill(body, 7);
+    uint32_t accepted = 0;
+    for (int i = 0; i < 20000; i++) {
+        uint32_t head = i;
+        if (stream->writeRecord(&head, sizeof(head), body.data(), body.size())) {
+            accepted++;
+        }
+    }
+    CHECK(stream->getBytesQueued() == accepted * (sizeof(uint32_t) + body.size()));
+    CHECK(stream->getBytesQueued() + stream->getBytesDropped() == 20000 * (sizeof(uint32_t) + body.size()));
+    stream->close();
+    
+    storage.end();
+    storage.begin();
+    CHECK(storage.fileSize("drops.bin") == accepted * (sizeof(uint32_t) + body.size()));
+    printf("  %lu of 20000 records accepted\n", (unsigned long)accepted);
+}
+
+int main() {
+    char root[] = "/tmp/mct2032-test-XXXXXX";
+    if (!mkdtemp(root)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    setenv("MCT_STORAGE_ROOT", root, 1);
+    
+    {
+        Storage storage;
+        if (!storage.begin()) {
+            printf("mount failed\n");
+            return 1;
+        }
+        testRoundTrip(storage);
+        testOversized(storage);
+        testHeldBlocks(storage);
+        testSync(storage);
+        testNoWaitDrops(storage);
+    }
+    
+    char command[64];
+    snprintf(command, sizeof(command), "rm -rf %s", root);
+    if (system(command) != 0) {
+        printf("could not remove %s\n", root);
+    }
+    
+    printf(failures ? "%d failures\n" : "all passed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,181 @@
+/**
+ * Top talkers host tests
+ * Space-Saving bounds against exact counts, ranking order and the window
+ */
+
+#include "TopTalkers.h"
+#include <stdio.h>
+#include <string.h>
+#include <map>
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    } \
+} while (0)
+
+// Beacon from transmitter id in BSS id / 4, padded to len
+static void makeFrame(uint8_t* frame, uint16_t id, uint16_t len) {
+    memset(frame, 0, len);
+    frame[0] = 0x80;
+    memset(frame + 4, 0xFF, 6);
+    frame[10] = 0x02;
+    frame[14] = id >> 8;
+    frame[15] = id & 0xFF;
+    frame[16] = 0x02;
+    frame[20] = (id / 4) >> 8;
+    frame[21] = (id / 4) & 0xFF;
+}
+
+static uint32_t idOf(const uint8_t* mac) {
+    return (mac[4] << 8) | mac[5];
+}
+
+static uint32_t rng = 12345;
+
+static uint32_t nextRandom() {
+    rng = rng * 1103515245 + 12345;
+    return rng >> 8;
+}
+
+// Skewed over many more addresses than counters: a few heavy, a long tail
+static uint16_t pickTalker() {
+    uint32_t r = nextRandom() % 100;
+    if (r < 40) {
+        return r % 5;
+    }
+    return 5 + nextRandom() % 500;
+}
+
+// Every reported count brackets the true one, largest first, heavy hitters found
+static void testBounds() {
+    printf("bounds\n");
+    TopTalkers talkers;
+    uint32_t start = millis();
+    std::map<uint32_t, uint32_t> frames, bytes, bssFrames;
+    uint32_t totalBytes = 0;
+    
+    uint8_t frame[200];
+    const uint32_t count = 40000;
+    for (uint32_t i = 0; i < count; i++) {
+        uint16_t id = pickTalker();
+        uint16_t len = 40 + nextRandom() % 160;
+        makeFrame(frame, id, len);
+        talkers.observe(frame, len, 1, start + i);
+        frames[id]++;
+        bytes[id] += len;
+        bssFrames[id / 4]++;
+        totalBytes += len;
+    }
+    
+    uint32_t now = start + count;
+    TalkerResult results[TALKER_MAX_RESULTS];
+    uint32_t windowMs;
+    uint32_t total;
+    
+    struct Case { uint8_t kind; uint8_t by; std::map<uint32_t, uint32_t>* truth; uint32_t total; };
+    Case cases[] = {
+        {TALKER_KIND_TX, TALKER_BY_FRAMES, &frames, count},
+        {TALKER_KIND_TX, TALKER_BY_BYTES, &bytes, totalBytes},
+        {TALKER_KIND_BSSID, TALKER_BY_FRAMES, &bssFrames, count},
+    };
+    for (const Case& c : cases) {
+        uint8_t n = talkers.query(c.kind, c.by, results, 10, now, &windowMs, &total);
+        CHECK(n == 10);
+        CHECK(total == c.total);
+        CHECK(windowMs >= count && windowMs < count + 100);
+        for (uint8_t i = 0; i < n; i++) {
+            uint32_t truth = (*c.truth)[idOf(results[i].mac)];
+            CHECK(results[i].count - results[i].error <= truth);
+            CHECK(truth <= results[i].count);
+            if (i > 0) {
+                CHECK(results[i - 1].count >= results[i].count);
+            }
+        }
+    }
+    
+    // The five heavy transmitters lead the frame ranking
+    uint8_t n = talkers.query(TALKER_KIND_TX, TALKER_BY_FRAMES, results, 5, now, &windowMs, &total);
+    CHECK(n == 5);
+    bool found[5] = {false};
+    for (uint8_t i = 0; i < n; i++) {
+        uint32_t id = idOf(results[i].mac);
+        if (id < 5) {
+            found[id] = true;
+        }
+    }
+    for (uint8_t id = 0; id < 5; id++) {
+        CHECK(found[id]);
+    }
+    
+    CHECK(talkers.query(TALKER_KIND_TX, TALKER_BY_FRAMES, results, 255, now, &windowMs, &total) == TALKER_MAX_RESULTS);
+}
+
+// Exact while the addresses fit; weights scale frames and bytes
+static void testExact() {
+    printf("exact\n");
+    TopTalkers talkers;
+    uint32_t now = millis();
+    uint8_t frame[100];
+    for (uint16_t id = 0; id < 10; id++) {
+        makeFrame(frame, id, 100);
+        for (uint16_t i = 0; i <= id; i++) {
+            talkers.observe(frame, 100, 3, now);
+        }
+    }
+    
+    // Group transmitters are never counted
+    makeFrame(frame, 99, 100);
+    frame[10] = 0x01;
+    talkers.observe(frame, 100, 1, now);
+    
+    TalkerResult results[TALKER_MAX_RESULTS];
+    uint32_t windowMs;
+    uint32_t total;
+    uint8_t n = talkers.query(TALKER_KIND_TX, TALKER_BY_FRAMES, results, TALKER_MAX_RESULTS, now, &windowMs, &total);
+    CHECK(n == 10);
+    CHECK(total == 3 * 55);
+    for (uint8_t i = 0; i < n; i++) {
+        CHECK(idOf(results[i].mac) == 9u - i);
+        CHECK(results[i].count == 3u * (10 - i));
+        CHECK(results[i].error == 0);
+    }
+    
+    n = talkers.query(TALKER_KIND_TX, TALKER_BY_BYTES, results, 1, now, &windowMs, &total);
+    CHECK(n == 1 && results[0].count == 3 * 10 * 100);
+}
+
+// Sub-windows older than the full span drop out of queries
+static void testWindow() {
+    printf("window\n");
+    TopTalkers talkers;
+    uint32_t now = millis();
+    uint8_t frame[100];
+    makeFrame(frame, 1, 100);
+    talkers.observe(frame, 100, 1, now);
+    makeFrame(frame, 2, 100);
+    talkers.observe(frame, 100, 1, now + TALKER_SLOT_MS);
+    
+    TalkerResult results[TALKER_MAX_RESULTS];
+    uint32_t windowMs;
+    uint32_t total;
+    uint32_t later = now + TALKER_SLOTS * TALKER_SLOT_MS - 1;
+    CHECK(talkers.query(TALKER_KIND_TX, TALKER_BY_FRAMES, results, 5, later, &windowMs, &total) == 2);
+    CHECK(total == 2);
+    
+    later = now + TALKER_SLOTS * TALKER_SLOT_MS;
+    CHECK(talkers.query(TALKER_KIND_TX, TALKER_BY_FRAMES, results, 5, later, &windowMs, &total) == 1);
+    CHECK(total == 1 && idOf(results[0].mac) == 2);
+}
+
+int main() {
+    testBounds();
+    testExact();
+    testWindow();
+    
+    printf(failures ? "%d failures\n" : "all passed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,184 @@
+/**
+ * Traffic graph host tests
+ * Direction and access category accounting, ranking, roams and PS-Poll edges
+ */
+
+#include "TrafficGraph.h"
+#include "Dot11.h"
+#include <stdio.h>
+#include <string.h>
+
+static int failures = 0;
+
+#define CHECK(cond) do { \
+    if (!(cond)) { \
+        printf("  FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond); \
+        failures++; \
+    } \
+} while (0)
+
+static void stationMac(uint8_t* mac, uint8_t id) {
+    const uint8_t base[6] = {0x02, 0xAA, 0x00, 0x00, 0x00, 0x00};
+    memcpy(mac, base, 6);
+    mac[5] = id;
+}
+
+static void apMac(uint8_t* mac, uint8_t id) {
+    const uint8_t base[6] = {0x00, 0x11, 0x22, 0x00, 0x00, 0x00};
+    memcpy(mac, base, 6);
+    mac[5] = id;
+}
+
+// Data frame between station sta and AP ap carrying body bytes; tid >= 0 makes it QoS
+static uint16_t makeData(uint8_t* frame, bool uplink, uint8_t sta, uint8_t ap, uint16_t body, int tid = -1) {
+    uint16_t header = tid >= 0 ? 26 : 24;
+    uint16_t len = header + body + DOT11_FCS_LEN;
+    memset(frame, 0, len);
+    frame[0] = tid >= 0 ? 0x88 : 0x08;
+    frame[1] = uplink ? DOT11_FC_TO_DS : DOT11_FC_FROM_DS;
+    if (uplink) {
+        apMac(frame + DOT11_ADDR_1, ap);
+        stationMac(frame + DOT11_ADDR_2, sta);
+    } else {
+        stationMac(frame + DOT11_ADDR_1, sta);
+        apMac(frame + DOT11_ADDR_2, ap);
+    }
+    apMac(frame + DOT11_ADDR_3, ap);
+    if (tid >= 0) {
+        frame[24] = tid;
+    }
+    return len;
+}
+
+static void send(TrafficGraph& graph, bool uplink, uint8_t sta, uint8_t ap, uint16_t body,
+                 int tid = -1, uint16_t weight = 1) {
+    uint8_t frame[1600];
+    uint16_t len = makeData(frame, uplink, sta, ap, body, tid);
+    graph.observeData(frame, len, weight, 1000);
+}
+
+// Directions, bodies past the header and FCS, weights and access categories
+static void testAccounting() {
+    printf("accounting\n");
+    TrafficGraph graph;
+    send(graph, true, 1, 1, 100);
+    send(graph, false, 1, 1, 1000, 6, 2);
+    send(graph, true, 1, 1, 50, 1);
+    send(graph, false, 1, 1, 10, 4);
+    
+    // Group-addressed downlink counts for the AP but makes no station
+    uint8_t frame[100];
+    uint16_t len = makeData(frame, false, 0, 1, 20);
+    memset(frame + DOT11_ADDR_1, 0xFF, 6);
+    graph.observeData(frame, len, 1, 1000);
+    
+    TrafficGraphReport report;
+    graph.getGraph(&report, 8, nullptr);
+    CHECK(report.stationCount == 1 && report.bssCount == 1);
+    CHECK(report.dataFrames == 6);
+    CHECK(report.apCount == 1 && report.edgeCount == 1);
+    
+    const BssTrafficReport& ap = report.aps[0];
+    CHECK(ap.stations == 1);
+    CHECK(ap.framesUp == 2 && ap.bytesUp == 150);
+    CHECK(ap.framesDown == 4 && ap.bytesDown == 2000 + 10 + 20);
+    CHECK(ap.acFrames[0] == 1);         // BK
+    CHECK(ap.acFrames[1] == 2);         // BE, non-QoS
+    CHECK(ap.acFrames[2] == 1);         // VI
+    CHECK(ap.acFrames[3] == 2);         // VO, weighted
+    
+    const EdgeTrafficReport& edge = report.edges[0];
+    uint8_t mac[6];
+    stationMac(mac, 1);
+    CHECK(memcmp(edge.station, mac, 6) == 0);
+    apMac(mac, 1);
+    CHECK(memcmp(edge.bssid, mac, 6) == 0);
+    CHECK(edge.framesUp == 2 && edge.bytesUp == 150);
+    CHECK(edge.framesDown == 3 && edge.bytesDown == 2010);
+    CHECK(edge.tidMask == ((1 << 6) | (1 << 1) | (1 << 4)));
+    CHECK(edge.roams == 0);
+}
+
+// APs and edges come busiest first, cut to k, or only those of one AP
+static void testRanking() {
+    printf("ranking\n");
+    TrafficGraph graph;
+    for (uint8_t sta = 1; sta <= 6; sta++) {
+        uint8_t ap = sta <= 3 ? 1 : (sta <= 5 ? 2 : 3);
+        send(graph, true, sta, ap, sta == 6 ? 700 : sta * 100);
+    }
+    
+    TrafficGraphReport report;
+    graph.getGraph(&report, 8, nullptr);
+    CHECK(report.apCount == 3 && report.edgeCount == 6);
+    CHECK(report.aps[0].bssid[5] == 2 && report.aps[0].stations == 2);       // 900 bytes
+    CHECK(report.aps[1].bssid[5] == 3 && report.aps[1].stations == 1);       // 700
+    CHECK(report.aps[2].bssid[5] == 1 && report.aps[2].stations == 3);       // 600
+    for (uint8_t i = 0; i < report.edgeCount; i++) {
+        CHECK(report.edges[i].station[5] == 6 - i);
+    }
+    
+    graph.getGraph(&report, 2, nullptr);
+    CHECK(report.apCount == 2 && report.edgeCount == 2);
+    CHECK(report.aps[0].bssid[5] == 2);
+    CHECK(report.edges[0].station[5] == 6 && report.edges[1].station[5] == 5);
+    CHECK(report.stationCount == 6 && report.bssCount == 3);
+    
+    uint8_t only[6];
+    apMac(only, 1);
+    graph.getGraph(&report, 8, only);
+    CHECK(report.apCount == 1 && report.aps[0].stations == 3);
+    CHECK(report.edgeCount == 3);
+    CHECK(report.edges[0].station[5] == 3 && report.edges[2].station[5] == 1);
+    
+    graph.getGraph(&report, 255, nullptr);
+    CHECK(report.edgeCount == 6);
+}
+
+// A station using another AP is a roam; PS-Poll links dozing stations; WDS has no edges
+static void testRoamsAndPolls() {
+    printf("roams and polls\n");
+    TrafficGraph graph;
+    send(graph, true, 1, 1, 100);
+    send(graph, true, 1, 2, 100);
+    send(graph, false, 1, 2, 100);
+    
+    uint8_t poll[20];
+    memset(poll, 0, sizeof(poll));
+    poll[0] = 0xA4;
+    apMac(poll + DOT11_ADDR_1, 3);
+    stationMac(poll + DOT11_ADDR_2, 9);
+    graph.observePsPoll(poll, 20, 2000);
+    graph.observePsPoll(poll, 15, 2000);
+    
+    uint8_t wds[100];
+    uint16_t len = makeData(wds, true, 1, 1, 20);
+    wds[1] = DOT11_FC_TO_DS | DOT11_FC_FROM_DS;
+    graph.observeData(wds, len + 6, 1, 2000);
+    
+    TrafficGraphReport report;
+    graph.getGraph(&report, 8, nullptr);
+    CHECK(report.stationCount == 2);
+    CHECK(graph.getWdsFrames() == 1);
+    CHECK(report.dataFrames == 4);
+    CHECK(report.edges[0].station[5] == 1 && report.edges[0].bssid[5] == 2 && report.edges[0].roams == 1);
+    CHECK(report.edges[1].station[5] == 9 && report.edges[1].bssid[5] == 3);
+    CHECK(report.edges[1].framesUp == 0 && report.edges[1].lastSeen == 2000);
+    
+    // The AP a station left keeps its traffic but not the station
+    for (uint8_t i = 0; i < report.apCount; i++) {
+        CHECK(report.aps[i].stations == (report.aps[i].bssid[5] == 2 ? 1 : 0));
+    }
+    
+    graph.reset();
+    CHECK(graph.getStationCount() == 0 && graph.getBssCount() == 0 && graph.getDataFrames() == 0);
+}
+
+int main() {
+    testAccounting();
+    testRanking();
+    testRoamsAndPolls();
+    
+    printf(failures ? "%d failures\n" : "all passed\n", failures);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,337 @@
+#!/usr/bin/env python3
+"""
+Compile the IEEE OUI registry into the firmware's flash vendor table
+
+Reads the MA-L registry CSV (https://standards-oui.ieee.org/oui/oui.csv)
+and writes mct2032-firmware/include/OuiData.h for src/OuiTable.cpp. The
+header is generated, not checked in; without it the firmware builds with
+an empty table.
+
+Layout, see include/OuiTable.h:
+  OUI_DATA_INDEX    first entry per OUI first byte, 257 x u16
+  OUI_DATA_LOW      low 16 bits of each OUI, sorted, N x u16
+  OUI_DATA_VENDOR   vendor id of each OUI, N x u16
+  OUI_DATA_BUCKETS  offset of every 16th name, u32
+  OUI_DATA_NAMES    sorted vendor names, front-coded
+
+Usage:
+  scripts/build-oui-table.py [--registry oui.csv] [--download] [--bench]
+
+Also runs as a PlatformIO pre-build script, where it regenerates the
+header when scripts/oui.csv is newer than it and stays quiet otherwise.
+"""
+
+import argparse
+import csv
+import os
+import random
+import re
+import subprocess
+import sys
+import tempfile
+import time
+import unicodedata
+import urllib.request
+from pathlib import Path
+
+REGISTRY_URL = "https://standards-oui.ieee.org/oui/oui.csv"
+NAME_BUCKET = 16        # OUI_NAME_BUCKET
+NAME_MAX = 31           # OUI_NAME_MAX less the terminator
+DEFAULT_NAME_LEN = 24
+
+# Corporate suffixes dropped from vendor names, repeatedly, from the end
+SUFFIX = re.compile(
+    r"[\s,.]*\b(inc|incorporated|corp|corporation|co|company|ltd|limited|llc|"
+    r"gmbh|ag|s\.?a|b\.?v|ab|oy|plc|pty|srl|s\.?p\.?a|k\.?k|technologies|"
+    r"technology|electronics|communications?)\b\.?$",
+    re.IGNORECASE,
+)
+
+def project_paths(root):
+    firmware = root / "mct2032-firmware"
+    return {
+        "registry": root / "scripts" / "oui.csv",
+        "output": firmware / "include" / "OuiData.h",
+        "source": firmware / "src" / "OuiTable.cpp",
+        "include": firmware / "include",
+    }
+
+def clean_name(name, max_len):
+    """Short ASCII vendor name, without the corporate suffixes"""
+    text = unicodedata.normalize("NFKD", name).encode("ascii", "ignore").decode()
+    text = " ".join(text.split())
+    while True:
+        shorter = SUFFIX.sub("", text).strip(" ,.-")
+        if shorter == text or not shorter:
+            break
+        text = shorter
+    return text[:max_len].rstrip(" ,.-") or "?"
+
+def read_registry(path, max_len):
+    """{oui: name} from an IEEE registry CSV"""
+    entries = {}
+    with open(path, newline="", encoding="utf-8", errors="replace") as f:
+        for row in csv.DictReader(f):
+            assignment = (row.get("Assignment") or "").strip()
+            if row.get("Registry", "MA-L") != "MA-L" or len(assignment) != 6:
+                continue
+            try:
+                oui = int(assignment, 16)
+            except ValueError:
+                continue
+            entries[oui] = clean_name(row.get("Organization Name", ""), max_len)
+    return entries
+
+def front_code(names):
+    """Bucket offsets and the front-coded name bytes"""
+    buckets = []
+    data = bytearray()
+    previous = b""
+    for i, name in enumerate(names):
+        raw = name.encode("ascii")
+        if i % NAME_BUCKET == 0:
+            buckets.append(len(data))
+            data.append(len(raw))
+            data += raw
+        else:
+            prefix = 0
+            while prefix < min(len(raw), len(previous)) and raw[prefix] == previous[prefix]:
+                prefix += 1
+            data.append(prefix)
+            data.append(len(raw) - prefix)
+            data += raw[prefix:]
+        previous = raw
+    return buckets, bytes(data)
+
+def build_table(entries):
+    names = sorted(set(entries.values()))
+    if len(entries) >= 0xFFFF or len(names) >= 0xFFFF:
+        raise SystemExit("Registry too large for 16-bit ids")
+    vendor_id = {name: i for i, name in enumerate(names)}
+    
+    ouis = sorted(entries)
+    index = [0] * 257
+    for oui in ouis:
+        index[(oui >> 16) + 1] += 1
+    for i in range(256):
+        index[i + 1] += index[i]
+    
+    buckets, name_data = front_code(names)
+    return {
+        "index": index,
+        "low": [oui & 0xFFFF for oui in ouis],
+        "vendor": [vendor_id[entries[oui]] for oui in ouis],
+        "buckets": buckets or [0],
+        "names": name_data or b"\0",
+        "count": len(ouis),
+        "vendors": len(names),
+    }
+
+def footprint(table):
+    sizes = {
+        "index": 2 * len(table["index"]),
+        "low": 2 * len(table["low"] or [0]),
+        "vendor": 2 * len(table["vendor"] or [0]),
+        "buckets": 4 * len(table["buckets"]),
+        "names": len(table["names"]),
+    }
+    sizes["total"] = sum(sizes.values())
+    return sizes
+
+def c_array(ctype, name, values, per_line=12, fmt="0x{:04X}"):
+    lines = [f"static const {ctype} {name}[{len(values)}] = {{"]
+    for i in range(0, len(values), per_line):
+        chunk = ", ".join(fmt.format(v) for v in values[i:i + per_line])
+        lines.append(f"    {chunk},")
+    lines.append("};")
+    return "\n".join(lines)
+
+def write_header(table, path, source):
+    low = table["low"] or [0]
+    vendor = table["vendor"] or [0]
+    text = "\n\n".join([
+        "/**\n"
+        f" * Generated by scripts/build-oui-table.py from {source.name}; do not edit\n"
+        " */",
+        f"#define OUI_DATA_COUNT      {table['count']}\n"
+        f"#define OUI_DATA_VENDORS    {table['vendors']}",
+        c_array("uint16_t", "OUI_DATA_INDEX", table["index"]),
+        c_array("uint16_t", "OUI_DATA_LOW", low),
+        c_array("uint16_t", "OUI_DATA_VENDOR", vendor),
+        c_array("uint32_t", "OUI_DATA_BUCKETS", table["buckets"], 8, "0x{:06X}"),
+        c_array("uint8_t", "OUI_DATA_NAMES", list(table["names"]), 16, "0x{:02X}"),
+    ]) + "\n"
+    path.write_text(text)
+
+BENCH_SOURCE = r"""
+#include "OuiTable.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#define SAMPLES 4096
+
+// bench <rounds> <samples: "oui expected" lines> <names out>
+int main(int argc, char** argv) {
+    const int rounds = atoi(argv[1]);
+    static uint32_t ouis[SAMPLES];
+    static unsigned expected[SAMPLES];
+    FILE* in = fopen(argv[2], "r");
+    for (int i = 0; i < SAMPLES; i++) {
+        if (fscanf(in, "%x %u", &ouis[i], &expected[i]) != 2) {
+            return 1;
+        }
+    }
+    fclose(in);
+    
+    uint32_t wrong = 0;
+    for (int i = 0; i < SAMPLES; i++) {
+        wrong += OuiTable::lookup(ouis[i]) != expected[i];
+    }
+    
+    uint32_t hits = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds; r++) {
+        for (uint32_t oui : ouis) {
+            hits += OuiTable::lookup(oui) != OUI_UNKNOWN;
+        }
+    }
+    double lookupSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    
+    char name[OUI_NAME_MAX];
+    uint32_t named = 0;
+    uint16_t vendors = OuiTable::getVendorCount();
+    start = std::chrono::steady_clock::now();
+    for (int r = 0; r < rounds && vendors; r++) {
+        for (uint32_t i = 0; i < SAMPLES; i++) {
+            named += OuiTable::name(i * 7919u % vendors, name, sizeof(name));
+        }
+    }
+    double nameSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    
+    FILE* out = fopen(argv[3], "w");
+    for (uint16_t i = 0; i < vendors; i++) {
+        OuiTable::name(i, name, sizeof(name));
+        fprintf(out, "%s\n", name);
+    }
+    fclose(out);
+    
+    double total = (double)SAMPLES * rounds;
+    printf("%.0f %.0f %u %u\n", total / lookupSec, nameSec > 0 ? named / nameSec : 0, wrong, hits);
+    return 0;
+}
+"""
+
+def run_bench(paths, entries, rounds):
+    """Host lookups/sec of src/OuiTable.cpp over the generated header, checked against the registry"""
+    compiler = os.environ.get("CXX", "c++")
+    names = sorted(set(entries.values()))
+    vendor_id = {name: i for i, name in enumerate(names)}
+    
+    # Half listed OUIs, half random universally administered ones
+    rng = random.Random(2032)
+    listed = sorted(entries)
+    samples = []
+    for i in range(4096):
+        if listed and i % 2 == 0:
+            oui = rng.choice(listed)
+        else:
+            oui = rng.getrandbits(24) & 0xFDFFFF
+        samples.append((oui, vendor_id[entries[oui]] if oui in entries else 0xFFFF))
+    
+    with tempfile.TemporaryDirectory() as tmp:
+        tmp = Path(tmp)
+        (tmp / "bench.cpp").write_text(BENCH_SOURCE)
+        (tmp / "samples.txt").write_text("".join(f"{oui:06X} {vid}\n" for oui, vid in samples))
+        try:
+            subprocess.run(
+                [compiler, "-O2", "-std=c++17", f"-I{paths['include']}",
+                 str(tmp / "bench.cpp"), str(paths["source"]), "-o", str(tmp / "bench")],
+                check=True,
+            )
+        except (OSError, subprocess.CalledProcessError) as e:
+            print(f"Benchmark skipped: could not build with {compiler} ({e})")
+            return False
+        result = subprocess.run(
+            [str(tmp / "bench"), str(rounds), str(tmp / "samples.txt"), str(tmp / "names.txt")],
+            capture_output=True, text=True, check=True,
+        )
+        lookups, name_rate, wrong, hits = result.stdout.split()
+        decoded = (tmp / "names.txt").read_text().splitlines()
+    
+    bad_names = sum(1 for a, b in zip(decoded, names) if a != b) + abs(len(decoded) - len(names))
+    hit_rate = int(hits) / (4096 * rounds) * 100
+    print(f"Host lookups/sec:    {float(lookups) / 1e6:.1f}M ({hit_rate:.0f}% listed OUIs)")
+    print(f"Host names/sec:      {float(name_rate) / 1e6:.1f}M")
+    print(f"Check:               {wrong} wrong lookups, {bad_names} wrong names")
+    return wrong == "0" and bad_names == 0
+
+def generate(paths, registry, name_len, quiet=False):
+    start = time.time()
+    entries = read_registry(registry, name_len)
+    table = build_table(entries)
+    write_header(table, paths["output"], registry)
+    if quiet:
+        return table, entries
+    
+    sizes = footprint(table)
+    print(f"Wrote {paths['output']} in {time.time() - start:.1f}s")
+    print(f"OUIs:                {table['count']}")
+    print(f"Vendors:             {table['vendors']} (names up to {name_len} chars)")
+    print("Flash footprint:")
+    for key in ("index", "low", "vendor", "buckets", "names"):
+        print(f"  {key:<18} {sizes[key]:>8} bytes")
+    print(f"  {'total':<18} {sizes['total']:>8} bytes ({sizes['total'] / 1024:.1f} KiB)")
+    if table["count"]:
+        print(f"  per OUI            {sizes['total'] / table['count']:>8.2f} bytes")
+    return table, entries
+
+def main():
+    root = Path(__file__).resolve().parent.parent
+    paths = project_paths(root)
+    
+    parser = argparse.ArgumentParser(description="Build the firmware OUI vendor table")
+    parser.add_argument("--registry", type=Path, default=paths["registry"],
+                        help="IEEE MA-L CSV (default: scripts/oui.csv)")
+    parser.add_argument("--download", action="store_true",
+                        help=f"fetch the registry from {REGISTRY_URL} first")
+    parser.add_argument("--name-len", type=int, default=DEFAULT_NAME_LEN,
+                        help=f"truncate vendor names (default: {DEFAULT_NAME_LEN}, max {NAME_MAX})")
+    parser.add_argument("--bench", action="store_true",
+                        help="build and time the lookup on this host")
+    parser.add_argument("--rounds", type=int, default=2000,
+                        help="benchmark rounds of 4096 lookups")
+    args = parser.parse_args()
+    
+    if not 1 <= args.name_len <= NAME_MAX:
+        parser.error(f"--name-len must be 1-{NAME_MAX}")
+    
+    if args.download:
+        print(f"Downloading {REGISTRY_URL}")
+        urllib.request.urlretrieve(REGISTRY_URL, args.registry)
+    
+    if not args.registry.exists():
+        print(f"Registry not found: {args.registry} (use --download or --registry)")
+        return 1
+    
+    _, entries = generate(paths, args.registry, args.name_len)
+    if args.bench and not run_bench(paths, entries, args.rounds):
+        return 1
+    return 0
+
+def platformio_hook(env):
+    """Pre-build step: regenerate when the registry is newer than the header"""
+    paths = project_paths(Path(env.subst("$PROJECT_DIR")).parent)
+    registry, output = paths["registry"], paths["output"]
+    if registry.exists() and (not output.exists() or output.stat().st_mtime < registry.stat().st_mtime):
+        table, _ = generate(paths, registry, DEFAULT_NAME_LEN, quiet=True)
+        print(f"OUI table: {table['count']} OUIs, {footprint(table)['total']} bytes")
+
+try:
+    Import  # noqa: F821 - only defined when PlatformIO runs this file
+except NameError:
+    if __name__ == "__main__":
+        sys.exit(main())
+else:
+    Import("env")  # noqa: F821
+    platformio_hook(env)  # noqa: F821
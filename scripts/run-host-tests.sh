@@ -0,0 +1,81 @@
+#!/bin/bash
+
+# MCT2032 Host Tests
+# Builds the firmware's host-compilable modules with g++ and runs their tests
+# under AddressSanitizer; --bench also builds the benchmarks optimised and runs them.
+# Analytics modules build against the stand-in Arduino, ESP-IDF and FreeRTOS
+# headers in test/host/shim.
+#
+#   scripts/run-host-tests.sh [--bench]
+
+SCRIPT_DIR="$( cd "$( dirname "${BASH_SOURCE[0]}" )" && pwd )"
+PROJECT_ROOT="$( cd "$SCRIPT_DIR/.." && pwd )"
+FIRMWARE="$PROJECT_ROOT/mct2032-firmware"
+BUILD_DIR="${BUILD_DIR:-/tmp/mct2032-host}"
+CXX="${CXX:-g++}"
+CXXFLAGS="-std=gnu++17 -Wall -Wextra -I$FIRMWARE/include -I$FIRMWARE/test/host/shim -pthread"
+
+mkdir -p "$BUILD_DIR"
+export MCT_STORAGE_ROOT="$BUILD_DIR/sdcard"
+
+FAILED=0
+
+# build <name> <flags> <sources...>
+build() {
+    local name="$1"
+    local flags="$2"
+    shift 2
+    $CXX $CXXFLAGS $flags "$@" -o "$BUILD_DIR/$name"
+}
+
+# check <name> <sources...>
+check() {
+    local name="$1"
+    shift
+    echo "== $name"
+    if ! build "$name" "-g -fsanitize=address,undefined -fno-sanitize-recover=undefined -fno-omit-frame-pointer" "$@"; then
+        echo "❌ $name failed to build"
+        FAILED=1
+        return
+    fi
+    if ! "$BUILD_DIR/$name"; then
+        echo "❌ $name failed"
+        FAILED=1
+    fi
+}
+
+# bench <name> <sources...>
+bench() {
+    local name="$1"
+    shift
+    echo "== $name"
+    if build "$name" "-O2 -DNDEBUG" "$@"; then
+        "$BUILD_DIR/$name"
+    else
+        FAILED=1
+    fi
+}
+
+check test_storage "$FIRMWARE/test/host/test_storage.cpp" "$FIRMWARE/src/Storage.cpp"
+check test_flight_recorder "$FIRMWARE/test/host/test_flight_recorder.cpp" "$FIRMWARE/src/FlightRecorder.cpp" "$FIRMWARE/src/Storage.cpp"
+check test_capture_filter "$FIRMWARE/test/host/test_capture_filter.cpp" "$FIRMWARE/src/CaptureFilter.cpp"
+check test_seq_loss "$FIRMWARE/test/host/test_seq_loss.cpp" "$FIRMWARE/src/SeqLossTracker.cpp"
+check test_retry_dedup "$FIRMWARE/test/host/test_retry_dedup.cpp" "$FIRMWARE/src/RetryDedup.cpp" "$FIRMWARE/src/SeqLossTracker.cpp"
+check test_top_talkers "$FIRMWARE/test/host/test_top_talkers.cpp" "$FIRMWARE/src/TopTalkers.cpp"
+check test_distinct "$FIRMWARE/test/host/test_distinct.cpp" "$FIRMWARE/src/HyperLogLog.cpp" "$FIRMWARE/src/DistinctCounters.cpp"
+check test_traffic_graph "$FIRMWARE/test/host/test_traffic_graph.cpp" "$FIRMWARE/src/TrafficGraph.cpp"
+check test_airtime "$FIRMWARE/test/host/test_airtime.cpp" "$FIRMWARE/src/AirtimeMeter.cpp"
+check test_phy_stats "$FIRMWARE/test/host/test_phy_stats.cpp" "$FIRMWARE/src/PhyStats.cpp"
+check test_probe_tracker "$FIRMWARE/test/host/test_probe_tracker.cpp" "$FIRMWARE/src/ProbeTracker.cpp"
+check test_device_clusters "$FIRMWARE/test/host/test_device_clusters.cpp" "$FIRMWARE/src/DeviceClusters.cpp"
+
+if [ "$1" == "--bench" ]; then
+    bench bench_storage "$FIRMWARE/test/host/bench_storage.cpp" "$FIRMWARE/src/Storage.cpp"
+    bench bench_dispatch "$FIRMWARE/test/host/bench_dispatch.cpp"
+fi
+
+if [ $FAILED -ne 0 ]; then
+    echo "❌ Host tests failed"
+    exit 1
+fi
+echo "✅ Host tests passed"